@@ -64,12 +64,28 @@ typedef struct {
     int32_t r_addend;
 } elf64_relocation_t;
 
+// Loadable (PT_LOAD) segment, still in the file until the runtime places it
+typedef struct {
+    uint64_t virtual_address;  // p_vaddr
+    uint64_t file_offset;      // p_offset
+    uint64_t file_size;        // p_filesz
+    uint64_t memory_size;      // p_memsz; the rest past file_size is zero (BSS)
+    bool writable;
+    bool executable;
+} knc_elf_segment_t;
+
+// Section inside a loadable segment, by guest virtual address
+typedef struct {
+    uint64_t address;  // sh_addr
+    uint64_t size;     // sh_size
+} knc_elf_section_t;
+
 // KNC Binary information
 typedef struct {
     std::string filename;
     uint64_t entry_point;
-    std::vector<uint8_t> text_section;
-    std::vector<uint8_t> data_section;
+    std::vector<knc_elf_segment_t> segments;
+    knc_elf_section_t text_section;  // .text; size 0 when the file has no section headers
     std::vector<elf64_symbol_t> symbols;
     std::vector<elf64_relocation_t> relocations;
     bool is_knc_binary;
@@ -78,6 +94,17 @@ typedef struct {
 class KNCBinaryLoader {
 private:
     knc_binary_info_t binary_info;
+    
+    // The whole file, mapped read-only (read into file_buffer where mmap is
+    // unavailable). Segments are not copied out of it; the runtime copies or
+    // maps them straight into guest memory.
+    const uint8_t* file_data;
+    uint64_t file_size;
+    int file_descriptor;
+    std::vector<uint8_t> file_buffer;
+    
+    bool map_file_image(const std::string& filename);
+    void unmap_file_image();
     bool validate_elf_header(const elf64_header_t* header);
     bool read_program_headers(FILE* file, const elf64_header_t* header);
     bool read_section_headers(FILE* file, const elf64_header_t* header);
@@ -94,12 +121,14 @@ public:
     
     // Get binary information
     const knc_binary_info_t& get_binary_info() const;
-    const uint8_t* get_binary_data() const;
-    uint64_t get_binary_size() const;
+    const uint8_t* get_file_data() const;
+    uint64_t get_file_size() const;
+    int get_file_descriptor() const;  // -1 when the file cannot be mapped into guest memory
     uint64_t get_entry_point() const;
     
     // Symbol resolution
     bool resolve_symbol(const std::string& name, uint64_t& address);
+    std::vector<uint64_t> get_function_addresses() const;  // Entry point, then every function symbol
     std::vector<std::string> get_symbol_names() const;
     
     // Relocation processing
@@ -0,0 +1,126 @@
+#ifndef KNC_GUEST_MEMORY_H
+#define KNC_GUEST_MEMORY_H
+
+#include <cstdint>
+#include <cstddef>
+#include <csetjmp>
+#include <vector>
+#include "knc_types.h"
+
+// Host page size backing guest memory
+typedef enum {
+    KNC_HUGE_PAGES_NONE = 0,   // Base host pages
+    KNC_HUGE_PAGES_THP = 1,    // Base mapping, transparent huge pages requested with madvise
+    KNC_HUGE_PAGES_2M = 2,     // hugetlbfs 2 MiB pages, falling back to THP
+    KNC_HUGE_PAGES_1G = 3      // hugetlbfs 1 GiB pages, falling back to 2 MiB, then THP
+} knc_huge_pages_t;
+
+const char* knc_huge_pages_name(knc_huge_pages_t pages);
+bool knc_parse_huge_pages(const char* name, knc_huge_pages_t& pages);
+
+// Where a guest fault resumes: arm with KNCGuestMemory::arm_fault_recovery,
+// then KNC_GUEST_FAULT_SETJMP returns nonzero when a fault lands there
+#ifdef _WIN32
+typedef jmp_buf knc_fault_jmp_buf_t;
+#define KNC_GUEST_FAULT_SETJMP(env) setjmp(env)
+#else
+typedef sigjmp_buf knc_fault_jmp_buf_t;
+#define KNC_GUEST_FAULT_SETJMP(env) sigsetjmp(env, 0)
+#endif
+
+// Host PC a fault at pc inside generated code should resume at, or 0
+typedef uintptr_t (*knc_fault_redirect_fn_t)(void* context, uintptr_t pc);
+
+// Host backing for emulated physical memory.
+//
+// Guest memory sits at the bottom of a reserved window covering the whole
+// guest physical address space (KNC_GUEST_ADDRESS_BITS). Pages are zero-filled
+// by the host on first touch, so a large guest costs only the pages the
+// program actually uses. The rest of the window is inaccessible: an
+// out-of-range guest access faults in hardware and is turned into
+// KNC_ERROR_MEMORY_ACCESS, so loads and stores need no range checks.
+class KNCGuestMemory {
+private:
+    uint8_t* base;
+    uint64_t size;
+    uint64_t huge_bytes;           // Leading part of guest memory mapped from hugetlbfs
+    uint8_t* reservation;          // Whole address window including guard regions
+    uint64_t reservation_size;
+    size_t host_page_size;
+    size_t backing_page_size;      // Page size of a hugetlbfs mapping, else host_page_size
+    knc_huge_pages_t backing;      // What was actually obtained
+    int window_slot;               // Registration with the fault handler, -1 when none
+    
+    // Ranges currently mapped from files instead of anonymous memory
+    typedef struct {
+        uint64_t offset;
+        uint64_t bytes;
+    } knc_file_range_t;
+    std::vector<knc_file_range_t> file_ranges;
+
+    static const size_t HUGE_PAGE_2M = 2ULL * 1024 * 1024;
+    static const size_t HUGE_PAGE_1G = 1024ULL * 1024 * 1024;
+    static const uint64_t GUARD_TAIL = 64 * 1024;  // Covers accesses that straddle the window end
+
+    bool reserve_window(size_t alignment);
+    bool map_hugetlb(uint64_t bytes, size_t page_size);
+    bool map_base_pages(uint64_t offset, uint64_t bytes, bool transparent_huge_pages);
+    uint64_t transparent_huge_bytes() const;
+
+public:
+    KNCGuestMemory();
+    ~KNCGuestMemory();
+
+    bool allocate(uint64_t bytes, knc_huge_pages_t pages = KNC_HUGE_PAGES_NONE);
+    void release();
+
+    uint8_t* data() const { return base; }
+    uint64_t get_size() const { return size; }
+    size_t get_page_size() const { return host_page_size; }
+    knc_huge_pages_t get_backing() const { return backing; }
+
+    // Host address of a guest physical address. Addresses past guest memory
+    // land in a guard region, but ones beyond the address window wrap around
+    uint8_t* host_address(uint64_t address) const { return base + (address & KNC_GUEST_ADDRESS_MASK); }
+
+    // Copies for callers outside guest execution; false if the range is not
+    // inside guest memory or faulted (a read-only file mapping)
+    bool read(uint64_t address, void* data, size_t bytes) const;
+    bool write(uint64_t address, const void* data, size_t bytes);
+    
+    // Map bytes of an open file read-only at address, sharing the host page
+    // cache instead of copying. The range is widened to whole host pages, so
+    // address and file_offset must agree modulo the host page size. False if
+    // the range cannot be file backed (hugetlbfs, Windows); copy it instead.
+    bool map_file(uint64_t address, int fd, uint64_t file_offset, uint64_t bytes);
+    
+    // Put every file-mapped range back to zero-filled anonymous memory
+    void discard_file_mappings();
+    uint64_t file_mapped_bytes() const;
+    
+    // Zero a range, returning whole base pages to the host
+    void zero(uint64_t address, uint64_t bytes);
+
+    // Generated code touching this memory (the JIT) registers where a fault
+    // inside it resumes; the handler is called from the signal handler
+    void set_fault_redirect(knc_fault_redirect_fn_t redirect, void* context);
+
+    // Faults on the calling host thread long-jump to the innermost armed
+    // recovery point. arm_fault_recovery returns the previously armed point,
+    // which disarm_fault_recovery restores.
+    static knc_fault_jmp_buf_t* arm_fault_recovery(knc_fault_jmp_buf_t* env);
+    static void disarm_fault_recovery(knc_fault_jmp_buf_t* previous);
+
+    // Host pages backing guest memory that have been touched so far
+    uint64_t resident_pages() const;
+    uint64_t resident_bytes() const;
+
+    // Huge pages currently backing guest memory (reserved hugetlbfs pages, or
+    // transparent huge pages the host kernel has assembled)
+    uint64_t huge_pages() const;
+
+    // Statistics
+    void print_statistics() const;
+};
+
+#endif // KNC_GUEST_MEMORY_H
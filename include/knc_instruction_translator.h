@@ -2,10 +2,13 @@
 #define KNC_INSTRUCTION_TRANSLATOR_H
 
 #include <vector>
+#include <array>
 #include <unordered_map>
 #include <cstdint>
 #include <string>
 #include <memory>
+#include <atomic>
+#include <mutex>
 
 // XED includes for KNC instruction translation
 #include <xed/xed-types.h>
@@ -14,50 +17,175 @@
 #include <xed/xed-iclass-enum.h>
 
 #include "knc_types.h"
+#include "knc_translation_store.h"
 
-// Translation context for instruction decoding
+// Translation context for instruction decoding. XED decodes into the
+// translator's scratch xed_decoded_inst_t; only what translation needs is kept.
 typedef struct {
-    xed_decoded_inst_t xedd;
+    const uint8_t* instruction_bytes;
+    xed_iclass_enum_t iclass;
     knc_instruction_type_t knc_type;
     uint32_t instruction_length;
-    uint8_t* instruction_bytes;
     bool is_vector_instruction;
     bool is_knc_specific;
     bool needs_translation;
 } knc_translation_context_t;
 
-// Translated instruction information
+// Translated instruction (micro-op): a fixed-size record with no heap
+// storage, so cache hits copy a few words. The description is interned in
+// the translator and looked up with get_description().
+#define KNC_MICRO_OP_MAX_BYTES 15
+
 typedef struct {
-    std::vector<uint8_t> translated_bytes;
-    uint32_t translated_length;
-    std::string description;
-    bool is_emulated;
-    uint32_t emulation_overhead_cycles;
-} knc_translated_instruction_t;
+    uint8_t bytes[KNC_MICRO_OP_MAX_BYTES];  // Host encoding, or the original bytes when emulated
+    uint8_t length;
+    uint16_t description;                   // Interned description index
+    uint8_t is_emulated;
+    uint8_t emulation_overhead_cycles;
+    uint8_t latency;                        // Result latency in core cycles
+} knc_micro_op_t;
+
+// Classification flags of an XED instruction class
+#define KNC_ICLASS_VECTOR        0x01  // Vector instruction, translated to AVX-512
+#define KNC_ICLASS_KNC_SPECIFIC  0x02  // KNC-only encoding
+#define KNC_ICLASS_KNL           0x04  // KNL-only instruction
 
 // Instruction translation cache
 typedef struct {
     uint64_t original_address;
-    uint8_t original_bytes[16];  // Max KNC instruction length
-    knc_translated_instruction_t translated;
+    knc_micro_op_t translated;
     uint32_t access_count;
+    bool referenced;             // CLOCK reference bit
     bool is_valid;
 } knc_translation_cache_entry_t;
 
+// Dispatch counts of addresses that have no translated block yet, kept the
+// way the instruction cache keeps access_count but updated without a lock
+typedef struct {
+    std::atomic<uint64_t> original_address;
+    std::atomic<uint32_t> access_count;
+} knc_hotness_entry_t;
+
+// Basic block of predecoded instructions, ending at the first control transfer.
+// Exit 0 is the taken/jump target, exit 1 the fall-through; each exit caches a
+// direct link to its successor block once that block has been translated.
+//
+// A superblock strings together blocks along the path their exits took most
+// often while interpreted. It starts where its first block does, and cores
+// entering that block run the superblock instead. Its inner branches stay in
+// the instruction list: wherever one goes off the recorded path, execution
+// leaves the superblock there (a side exit) and continues at the dispatcher.
+#define KNC_BLOCK_EXIT_TAKEN 0
+#define KNC_BLOCK_EXIT_FALLTHROUGH 1
+#define KNC_BLOCK_NUM_EXITS 2
+
+typedef struct knc_translated_block_s {
+    uint64_t start_address;
+    uint64_t end_address;  // One past the last instruction
+    uint64_t code_hash;    // knc_hash_bytes of the guest bytes it was decoded from
+    const uint8_t* code;   // Host address of those bytes
+    std::atomic<bool> check_code;  // Compare code_hash before each dispatch (code shares a page with data)
+    std::vector<knc_decoded_instruction_t> instructions;
+    uint64_t exit_targets[KNC_BLOCK_NUM_EXITS];  // ~0 when the exit is not static
+    std::atomic<struct knc_translated_block_s*> successors[KNC_BLOCK_NUM_EXITS];
+    std::atomic<bool> is_valid;  // Cleared when the guest code is invalidated
+    std::atomic<uint32_t> execution_count;
+    std::atomic<uint32_t> exit_counts[KNC_BLOCK_NUM_EXITS];  // Interpreted executions leaving through each exit
+    std::atomic<knc_jit_entry_t> jit_code;  // Set once the block has been compiled
+    
+    // Superblocks. A superblock lists the blocks it was formed from; a block
+    // points at the superblock formed from it and lists those containing it.
+    std::vector<struct knc_translated_block_s*> parts;
+    std::atomic<struct knc_translated_block_s*> superblock;
+    std::vector<struct knc_translated_block_s*> containing_superblocks;
+} knc_translated_block_t;
+
+// Binds a decoded operation to the executing engine's handler
+typedef knc_instruction_handler_t (*knc_handler_resolver_t)(knc_exec_op_t op);
+
 class KNCInstructionTranslator {
 private:
     // XED decoder state
     xed_state_t xed_state;
     xed_decoded_inst_t xedd;
     
-    // Translation cache
-    std::vector<knc_translation_cache_entry_t> translation_cache;
-    std::unordered_map<uint64_t, size_t> cache_index;
-    static const size_t CACHE_SIZE = 16384;  // 16K entries
+    // Both lookup caches are CACHE_WAYS-way set-associative with CLOCK
+    // replacement: a hit sets the way's reference bit, and a fill into a
+    // full set evicts the first way from the set's hand on whose bit is
+    // clear, clearing the bits it passes. Sets are picked by a
+    // multiplicative hash, so code laid out at power-of-two strides does
+    // not alias into a few sets.
+    static const uint32_t CACHE_WAYS = 8;
+    static const uint64_t EMPTY_TAG = ~0ULL;
+    uint32_t cache_set_bits;  // log2 of the number of sets
+    
+    // Instruction translation cache, for translate_instruction
+    std::vector<knc_translation_cache_entry_t> translation_cache;  // Set-major
+    std::vector<uint8_t> translation_cache_hands;
+    size_t translation_entries;  // Valid entries, so invalidating an empty cache costs nothing
+    uint64_t translation_evictions;
+    
+    // Basic blocks, keyed by guest start address. block_cache owns every
+    // translated block; blocks are only freed by flush_translation_cache.
+    std::unordered_map<uint64_t, std::unique_ptr<knc_translated_block_t>> block_cache;
+    std::vector<std::unique_ptr<knc_translated_block_t>> retired_blocks;
+    std::unordered_map<uint64_t, std::vector<knc_translated_block_t*>> page_blocks;  // By 4K guest page
+    std::vector<std::unique_ptr<knc_translated_block_t>> superblocks;  // Freed with the blocks
+    mutable std::mutex block_mutex;
+    
+    // Lookup cache in front of block_cache that cores probe without a lock.
+    // Ways are filled under block_mutex, tag last, so a reader that matches a
+    // tag and then finds a different block in the way has raced a refill and
+    // treats it as a miss.
+    struct alignas(64) knc_block_set_t {
+        std::atomic<uint64_t> tags[CACHE_WAYS];
+        std::atomic<knc_translated_block_t*> blocks[CACHE_WAYS];
+        std::atomic<uint8_t> referenced[CACHE_WAYS];
+        uint8_t hand;
+    };
+    std::unique_ptr<knc_block_set_t[]> block_sets;
+    knc_handler_resolver_t handler_resolver;
+    
+    // Direct-mapped, so an address that collides takes the entry over and
+    // starts counting again; counts only ever err on the cold side
+    static const uint32_t HOTNESS_BITS = 12;
+    static const size_t HOTNESS_ENTRIES = static_cast<size_t>(1) << HOTNESS_BITS;
+    std::unique_ptr<knc_hotness_entry_t[]> hotness;
+    static const size_t MAX_BLOCK_INSTRUCTIONS = 64;
+    static const size_t MAX_SUPERBLOCK_INSTRUCTIONS = 256;
+    static const uint32_t SUPERBLOCK_BIAS = 8;  // Follow an exit taken at least 7 times in 8
     
-    // Instruction mapping tables
-    std::unordered_map<xed_iclass_enum_t, knc_instruction_type_t> xed_to_knc_map;
-    std::unordered_map<knc_instruction_type_t, std::string> knc_instruction_names;
+    // Persistent translation cache for the loaded binary. Blocks found in
+    // the store are copied out instead of decoded; on close, the blocks
+    // translated this run are merged with the store and written back.
+    KNCTranslationStore persistent_store;
+    std::string persistent_path;
+    knc_translation_cache_key_t persistent_key;
+    std::vector<bool> persistent_rejected;  // Stored blocks whose guest bytes changed
+    bool persistent_dirty;
+    uint64_t persistent_blocks_loaded;
+    uint64_t persistent_blocks_rejected;
+    uint64_t persistent_blocks_saved;
+    
+    // What the translator knows about each XED instruction class, indexed
+    // by xed_iclass_enum_t. Built at compile time from the instruction table
+    // in build_iclass_table(); classes not listed there pass through.
+    typedef knc_micro_op_t (KNCInstructionTranslator::*knc_translate_handler_t)(const knc_translation_context_t& ctx);
+    typedef struct {
+        uint32_t knc_type;                 // knc_instruction_type_t, or the iclass itself when unlisted
+        knc_translate_handler_t translate; // Null: passed through, or emulated if a vector instruction
+        const char* name;
+        uint8_t flags;                     // KNC_ICLASS_*
+        uint8_t latency;
+    } knc_iclass_entry_t;
+    typedef std::array<knc_iclass_entry_t, XED_ICLASS_LAST> knc_iclass_table_t;
+    static const knc_iclass_table_t iclass_table;
+    static constexpr knc_iclass_table_t build_iclass_table();
+    static const knc_iclass_entry_t& get_iclass_entry(xed_iclass_enum_t iclass);
+    
+    // Interned micro-op descriptions; index 0 is the empty description
+    std::vector<std::string> descriptions;
+    std::unordered_map<std::string, uint16_t> description_ids;
     
     // Statistics
     uint64_t instructions_translated;
@@ -65,55 +193,77 @@ private:
     uint64_t cache_misses;
     uint64_t knc_specific_instructions;
     uint64_t vector_instructions;
+    uint64_t blocks_translated;
+    uint64_t blocks_pretranslated;
+    uint64_t block_misses;
+    uint64_t block_conflict_misses;  // Misses on blocks translated earlier and evicted
+    uint64_t block_evictions;
+    std::atomic<uint64_t> blocks_chained;
+    uint64_t superblocks_formed;
+    uint64_t superblock_parts;
+    uint64_t superblocks_retired;
     
     // Initialization
-    void initialize_instruction_maps();
     void setup_xed_decoder();
+    xed_error_enum_t xed_decode_bytes(const uint8_t* bytes, uint32_t length, xed_decoded_inst_t& xed_inst);
+    uint16_t intern_description(const std::string& description);
+    knc_micro_op_t make_micro_op(const std::string& description, bool is_emulated, uint8_t overhead_cycles);
     
     // Cache management
-    size_t get_cache_index(uint64_t address);
-    void add_to_cache(uint64_t address, const uint8_t* original_bytes, 
-                    const knc_translated_instruction_t& translated);
-    bool lookup_in_cache(uint64_t address, knc_translated_instruction_t& translated);
+    size_t get_cache_set(uint64_t address) const;
+    void allocate_caches(size_t entries);
+    void insert_block(knc_translated_block_t* block);
+    void evict_block(const knc_translated_block_t* block);
+    void add_block(knc_translated_block_t* block);
+    void retire_block(knc_translated_block_t* block);
+    void retire_superblock(knc_translated_block_t* superblock);
+    int hot_exit(const knc_translated_block_t* block) const;
+    void add_to_cache(uint64_t address, const knc_micro_op_t& translated);
+    bool lookup_in_cache(uint64_t address, knc_micro_op_t& translated);
     void invalidate_cache_entry(uint64_t address);
+    knc_translated_block_t* new_block(uint64_t start_address);
+    knc_translated_block_t* form_block(uint64_t start_address, const uint8_t* block_bytes, size_t block_size);
+    knc_translated_block_t* load_cached_block(uint64_t start_address, const uint8_t* block_bytes, size_t block_size);
+    void set_block_exits(knc_translated_block_t* block);
     
     // Instruction translation functions
-    knc_translated_instruction_t translate_vector_instruction(const knc_translation_context_t& ctx);
-    knc_translated_instruction_t translate_scalar_instruction(const knc_translation_context_t& ctx);
-    knc_translated_instruction_t translate_memory_instruction(const knc_translation_context_t& ctx);
-    knc_translated_instruction_t translate_control_instruction(const knc_translation_context_t& ctx);
+    knc_micro_op_t translate_vector_instruction(const knc_translation_context_t& ctx);
+    knc_micro_op_t translate_scalar_instruction(const knc_translation_context_t& ctx);
+    knc_micro_op_t translate_memory_instruction(const knc_translation_context_t& ctx);
+    knc_micro_op_t translate_control_instruction(const knc_translation_context_t& ctx);
     
     // KNC-specific instruction translations
-    knc_translated_instruction_t translate_vpaddd(const knc_translation_context_t& ctx);
-    knc_translated_instruction_t translate_vpsubd(const knc_translation_context_t& ctx);
-    knc_translated_instruction_t translate_vpmulud(const knc_translation_context_t& ctx);
-    knc_translated_instruction_t translate_vpermd(const knc_translation_context_t& ctx);
-    knc_translated_instruction_t translate_vpbroadcastd(const knc_translation_context_t& ctx);
-    knc_translated_instruction_t translate_vgatherdps(const knc_translation_context_t& ctx);
-    knc_translated_instruction_t translate_vscatterdps(const knc_translation_context_t& ctx);
-    knc_translated_instruction_t translate_vcmpps(const knc_translation_context_t& ctx);
-    knc_translated_instruction_t translate_vmaxps(const knc_translation_context_t& ctx);
-    knc_translated_instruction_t translate_vminps(const knc_translation_context_t& ctx);
-    
-    // Vector operation helpers
-    std::vector<uint8_t> generate_avx512_vector_op(const knc_translation_context_t& ctx, 
-                                                  const std::string& avx512_mnemonic);
-    std::vector<uint8_t> generate_vector_broadcast(const knc_translation_context_t& ctx);
-    std::vector<uint8_t> generate_vector_gather(const knc_translation_context_t& ctx);
-    std::vector<uint8_t> generate_vector_scatter(const knc_translation_context_t& ctx);
-    std::vector<uint8_t> generate_vector_permute(const knc_translation_context_t& ctx);
+    knc_micro_op_t translate_vpaddd(const knc_translation_context_t& ctx);
+    knc_micro_op_t translate_vpsubd(const knc_translation_context_t& ctx);
+    knc_micro_op_t translate_vpmulud(const knc_translation_context_t& ctx);
+    knc_micro_op_t translate_vpermd(const knc_translation_context_t& ctx);
+    knc_micro_op_t translate_vpbroadcastd(const knc_translation_context_t& ctx);
+    knc_micro_op_t translate_vgatherdps(const knc_translation_context_t& ctx);
+    knc_micro_op_t translate_vscatterdps(const knc_translation_context_t& ctx);
+    knc_micro_op_t translate_vcmpps(const knc_translation_context_t& ctx);
+    knc_micro_op_t translate_vmaxps(const knc_translation_context_t& ctx);
+    knc_micro_op_t translate_vminps(const knc_translation_context_t& ctx);
+    
+    // KNL AVX-512F/CD/ER/PF instructions
+    knc_micro_op_t translate_knl_instruction(const knc_translation_context_t& ctx);
+    
+    // Vector operation helpers - append the host encoding to op
+    void generate_avx512_vector_op(const knc_translation_context_t& ctx, const std::string& avx512_mnemonic,
+                                   knc_micro_op_t& op);
+    void generate_vector_broadcast(const knc_translation_context_t& ctx, knc_micro_op_t& op);
+    void generate_vector_gather(const knc_translation_context_t& ctx, knc_micro_op_t& op);
+    void generate_vector_scatter(const knc_translation_context_t& ctx, knc_micro_op_t& op);
+    void generate_vector_permute(const knc_translation_context_t& ctx, knc_micro_op_t& op);
     
     // Register mapping
     uint32_t map_knc_register_to_x86(uint32_t knc_reg);
     std::string get_x86_register_name(uint32_t knc_reg);
     
     // Memory access helpers
-    std::vector<uint8_t> generate_memory_load(const knc_translation_context_t& ctx, uint32_t size);
-    std::vector<uint8_t> generate_memory_store(const knc_translation_context_t& ctx, uint32_t size);
+    void generate_memory_load(const knc_translation_context_t& ctx, uint32_t size, knc_micro_op_t& op);
+    void generate_memory_store(const knc_translation_context_t& ctx, uint32_t size, knc_micro_op_t& op);
     
     // Utility functions
-    bool is_knc_vector_instruction(xed_iclass_enum_t iclass);
-    bool is_knc_specific_instruction(xed_iclass_enum_t iclass);
     knc_instruction_type_t classify_instruction(const xed_decoded_inst_t& xedd);
     
 public:
@@ -125,12 +275,57 @@ public:
     void shutdown();
     
     // Main translation interface
-    knc_translated_instruction_t translate_instruction(uint64_t address, const uint8_t* instruction_bytes);
-    knc_translated_instruction_t translate_block(uint64_t start_address, const uint8_t* block_bytes, size_t block_size);
+    knc_micro_op_t translate_instruction(uint64_t address, const uint8_t* instruction_bytes);
+    const std::string& get_description(const knc_micro_op_t& op) const;
+    
+    // Instruction table queries; unknown classes have no name and latency 1
+    static const char* get_instruction_name(xed_iclass_enum_t iclass);
+    static uint32_t get_instruction_latency(xed_iclass_enum_t iclass);
+    
+    // Block lookup without a lock, for the dispatcher; null on a miss
+    knc_translated_block_t* find_block(uint64_t start_address);
+    
+    // Count a dispatch to an untranslated address; true once it has been
+    // reached threshold times. Safe to call from several core threads.
+    bool count_execution(uint64_t address, uint32_t threshold);
+    
+    // Block translation - block_bytes points at guest code for start_address with
+    // block_size bytes readable. Returns the cached block when one exists.
+    knc_translated_block_t* translate_block(uint64_t start_address, const uint8_t* block_bytes, size_t block_size);
+    void link_block(knc_translated_block_t* block, uint32_t exit_index, knc_translated_block_t* successor);
+    
+    // Ahead-of-time translation of a code region, code pointing at its host
+    // bytes. Blocks are formed from each seed and then along their static
+    // exits and call return points, staying inside the region; the seeds are
+    // split by address into one chunk per host thread. Blocks not already
+    // cached are added to the block cache, and are returned so the caller
+    // can track their code pages.
+    std::vector<knc_translated_block_t*> pretranslate(uint64_t start_address, const uint8_t* code, size_t size,
+                                                      const std::vector<uint64_t>& seeds, uint32_t threads);
+    
+    // Form a superblock starting at block along the hot exits recorded in
+    // its and its successors' exit_counts. Returns null when the hot path
+    // does not reach a second block.
+    knc_translated_block_t* form_superblock(knc_translated_block_t* block);
+    void set_handler_resolver(knc_handler_resolver_t resolver);
+    
+    // Predecoding for the interpreter - safe to call from several core threads
+    bool decode_instruction(uint64_t address, const uint8_t* instruction_bytes, size_t available,
+                            knc_decoded_instruction_t& decoded);
     
     // Cache management
     void flush_translation_cache();
-    void invalidate_cache_range(uint64_t start_address, uint64_t size);
+    // Retire the blocks overlapping a guest range, e.g. after the guest
+    // wrote to it; returns how many were retired
+    size_t invalidate_cache_range(uint64_t start_address, uint64_t size);
+    bool has_blocks_in_range(uint64_t start_address, uint64_t size) const;
+    void check_code_in_range(uint64_t start_address, uint64_t size);
+    
+    // Persistent translation cache. open reuses the blocks in the file at
+    // path if it was written for key; close saves this run's blocks back to
+    // it. Close before flushing the translation cache, or they are lost.
+    bool open_persistent_cache(const std::string& path, const knc_translation_cache_key_t& key);
+    void close_persistent_cache();
     
     // State queries
     const knc_translation_context_t& get_last_translation_context() const;
@@ -143,9 +338,10 @@ public:
     // Debugging
     void dump_translation_cache() const;
     void print_instruction_translation(uint64_t address, const uint8_t* original, 
-                                   const knc_translated_instruction_t& translated) const;
+                                   const knc_micro_op_t& translated) const;
     
-    // Configuration
+    // Configuration. The size is in entries per cache, rounded up to whole
+    // sets; resizing empties the lookup caches, so call it while no core runs.
     void set_cache_size(size_t size);
     void enable_debug_output(bool enable);
 };
@@ -0,0 +1,97 @@
+#ifndef KNC_JIT_COMPILER_H
+#define KNC_JIT_COMPILER_H
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include "knc_types.h"
+#include "knc_instruction_translator.h"
+
+// Status returned by compiled blocks
+#define KNC_JIT_EXIT_NORMAL 0   // Block completed, RIP holds the next guest address
+#define KNC_JIT_EXIT_SIDE 1     // Left early at RIP; the interpreter must run that instruction
+
+// Upper bound for knc_core_state_t::jit_loop_budget
+#define KNC_JIT_MAX_LOOP_BUDGET 65536
+
+// Host JIT for translated blocks.
+//
+// Compiled code is entered with the core state.
+// Guest ZMM and mask registers used by the block are kept in the host
+// registers of the same number for the length of the block; guest GPRs and
+// RFLAGS stay in the core state. A block that branches back to its own start
+// loops natively for up to jit_loop_budget passes. In a superblock, an inner
+// conditional branch going off the recorded path is a side exit at that
+// branch, and the interpreter takes it from there.
+//
+// Guest loads and stores translate through the core's software TLB inline;
+// a miss leaves the block at a side exit for that instruction, and the
+// interpreter walks the page tables. Should a translated access still fault
+// on a guard page, the fault handler resumes at the same side exit.
+class KNCJitCompiler {
+private:
+    // Executable code buffer, bump allocated until the next reset. It is
+    // never writable and executable at once: code is copied in through a
+    // second, writable mapping of the same memory that is only opened while
+    // a block is written. Without one, each block starts on a fresh page
+    // that is made executable once written.
+    uint8_t* code_buffer;
+    uint8_t* code_write;     // Writable view of code_buffer, or code_buffer itself
+    size_t code_capacity;
+    size_t code_used;
+    size_t code_alignment;   // Of block entry points
+    bool available;
+    bool buffer_full_reported;
+    mutable std::mutex compile_mutex;
+
+    // Host code of each compiled guest memory access and the side exit a fault
+    // there resumes at, in code address order; read from the fault handler
+    typedef struct {
+        uintptr_t start;
+        uintptr_t end;
+        uintptr_t resume;
+    } knc_jit_fault_site_t;
+    std::unique_ptr<knc_jit_fault_site_t[]> fault_sites;
+    size_t fault_site_capacity;
+    std::atomic<size_t> fault_site_count;
+
+    // Statistics
+    uint64_t blocks_compiled;
+    uint64_t blocks_rejected;
+
+    static const size_t DEFAULT_CODE_BUFFER_SIZE = 16 * 1024 * 1024;  // 16MB
+
+    bool host_supports_jit() const;
+    bool can_compile_instruction(const knc_decoded_instruction_t& inst) const;
+    bool can_compile(const knc_translated_block_t& block) const;
+    bool emit_block(const knc_translated_block_t& block, std::vector<uint8_t>& code,
+                    std::vector<knc_jit_fault_site_t>& faults) const;
+    // Copy finished code in at offset, leaving its pages executable only
+    bool write_code(size_t offset, const std::vector<uint8_t>& code);
+
+public:
+    KNCJitCompiler();
+    ~KNCJitCompiler();
+
+    // Initialization
+    bool initialize(size_t buffer_size = DEFAULT_CODE_BUFFER_SIZE);
+    void shutdown();
+    bool is_available() const;
+
+    // Compile a translated block; returns nullptr when the block is not supported
+    knc_jit_entry_t compile_block(const knc_translated_block_t& block);
+
+    // Discard all compiled code - callers must ensure none of it is running
+    void reset();
+
+    // knc_fault_redirect_fn_t for guest memory; context is the compiler
+    static uintptr_t fault_resume_address(void* context, uintptr_t pc);
+
+    // Statistics
+    void print_statistics() const;
+    uint64_t get_blocks_compiled() const;
+};
+
+#endif // KNC_JIT_COMPILER_H
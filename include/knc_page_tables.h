@@ -0,0 +1,100 @@
+#ifndef KNC_PAGE_TABLES_H
+#define KNC_PAGE_TABLES_H
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+
+// Guest page sizes
+typedef enum {
+    KNC_PAGE_4K = 0,
+    KNC_PAGE_2M = 1,
+    KNC_PAGE_1G = 2
+} knc_page_size_t;
+
+#define KNC_PAGE_SHIFT 12
+#define KNC_PAGE_SIZE_4K (1ULL << 12)
+#define KNC_PAGE_SIZE_2M (1ULL << 21)
+#define KNC_PAGE_SIZE_1G (1ULL << 30)
+#define KNC_VIRTUAL_ADDRESS_BITS 48  // Four-level tables
+
+const char* knc_page_size_name(knc_page_size_t size);
+bool knc_parse_page_size(const char* name, knc_page_size_t& size);
+uint64_t knc_page_bytes(knc_page_size_t size);
+
+// Result of translating a guest virtual address
+typedef struct {
+    uint64_t physical;      // Guest physical address of the translated byte
+    uint64_t page_base;     // Guest physical address of the start of its page
+    knc_page_size_t size;
+    bool writable;
+    uint32_t levels;        // Page-table entries the walk read
+} knc_page_walk_t;
+
+// Guest virtual memory: x86-64 style four-level page tables (PML4, PDPT,
+// PD, PT) with 1G leaves in the PDPT and 2M leaves in the PD.
+//
+// Mappings are registered as regions, and leaf entries are filled on the
+// first walk that reaches them - demand paging - so mapping all of a large
+// guest costs nothing until it is touched. The tables are shared by every
+// core. Entries only ever go from absent to present, so walks read them
+// without a lock; filling one takes fill_mutex.
+class KNCPageTables {
+private:
+    typedef struct {
+        uint64_t virtual_address;
+        uint64_t physical_address;
+        uint64_t bytes;
+        knc_page_size_t size;
+        bool writable;
+    } knc_page_region_t;
+
+    // Table entries: bit 0 present, bit 1 writable, bit 7 large-page leaf,
+    // bits 12 and up the guest physical address of a leaf or the host
+    // address of the next-level table
+    static const uint64_t ENTRY_PRESENT = 0x1;
+    static const uint64_t ENTRY_WRITABLE = 0x2;
+    static const uint64_t ENTRY_LARGE = 0x80;
+    static const uint64_t ENTRY_ADDRESS = 0x000FFFFFFFFFF000ULL;
+    static const uint32_t ENTRIES_PER_TABLE = 512;
+
+    struct alignas(4096) knc_page_table_t {
+        std::atomic<uint64_t> entries[ENTRIES_PER_TABLE];
+    };
+
+    std::vector<std::unique_ptr<knc_page_table_t>> tables;  // tables[0] is the PML4
+    knc_page_table_t* root;
+    std::vector<knc_page_region_t> regions;
+    uint64_t physical_limit;
+    std::mutex fill_mutex;
+    uint64_t pages_filled[3];  // Leaf entries filled, per page size
+
+    const knc_page_region_t* find_region(uint64_t virtual_address) const;
+    bool walk(uint64_t virtual_address, knc_page_walk_t& result) const;
+    bool fill(uint64_t virtual_address);
+    knc_page_table_t* new_table();
+
+public:
+    KNCPageTables();
+    ~KNCPageTables();
+
+    // Drop every mapping; physical_size bounds the frames later mappings may use
+    void reset(uint64_t physical_size);
+
+    // Map bytes at virtual_address onto guest physical memory at
+    // physical_address, using pages up to page_size wherever both addresses
+    // are aligned for them and smaller pages elsewhere. Addresses and length
+    // must be 4K aligned, and the range must not overlap an existing mapping.
+    bool map(uint64_t virtual_address, uint64_t physical_address, uint64_t bytes,
+             knc_page_size_t page_size, bool writable);
+
+    // Walk the tables for virtual_address; false on a page fault
+    bool translate(uint64_t virtual_address, knc_page_walk_t& result);
+
+    // Statistics
+    void print_statistics() const;
+};
+
+#endif // KNC_PAGE_TABLES_H
@@ -53,6 +53,7 @@ typedef struct {
     uint64_t cache_references;
     uint64_t tlb_hits;
     uint64_t tlb_misses;
+    knc_gather_lines_t gather_lines;  // Gathers and scatters by distinct cache lines touched
     uint64_t last_update_time;
 } knc_core_perf_data_t;
 
@@ -66,6 +67,7 @@ private:
     // Performance data
     std::vector<knc_core_perf_data_t> core_data;
     knc_performance_counters_t aggregate_counters_val;
+    knc_gather_lines_t aggregate_gather_lines;
     
     // Synchronization
     std::mutex data_mutex;
@@ -127,16 +129,20 @@ public:
     void record_ring_bus_transaction(uint32_t core_id, uint32_t dest_tile, size_t size);
     void record_branch_event(uint32_t core_id, bool taken, bool mispredicted);
     void record_cycle(uint32_t core_id, uint64_t cycles);
+    void record_tlb_events(uint32_t core_id, uint64_t hits, uint64_t misses);
+    void record_gather_lines(uint32_t core_id, const knc_gather_lines_t& lines);
     
     // Data retrieval
     const knc_core_perf_data_t& get_core_data(uint32_t core_id) const;
     const knc_performance_counters_t& get_aggregate_counters() const;
+    const knc_gather_lines_t& get_gather_lines() const { return aggregate_gather_lines; }
     uint64_t get_counter_value(uint32_t core_id, knc_perf_event_type_t event_type) const;
     
     // Statistics and reporting
     void print_performance_report() const;
     void print_core_statistics(uint32_t core_id) const;
     void print_aggregate_statistics() const;
+    void print_gather_histogram() const;
     void export_csv(const std::string& filename) const;
     
     // Real-time monitoring
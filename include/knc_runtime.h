@@ -2,34 +2,102 @@
 #define KNC_RUNTIME_H
 
 #include <vector>
+#include <string>
 #include <memory>
 #include <thread>
 #include <atomic>
 #include <mutex>
 #include <condition_variable>
+#include <deque>
 
 #include "knc_types.h"
+#include "knc_vector_backend.h"
+#include "knc_scheduler.h"
+#include "knc_guest_memory.h"
+#include "knc_page_tables.h"
+#include "knc_binary_loader.h"
 
 // Forward declarations
 class RingBusSimulator;
 class KNCDebugger;
 class KNCPerformanceMonitor;
 class PCIeBridge;
+class KNCInstructionTranslator;
+class KNCJitCompiler;
+typedef struct knc_translated_block_s knc_translated_block_t;
 
 class KNCRuntime {
 private:
     // Architecture
     knc_architecture_t architecture;
     
-    // Core states
+    // Hardware thread contexts, KNC_THREADS_PER_CORE per core (core-major)
     std::vector<knc_core_state_t> core_states;
-    std::vector<std::thread> core_threads;
+    std::vector<knc_core_issue_t> core_issue;
+    uint32_t threads_per_core;
+    
+    // Guest physical memory - demand-zero host mapping, guest address 0 at memory
+    std::unique_ptr<KNCGuestMemory> guest_memory;
+    knc_huge_pages_t huge_pages;
     uint8_t* memory;
     
-    // MMU memory management
+    // Guest virtual memory - page tables shared by every core, walked on a
+    // miss in the core's software TLB
+    std::unique_ptr<KNCPageTables> page_tables;
+    knc_page_size_t page_size;
+    std::unique_ptr<knc_tlb_t[]> tlbs;
+    
+    // Gathers and scatters of each core by distinct cache lines touched, and
+    // the part of them already passed to the performance monitor
+    std::unique_ptr<knc_gather_lines_t[]> gather_lines;
+    std::unique_ptr<knc_gather_lines_t[]> reported_gather_lines;
+    
+    // Self-modifying code. A bit per 4K guest physical page is set while the
+    // page holds translated blocks, and TLB entries for such pages get no
+    // write permission. Stores to them take the TLB miss path, which retires
+    // the blocks the store overlaps, and clears the bit once the page holds
+    // none, before letting the store through. Setting a bit bumps
+    // code_generation; each core then drops write entries for marked pages
+    // at its next block dispatch, and the core that translated the block
+    // drops them at once.
+    //
+    // A store to a code page that misses every block means code and data
+    // share the page. Such a mixed page is left writable, and its blocks
+    // instead compare their code hash before each dispatch.
+    std::unique_ptr<std::atomic<uint64_t>[]> code_pages;
+    std::unique_ptr<std::atomic<uint64_t>[]> mixed_pages;
+    std::atomic<uint64_t> code_generation;
+    std::mutex code_mutex;  // Orders translations against invalidating stores
+    std::atomic<uint64_t> code_page_writes;
+    std::atomic<uint64_t> code_blocks_invalidated;
+    static bool test_page(const std::unique_ptr<std::atomic<uint64_t>[]>& bitmap, uint64_t physical);
+    bool track_code_pages(knc_translated_block_t* block, uint64_t physical);
+    bool write_code_page(uint64_t address, size_t size, uint64_t physical);
+    bool check_block_code(knc_core_state_t& thread, knc_translated_block_t*& block);
+    void revoke_code_writes(knc_tlb_t& tlb);
+    
+    // MMU memory management. Access statistics are sharded per emulated core,
+    // plus one shard shared by host-side callers, each on its own cache lines,
+    // and summed when read.
     knc_memory_system_t memory_system;
     std::vector<knc_mmu_t> mmus;
-    std::mutex mmu_mutex;
+    struct alignas(64) knc_mmu_counters_t {
+        std::atomic<uint64_t> accesses[KNL_NUM_MMUS];
+        std::atomic<uint64_t> cache_hits[KNL_NUM_MMUS];
+        std::atomic<uint64_t> cache_misses[KNL_NUM_MMUS];
+        std::atomic<uint32_t> hit_state;  // Generator for the simulated hit rate
+    };
+    std::unique_ptr<knc_mmu_counters_t[]> mmu_counters;  // num_cores + 1 shards
+    void count_mmu_access(uint32_t mmu_id);
+    
+    // Guest atomics remember, per hashed cache line, the last core to write
+    // the line. A line taken over from another core is contended and is
+    // reported to the ring bus DTD model.
+    static const uint32_t ATOMIC_LINE_SLOTS = 4096;
+    std::unique_ptr<std::atomic<uint64_t>[]> atomic_lines;
+    std::atomic<uint64_t> contended_atomics;
+    void note_atomic_access(uint32_t core_id, uint64_t address);
+    std::mutex split_lock_mutex;  // Serializes atomics whose operand straddles a page
     
     // Configuration
     uint32_t num_cores;
@@ -37,10 +105,19 @@ private:
     
     // Synchronization
     std::atomic<bool> should_halt;
-    std::atomic<uint64_t> global_cycle_count;
-    std::mutex memory_mutex;
+    std::atomic<uint64_t> global_cycle_count;  // Virtual time every core has reached
     std::condition_variable barrier_cv;
     
+    // Each core keeps its own virtual clock and may run at most sync_quantum
+    // cycles ahead of the slowest core. Clocks are published for other workers
+    // on separate cache lines.
+    struct alignas(64) knc_core_clock_t {
+        std::atomic<uint64_t> cycles;
+    };
+    std::unique_ptr<knc_core_clock_t[]> core_clocks;
+    uint64_t sync_quantum;  // 0 = cores run unsynchronized
+    std::atomic<uint64_t> max_core_skew;
+    
     // Component references
     RingBusSimulator* ring_bus;
     KNCDebugger* debugger;
@@ -51,19 +128,90 @@ private:
     bool initialized;
     std::atomic<bool> running;
     
+    // Translated code runs in three tiers. An address the dispatcher has
+    // reached fewer than WARM_THRESHOLD times is cold: its instructions are
+    // decoded and run one at a time up to the next branch, with nothing
+    // cached. Warm code is translated into basic blocks of predecoded
+    // instructions, chained to their successors so hot loops stay out of the
+    // dispatcher. Interpreted blocks count the exits they leave through; a
+    // block reaching SUPERBLOCK_THRESHOLD executions becomes the head of a
+    // superblock along its hot path, which then runs (and is compiled) in its
+    // place. Blocks reaching JIT_THRESHOLD are hot and go to the JIT.
+    std::unique_ptr<KNCInstructionTranslator> translator;
+    static const uint32_t WARM_THRESHOLD = 2;
+    static const uint32_t SUPERBLOCK_THRESHOLD = 32;
+    static const size_t MAX_COLD_INSTRUCTIONS = 64;  // Per cold run, as for a block
+    std::string translation_cache_dir;  // Persistent translation caches for ELF binaries; empty = off
+    uint32_t pretranslate_threads;      // Host threads translating .text at load time; 0 = translate lazily
+    void pretranslate_text(const KNCBinaryLoader& loader);
+    
+    // Emulated contexts are multiplexed onto a pool of host workers
+    std::unique_ptr<KNCScheduler> scheduler;
+    uint32_t num_workers;  // 0 = one per host CPU
+    static const uint64_t SLICE_INSTRUCTIONS = 20000;  // Guest instructions per scheduling slice
+    
+    // Host JIT for hot blocks. Blocks are compiled on a background thread
+    // so cores keep interpreting them meanwhile; a core picks up jit_code on
+    // its next dispatch of the block once it is set.
+    std::unique_ptr<KNCJitCompiler> jit;
+    bool jit_enabled;
+    static const uint32_t JIT_THRESHOLD = 64;  // Interpreted executions before queueing for compilation
+    std::thread compile_thread;
+    std::mutex compile_mutex;
+    std::condition_variable compile_ready;  // Work queued, or compile_stop set
+    std::condition_variable compile_idle;   // Queue drained and no compile in progress
+    std::deque<knc_translated_block_t*> compile_queue;
+    bool compile_busy;
+    bool compile_stop;
+    std::atomic<uint64_t> blocks_compiled;
+    void start_compile_thread();
+    void stop_compile_thread();
+    void compile_worker();
+    void request_compile(knc_translated_block_t* block);
+    void drain_compile_queue();
+    
+    // Host kernels for emulated vector operations, chosen from CPUID at initialize()
+    knc_vector_backend_t vector_backend;
+    const knc_vector_ops_t* vector_ops;
+    
+    // Interpreter handlers live in knc_runtime.cpp
+    friend struct KNCInterpreterOps;
+    
     // Core execution functions
-    void execute_core(uint32_t core_id);
-    knc_error_t execute_instruction(knc_core_state_t& core, uint8_t* instruction);
-    knc_error_t handle_vector_instruction(knc_core_state_t& core, uint8_t* instruction);
-    knc_error_t handle_scalar_instruction(knc_core_state_t& core, uint8_t* instruction);
-    knc_error_t handle_memory_instruction(knc_core_state_t& core, uint8_t* instruction);
-    knc_error_t handle_control_instruction(knc_core_state_t& core, uint8_t* instruction);
-    
-    // Memory access functions
-    knc_error_t read_memory(uint64_t address, void* data, size_t size);
-    knc_error_t write_memory(uint64_t address, const void* data, size_t size);
-    knc_error_t read_vector_memory(uint64_t address, __m512i& data);
-    knc_error_t write_vector_memory(uint64_t address, const __m512i& data);
+    knc_slice_result_t execute_slice(uint32_t core_id, uint64_t budget);
+    bool step_thread(knc_core_state_t& thread, knc_translated_block_t*& block, uint64_t allowance);
+    // issued: instructions each thread retired this round; gathered: cycles
+    // their multi-line gathers and scatters took on top of those
+    void account_issue(uint32_t core_id, const uint64_t issued[KNC_THREADS_PER_CORE],
+                       const uint64_t gathered[KNC_THREADS_PER_CORE]);
+    // With cold set, a miss on an address that is still cold returns null
+    // and sets *cold instead of translating
+    knc_translated_block_t* lookup_block(knc_core_state_t& thread, uint64_t rip, bool* cold = nullptr);
+    bool fetch_code(uint64_t rip, uint64_t& physical, uint64_t& available);
+    static const uint64_t MAX_FETCH_BYTES = 1024;  // Guest code bytes lookup_block needs mapped contiguously
+    knc_error_t execute_cold(uint32_t core_id, knc_core_state_t& core);
+    knc_error_t execute_block(uint32_t core_id, knc_core_state_t& core, const knc_translated_block_t& block);
+    knc_error_t interpret_block(uint32_t core_id, knc_core_state_t& core, const knc_translated_block_t& block);
+    bool execute_jit_block(knc_core_state_t& core, const knc_translated_block_t& block, knc_jit_entry_t code);
+    void profile_block(knc_translated_block_t& block, uint32_t exit);
+    knc_error_t execute_instruction(knc_core_state_t& core, const knc_decoded_instruction_t& inst);
+    static knc_instruction_handler_t get_instruction_handler(knc_exec_op_t op);
+    
+    // Memory access functions - guest virtual addresses, translated through the core's TLB
+    knc_error_t read_memory(const knc_core_state_t& core, uint64_t address, void* data, size_t size);
+    knc_error_t write_memory(const knc_core_state_t& core, uint64_t address, const void* data, size_t size);
+    knc_error_t read_vector_memory(const knc_core_state_t& core, uint64_t address, knc_vector_t& data);
+    knc_error_t write_vector_memory(const knc_core_state_t& core, uint64_t address, const knc_vector_t& data);
+    knc_error_t access_pages(const knc_core_state_t& core, uint64_t address, void* data, size_t size, bool is_write);
+    
+    // Software TLB. tlb_lookup returns the host address of an access that
+    // stays within one page, or nullptr on a page fault, a store to a
+    // read-only page or an access crossing a page boundary.
+    uint8_t* tlb_lookup(const knc_core_state_t& core, uint64_t address, size_t size, bool is_write);
+    uint8_t* tlb_miss(const knc_core_state_t& core, uint64_t address, size_t size, bool is_write);
+    void flush_tlbs();
+    void collect_tlb_events(uint32_t core_id);
+    void collect_gather_events(uint32_t core_id);
     
     // System call handling
     knc_error_t handle_system_call(knc_core_state_t& core, knc_syscall_type_t syscall);
@@ -75,10 +223,15 @@ private:
     knc_error_t syscall_mmap(knc_core_state_t& core);
     knc_error_t syscall_munmap(knc_core_state_t& core);
     
+    // Program loading
+    bool map_address_space(const std::vector<knc_elf_segment_t>& segments);
+    void reset_contexts(uint64_t image_end);
+    
     // Synchronization functions
-    void barrier_wait(uint32_t core_id);
+    bool barrier_wait(uint32_t core_id);  // False while the core is a full quantum ahead
     void synchronize_cores();
     void update_global_cycle_count();
+    void publish_core_clock(uint32_t core_id, uint64_t cycles);
     
     // Performance monitoring
     void update_performance_counters(knc_core_state_t& core, knc_instruction_type_t inst_type);
@@ -93,8 +246,11 @@ public:
     bool initialize();
     void shutdown();
     
-    // Program loading
+    // Program loading. load_program copies a flat image to address 0 and
+    // starts there; load_binary places ELF segments at their virtual addresses
+    // and starts at the ELF entry point.
     bool load_program(const uint8_t* program_data, uint64_t program_size);
+    bool load_binary(const KNCBinaryLoader& loader);
     bool set_entry_point(uint64_t entry_point);
     
     // Component registration
@@ -103,6 +259,19 @@ public:
     void set_performance_monitor(KNCPerformanceMonitor* monitor);
     void set_pcie_bridge(PCIeBridge* bridge);
     
+    // Execution engine configuration (call before initialize)
+    void set_jit_enabled(bool enable);
+    void set_worker_threads(uint32_t workers);
+    bool set_threads_per_core(uint32_t threads);  // Call before load_program
+    bool set_vector_backend(knc_vector_backend_t backend);
+    void set_sync_quantum(uint64_t cycles);  // 0 disables synchronization
+    void set_huge_pages(knc_huge_pages_t pages);
+    void set_page_size(knc_page_size_t size);  // Largest guest page size; call before load_program
+    void set_translation_cache(const std::string& directory);  // Call before load_binary
+    void set_pretranslation(uint32_t threads);  // Call before load_binary; 0 translates lazily
+    void set_block_cache_size(size_t entries);  // Call before run
+    const char* get_vector_backend_name() const;
+    
     // MMU memory management (public for testing)
     uint32_t address_to_mmu(uint64_t address);
     bool is_valid_address(uint64_t address);
@@ -120,8 +289,11 @@ public:
     // State queries
     bool is_running() const;
     uint64_t get_cycle_count() const;
-    const knc_core_state_t& get_core_state(uint32_t core_id) const;
+    const knc_core_state_t& get_core_state(uint32_t core_id) const;  // Hardware thread 0
+    const knc_core_state_t& get_thread_state(uint32_t core_id, uint32_t thread_id) const;
+    uint64_t get_core_cycles(uint32_t core_id) const;
     const knc_memory_t& get_memory() const;
+    uint64_t get_blocks_compiled() const;  // By the background JIT
     
     // Debugging interface
     void dump_core_state(uint32_t core_id) const;
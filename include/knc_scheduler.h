@@ -0,0 +1,73 @@
+#ifndef KNC_SCHEDULER_H
+#define KNC_SCHEDULER_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+
+// Outcome of running one emulated hardware context for a time slice
+typedef enum {
+    KNC_SLICE_PREEMPTED = 0,   // Slice budget used up; requeue behind other contexts
+    KNC_SLICE_YIELDED = 1,     // Guest is spin-waiting; requeue and let another context run
+    KNC_SLICE_FINISHED = 2,    // Context halted or faulted; never scheduled again
+    KNC_SLICE_BLOCKED = 3      // Ahead of the slower contexts; requeue without holding the host CPU
+} knc_slice_result_t;
+
+typedef std::function<knc_slice_result_t(uint32_t context_id, uint32_t worker_id)> knc_slice_fn_t;
+
+// M:N scheduler - multiplexes emulated hardware contexts onto a fixed pool of
+// host worker threads. Each worker round-robins its own run queue and steals
+// from the tail of another worker's queue when it runs dry.
+class KNCScheduler {
+private:
+    // One run queue per worker, padded so neighbouring queues do not share a cache line
+    struct alignas(64) knc_worker_queue_t {
+        std::mutex lock;
+        std::deque<uint32_t> contexts;
+        uint64_t slices;
+        uint64_t steals;
+        uint64_t yields;
+        uint64_t blocked;
+    };
+
+    std::vector<std::unique_ptr<knc_worker_queue_t>> queues;
+    std::vector<std::thread> workers;
+    knc_slice_fn_t run_slice;
+    std::atomic<uint32_t> live_contexts;
+    std::atomic<bool> stop_requested;
+    uint32_t num_contexts;
+
+    static const uint32_t IDLE_SPINS_BEFORE_SLEEP = 64;
+
+    void worker_loop(uint32_t worker_id);
+    bool pop_local(uint32_t worker_id, uint32_t& context_id);
+    bool steal(uint32_t worker_id, uint32_t& context_id);
+    void push_local(uint32_t worker_id, uint32_t context_id);
+
+public:
+    KNCScheduler();
+    ~KNCScheduler();
+
+    // Distribute contexts round-robin over num_workers threads and start them
+    bool start(uint32_t contexts, uint32_t num_workers, knc_slice_fn_t slice_fn);
+
+    // Ask workers to finish their current slice and exit, then join them
+    void stop();
+    void join();
+
+    bool is_finished() const;
+    uint32_t get_num_workers() const;
+
+    // Host threads worth using: one per host CPU, never more than there are contexts
+    static uint32_t default_worker_count(uint32_t contexts);
+
+    // Statistics
+    void print_statistics() const;
+};
+
+#endif // KNC_SCHEDULER_H
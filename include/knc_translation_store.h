@@ -0,0 +1,91 @@
+#ifndef KNC_TRANSLATION_STORE_H
+#define KNC_TRANSLATION_STORE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "knc_types.h"
+
+// Bump whenever decoding changes what ends up in a knc_decoded_instruction_t,
+// so cache files written by an older translator are ignored
+#define KNC_TRANSLATOR_VERSION 3
+
+// 64-bit content hash for binaries and guest code
+uint64_t knc_hash_bytes(const void* data, size_t bytes, uint64_t seed = 0);
+
+// What a translation cache file was built from; a file is only used when
+// every field matches
+typedef struct {
+    uint64_t binary_hash;           // knc_hash_bytes of the whole ELF file
+    uint64_t binary_size;
+    uint32_t translator_version;    // KNC_TRANSLATOR_VERSION
+    uint32_t architecture;          // knc_architecture_t
+} knc_translation_cache_key_t;
+
+// A block in a cache file; its instructions are a slice of the file's
+// instruction array, stored with a null handler
+typedef struct {
+    uint64_t start_address;
+    uint64_t end_address;
+    uint64_t code_hash;             // knc_hash_bytes of the guest bytes it was decoded from
+    uint32_t first_instruction;
+    uint32_t instruction_count;
+} knc_cached_block_t;
+
+// Read side of the persistent translation cache: a file of predecoded
+// blocks for one binary, memory-mapped read-only and indexed by block start
+// address. Nothing is decoded up front; the translator copies a block out
+// when a core first reaches it, after checking the guest bytes still hash
+// to the stored code_hash. Files are replaced whole by write(), which goes
+// through a temporary file and a rename, so readers never see a partial one.
+class KNCTranslationStore {
+private:
+    typedef struct {
+        uint64_t magic;
+        uint32_t format_version;
+        uint32_t instruction_size;  // sizeof(knc_decoded_instruction_t) of the writer
+        knc_translation_cache_key_t key;
+        uint32_t block_count;
+        uint32_t instruction_count;
+        uint64_t payload_hash;      // knc_hash_bytes of everything after the header
+    } knc_cache_file_header_t;
+
+    static const uint64_t FILE_MAGIC = 0x4548434143434E4BULL;  // "KNCCACHE"
+    static const uint32_t FORMAT_VERSION = 1;
+
+    const uint8_t* file_data;
+    size_t file_size;
+    std::vector<uint8_t> file_buffer;  // Holds the file when it could not be mapped
+    const knc_cached_block_t* blocks;
+    const knc_decoded_instruction_t* instructions;
+    uint32_t block_count;
+    std::unordered_map<uint64_t, uint32_t> block_index;
+
+    bool map_file(const std::string& path);
+    bool validate(const knc_translation_cache_key_t& key, std::string& reason);
+
+public:
+    KNCTranslationStore();
+    ~KNCTranslationStore();
+
+    // Map the cache file at path; false when it is missing or was built for
+    // another binary, translator version or architecture
+    bool open(const std::string& path, const knc_translation_cache_key_t& key);
+    void close();
+    bool is_open() const { return file_data != nullptr; }
+
+    uint32_t get_block_count() const { return block_count; }
+    const knc_cached_block_t& get_block(uint32_t index) const { return blocks[index]; }
+    const knc_cached_block_t* find_block(uint64_t start_address) const;
+    const knc_decoded_instruction_t* get_instructions(const knc_cached_block_t& block) const;
+
+    // Replace the cache file at path with the given blocks; each block's
+    // first_instruction indexes instructions
+    static bool write(const std::string& path, const knc_translation_cache_key_t& key,
+                      const std::vector<knc_cached_block_t>& blocks,
+                      const std::vector<knc_decoded_instruction_t>& instructions);
+};
+
+#endif // KNC_TRANSLATION_STORE_H
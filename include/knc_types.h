@@ -2,7 +2,6 @@
 #define KNC_TYPES_H
 
 #include <cstdint>
-#include <immintrin.h>
 
 // Architecture Detection
 typedef enum {
@@ -14,6 +13,9 @@ typedef enum {
 // KNC Architecture Constants (Knights Corner)
 #define KNC_NUM_CORES 60
 #define KNC_CORES_PER_TILE 4
+#define KNC_THREADS_PER_CORE 4   // Hardware threads, issued round-robin
+#define KNC_DEFAULT_SYNC_QUANTUM 10000  // Cycles a core may run ahead of the slowest core
+#define KNC_DEFAULT_BLOCK_CACHE_ENTRIES 16384  // Translated block lookup cache size
 #define KNC_NUM_TILES (KNC_NUM_CORES / KNC_CORES_PER_TILE)
 #define KNC_NUM_VECTOR_REGISTERS 32
 #define KNC_VECTOR_SIZE 512
@@ -21,10 +23,17 @@ typedef enum {
 #define KNC_NUM_MASK_REGISTERS 8
 #define KNC_L1_CACHE_SIZE 32 * 1024
 #define KNC_L2_CACHE_SIZE 512 * 1024
+#define KNC_CACHE_LINE_SIZE 64
 #define KNC_MEMORY_SIZE (8ULL * 1024 * 1024 * 1024)  // 8GB
 #define KNC_NUM_MMUS 8
 #define KNC_MMU_SIZE (KNC_MEMORY_SIZE / KNC_NUM_MMUS)  // 1GB per MMU
 
+// Guest physical address width. Loads and stores use the low bits of the
+// effective address; the part of this window past the end of guest memory
+// is an inaccessible guard region.
+#define KNC_GUEST_ADDRESS_BITS 40
+#define KNC_GUEST_ADDRESS_MASK ((1ULL << KNC_GUEST_ADDRESS_BITS) - 1)
+
 // Xeon Phi 5110P Clock Speed
 #define KNC_CLOCK_FREQUENCY_HZ 1053000000ULL  // 1.053 GHz (1053 MHz)
 #define KNC_CLOCK_FREQUENCY_MHZ 1053          // 1053 MHz
@@ -59,10 +68,56 @@ typedef enum {
 // Runtime Architecture Selection
 extern knc_architecture_t current_architecture;
 
+// General purpose register numbers (x86-64 encoding order)
+typedef enum {
+    KNC_REG_RAX = 0,
+    KNC_REG_RCX = 1,
+    KNC_REG_RDX = 2,
+    KNC_REG_RBX = 3,
+    KNC_REG_RSP = 4,
+    KNC_REG_RBP = 5,
+    KNC_REG_RSI = 6,
+    KNC_REG_RDI = 7,
+    KNC_REG_R8 = 8,
+    KNC_REG_R9 = 9,
+    KNC_REG_R10 = 10,
+    KNC_REG_R11 = 11,
+    KNC_REG_R12 = 12,
+    KNC_REG_R13 = 13,
+    KNC_REG_R14 = 14,
+    KNC_REG_R15 = 15,
+    KNC_REG_RIP = 0xFE,   // RIP-relative memory operand base
+    KNC_REG_NONE = 0xFF   // Operand slot not used
+} knc_gpr_t;
+
+// RFLAGS bits maintained by the interpreter
+#define KNC_RFLAGS_CF (1ULL << 0)
+#define KNC_RFLAGS_PF (1ULL << 2)
+#define KNC_RFLAGS_ZF (1ULL << 6)
+#define KNC_RFLAGS_SF (1ULL << 7)
+#define KNC_RFLAGS_OF (1ULL << 11)
+
+// Per-core guest stack carved from the top of guest memory
+#define KNC_STACK_SIZE (1024 * 1024)  // 1MB per core
+
+// 512-bit vector register contents, independent of host SIMD support
+#define KNC_VECTOR_LANES (KNC_VECTOR_BYTES / 4)
+typedef union alignas(64) {
+    uint8_t u8[KNC_VECTOR_BYTES];
+    uint16_t u16[KNC_VECTOR_BYTES / 2];
+    int32_t i32[KNC_VECTOR_LANES];
+    uint32_t u32[KNC_VECTOR_LANES];
+    float f32[KNC_VECTOR_LANES];
+    uint64_t u64[KNC_VECTOR_BYTES / 8];
+} knc_vector_t;
+
+// 16-bit write mask, one bit per dword lane
+typedef uint16_t knc_mask_t;
+
 // KNC Register Types
 typedef struct {
-    __m512i zmm[KNC_NUM_VECTOR_REGISTERS];  // 512-bit vector registers
-    __mmask16 k[KNC_NUM_MASK_REGISTERS];    // Mask registers
+    knc_vector_t zmm[KNC_NUM_VECTOR_REGISTERS];  // 512-bit vector registers
+    knc_mask_t k[KNC_NUM_MASK_REGISTERS];        // Mask registers
     uint64_t gpr[16];                           // General purpose registers
     uint64_t rip;                               // Instruction pointer
     uint64_t rflags;                            // Flags register
@@ -81,9 +136,6 @@ typedef struct {
     uint64_t base_address;
     uint64_t size;
     uint32_t tile_id;  // Associated tile for symmetric placement
-    uint64_t accesses;
-    uint64_t cache_hits;
-    uint64_t cache_misses;
 } knc_mmu_t;
 
 // KNC Memory System with 8 MMUs
@@ -93,15 +145,85 @@ typedef struct {
     uint32_t active_mmus;
 } knc_memory_system_t;
 
-// KNC Core State
+// Software data TLB, one per core and shared by its hardware threads.
+//
+// Loads and stores - interpreted or compiled - probe the direct-mapped array
+// of 4K translations. 2M and 1G translations sit in their own smaller arrays
+// and refill 4K entries without a page walk, so TLB reach follows the guest
+// page size. Sizes follow the KNC L1 data TLB (64 4K and 8 2M entries).
+#define KNC_TLB_ENTRIES 64
+#define KNC_TLB_LARGE_ENTRIES 8
+#define KNC_TLB_HUGE_ENTRIES 4
+
+typedef struct {
+    uint64_t read_tag;     // Virtual page number + 1 when loads may use the entry, else 0
+    uint64_t write_tag;    // The same for stores; 0 for a read-only page
+    int64_t host_offset;   // Host address minus guest virtual address
+    uint32_t hits;         // Accesses served since the TLB counters were last collected
+    uint32_t source;       // 0 for a 4K page, else 1 + the large/huge entry it came from
+} knc_tlb_entry_t;
+
+typedef struct {
+    uint64_t tag;          // Virtual page number (in pages of this size) + 1, 0 = invalid
+    uint64_t physical;     // Guest physical address of the page
+    bool writable;
+} knc_tlb_page_t;
+
+typedef struct alignas(64) {
+    knc_tlb_entry_t entries[KNC_TLB_ENTRIES];
+    knc_tlb_page_t large[KNC_TLB_LARGE_ENTRIES];
+    knc_tlb_page_t huge[KNC_TLB_HUGE_ENTRIES];
+    uint64_t hits;             // Collected entry hits, plus refills from large and huge entries
+    uint64_t misses;           // Page walks
+    uint64_t walk_reads;       // Page-table entries read by those walks
+    uint64_t reported_hits;    // Already passed to the performance monitor
+    uint64_t reported_misses;
+    uint64_t code_generation;  // Code pages the write entries account for (see KNCRuntime)
+} knc_tlb_t;
+
+// KNC Core State - one per hardware thread context (KNC_THREADS_PER_CORE per core)
 typedef struct {
     knc_register_file_t registers;
     uint32_t core_id;
+    uint32_t thread_id;
     uint32_t tile_id;
     bool is_halted;
-    uint64_t cycles_executed;
+    bool yield_requested;  // PAUSE seen - give the host worker to another context
+    uint64_t cycles_executed;  // Instructions retired by this thread
+    uint64_t active_cycles;    // Core cycles while this thread had instructions to issue
+    uint64_t stall_cycles;     // Active cycles in which another thread held the issue slot
+    uint64_t gather_cycles;    // Issue cycles of the extra passes of multi-line gathers and scatters
+    uint64_t block_lookups;    // Block cache lookups by the dispatcher for this thread
+    uint64_t cold_runs;        // Runs of cold code, interpreted without translation
+    uint64_t cold_instructions;
+    uint32_t jit_loop_budget;  // Passes a compiled self-loop may run before returning (>= 1)
+    uint64_t stack_top;  // Initial RSP; RET at this depth ends the program
+    knc_tlb_t* tlb;      // Data TLB of the core
 } knc_core_state_t;
 
+// Issue state shared by the hardware threads of one core. A thread cannot
+// issue on back-to-back cycles, so a single thread reaches at most half the
+// core's issue rate and at least two threads are needed to fill every cycle.
+typedef struct {
+    uint32_t num_threads;   // Hardware threads in use (1-KNC_THREADS_PER_CORE)
+    uint32_t next_thread;   // Round-robin issue pointer
+    uint64_t cycles;        // Core clock
+    uint64_t idle_cycles;   // Cycles in which no thread could issue
+} knc_core_issue_t;
+
+// A gather or scatter takes one pass per distinct cache line its active
+// elements touch; on KNC each further pass is another vgatherd/vscatterd
+// and jknzd round of the mask loop
+#define KNC_GATHER_CYCLES_PER_LINE 2
+
+// Gathers and scatters of one core, counted by the number of distinct cache
+// lines they touched (bucket 0 holds those with an empty mask)
+#define KNC_GATHER_LINE_BUCKETS (KNC_VECTOR_LANES + 1)
+typedef struct {
+    uint64_t gathers[KNC_GATHER_LINE_BUCKETS];
+    uint64_t scatters[KNC_GATHER_LINE_BUCKETS];
+} knc_gather_lines_t;
+
 // KNC Instruction Types
 typedef enum {
     KNC_INST_ADD_PS = 0x58,
@@ -133,7 +255,16 @@ typedef enum {
     KNL_INST_VFMADDSUBPD231PS = 0x9A,
     KNL_INST_VFMADDSUB132PS = 0x9B,
     KNL_INST_VFMSUBADDPD231PS = 0x9C,
-    KNL_INST_VFMSUBADD132PS = 0x9D
+    KNL_INST_VFMSUBADD132PS = 0x9D,
+    KNL_INST_VEXPANDPS = 0xA0,
+    KNL_INST_VCOMPRESSPS = 0xA1,
+    KNL_INST_VPCONFLICTD = 0xA2,
+    KNL_INST_VPLZCNTD = 0xA3,
+    KNL_INST_VRCP28PS = 0xA4,
+    KNL_INST_VRSQRT28PS = 0xA5,
+    KNL_INST_VEXP2PS = 0xA6,
+    KNL_INST_VGATHERPF0DPS = 0xA7,
+    KNL_INST_VSCATTERPF0DPS = 0xA8
 } knc_instruction_type_t;
 
 // KNC Ring Bus Types
@@ -207,6 +338,196 @@ typedef enum {
     KNC_ERROR_SYSTEM_CALL = -7
 } knc_error_t;
 
+// Interpreter operations produced by the predecoder
+typedef enum {
+    KNC_OP_UNKNOWN = 0,      // Decoded length only - raises KNC_ERROR_INVALID_INSTRUCTION
+    KNC_OP_NOP,
+    KNC_OP_PAUSE,
+    KNC_OP_HLT,
+    KNC_OP_SYSCALL,
+    // Scalar integer
+    KNC_OP_MOV,
+    KNC_OP_LEA,
+    KNC_OP_ADD,
+    KNC_OP_SUB,
+    KNC_OP_AND,
+    KNC_OP_OR,
+    KNC_OP_XOR,
+    KNC_OP_CMP,
+    KNC_OP_TEST,
+    KNC_OP_INC,
+    KNC_OP_DEC,
+    KNC_OP_IMUL,
+    KNC_OP_SHL,
+    KNC_OP_SHR,
+    KNC_OP_SAR,
+    KNC_OP_XCHG,
+    KNC_OP_XADD,
+    KNC_OP_CMPXCHG,
+    KNC_OP_PUSH,
+    KNC_OP_POP,
+    KNC_OP_ADC,
+    KNC_OP_SBB,
+    KNC_OP_NOT,
+    KNC_OP_NEG,
+    KNC_OP_MUL,               // rDX:rAX = rAX * r/m (AX = AL * r/m8), unsigned
+    KNC_OP_IMUL_WIDE,         // One-operand signed form of KNC_OP_MUL
+    KNC_OP_DIV,               // rAX, rDX = rDX:rAX / r/m (AL, AH = AX / r/m8), unsigned
+    KNC_OP_IDIV,
+    KNC_OP_ROL,
+    KNC_OP_ROR,
+    KNC_OP_MOVZX,             // Source size in immediate
+    KNC_OP_MOVSX,             // movsx/movsxd, source size in immediate
+    KNC_OP_CMOVCC,
+    KNC_OP_SETCC,
+    KNC_OP_CBW,               // cbw/cwde/cdqe
+    KNC_OP_CWD,               // cwd/cdq/cqo
+    KNC_OP_LEAVE,
+    // Control transfer
+    KNC_OP_JMP,
+    KNC_OP_JMP_INDIRECT,
+    KNC_OP_JCC,
+    KNC_OP_CALL,
+    KNC_OP_CALL_INDIRECT,
+    KNC_OP_RET,
+    // 512-bit vector
+    KNC_OP_VPADDD,
+    KNC_OP_VPSUBD,
+    KNC_OP_VPMULLD,
+    KNC_OP_VPANDD,
+    KNC_OP_VPORD,
+    KNC_OP_VPXORD,
+    KNC_OP_VADDPS,
+    KNC_OP_VSUBPS,
+    KNC_OP_VMULPS,
+    KNC_OP_VDIVPS,
+    KNC_OP_VMAXPS,
+    KNC_OP_VMINPS,
+    KNC_OP_VFMADD231PS,
+    KNC_OP_VPERMD,
+    KNC_OP_VPBROADCASTD,
+    KNC_OP_VCMPPS,
+    KNC_OP_VLOAD,             // vmovaps/vmovups/vmovdqa32/vmovdqu32 load
+    KNC_OP_VSTORE,            // vmovaps/vmovups/vmovdqa32/vmovdqu32 store
+    KNC_OP_VGATHERDPS,
+    KNC_OP_VSCATTERDPS,
+    // KNL AVX-512F/CD/ER/PF
+    KNC_OP_VEXPAND,           // vexpandps/vpexpandd
+    KNC_OP_VCOMPRESS,         // vcompressps/vpcompressd
+    KNC_OP_VPERMT2D,          // vpermt2d/vpermt2ps
+    KNC_OP_VPCONFLICTD,
+    KNC_OP_VPLZCNTD,
+    KNC_OP_VRCP28PS,
+    KNC_OP_VRSQRT28PS,
+    KNC_OP_VEXP2PS,
+    KNC_OP_VGATHERPFDPS,      // vgatherpf0dps/vgatherpf1dps
+    KNC_OP_VSCATTERPFDPS,     // vscatterpf0dps/vscatterpf1dps
+    // KNC-only vector instructions
+    KNC_OP_VLOADUNPACKL,      // vloadunpackld/vloadunpacklps
+    KNC_OP_VLOADUNPACKH,      // vloadunpackhd/vloadunpackhps
+    KNC_OP_VPACKSTOREL,       // vpackstoreld/vpackstorelps
+    KNC_OP_VPACKSTOREH,       // vpackstorehd/vpackstorehps
+    // 16-bit opmask instructions (KNC two-operand and AVX-512 three-operand forms)
+    KNC_OP_KAND,
+    KNC_OP_KANDN,             // dst = ~src & src2
+    KNC_OP_KOR,
+    KNC_OP_KXOR,
+    KNC_OP_KXNOR,
+    KNC_OP_KNOT,
+    KNC_OP_KMOV,              // k <- k/m16, or m16 <- k
+    KNC_OP_KMOV_FROM_GPR,
+    KNC_OP_KMOV_TO_GPR,
+    KNC_OP_KORTEST,
+    KNC_OP_COUNT
+} knc_exec_op_t;
+
+// Decoded instruction flags
+#define KNC_DECODE_MEM_DST    0x0001  // Destination is the memory operand
+#define KNC_DECODE_MEM_SRC    0x0002  // Source is the memory operand
+#define KNC_DECODE_SRC_IMM    0x0004  // Source is the immediate
+#define KNC_DECODE_LOCK       0x0008  // LOCK prefix present
+#define KNC_DECODE_REP        0x0010  // F3 prefix present
+#define KNC_DECODE_VECTOR     0x0020  // 512-bit vector instruction
+#define KNC_DECODE_ZEROING    0x0040  // Zeroing (rather than merging) write-mask
+#define KNC_DECODE_BROADCAST  0x0080  // Memory source is a broadcast element
+#define KNC_DECODE_BRANCH     0x0100  // Control transfer - ends a basic block
+#define KNC_DECODE_FLOAT      0x0200  // Memory conversions produce or consume float32 lanes
+#define KNC_DECODE_HIGH_BYTE  0x0400  // Byte registers 4-7 are AH, CH, DH, BH (no REX prefix)
+
+// KNC (MVEX) operand conversions. A register source is swizzled within each
+// group of four lanes (named from lane 3 down to lane 0); a memory source is
+// broadcast or up-converted from a narrower format, and a store
+// down-converted to one.
+typedef enum {
+    KNC_CONV_NONE = 0,
+    KNC_SWIZZLE_CDAB,         // Swap adjacent lanes
+    KNC_SWIZZLE_BADC,         // Swap lane pairs
+    KNC_SWIZZLE_DACB,         // Rotate the low three lanes (cross product)
+    KNC_SWIZZLE_AAAA,         // Replicate one lane
+    KNC_SWIZZLE_BBBB,
+    KNC_SWIZZLE_CCCC,
+    KNC_SWIZZLE_DDDD,
+    KNC_CONV_1TO16,           // One 32-bit element to every lane
+    KNC_CONV_4TO16,           // Four 32-bit elements to every group
+    KNC_CONV_FLOAT16,
+    KNC_CONV_UINT8,
+    KNC_CONV_SINT8,
+    KNC_CONV_UINT16,
+    KNC_CONV_SINT16
+} knc_conversion_t;
+
+// Bytes per memory element of a conversion; 4 when elements are not converted
+static inline uint32_t knc_conversion_element_size(uint8_t conversion) {
+    switch (conversion) {
+        case KNC_CONV_FLOAT16:
+        case KNC_CONV_UINT16:
+        case KNC_CONV_SINT16:
+            return 2;
+        case KNC_CONV_UINT8:
+        case KNC_CONV_SINT8:
+            return 1;
+        default:
+            return 4;
+    }
+}
+
+// Memory operand of a decoded instruction
+typedef struct {
+    int32_t displacement;
+    uint8_t base;     // knc_gpr_t, KNC_REG_RIP or KNC_REG_NONE
+    uint8_t index;    // knc_gpr_t, zmm number for gathers, or KNC_REG_NONE
+    uint8_t scale;    // 1, 2, 4 or 8
+    uint8_t segment;  // 0, or 0x64/0x65 for FS/GS overrides
+} knc_memory_operand_t;
+
+class KNCRuntime;
+struct knc_decoded_instruction_s;
+
+// Interpreter handler bound to a decoded instruction
+typedef knc_error_t (*knc_instruction_handler_t)(KNCRuntime& runtime, knc_core_state_t& core,
+                                                 const struct knc_decoded_instruction_s& inst);
+
+// Host code compiled from a translated block by the JIT; returns a KNC_JIT_EXIT_* status
+typedef uint32_t (*knc_jit_entry_t)(knc_core_state_t* core);
+
+// Predecoded guest instruction - decoded once, executed many times
+typedef struct knc_decoded_instruction_s {
+    knc_instruction_handler_t handler;
+    uint64_t address;           // Guest address of the instruction
+    int64_t immediate;          // Immediate, absolute target for relative branches, or movzx/movsx source size
+    knc_memory_operand_t memory;
+    uint16_t op;                // knc_exec_op_t
+    uint16_t flags;             // KNC_DECODE_* bits
+    uint8_t length;             // Instruction length in bytes
+    uint8_t operand_size;       // Scalar operand size in bytes (vector ops use 64)
+    uint8_t dst;                // Destination register
+    uint8_t src;                // Source register (first source for vector ops)
+    uint8_t src2;               // Second source register (vector register form)
+    uint8_t mask;               // Opmask register k0-k7 (k0 = unmasked)
+    uint8_t condition;          // Jcc condition code, VCMPPS predicate or prefetch level
+    uint8_t conversion;         // knc_conversion_t of a KNC (MVEX) vector instruction
+} knc_decoded_instruction_t;
+
 // Architecture Detection Functions
 static inline knc_architecture_t detect_host_architecture() {
     // Simple CPUID-based detection for now
@@ -0,0 +1,94 @@
+#ifndef KNC_VECTOR_BACKEND_H
+#define KNC_VECTOR_BACKEND_H
+
+#include <cstdint>
+#include "knc_types.h"
+
+// Host implementations of the emulated 512-bit vector operations
+typedef enum {
+    KNC_VECTOR_BACKEND_SCALAR = 0,   // Portable C++, one lane at a time
+    KNC_VECTOR_BACKEND_AVX2 = 1,     // Two 256-bit halves per operation (AVX2 + FMA)
+    KNC_VECTOR_BACKEND_AVX512 = 2,   // One host instruction per operation (AVX-512F + CD)
+    KNC_VECTOR_BACKEND_AUTO = 3      // Best backend the host CPU supports
+} knc_vector_backend_t;
+
+typedef void (*knc_vector_unary_fn_t)(knc_vector_t& dst, const knc_vector_t& a);
+typedef void (*knc_vector_binary_fn_t)(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b);
+typedef void (*knc_vector_ternary_fn_t)(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b,
+                                        const knc_vector_t& c);
+typedef void (*knc_vector_mask_fn_t)(knc_vector_t& dst, const knc_vector_t& src, knc_mask_t mask, bool zeroing);
+typedef void (*knc_vector_swizzle_fn_t)(knc_vector_t& dst, const knc_vector_t& src, uint8_t swizzle);
+typedef void (*knc_vector_upconvert_fn_t)(knc_vector_t& dst, const void* src, uint8_t format, bool to_float);
+typedef void (*knc_vector_downconvert_fn_t)(void* dst, const knc_vector_t& src, uint8_t format, bool from_float);
+typedef void (*knc_vector_gather_fn_t)(knc_vector_t& dst, const uint64_t addresses[KNC_VECTOR_LANES], knc_mask_t mask);
+typedef void (*knc_vector_scatter_fn_t)(const uint64_t addresses[KNC_VECTOR_LANES], const knc_vector_t& src,
+                                        knc_mask_t mask);
+
+// Kernel table for one backend. Every backend produces bit-identical results.
+typedef struct {
+    knc_vector_backend_t backend;
+    const char* name;
+
+    // Dword integer operations
+    knc_vector_binary_fn_t add_epi32;
+    knc_vector_binary_fn_t sub_epi32;
+    knc_vector_binary_fn_t mullo_epi32;
+    knc_vector_binary_fn_t and_epi32;
+    knc_vector_binary_fn_t or_epi32;
+    knc_vector_binary_fn_t xor_epi32;
+    knc_vector_binary_fn_t permutexvar_epi32;  // dst[i] = b[a[i] & 15]
+
+    // Single precision operations
+    knc_vector_binary_fn_t add_ps;
+    knc_vector_binary_fn_t sub_ps;
+    knc_vector_binary_fn_t mul_ps;
+    knc_vector_binary_fn_t div_ps;
+    knc_vector_binary_fn_t max_ps;
+    knc_vector_binary_fn_t min_ps;
+    knc_vector_ternary_fn_t fmadd_ps;          // dst = a * b + c, single rounding
+
+    // Write-masked move: lanes with a clear mask bit keep dst, or are zeroed
+    knc_vector_mask_fn_t mask_mov_epi32;
+
+    // KNL AVX-512F/CD/ER operations. The ER approximations are computed in
+    // double precision and rounded once, so they are exact to well past the
+    // 2^-28 the hardware guarantees; denormal inputs and results are zero, as
+    // on KNL. The AVX2 backend runs these with the scalar kernels.
+    knc_vector_mask_fn_t expand_epi32;          // Consecutive src lanes into the lanes with a set mask bit
+    knc_vector_mask_fn_t compress_epi32;        // Lanes with a set mask bit packed into the low lanes
+    knc_vector_ternary_fn_t permutex2var_epi32; // dst[i] = (b[i] & 16 ? c : a)[b[i] & 15]
+    knc_vector_unary_fn_t conflict_epi32;       // dst[i] = bit j set for each j < i with a[j] == a[i]
+    knc_vector_unary_fn_t lzcnt_epi32;
+    knc_vector_unary_fn_t rcp28_ps;
+    knc_vector_unary_fn_t rsqrt28_ps;
+    knc_vector_unary_fn_t exp2_ps;
+
+    // KNC operand conversions. swizzle_epi32 takes a KNC_SWIZZLE_*; the
+    // conversions move sixteen elements of a KNC_CONV_FLOAT16..SINT16 memory
+    // format to or from 32-bit lanes holding float32 or int32 values. Float
+    // down-conversions round to nearest even and saturate; integer ones
+    // truncate. src and dst may overlap. The AVX2 backend swizzles with host
+    // shuffles and converts with the scalar kernels.
+    knc_vector_swizzle_fn_t swizzle_epi32;
+    knc_vector_upconvert_fn_t upconvert;
+    knc_vector_downconvert_fn_t downconvert;
+
+    // Dword gather and scatter through host addresses, one per lane; lanes
+    // with a clear mask bit are not accessed. Scatters write in lane order,
+    // so the highest lane wins when addresses repeat. The AVX2 backend
+    // scatters with the scalar kernel.
+    knc_vector_gather_fn_t gather_epi32;
+    knc_vector_scatter_fn_t scatter_epi32;
+} knc_vector_ops_t;
+
+// Backend selection
+knc_vector_backend_t knc_detect_vector_backend();
+bool knc_vector_backend_supported(knc_vector_backend_t backend);
+const knc_vector_ops_t* knc_get_vector_ops(knc_vector_backend_t backend);  // nullptr if unsupported
+const char* knc_vector_backend_name(knc_vector_backend_t backend);
+bool knc_parse_vector_backend(const char* name, knc_vector_backend_t& backend);
+
+// Time every kernel on every backend this host supports and print the results
+void knc_benchmark_vector_backends(uint64_t iterations);
+
+#endif // KNC_VECTOR_BACKEND_H
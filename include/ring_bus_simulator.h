@@ -83,6 +83,8 @@ private:
     std::vector<dtd_tile_state_t> dtd_tiles;
     uint32_t cache_line_size;  // 64 bytes for KNC
     uint32_t associativity;    // 8-way set associative
+    std::mutex dtd_mutex;      // Directory updates from emulated cores
+    std::atomic<uint64_t> contended_lines;
     
     // Simulation state
     std::atomic<bool> running;
@@ -177,6 +179,12 @@ public:
     bool simulate_tile_communication(uint32_t source_tile, uint32_t dest_tile,
                                 const void* data, uint32_t size);
     bool simulate_broadcast(uint32_t source_tile, const void* data, uint32_t size);
+    
+    // A guest atomic found its cache line last written by another tile: move
+    // the line to the requesting tile in the directory. Safe to call from
+    // any emulation worker.
+    void record_contended_line(uint64_t address, uint32_t requesting_tile);
+    uint64_t get_contended_lines() const;
     bool simulate_reduce_operation(uint32_t tile_group, const void* data, uint32_t size);
     
     // Debugging
@@ -42,6 +42,23 @@ typedef enum {
     XED_ICLASS_VMAXPS = 108,
     XED_ICLASS_VMINPS = 109,
     
+    // KNL AVX-512F/CD/ER/PF instructions
+    XED_ICLASS_VEXPANDPS = 110,
+    XED_ICLASS_VPEXPANDD = 111,
+    XED_ICLASS_VCOMPRESSPS = 112,
+    XED_ICLASS_VPCOMPRESSD = 113,
+    XED_ICLASS_VPERMT2D = 114,
+    XED_ICLASS_VPERMT2PS = 115,
+    XED_ICLASS_VPCONFLICTD = 116,
+    XED_ICLASS_VPLZCNTD = 117,
+    XED_ICLASS_VRCP28PS = 118,
+    XED_ICLASS_VRSQRT28PS = 119,
+    XED_ICLASS_VEXP2PS = 120,
+    XED_ICLASS_VGATHERPF0DPS = 121,
+    XED_ICLASS_VGATHERPF1DPS = 122,
+    XED_ICLASS_VSCATTERPF0DPS = 123,
+    XED_ICLASS_VSCATTERPF1DPS = 124,
+    
     // KNC-specific instructions
     XED_ICLASS_KNC_VPADDD = 200,
     XED_ICLASS_KNC_VPSUBD = 201,
@@ -26,6 +26,10 @@
 #pragma comment(lib, "ws2_32.lib")
 #else
 #include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 // ELF constants
@@ -36,19 +40,32 @@
 #define PF_X 1
 #define PF_W 2
 #define PF_R 4
+#define SHT_PROGBITS 1
 #define SHT_SYMTAB 2
 #define SHT_STRTAB 3
 #define SHT_RELA 4
+#define STT_FUNC 2
 
 KNCBinaryLoader::KNCBinaryLoader() {
-    memset(&binary_info, 0, sizeof(binary_info));
+    binary_info.entry_point = 0;
+    binary_info.is_knc_binary = false;
+    binary_info.text_section.address = 0;
+    binary_info.text_section.size = 0;
+    file_data = nullptr;
+    file_size = 0;
+    file_descriptor = -1;
 }
 
 KNCBinaryLoader::~KNCBinaryLoader() {
+    unmap_file_image();
 }
 
 bool KNCBinaryLoader::load_binary(const std::string& filename) {
     binary_info.filename = filename;
+    binary_info.segments.clear();
+    binary_info.text_section.address = 0;
+    binary_info.text_section.size = 0;
+    unmap_file_image();
     
     FILE* file = fopen(filename.c_str(), "rb");
     if (!file) {
@@ -92,6 +109,17 @@ bool KNCBinaryLoader::load_binary(const std::string& filename) {
     
     fclose(file);
     
+    if (!map_file_image(filename)) {
+        return false;
+    }
+    for (const knc_elf_segment_t& segment : binary_info.segments) {
+        if (segment.file_offset > file_size || segment.file_size > file_size - segment.file_offset) {
+            std::cerr << "Error: Segment at 0x" << std::hex << segment.virtual_address << std::dec
+                      << " extends past the end of the file\n";
+            return false;
+        }
+    }
+    
     std::cout << "Successfully loaded KNC binary: " << filename << "\n";
     std::cout << "Entry point: 0x" << std::hex << binary_info.entry_point << std::dec << "\n";
     
@@ -137,33 +165,20 @@ bool KNCBinaryLoader::read_program_headers(FILE* file, const elf64_header_t* hea
             return false;
         }
         
-        // Load loadable segments
-        if (phdr.p_type == PT_LOAD) {
-            std::vector<uint8_t> segment_data(phdr.p_memsz);
-            
-            // Seek to segment data
-            fseek(file, phdr.p_offset, SEEK_SET);
-            
-            // Read segment data
-            if (fread(segment_data.data(), phdr.p_filesz, 1, file) != 1) {
-                std::cerr << "Error: Cannot read segment data\n";
+        // Record loadable segments; their contents stay in the file image
+        if (phdr.p_type == PT_LOAD && phdr.p_memsz > 0) {
+            if (phdr.p_filesz > phdr.p_memsz) {
+                std::cerr << "Error: Segment " << i << " has more file bytes than memory bytes\n";
                 return false;
             }
-            
-            // Zero-fill remaining bytes if memsz > filesz
-            if (phdr.p_memsz > phdr.p_filesz) {
-                memset(segment_data.data() + phdr.p_filesz, 0, 
-                       phdr.p_memsz - phdr.p_filesz);
-            }
-            
-            // Store segment based on permissions
-            if (phdr.p_flags & PF_X) {
-                // Executable segment (text)
-                binary_info.text_section = segment_data;
-            } else if (phdr.p_flags & PF_W) {
-                // Writable segment (data)
-                binary_info.data_section = segment_data;
-            }
+            knc_elf_segment_t segment;
+            segment.virtual_address = phdr.p_vaddr;
+            segment.file_offset = phdr.p_offset;
+            segment.file_size = phdr.p_filesz;
+            segment.memory_size = phdr.p_memsz;
+            segment.writable = (phdr.p_flags & PF_W) != 0;
+            segment.executable = (phdr.p_flags & PF_X) != 0;
+            binary_info.segments.push_back(segment);
         }
     }
     
@@ -184,6 +199,22 @@ bool KNCBinaryLoader::read_section_headers(FILE* file, const elf64_header_t* hea
         return false;
     }
     
+    // Find .text through the section name string table
+    if (header->e_shstrndx < header->e_shnum) {
+        const elf64_section_header_t& names = sections[header->e_shstrndx];
+        std::vector<char> strings(names.sh_size + 1, '\0');
+        fseek(file, names.sh_offset, SEEK_SET);
+        if (names.sh_size > 0 && fread(strings.data(), names.sh_size, 1, file) == 1) {
+            for (const elf64_section_header_t& shdr : sections) {
+                if (shdr.sh_type == SHT_PROGBITS && shdr.sh_name < names.sh_size &&
+                    strcmp(&strings[shdr.sh_name], ".text") == 0) {
+                    binary_info.text_section.address = shdr.sh_addr;
+                    binary_info.text_section.size = shdr.sh_size;
+                }
+            }
+        }
+    }
+    
     // Process each section
     for (int i = 0; i < header->e_shnum; i++) {
         const elf64_section_header_t& shdr = sections[i];
@@ -250,18 +281,61 @@ const knc_binary_info_t& KNCBinaryLoader::get_binary_info() const {
     return binary_info;
 }
 
-const uint8_t* KNCBinaryLoader::get_binary_data() const {
-    if (!binary_info.text_section.empty()) {
-        return binary_info.text_section.data();
+bool KNCBinaryLoader::map_file_image(const std::string& filename) {
+#ifndef _WIN32
+    file_descriptor = open(filename.c_str(), O_RDONLY);
+    struct stat info;
+    if (file_descriptor >= 0 && fstat(file_descriptor, &info) == 0 && info.st_size > 0) {
+        void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+        if (mapping != MAP_FAILED) {
+            file_data = static_cast<const uint8_t*>(mapping);
+            file_size = info.st_size;
+            return true;
+        }
+    }
+    if (file_descriptor >= 0) {
+        close(file_descriptor);
+        file_descriptor = -1;
     }
-    return binary_info.data_section.data();
+#endif
+    
+    // No mapping: read the file once instead
+    std::ifstream input(filename, std::ios::binary);
+    file_buffer.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    if (!input.good() && !input.eof()) {
+        std::cerr << "Error: Cannot read file " << filename << "\n";
+        return false;
+    }
+    file_data = file_buffer.data();
+    file_size = file_buffer.size();
+    return true;
 }
 
-uint64_t KNCBinaryLoader::get_binary_size() const {
-    if (!binary_info.text_section.empty()) {
-        return binary_info.text_section.size();
+void KNCBinaryLoader::unmap_file_image() {
+#ifndef _WIN32
+    if (file_data && file_buffer.empty()) {
+        munmap(const_cast<uint8_t*>(file_data), file_size);
     }
-    return binary_info.data_section.size();
+    if (file_descriptor >= 0) {
+        close(file_descriptor);
+    }
+#endif
+    file_buffer.clear();
+    file_data = nullptr;
+    file_size = 0;
+    file_descriptor = -1;
+}
+
+const uint8_t* KNCBinaryLoader::get_file_data() const {
+    return file_data;
+}
+
+uint64_t KNCBinaryLoader::get_file_size() const {
+    return file_size;
+}
+
+int KNCBinaryLoader::get_file_descriptor() const {
+    return file_descriptor;
 }
 
 uint64_t KNCBinaryLoader::get_entry_point() const {
@@ -279,6 +353,16 @@ bool KNCBinaryLoader::resolve_symbol(const std::string& name, uint64_t& address)
     return false;
 }
 
+std::vector<uint64_t> KNCBinaryLoader::get_function_addresses() const {
+    std::vector<uint64_t> addresses(1, binary_info.entry_point);
+    for (const elf64_symbol_t& symbol : binary_info.symbols) {
+        if ((symbol.st_info & 0xF) == STT_FUNC && symbol.st_value != 0) {
+            addresses.push_back(symbol.st_value);
+        }
+    }
+    return addresses;
+}
+
 std::vector<std::string> KNCBinaryLoader::get_symbol_names() const {
     std::vector<std::string> names;
     // Simplified - would need string table support
@@ -296,8 +380,15 @@ void KNCBinaryLoader::print_binary_info() const {
     std::cout << "Filename: " << binary_info.filename << "\n";
     std::cout << "Entry point: 0x" << std::hex << binary_info.entry_point << std::dec << "\n";
     std::cout << "KNC binary: " << (binary_info.is_knc_binary ? "Yes" : "No") << "\n";
-    std::cout << "Text section size: " << binary_info.text_section.size() << " bytes\n";
-    std::cout << "Data section size: " << binary_info.data_section.size() << " bytes\n";
+    for (const knc_elf_segment_t& segment : binary_info.segments) {
+        std::cout << "Segment 0x" << std::hex << segment.virtual_address << std::dec << ": "
+                  << segment.file_size << " file bytes, " << segment.memory_size << " memory bytes, "
+                  << (segment.writable ? "rw" : "r-") << (segment.executable ? "x" : "-") << "\n";
+    }
+    if (binary_info.text_section.size > 0) {
+        std::cout << ".text: 0x" << std::hex << binary_info.text_section.address << std::dec << ", "
+                  << binary_info.text_section.size << " bytes\n";
+    }
     std::cout << "Symbols: " << binary_info.symbols.size() << "\n";
     std::cout << "Relocations: " << binary_info.relocations.size() << "\n";
 }
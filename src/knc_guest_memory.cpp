@@ -0,0 +1,577 @@
+/*
+ * Copyright (c) 2026 IMIC_SDS Development Team
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "knc_guest_memory.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <signal.h>
+#include <ucontext.h>
+#include <unistd.h>
+#endif
+
+// Pages inspected per mincore() call when counting resident pages
+#define RESIDENCY_SCAN_PAGES (256 * 1024)
+
+// Guest memories that may be alive at once
+#define MAX_GUARD_WINDOWS 8
+
+#if defined(MAP_HUGETLB) && !defined(MAP_HUGE_SHIFT)
+#define MAP_HUGE_SHIFT 26
+#endif
+
+// ---------------------------------------------------------------------------
+// Guest fault handling
+//
+// Every reserved window is registered here. A host fault inside a window is a
+// guest access outside guest memory: generated code is sent to the resume
+// point its owner registered, anything else long-jumps to the recovery point
+// armed on the faulting thread. Faults elsewhere go to the previous handler.
+// ---------------------------------------------------------------------------
+
+namespace {
+
+// Window start of a slot claimed by allocate() but not yet published
+const uintptr_t GUARD_WINDOW_CLAIMED = ~static_cast<uintptr_t>(0);
+
+struct knc_guard_window_t {
+    std::atomic<uintptr_t> start;  // 0 = free slot, published last
+    std::atomic<uintptr_t> end;
+    std::atomic<knc_fault_redirect_fn_t> redirect;
+    std::atomic<void*> redirect_context;
+};
+
+knc_guard_window_t guard_windows[MAX_GUARD_WINDOWS];
+thread_local knc_fault_jmp_buf_t* fault_recovery = nullptr;
+std::once_flag fault_handler_installed;
+
+const knc_guard_window_t* find_guard_window(uintptr_t address) {
+    for (const knc_guard_window_t& window : guard_windows) {
+        uintptr_t start = window.start.load(std::memory_order_acquire);
+        if (start && start != GUARD_WINDOW_CLAIMED && address >= start &&
+            address < window.end.load(std::memory_order_relaxed)) {
+            return &window;
+        }
+    }
+    return nullptr;
+}
+
+#ifdef _WIN32
+LONG CALLBACK guest_fault_filter(EXCEPTION_POINTERS* info) {
+    if (info->ExceptionRecord->ExceptionCode != EXCEPTION_ACCESS_VIOLATION) {
+        return EXCEPTION_CONTINUE_SEARCH;
+    }
+    uintptr_t address = static_cast<uintptr_t>(info->ExceptionRecord->ExceptionInformation[1]);
+    if (find_guard_window(address) && fault_recovery) {
+        longjmp(*fault_recovery, 1);
+    }
+    return EXCEPTION_CONTINUE_SEARCH;
+}
+
+void install_fault_handler() {
+    AddVectoredExceptionHandler(1, guest_fault_filter);
+}
+#else
+struct sigaction previous_segv_action;
+
+// Point the interrupted context at resume if the owner of the window has one for this PC
+bool redirect_faulting_pc(const knc_guard_window_t& window, void* context) {
+    knc_fault_redirect_fn_t redirect = window.redirect.load(std::memory_order_acquire);
+    if (!redirect) {
+        return false;
+    }
+    ucontext_t* uc = static_cast<ucontext_t*>(context);
+#if defined(__linux__) && defined(__x86_64__)
+    uintptr_t resume = redirect(window.redirect_context.load(std::memory_order_relaxed),
+                                static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_RIP]));
+    if (resume) {
+        uc->uc_mcontext.gregs[REG_RIP] = static_cast<greg_t>(resume);
+        return true;
+    }
+#elif defined(__APPLE__) && defined(__x86_64__)
+    uintptr_t resume = redirect(window.redirect_context.load(std::memory_order_relaxed),
+                                static_cast<uintptr_t>(uc->uc_mcontext->__ss.__rip));
+    if (resume) {
+        uc->uc_mcontext->__ss.__rip = resume;
+        return true;
+    }
+#else
+    (void)uc;
+#endif
+    return false;
+}
+
+void guest_fault_handler(int signal_number, siginfo_t* info, void* context) {
+    const knc_guard_window_t* window = find_guard_window(reinterpret_cast<uintptr_t>(info->si_addr));
+    if (window) {
+        if (redirect_faulting_pc(*window, context)) {
+            return;
+        }
+        if (fault_recovery) {
+            siglongjmp(*fault_recovery, 1);  // SA_NODEFER: the signal mask needs no restoring
+        }
+    }
+
+    // Not a guest access - hand it to the previous handler. With no handler
+    // to chain to, the faulting instruction re-runs under the default action.
+    if (previous_segv_action.sa_flags & SA_SIGINFO) {
+        previous_segv_action.sa_sigaction(signal_number, info, context);
+    } else if (previous_segv_action.sa_handler != SIG_DFL && previous_segv_action.sa_handler != SIG_IGN) {
+        previous_segv_action.sa_handler(signal_number);
+    } else {
+        struct sigaction default_action;
+        memset(&default_action, 0, sizeof(default_action));
+        default_action.sa_handler = SIG_DFL;
+        sigemptyset(&default_action.sa_mask);
+        sigaction(signal_number, &default_action, nullptr);
+    }
+}
+
+void install_fault_handler() {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = guest_fault_handler;
+    action.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGSEGV, &action, &previous_segv_action);
+}
+#endif
+
+}  // namespace
+
+const char* knc_huge_pages_name(knc_huge_pages_t pages) {
+    switch (pages) {
+        case KNC_HUGE_PAGES_THP: return "thp";
+        case KNC_HUGE_PAGES_2M: return "2m";
+        case KNC_HUGE_PAGES_1G: return "1g";
+        default: return "none";
+    }
+}
+
+bool knc_parse_huge_pages(const char* name, knc_huge_pages_t& pages) {
+    static const knc_huge_pages_t modes[] = {
+        KNC_HUGE_PAGES_NONE, KNC_HUGE_PAGES_THP, KNC_HUGE_PAGES_2M, KNC_HUGE_PAGES_1G
+    };
+    for (knc_huge_pages_t candidate : modes) {
+        if (strcmp(name, knc_huge_pages_name(candidate)) == 0) {
+            pages = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+KNCGuestMemory::KNCGuestMemory() {
+    base = nullptr;
+    size = 0;
+    huge_bytes = 0;
+    reservation = nullptr;
+    reservation_size = 0;
+    backing = KNC_HUGE_PAGES_NONE;
+    window_slot = -1;
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    host_page_size = info.dwPageSize;
+#else
+    host_page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    backing_page_size = host_page_size;
+}
+
+KNCGuestMemory::~KNCGuestMemory() {
+    release();
+}
+
+bool KNCGuestMemory::allocate(uint64_t bytes, knc_huge_pages_t pages) {
+    if (base) {
+        std::cerr << "Error: Guest memory already allocated\n";
+        return false;
+    }
+    if (bytes == 0 || bytes > KNC_GUEST_ADDRESS_MASK + 1) {
+        return false;
+    }
+
+    size_t alignment = (pages == KNC_HUGE_PAGES_1G) ? HUGE_PAGE_1G :
+                       (pages != KNC_HUGE_PAGES_NONE) ? HUGE_PAGE_2M : host_page_size;
+    if (!reserve_window(alignment)) {
+        std::cerr << "Error: Failed to reserve the guest address window\n";
+        return false;
+    }
+
+    // Reserved hugetlbfs pages first, then progressively weaker requests.
+    // Any tail smaller than a huge page uses base pages, so the guard region
+    // still starts exactly at the end of guest memory.
+    bool mapped = false;
+    if (pages == KNC_HUGE_PAGES_1G) {
+        mapped = map_hugetlb(bytes, HUGE_PAGE_1G);
+        if (!mapped) {
+            std::cout << "Guest memory: no 1 GiB huge pages available, trying 2 MiB\n";
+        }
+    }
+    if (!mapped && (pages == KNC_HUGE_PAGES_1G || pages == KNC_HUGE_PAGES_2M)) {
+        mapped = map_hugetlb(bytes, HUGE_PAGE_2M);
+        if (!mapped) {
+            std::cout << "Guest memory: no 2 MiB huge pages available, using transparent huge pages\n";
+        }
+    }
+    if (mapped) {
+        mapped = (huge_bytes == bytes) || map_base_pages(huge_bytes, bytes - huge_bytes, false);
+    } else {
+        mapped = map_base_pages(0, bytes, pages != KNC_HUGE_PAGES_NONE);
+    }
+    if (!mapped) {
+        std::cerr << "Error: Failed to reserve " << (bytes / (1024 * 1024)) << " MB of guest memory\n";
+        release();
+        return false;
+    }
+    size = bytes;
+
+    // Make faults in the window recoverable
+    std::call_once(fault_handler_installed, install_fault_handler);
+    for (int slot = 0; slot < MAX_GUARD_WINDOWS; slot++) {
+        // Claim the slot, then publish its start once end is in place, so
+        // the fault handler never pairs a start with another window's end
+        uintptr_t expected = 0;
+        knc_guard_window_t& window = guard_windows[slot];
+        if (window.start.compare_exchange_strong(expected, GUARD_WINDOW_CLAIMED, std::memory_order_acq_rel)) {
+            window.end.store(reinterpret_cast<uintptr_t>(reservation + reservation_size), std::memory_order_relaxed);
+            window.start.store(reinterpret_cast<uintptr_t>(reservation), std::memory_order_release);
+            window_slot = slot;
+            break;
+        }
+    }
+    if (window_slot < 0) {
+        std::cerr << "Error: Too many guest memories alive at once\n";
+        release();
+        return false;
+    }
+    return true;
+}
+
+bool KNCGuestMemory::reserve_window(size_t alignment) {
+    // The whole guest physical address space, plus room for an access that
+    // starts at its last byte, plus slack to align the base
+    reservation_size = (KNC_GUEST_ADDRESS_MASK + 1) + GUARD_TAIL + alignment;
+#ifdef _WIN32
+    void* mapping = VirtualAlloc(nullptr, reservation_size, MEM_RESERVE, PAGE_NOACCESS);
+    if (!mapping) {
+        reservation_size = 0;
+        return false;
+    }
+#else
+    void* mapping = mmap(nullptr, reservation_size, PROT_NONE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapping == MAP_FAILED) {
+        reservation_size = 0;
+        return false;
+    }
+#endif
+    reservation = static_cast<uint8_t*>(mapping);
+    base = reinterpret_cast<uint8_t*>(
+        (reinterpret_cast<uintptr_t>(reservation) + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1));
+    return true;
+}
+
+bool KNCGuestMemory::map_hugetlb(uint64_t bytes, size_t page_size) {
+#if defined(_WIN32) || !defined(MAP_HUGETLB)
+    (void)bytes;
+    (void)page_size;
+    return false;
+#else
+    // No MAP_NORESERVE: the pool reservation is checked here rather than
+    // surfacing later as SIGBUS on first touch
+    uint64_t whole_pages = bytes & ~static_cast<uint64_t>(page_size - 1);
+    if (whole_pages == 0) {
+        return false;
+    }
+    int page_shift = __builtin_ctzll(page_size);
+    void* mapping = mmap(base, whole_pages, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB | (page_shift << MAP_HUGE_SHIFT),
+                         -1, 0);
+    if (mapping == MAP_FAILED) {
+        // A failed fixed mapping may have dropped the reservation underneath
+        mmap(base, whole_pages, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+        return false;
+    }
+
+    huge_bytes = whole_pages;
+    backing_page_size = page_size;
+    backing = (page_size == HUGE_PAGE_1G) ? KNC_HUGE_PAGES_1G : KNC_HUGE_PAGES_2M;
+    return true;
+#endif
+}
+
+bool KNCGuestMemory::map_base_pages(uint64_t offset, uint64_t bytes, bool transparent_huge_pages) {
+#ifdef _WIN32
+    // Committed pages are still zero-filled on first touch
+    (void)transparent_huge_pages;
+    return VirtualAlloc(base + offset, bytes, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+    uint64_t rounded = (bytes + host_page_size - 1) & ~static_cast<uint64_t>(host_page_size - 1);
+    void* mapping = mmap(base + offset, rounded, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (transparent_huge_pages && madvise(base + offset, rounded, MADV_HUGEPAGE) != 0) {
+        std::cout << "Guest memory: transparent huge pages unavailable, using base pages\n";
+        transparent_huge_pages = false;
+    }
+#else
+    transparent_huge_pages = false;
+#endif
+    if (transparent_huge_pages) {
+        backing = KNC_HUGE_PAGES_THP;
+    }
+    return true;
+#endif
+}
+
+void KNCGuestMemory::release() {
+    file_ranges.clear();
+    if (window_slot >= 0) {
+        guard_windows[window_slot].redirect.store(nullptr, std::memory_order_relaxed);
+        guard_windows[window_slot].start.store(0, std::memory_order_release);
+        window_slot = -1;
+    }
+    if (reservation) {
+#ifdef _WIN32
+        VirtualFree(reservation, 0, MEM_RELEASE);
+#else
+        munmap(reservation, reservation_size);
+#endif
+    }
+    base = nullptr;
+    size = 0;
+    huge_bytes = 0;
+    reservation = nullptr;
+    reservation_size = 0;
+    backing_page_size = host_page_size;
+    backing = KNC_HUGE_PAGES_NONE;
+}
+
+bool KNCGuestMemory::read(uint64_t address, void* data, size_t bytes) const {
+    // host_address wraps addresses beyond the window back into guest memory
+    if (address >= size || bytes > size - address) {
+        return false;
+    }
+    knc_fault_jmp_buf_t recovery;
+    knc_fault_jmp_buf_t* previous = arm_fault_recovery(&recovery);
+    if (KNC_GUEST_FAULT_SETJMP(recovery)) {
+        disarm_fault_recovery(previous);
+        return false;
+    }
+    memcpy(data, host_address(address), bytes);
+    disarm_fault_recovery(previous);
+    return true;
+}
+
+bool KNCGuestMemory::write(uint64_t address, const void* data, size_t bytes) {
+    if (address >= size || bytes > size - address) {
+        return false;
+    }
+    knc_fault_jmp_buf_t recovery;
+    knc_fault_jmp_buf_t* previous = arm_fault_recovery(&recovery);
+    if (KNC_GUEST_FAULT_SETJMP(recovery)) {
+        disarm_fault_recovery(previous);
+        return false;
+    }
+    memcpy(host_address(address), data, bytes);
+    disarm_fault_recovery(previous);
+    return true;
+}
+
+bool KNCGuestMemory::map_file(uint64_t address, int fd, uint64_t file_offset, uint64_t bytes) {
+#ifdef _WIN32
+    (void)address;
+    (void)fd;
+    (void)file_offset;
+    (void)bytes;
+    return false;
+#else
+    uint64_t page_mask = host_page_size - 1;
+    if (fd < 0 || bytes == 0 || address + bytes > size || address < huge_bytes ||
+        ((address ^ file_offset) & page_mask)) {
+        return false;
+    }
+    uint64_t start = address & ~page_mask;
+    uint64_t length = ((address + bytes + page_mask) & ~page_mask) - start;
+    if (start + length > size) {
+        return false;  // Would cover the guard region
+    }
+    void* mapping = mmap(base + start, length, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd,
+                         static_cast<off_t>(file_offset & ~page_mask));
+    if (mapping == MAP_FAILED) {
+        map_base_pages(start, length, backing == KNC_HUGE_PAGES_THP);  // Restore what MAP_FIXED dropped
+        return false;
+    }
+    file_ranges.push_back({start, length});
+    return true;
+#endif
+}
+
+void KNCGuestMemory::discard_file_mappings() {
+    for (const knc_file_range_t& range : file_ranges) {
+        map_base_pages(range.offset, range.bytes, backing == KNC_HUGE_PAGES_THP);
+    }
+    file_ranges.clear();
+}
+
+uint64_t KNCGuestMemory::file_mapped_bytes() const {
+    uint64_t total = 0;
+    for (const knc_file_range_t& range : file_ranges) {
+        total += range.bytes;
+    }
+    return total;
+}
+
+void KNCGuestMemory::zero(uint64_t address, uint64_t bytes) {
+    if (bytes == 0 || address >= size) {
+        return;
+    }
+    bytes = std::min<uint64_t>(bytes, size - address);
+    
+    // Whole base pages are dropped, so they cost nothing until touched again
+    uint64_t page_mask = host_page_size - 1;
+    uint64_t first = std::max<uint64_t>((address + page_mask) & ~page_mask, huge_bytes);
+    uint64_t last = (address + bytes) & ~page_mask;
+#if defined(_WIN32) || !defined(MADV_DONTNEED)
+    last = first;
+#endif
+    if (first >= last) {
+        memset(base + address, 0, bytes);
+        return;
+    }
+#if !defined(_WIN32) && defined(MADV_DONTNEED)
+    madvise(base + first, last - first, MADV_DONTNEED);
+#endif
+    memset(base + address, 0, first - address);
+    memset(base + last, 0, address + bytes - last);
+}
+
+void KNCGuestMemory::set_fault_redirect(knc_fault_redirect_fn_t redirect, void* context) {
+    if (window_slot < 0) {
+        return;
+    }
+    knc_guard_window_t& window = guard_windows[window_slot];
+    window.redirect_context.store(context, std::memory_order_relaxed);
+    window.redirect.store(redirect, std::memory_order_release);
+}
+
+knc_fault_jmp_buf_t* KNCGuestMemory::arm_fault_recovery(knc_fault_jmp_buf_t* env) {
+    knc_fault_jmp_buf_t* previous = fault_recovery;
+    fault_recovery = env;
+    return previous;
+}
+
+void KNCGuestMemory::disarm_fault_recovery(knc_fault_jmp_buf_t* previous) {
+    fault_recovery = previous;
+}
+
+uint64_t KNCGuestMemory::resident_pages() const {
+    if (!base) {
+        return 0;
+    }
+#ifdef _WIN32
+    // Residency is not cheaply queryable; report the whole region
+    return (size + host_page_size - 1) / host_page_size;
+#else
+    uint64_t total_pages = (size + host_page_size - 1) / host_page_size;
+    std::vector<unsigned char> residency(std::min<uint64_t>(total_pages, RESIDENCY_SCAN_PAGES));
+    uint64_t resident = 0;
+
+    for (uint64_t page = 0; page < total_pages; page += residency.size()) {
+        uint64_t count = std::min<uint64_t>(residency.size(), total_pages - page);
+        if (mincore(base + page * host_page_size, count * host_page_size, residency.data()) != 0) {
+            return 0;
+        }
+        for (uint64_t i = 0; i < count; i++) {
+            resident += residency[i] & 1;
+        }
+    }
+    return resident;
+#endif
+}
+
+uint64_t KNCGuestMemory::resident_bytes() const {
+    return resident_pages() * host_page_size;
+}
+
+uint64_t KNCGuestMemory::transparent_huge_bytes() const {
+    // The kernel reports THP usage per mapping in /proc/self/smaps
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    bool in_mapping = false;
+
+    while (std::getline(smaps, line)) {
+        if (!line.empty() && isxdigit(static_cast<unsigned char>(line[0])) && line.find('-') != std::string::npos) {
+            uintptr_t start = static_cast<uintptr_t>(strtoull(line.c_str(), nullptr, 16));
+            in_mapping = (start == reinterpret_cast<uintptr_t>(base));
+            continue;
+        }
+        if (in_mapping && line.compare(0, 14, "AnonHugePages:") == 0) {
+            return strtoull(line.c_str() + 14, nullptr, 10) * 1024;
+        }
+    }
+    return 0;
+}
+
+uint64_t KNCGuestMemory::huge_pages() const {
+    if (!base) {
+        return 0;
+    }
+    switch (backing) {
+        case KNC_HUGE_PAGES_1G:
+        case KNC_HUGE_PAGES_2M:
+            return huge_bytes / backing_page_size;
+        case KNC_HUGE_PAGES_THP:
+            return transparent_huge_bytes() / HUGE_PAGE_2M;
+        default:
+            return 0;
+    }
+}
+
+void KNCGuestMemory::print_statistics() const {
+    uint64_t total_pages = (size + host_page_size - 1) / host_page_size;
+    uint64_t resident = resident_pages();
+
+    std::cout << "Guest memory resident: " << (resident * host_page_size) / 1024 << " KB ("
+              << resident << "/" << total_pages << " host pages touched)\n";
+    if (!file_ranges.empty()) {
+        std::cout << "Guest memory mapped from files: " << file_mapped_bytes() / 1024 << " KB\n";
+    }
+    if (backing != KNC_HUGE_PAGES_NONE) {
+        std::cout << "Guest memory huge pages: " << huge_pages() << " x "
+                  << (backing == KNC_HUGE_PAGES_1G ? "1 GiB" : "2 MiB")
+                  << (backing == KNC_HUGE_PAGES_THP ? " (transparent)" : " (hugetlbfs)") << "\n";
+    }
+}
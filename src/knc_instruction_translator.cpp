@@ -16,10 +16,14 @@
  */
 
 #include "knc_instruction_translator.h"
+#include "knc_page_tables.h"
 #include <iostream>
 #include <fstream>
 #include <iomanip>
 #include <algorithm>
+#include <cstring>
+#include <initializer_list>
+#include <thread>
 
 // XED includes for KNC instruction translation
 #include <xed/xed-types.h>
@@ -34,10 +38,31 @@ KNCInstructionTranslator::KNCInstructionTranslator() {
     cache_misses = 0;
     knc_specific_instructions = 0;
     vector_instructions = 0;
+    blocks_translated = 0;
+    blocks_pretranslated = 0;
+    block_misses = 0;
+    block_conflict_misses = 0;
+    block_evictions = 0;
+    translation_entries = 0;
+    translation_evictions = 0;
+    blocks_chained.store(0);
+    superblocks_formed = 0;
+    superblock_parts = 0;
+    superblocks_retired = 0;
+    handler_resolver = nullptr;
+    memset(&persistent_key, 0, sizeof(persistent_key));
+    persistent_dirty = false;
+    persistent_blocks_loaded = 0;
+    persistent_blocks_rejected = 0;
+    persistent_blocks_saved = 0;
+    descriptions.push_back("");
+    description_ids[""] = 0;
     
-    translation_cache.resize(CACHE_SIZE);
-    for (size_t i = 0; i < CACHE_SIZE; i++) {
-        translation_cache[i].is_valid = false;
+    allocate_caches(KNC_DEFAULT_BLOCK_CACHE_ENTRIES);
+    hotness.reset(new knc_hotness_entry_t[HOTNESS_ENTRIES]);
+    for (size_t i = 0; i < HOTNESS_ENTRIES; i++) {
+        hotness[i].original_address.store(EMPTY_TAG, std::memory_order_relaxed);
+        hotness[i].access_count.store(0, std::memory_order_relaxed);
     }
 }
 
@@ -49,11 +74,9 @@ bool KNCInstructionTranslator::initialize() {
     // Initialize XED decoder
     setup_xed_decoder();
     
-    // Initialize instruction mappings
-    initialize_instruction_maps();
-    
     std::cout << "KNC Instruction Translator initialized\n";
-    std::cout << "Translation cache size: " << CACHE_SIZE << " entries\n";
+    std::cout << "Translation cache size: " << translation_cache.size() << " entries ("
+              << (translation_cache.size() / CACHE_WAYS) << " sets x " << CACHE_WAYS << " ways)\n";
     
     return true;
 }
@@ -65,52 +88,96 @@ void KNCInstructionTranslator::setup_xed_decoder() {
     // Tables initialization is not needed for simplified implementation
 }
 
-void KNCInstructionTranslator::initialize_instruction_maps() {
-    // Map XED instruction classes to KNC instruction types
-    xed_to_knc_map[XED_ICLASS_VPADDD] = KNC_INST_VPADDD;
-    xed_to_knc_map[XED_ICLASS_VPSUBD] = KNC_INST_VPSUBD;
-    xed_to_knc_map[XED_ICLASS_VPMULUD] = KNC_INST_VPMULUD;
-    xed_to_knc_map[XED_ICLASS_VPERMD] = KNC_INST_VPERMD;
-    xed_to_knc_map[XED_ICLASS_VPBROADCASTD] = KNC_INST_VPBROADCASTD;
-    xed_to_knc_map[XED_ICLASS_VGATHERDPS] = KNC_INST_VGATHERDPS;
-    xed_to_knc_map[XED_ICLASS_VSCATTERDPS] = KNC_INST_VSCATTERDPS;
-    xed_to_knc_map[XED_ICLASS_VCMPPS] = KNC_INST_VCMPPS;
-    xed_to_knc_map[XED_ICLASS_VMAXPS] = KNC_INST_VMAXPS;
-    xed_to_knc_map[XED_ICLASS_VMINPS] = KNC_INST_VMINPS;
-    
-    // KNL-specific instruction mappings
-    // Note: These would require XED instruction classes that may not exist in current version
-    // xed_to_knc_map[XED_ICLASS_VEXPANDPD] = KNL_INST_VEXPANDPD;
-    // xed_to_knc_map[XED_ICLASS_VCOMPRESSPD] = KNL_INST_VCOMPRESSPD;
-    // xed_to_knc_map[XED_ICLASS_VPERMILPD] = KNL_INST_VPERMILPD;
-    // xed_to_knc_map[XED_ICLASS_VPERMD2] = KNL_INST_VPERMD2;
-    // xed_to_knc_map[XED_ICLASS_VPERMT2D] = KNL_INST_VPERMT2D;
-    // xed_to_knc_map[XED_ICLASS_VPMOVD] = KNL_INST_VPMOVD;
-    // xed_to_knc_map[XED_ICLASS_VFMADDPD231PS] = KNL_INST_VFMADDPD231PS;
-    // xed_to_knc_map[XED_ICLASS_VFMADDSUBPD231PS] = KNL_INST_VFMADDSUBPD231PS;
-    // xed_to_knc_map[XED_ICLASS_VFMADDSUB132PS] = KNL_INST_VFMADDSUB132PS;
-    // xed_to_knc_map[XED_ICLASS_VFMSUBADDPD231PS] = KNL_INST_VFMSUBADDPD231PS;
-    // xed_to_knc_map[XED_ICLASS_VFMSUBADD132PS] = KNL_INST_VFMSUBADD132PS;
-    
-    // Initialize instruction names
-    knc_instruction_names[KNC_INST_VPADDD] = "VPADDD";
-    knc_instruction_names[KNC_INST_VPSUBD] = "VPSUBD";
-    knc_instruction_names[KNC_INST_VPMULUD] = "VPMULUD";
-    knc_instruction_names[KNC_INST_VPERMD] = "VPERMD";
-    knc_instruction_names[KNC_INST_VPBROADCASTD] = "VPBROADCASTD";
-    knc_instruction_names[KNC_INST_VGATHERDPS] = "VGATHERDPS";
-    knc_instruction_names[KNC_INST_VSCATTERDPS] = "VSCATTERDPS";
-    knc_instruction_names[KNC_INST_VCMPPS] = "VCMPPS";
-    knc_instruction_names[KNC_INST_VMAXPS] = "VMAXPS";
-    knc_instruction_names[KNC_INST_VMINPS] = "VMINPS";
-}
-
-knc_translated_instruction_t KNCInstructionTranslator::translate_instruction(uint64_t address, 
+xed_error_enum_t KNCInstructionTranslator::xed_decode_bytes(const uint8_t* bytes, uint32_t length,
+                                                           xed_decoded_inst_t& xed_inst) {
+    // Single XED entry point; the decoder mode comes from xed_state
+    memset(&xed_inst, 0, sizeof(xed_inst));
+    return xed_decode(&xed_state, bytes, length);
+}
+
+constexpr KNCInstructionTranslator::knc_iclass_table_t KNCInstructionTranslator::build_iclass_table() {
+    typedef struct {
+        xed_iclass_enum_t iclass;
+        knc_iclass_entry_t entry;
+    } knc_instruction_row_t;
+    
+    // The instruction table: one row per XED class the translator handles.
+    // Latencies are those of the KNC vector unit; gathers and scatters add
+    // their per-cache-line cost at run time.
+    const knc_instruction_row_t rows[] = {
+        {XED_ICLASS_VPADDD,       {KNC_INST_VPADDD,       &KNCInstructionTranslator::translate_vpaddd,       "VPADDD",       KNC_ICLASS_VECTOR, 4}},
+        {XED_ICLASS_VPSUBD,       {KNC_INST_VPSUBD,       &KNCInstructionTranslator::translate_vpsubd,       "VPSUBD",       KNC_ICLASS_VECTOR, 4}},
+        {XED_ICLASS_VPMULUD,      {KNC_INST_VPMULUD,      &KNCInstructionTranslator::translate_vpmulud,      "VPMULUD",      KNC_ICLASS_VECTOR, 4}},
+        {XED_ICLASS_VPERMD,       {KNC_INST_VPERMD,       &KNCInstructionTranslator::translate_vpermd,       "VPERMD",       KNC_ICLASS_VECTOR, 6}},
+        {XED_ICLASS_VPBROADCASTD, {KNC_INST_VPBROADCASTD, &KNCInstructionTranslator::translate_vpbroadcastd, "VPBROADCASTD", KNC_ICLASS_VECTOR, 4}},
+        {XED_ICLASS_VGATHERDPS,   {KNC_INST_VGATHERDPS,   &KNCInstructionTranslator::translate_vgatherdps,   "VGATHERDPS",   KNC_ICLASS_VECTOR, 8}},
+        {XED_ICLASS_VSCATTERDPS,  {KNC_INST_VSCATTERDPS,  &KNCInstructionTranslator::translate_vscatterdps,  "VSCATTERDPS",  KNC_ICLASS_VECTOR, 8}},
+        {XED_ICLASS_VCMPPS,       {KNC_INST_VCMPPS,       &KNCInstructionTranslator::translate_vcmpps,       "VCMPPS",       KNC_ICLASS_VECTOR, 4}},
+        {XED_ICLASS_VMAXPS,       {KNC_INST_VMAXPS,       &KNCInstructionTranslator::translate_vmaxps,       "VMAXPS",       KNC_ICLASS_VECTOR, 4}},
+        {XED_ICLASS_VMINPS,       {KNC_INST_VMINPS,       &KNCInstructionTranslator::translate_vminps,       "VMINPS",       KNC_ICLASS_VECTOR, 4}},
+        
+        // KNC (MVEX) encodings of the same operations
+        {XED_ICLASS_KNC_VPADDD,       {KNC_INST_VPADDD,       &KNCInstructionTranslator::translate_vpaddd,       "VPADDD",       KNC_ICLASS_VECTOR | KNC_ICLASS_KNC_SPECIFIC, 4}},
+        {XED_ICLASS_KNC_VPSUBD,       {KNC_INST_VPSUBD,       &KNCInstructionTranslator::translate_vpsubd,       "VPSUBD",       KNC_ICLASS_VECTOR | KNC_ICLASS_KNC_SPECIFIC, 4}},
+        {XED_ICLASS_KNC_VPMULUD,      {KNC_INST_VPMULUD,      &KNCInstructionTranslator::translate_vpmulud,      "VPMULUD",      KNC_ICLASS_VECTOR | KNC_ICLASS_KNC_SPECIFIC, 4}},
+        {XED_ICLASS_KNC_VPERMD,       {KNC_INST_VPERMD,       &KNCInstructionTranslator::translate_vpermd,       "VPERMD",       KNC_ICLASS_VECTOR | KNC_ICLASS_KNC_SPECIFIC, 6}},
+        {XED_ICLASS_KNC_VPBROADCASTD, {KNC_INST_VPBROADCASTD, &KNCInstructionTranslator::translate_vpbroadcastd, "VPBROADCASTD", KNC_ICLASS_VECTOR | KNC_ICLASS_KNC_SPECIFIC, 4}},
+        {XED_ICLASS_KNC_VGATHERDPS,   {KNC_INST_VGATHERDPS,   &KNCInstructionTranslator::translate_vgatherdps,   "VGATHERDPS",   KNC_ICLASS_VECTOR | KNC_ICLASS_KNC_SPECIFIC, 8}},
+        {XED_ICLASS_KNC_VSCATTERDPS,  {KNC_INST_VSCATTERDPS,  &KNCInstructionTranslator::translate_vscatterdps,  "VSCATTERDPS",  KNC_ICLASS_VECTOR | KNC_ICLASS_KNC_SPECIFIC, 8}},
+        {XED_ICLASS_KNC_VCMPPS,       {KNC_INST_VCMPPS,       &KNCInstructionTranslator::translate_vcmpps,       "VCMPPS",       KNC_ICLASS_VECTOR | KNC_ICLASS_KNC_SPECIFIC, 4}},
+        {XED_ICLASS_KNC_VMAXPS,       {KNC_INST_VMAXPS,       &KNCInstructionTranslator::translate_vmaxps,       "VMAXPS",       KNC_ICLASS_VECTOR | KNC_ICLASS_KNC_SPECIFIC, 4}},
+        {XED_ICLASS_KNC_VMINPS,       {KNC_INST_VMINPS,       &KNCInstructionTranslator::translate_vminps,       "VMINPS",       KNC_ICLASS_VECTOR | KNC_ICLASS_KNC_SPECIFIC, 4}},
+        
+        // KNL AVX-512F/CD/ER/PF instructions, executed by the vector backend
+        {XED_ICLASS_VEXPANDPS,      {KNL_INST_VEXPANDPS,      &KNCInstructionTranslator::translate_knl_instruction, "VEXPANDPS",      KNC_ICLASS_VECTOR | KNC_ICLASS_KNL, 6}},
+        {XED_ICLASS_VPEXPANDD,      {KNL_INST_VEXPANDPS,      &KNCInstructionTranslator::translate_knl_instruction, "VPEXPANDD",      KNC_ICLASS_VECTOR | KNC_ICLASS_KNL, 6}},
+        {XED_ICLASS_VCOMPRESSPS,    {KNL_INST_VCOMPRESSPS,    &KNCInstructionTranslator::translate_knl_instruction, "VCOMPRESSPS",    KNC_ICLASS_VECTOR | KNC_ICLASS_KNL, 6}},
+        {XED_ICLASS_VPCOMPRESSD,    {KNL_INST_VCOMPRESSPS,    &KNCInstructionTranslator::translate_knl_instruction, "VPCOMPRESSD",    KNC_ICLASS_VECTOR | KNC_ICLASS_KNL, 6}},
+        {XED_ICLASS_VPERMT2D,       {KNL_INST_VPERMT2D,       &KNCInstructionTranslator::translate_knl_instruction, "VPERMT2D",       KNC_ICLASS_VECTOR | KNC_ICLASS_KNL, 3}},
+        {XED_ICLASS_VPERMT2PS,      {KNL_INST_VPERMT2D,       &KNCInstructionTranslator::translate_knl_instruction, "VPERMT2PS",      KNC_ICLASS_VECTOR | KNC_ICLASS_KNL, 3}},
+        {XED_ICLASS_VPCONFLICTD,    {KNL_INST_VPCONFLICTD,    &KNCInstructionTranslator::translate_knl_instruction, "VPCONFLICTD",    KNC_ICLASS_VECTOR | KNC_ICLASS_KNL, 20}},
+        {XED_ICLASS_VPLZCNTD,       {KNL_INST_VPLZCNTD,       &KNCInstructionTranslator::translate_knl_instruction, "VPLZCNTD",       KNC_ICLASS_VECTOR | KNC_ICLASS_KNL, 2}},
+        {XED_ICLASS_VRCP28PS,       {KNL_INST_VRCP28PS,       &KNCInstructionTranslator::translate_knl_instruction, "VRCP28PS",       KNC_ICLASS_VECTOR | KNC_ICLASS_KNL, 7}},
+        {XED_ICLASS_VRSQRT28PS,     {KNL_INST_VRSQRT28PS,     &KNCInstructionTranslator::translate_knl_instruction, "VRSQRT28PS",     KNC_ICLASS_VECTOR | KNC_ICLASS_KNL, 7}},
+        {XED_ICLASS_VEXP2PS,        {KNL_INST_VEXP2PS,        &KNCInstructionTranslator::translate_knl_instruction, "VEXP2PS",        KNC_ICLASS_VECTOR | KNC_ICLASS_KNL, 8}},
+        {XED_ICLASS_VGATHERPF0DPS,  {KNL_INST_VGATHERPF0DPS,  &KNCInstructionTranslator::translate_knl_instruction, "VGATHERPF0DPS",  KNC_ICLASS_VECTOR | KNC_ICLASS_KNL, 8}},
+        {XED_ICLASS_VGATHERPF1DPS,  {KNL_INST_VGATHERPF0DPS,  &KNCInstructionTranslator::translate_knl_instruction, "VGATHERPF1DPS",  KNC_ICLASS_VECTOR | KNC_ICLASS_KNL, 8}},
+        {XED_ICLASS_VSCATTERPF0DPS, {KNL_INST_VSCATTERPF0DPS, &KNCInstructionTranslator::translate_knl_instruction, "VSCATTERPF0DPS", KNC_ICLASS_VECTOR | KNC_ICLASS_KNL, 8}},
+        {XED_ICLASS_VSCATTERPF1DPS, {KNL_INST_VSCATTERPF0DPS, &KNCInstructionTranslator::translate_knl_instruction, "VSCATTERPF1DPS", KNC_ICLASS_VECTOR | KNC_ICLASS_KNL, 8}},
+    };
+    
+    knc_iclass_table_t table = {};
+    for (size_t i = 0; i < table.size(); i++) {
+        table[i] = {static_cast<uint32_t>(i), nullptr, nullptr, 0, 1};
+    }
+    for (const knc_instruction_row_t& row : rows) {
+        table[row.iclass] = row.entry;
+    }
+    return table;
+}
+
+constexpr KNCInstructionTranslator::knc_iclass_table_t KNCInstructionTranslator::iclass_table =
+    KNCInstructionTranslator::build_iclass_table();
+
+inline const KNCInstructionTranslator::knc_iclass_entry_t& KNCInstructionTranslator::get_iclass_entry(
+    xed_iclass_enum_t iclass) {
+    return iclass_table[static_cast<size_t>(iclass) < iclass_table.size() ? iclass : XED_ICLASS_INVALID];
+}
+
+const char* KNCInstructionTranslator::get_instruction_name(xed_iclass_enum_t iclass) {
+    return get_iclass_entry(iclass).name;
+}
+
+uint32_t KNCInstructionTranslator::get_instruction_latency(xed_iclass_enum_t iclass) {
+    return get_iclass_entry(iclass).latency;
+}
+
+knc_micro_op_t KNCInstructionTranslator::translate_instruction(uint64_t address, 
                                                                   const uint8_t* instruction_bytes) {
     instructions_translated++;
     
     // Check translation cache first
-    knc_translated_instruction_t cached_result;
+    knc_micro_op_t cached_result;
     if (lookup_in_cache(address, cached_result)) {
         cache_hits++;
         return cached_result;
@@ -120,270 +187,259 @@ knc_translated_instruction_t KNCInstructionTranslator::translate_instruction(uin
     
     // Decode instruction using XED
     knc_translation_context_t ctx;
-    ctx.instruction_bytes = const_cast<uint8_t*>(instruction_bytes);
+    ctx.instruction_bytes = instruction_bytes;
     ctx.instruction_length = 15;  // Max x86 instruction length
     
-    xed_error_enum_t xed_error = xed_decode(&xed_state, instruction_bytes, 
-                                           ctx.instruction_length);
+    xed_error_enum_t xed_error = xed_decode_bytes(instruction_bytes, ctx.instruction_length, xedd);
     
     if (xed_error != XED_ERROR_NONE) {
         std::cerr << "XED decode error at address 0x" << std::hex << address 
                   << ": " << xed_error_enum_t2str(xed_error) << std::dec << "\n";
         
         // Return invalid instruction
-        knc_translated_instruction_t result;
-        result.is_emulated = false;
-        result.emulation_overhead_cycles = 0;
-        return result;
+        return make_micro_op("", false, 0);
     }
     
-    ctx.instruction_length = xed_decoded_inst_get_length(&ctx.xedd);
-    xed_iclass_enum_t iclass = xed_decoded_inst_get_iclass(&ctx.xedd);
-    ctx.knc_type = classify_instruction(ctx.xedd);
-    ctx.is_vector_instruction = is_knc_vector_instruction(iclass);
-    ctx.is_knc_specific = is_knc_specific_instruction(iclass);
+    ctx.instruction_length = xed_decoded_inst_get_length(&xedd);
+    ctx.iclass = xed_decoded_inst_get_iclass(&xedd);
+    const knc_iclass_entry_t& entry = get_iclass_entry(ctx.iclass);
+    ctx.knc_type = static_cast<knc_instruction_type_t>(entry.knc_type);
+    ctx.is_vector_instruction = (entry.flags & KNC_ICLASS_VECTOR) != 0;
+    ctx.is_knc_specific = (entry.flags & KNC_ICLASS_KNC_SPECIFIC) != 0;
     ctx.needs_translation = ctx.is_knc_specific || ctx.is_vector_instruction;
     
     // Translate based on instruction type
     if (ctx.is_vector_instruction) {
         vector_instructions++;
-        cached_result = translate_vector_instruction(ctx);
+        cached_result = entry.translate ? (this->*entry.translate)(ctx) : translate_vector_instruction(ctx);
     } else if (ctx.is_knc_specific) {
         knc_specific_instructions++;
-        cached_result = translate_scalar_instruction(ctx);
+        cached_result = entry.translate ? (this->*entry.translate)(ctx) : translate_scalar_instruction(ctx);
     } else {
         // Regular x86 instruction - pass through
-        cached_result.translated_bytes.assign(instruction_bytes, 
-                                       instruction_bytes + ctx.instruction_length);
-        cached_result.translated_length = ctx.instruction_length;
-        cached_result.description = "Native x86 instruction";
-        cached_result.is_emulated = false;
-        cached_result.emulation_overhead_cycles = 0;
+        cached_result = make_micro_op("Native x86 instruction", false, 0);
+        cached_result.length = static_cast<uint8_t>(std::min<uint32_t>(ctx.instruction_length, KNC_MICRO_OP_MAX_BYTES));
+        memcpy(cached_result.bytes, instruction_bytes, cached_result.length);
     }
     
+    cached_result.latency = entry.latency;
+    
     // Add to cache
-    add_to_cache(address, instruction_bytes, cached_result);
+    add_to_cache(address, cached_result);
     
     return cached_result;
 }
 
-knc_translated_instruction_t KNCInstructionTranslator::translate_vector_instruction(const knc_translation_context_t& ctx) {
-    switch (ctx.knc_type) {
-        case KNC_INST_VPADDD:
-            return translate_vpaddd(ctx);
-        case KNC_INST_VPSUBD:
-            return translate_vpsubd(ctx);
-        case KNC_INST_VPMULUD:
-            return translate_vpmulud(ctx);
-        case KNC_INST_VPERMD:
-            return translate_vpermd(ctx);
-        case KNC_INST_VPBROADCASTD:
-            return translate_vpbroadcastd(ctx);
-        case KNC_INST_VGATHERDPS:
-            return translate_vgatherdps(ctx);
-        case KNC_INST_VSCATTERDPS:
-            return translate_vscatterdps(ctx);
-        case KNC_INST_VCMPPS:
-            return translate_vcmpps(ctx);
-        case KNC_INST_VMAXPS:
-            return translate_vmaxps(ctx);
-        case KNC_INST_VMINPS:
-            return translate_vminps(ctx);
-        default:
-            // Unknown vector instruction - emulate
-            knc_translated_instruction_t result;
-            result.translated_bytes.clear();
-            result.description = "Unknown vector instruction - needs emulation";
-            result.is_emulated = true;
-            result.emulation_overhead_cycles = 10;  // Estimated overhead
-            return result;
+uint16_t KNCInstructionTranslator::intern_description(const std::string& description) {
+    auto it = description_ids.find(description);
+    if (it != description_ids.end()) {
+        return it->second;
+    }
+    if (descriptions.size() > UINT16_MAX) {
+        return 0;  // Table full; the micro-op goes without a description
     }
+    uint16_t id = static_cast<uint16_t>(descriptions.size());
+    descriptions.push_back(description);
+    description_ids[description] = id;
+    return id;
 }
 
-knc_translated_instruction_t KNCInstructionTranslator::translate_vpaddd(const knc_translation_context_t& ctx) {
+knc_micro_op_t KNCInstructionTranslator::make_micro_op(const std::string& description, bool is_emulated,
+                                                       uint8_t overhead_cycles) {
+    knc_micro_op_t op;
+    memset(&op, 0, sizeof(op));
+    op.description = intern_description(description);
+    op.is_emulated = is_emulated;
+    op.emulation_overhead_cycles = overhead_cycles;
+    return op;
+}
+
+const std::string& KNCInstructionTranslator::get_description(const knc_micro_op_t& op) const {
+    return op.description < descriptions.size() ? descriptions[op.description] : descriptions[0];
+}
+
+// Append host encoding bytes to a micro-op, dropping any past its capacity
+static void append_micro_op_bytes(knc_micro_op_t& op, std::initializer_list<uint8_t> bytes) {
+    for (uint8_t value : bytes) {
+        if (op.length < KNC_MICRO_OP_MAX_BYTES) {
+            op.bytes[op.length++] = value;
+        }
+    }
+}
+
+knc_micro_op_t KNCInstructionTranslator::translate_vector_instruction(const knc_translation_context_t& ctx) {
+    // Vector instruction without a translation in the table - emulate
+    return make_micro_op("Unknown vector instruction - needs emulation", true, 10);  // Estimated overhead
+}
+
+knc_micro_op_t KNCInstructionTranslator::translate_vpaddd(const knc_translation_context_t& ctx) {
     // Translate KNC VPADDD to AVX-512 VPADDD
-    knc_translated_instruction_t result;
+    knc_micro_op_t result = make_micro_op("KNC VPADDD -> AVX-512 VPADDD", false, 0);
     
     // Generate AVX-512 equivalent
-    result.translated_bytes = generate_avx512_vector_op(ctx, "vpaddd");
-    result.translated_length = result.translated_bytes.size();
-    result.description = "KNC VPADDD -> AVX-512 VPADDD";
-    result.is_emulated = false;
-    result.emulation_overhead_cycles = 0;
-    
+    generate_avx512_vector_op(ctx, "vpaddd", result);
+    return result;
+}
+
+knc_micro_op_t KNCInstructionTranslator::translate_knl_instruction(const knc_translation_context_t& ctx) {
+    // KNL instructions keep their AVX-512 encoding; the interpreter executes
+    // them through the host vector backend
+    const knc_iclass_entry_t& entry = get_iclass_entry(ctx.iclass);
+    knc_micro_op_t result = make_micro_op(std::string("KNL ") + entry.name + " -> vector backend", false, 0);
+    result.length = static_cast<uint8_t>(std::min<uint32_t>(ctx.instruction_length, KNC_MICRO_OP_MAX_BYTES));
+    memcpy(result.bytes, ctx.instruction_bytes, result.length);
     return result;
 }
 
-knc_translated_instruction_t KNCInstructionTranslator::translate_vpbroadcastd(const knc_translation_context_t& ctx) {
+knc_micro_op_t KNCInstructionTranslator::translate_vpbroadcastd(const knc_translation_context_t& ctx) {
     // Translate KNC VPBROADCASTD to AVX-512 VPBROADCASTD
-    knc_translated_instruction_t result;
-    
-    result.translated_bytes = generate_vector_broadcast(ctx);
-    result.translated_length = result.translated_bytes.size();
-    result.description = "KNC VPBROADCASTD -> AVX-512 VPBROADCASTD";
-    result.is_emulated = false;
-    result.emulation_overhead_cycles = 0;
-    
+    knc_micro_op_t result = make_micro_op("KNC VPBROADCASTD -> AVX-512 VPBROADCASTD", false, 0);
+    generate_vector_broadcast(ctx, result);
     return result;
 }
 
-knc_translated_instruction_t KNCInstructionTranslator::translate_vgatherdps(const knc_translation_context_t& ctx) {
+knc_micro_op_t KNCInstructionTranslator::translate_vgatherdps(const knc_translation_context_t& ctx) {
     // Translate KNC VGATHERDPS to AVX-512 VGATHERDPS
-    knc_translated_instruction_t result;
-    
-    result.translated_bytes = generate_vector_gather(ctx);
-    result.translated_length = result.translated_bytes.size();
-    result.description = "KNC VGATHERDPS -> AVX-512 VGATHERDPS";
-    result.is_emulated = false;
-    result.emulation_overhead_cycles = 1;  // Small overhead for complex instruction
+    // Small overhead for complex instruction
+    knc_micro_op_t result = make_micro_op("KNC VGATHERDPS -> AVX-512 VGATHERDPS", false, 1);
+    generate_vector_gather(ctx, result);
     return result;
 }
 
-knc_translated_instruction_t KNCInstructionTranslator::translate_vscatterdps(const knc_translation_context_t& ctx) {
+knc_micro_op_t KNCInstructionTranslator::translate_vscatterdps(const knc_translation_context_t& ctx) {
     // Translate KNC VSCATTERDPS to AVX-512 VSCATTERDPS
-    knc_translated_instruction_t result;
-    
-    result.translated_bytes = generate_vector_scatter(ctx);
-    result.translated_length = result.translated_bytes.size();
-    result.description = "KNC VSCATTERDPS -> AVX-512 VSCATTERDPS";
-    result.is_emulated = false;
-    result.emulation_overhead_cycles = 1;  // Small overhead for complex instruction
+    // Small overhead for complex instruction
+    knc_micro_op_t result = make_micro_op("KNC VSCATTERDPS -> AVX-512 VSCATTERDPS", false, 1);
+    generate_vector_scatter(ctx, result);
     return result;
 }
 
-std::vector<uint8_t> KNCInstructionTranslator::generate_avx512_vector_op(const knc_translation_context_t& ctx, 
-                                                               const std::string& avx512_mnemonic) {
-    std::vector<uint8_t> result;
-    
+void KNCInstructionTranslator::generate_avx512_vector_op(const knc_translation_context_t& ctx, 
+                                                         const std::string& avx512_mnemonic, knc_micro_op_t& op) {
     // This is a simplified implementation
     // In practice, this would generate proper AVX-512 instruction encoding
     
     // Add EVEX prefix for AVX-512
-    result.push_back(0x62);  // EVEX prefix
+    append_micro_op_bytes(op, {0x62});
     
     // Add opcode based on mnemonic
     if (avx512_mnemonic == "vpaddd") {
-        result.push_back(0x01);
-        result.push_back(0x00);
-        result.push_back(0x58);  // VPADDD opcode
+        append_micro_op_bytes(op, {0x01, 0x00, 0x58});  // VPADDD opcode
     } else if (avx512_mnemonic == "vpsubd") {
-        result.push_back(0x01);
-        result.push_back(0x00);
-        result.push_back(0xFA);  // VPSUBD opcode
+        append_micro_op_bytes(op, {0x01, 0x00, 0xFA});  // VPSUBD opcode
     }
     
     // Add register encodings (simplified)
-    result.push_back(0x00);  // ModR/M byte (simplified)
-    result.push_back(0x00);  // SIB byte (simplified)
-    
-    return result;
+    append_micro_op_bytes(op, {0x00, 0x00});  // ModR/M and SIB bytes (simplified)
 }
 
-std::vector<uint8_t> KNCInstructionTranslator::generate_vector_broadcast(const knc_translation_context_t& ctx) {
-    std::vector<uint8_t> result;
-    
+void KNCInstructionTranslator::generate_vector_broadcast(const knc_translation_context_t& ctx, knc_micro_op_t& op) {
     // Generate AVX-512 VPBROADCASTD instruction
-    result.push_back(0x62);  // EVEX prefix
-    result.push_back(0x01);
-    result.push_back(0x00);
-    result.push_back(0x7C);  // VPBROADCASTD opcode
+    append_micro_op_bytes(op, {0x62, 0x01, 0x00, 0x7C});  // EVEX prefix, VPBROADCASTD opcode
     
     // Add register and memory operands (simplified)
-    result.push_back(0x00);
-    result.push_back(0x00);
-    
-    return result;
+    append_micro_op_bytes(op, {0x00, 0x00});
 }
 
-std::vector<uint8_t> KNCInstructionTranslator::generate_vector_gather(const knc_translation_context_t& ctx) {
-    std::vector<uint8_t> result;
-    
+void KNCInstructionTranslator::generate_vector_gather(const knc_translation_context_t& ctx, knc_micro_op_t& op) {
     // Generate AVX-512 VGATHERDPS instruction
-    result.push_back(0x62);  // EVEX prefix
-    result.push_back(0x01);
-    result.push_back(0x00);
-    result.push_back(0x7D);  // VGATHERDPS opcode
+    append_micro_op_bytes(op, {0x62, 0x01, 0x00, 0x7D});  // EVEX prefix, VGATHERDPS opcode
     
     // Add operands (simplified)
-    result.push_back(0x00);
-    result.push_back(0x00);
-    
-    return result;
+    append_micro_op_bytes(op, {0x00, 0x00});
 }
 
-std::vector<uint8_t> KNCInstructionTranslator::generate_vector_scatter(const knc_translation_context_t& ctx) {
-    std::vector<uint8_t> result;
-    
+void KNCInstructionTranslator::generate_vector_scatter(const knc_translation_context_t& ctx, knc_micro_op_t& op) {
     // Generate AVX-512 VSCATTERDPS instruction
-    result.push_back(0x62);  // EVEX prefix
-    result.push_back(0x01);
-    result.push_back(0x00);
-    result.push_back(0x7F);  // VSCATTERDPS opcode
+    append_micro_op_bytes(op, {0x62, 0x01, 0x00, 0x7F});  // EVEX prefix, VSCATTERDPS opcode
     
     // Add operands (simplified)
-    result.push_back(0x00);
-    result.push_back(0x00);
-    
-    return result;
+    append_micro_op_bytes(op, {0x00, 0x00});
 }
 
-bool KNCInstructionTranslator::is_knc_vector_instruction(xed_iclass_enum_t iclass) {
-    return (iclass == XED_ICLASS_VPADDD ||
-            iclass == XED_ICLASS_VPSUBD ||
-            iclass == XED_ICLASS_VPMULUD ||
-            iclass == XED_ICLASS_VPERMD ||
-            iclass == XED_ICLASS_VPBROADCASTD ||
-            iclass == XED_ICLASS_VGATHERDPS ||
-            iclass == XED_ICLASS_VSCATTERDPS ||
-            iclass == XED_ICLASS_VCMPPS ||
-            iclass == XED_ICLASS_VMAXPS ||
-            iclass == XED_ICLASS_VMINPS);
+knc_instruction_type_t KNCInstructionTranslator::classify_instruction(const xed_decoded_inst_t& xedd) {
+    return static_cast<knc_instruction_type_t>(get_iclass_entry(xed_decoded_inst_get_iclass(&xedd)).knc_type);
 }
 
-bool KNCInstructionTranslator::is_knc_specific_instruction(xed_iclass_enum_t iclass) {
-    // KNC has some specific instructions not found in standard x86
-    // This would be expanded based on KNC documentation
-    return false;  // Simplified for now
+size_t KNCInstructionTranslator::get_cache_set(uint64_t address) const {
+    return static_cast<size_t>((address * 0x9E3779B97F4A7C15ULL) >> (64 - cache_set_bits));
 }
 
-knc_instruction_type_t KNCInstructionTranslator::classify_instruction(const xed_decoded_inst_t& xedd) {
-    xed_iclass_enum_t iclass = xed_decoded_inst_get_iclass(&xedd);
-    auto it = xed_to_knc_map.find(iclass);
-    if (it != xed_to_knc_map.end()) {
-        return it->second;
+void KNCInstructionTranslator::allocate_caches(size_t entries) {
+    cache_set_bits = 1;
+    while ((static_cast<size_t>(CACHE_WAYS) << cache_set_bits) < entries && cache_set_bits < 24) {
+        cache_set_bits++;
+    }
+    size_t sets = static_cast<size_t>(1) << cache_set_bits;
+    
+    translation_cache.clear();
+    translation_cache.resize(sets * CACHE_WAYS);
+    for (auto& entry : translation_cache) {
+        entry.referenced = false;
+        entry.is_valid = false;
     }
+    translation_cache_hands.assign(sets, 0);
+    translation_entries = 0;
     
-    return static_cast<knc_instruction_type_t>(iclass);
+    block_sets.reset(new knc_block_set_t[sets]);
+    for (size_t i = 0; i < sets; i++) {
+        for (uint32_t way = 0; way < CACHE_WAYS; way++) {
+            block_sets[i].tags[way].store(EMPTY_TAG, std::memory_order_relaxed);
+            block_sets[i].blocks[way].store(nullptr, std::memory_order_relaxed);
+            block_sets[i].referenced[way].store(0, std::memory_order_relaxed);
+        }
+        block_sets[i].hand = 0;
+    }
 }
 
-size_t KNCInstructionTranslator::get_cache_index(uint64_t address) {
-    return (address >> 4) % CACHE_SIZE;  // Simple hash based on address
+void KNCInstructionTranslator::set_cache_size(size_t size) {
+    std::lock_guard<std::mutex> lock(block_mutex);
+    allocate_caches(std::max<size_t>(size, 2 * CACHE_WAYS));
 }
 
-bool KNCInstructionTranslator::lookup_in_cache(uint64_t address, knc_translated_instruction_t& translated) {
-    size_t index = get_cache_index(address);
-    auto& entry = translation_cache[index];
-    
-    if (entry.is_valid && entry.original_address == address) {
-        translated = entry.translated;
-        entry.access_count++;
-        return true;
+bool KNCInstructionTranslator::lookup_in_cache(uint64_t address, knc_micro_op_t& translated) {
+    knc_translation_cache_entry_t* set = &translation_cache[get_cache_set(address) * CACHE_WAYS];
+    for (uint32_t way = 0; way < CACHE_WAYS; way++) {
+        knc_translation_cache_entry_t& entry = set[way];
+        if (entry.is_valid && entry.original_address == address) {
+            translated = entry.translated;
+            entry.access_count++;
+            entry.referenced = true;
+            return true;
+        }
     }
     
     return false;
 }
 
-void KNCInstructionTranslator::add_to_cache(uint64_t address, const uint8_t* original_bytes,
-                                          const knc_translated_instruction_t& translated) {
-    size_t index = get_cache_index(address);
-    auto& entry = translation_cache[index];
+void KNCInstructionTranslator::add_to_cache(uint64_t address, const knc_micro_op_t& translated) {
+    size_t set_index = get_cache_set(address);
+    knc_translation_cache_entry_t* set = &translation_cache[set_index * CACHE_WAYS];
+    
+    // A free way, else the CLOCK victim
+    uint32_t way = 0;
+    while (way < CACHE_WAYS && set[way].is_valid) {
+        way++;
+    }
+    if (way < CACHE_WAYS) {
+        translation_entries++;
+    } else {
+        uint8_t& hand = translation_cache_hands[set_index];
+        while (set[hand].referenced) {
+            set[hand].referenced = false;
+            hand = (hand + 1) % CACHE_WAYS;
+        }
+        way = hand;
+        hand = (hand + 1) % CACHE_WAYS;
+        translation_evictions++;
+    }
     
+    knc_translation_cache_entry_t& entry = set[way];
     entry.original_address = address;
     entry.translated = translated;
     entry.access_count = 1;
+    entry.referenced = false;
     entry.is_valid = true;
-    
-    memcpy(entry.original_bytes, original_bytes, std::min(static_cast<uint32_t>(16UL), translated.translated_length));
 }
 
 void KNCInstructionTranslator::print_translation_statistics() const {
@@ -391,6 +447,9 @@ void KNCInstructionTranslator::print_translation_statistics() const {
     std::cout << "Instructions translated: " << instructions_translated << "\n";
     std::cout << "Cache hits: " << cache_hits << "\n";
     std::cout << "Cache misses: " << cache_misses << "\n";
+    std::cout << "Cache evictions: " << translation_evictions << "\n";
+    std::cout << "Cache entry size: " << sizeof(knc_translation_cache_entry_t) << " bytes ("
+              << descriptions.size() << " interned descriptions)\n";
     
     if (cache_hits + cache_misses > 0) {
         double hit_rate = (double)cache_hits / (cache_hits + cache_misses) * 100.0;
@@ -399,83 +458,1757 @@ void KNCInstructionTranslator::print_translation_statistics() const {
     
     std::cout << "KNC-specific instructions: " << knc_specific_instructions << "\n";
     std::cout << "Vector instructions: " << vector_instructions << "\n";
+    std::cout << "Blocks translated: " << blocks_translated << " (" << blocks_pretranslated << " ahead of time)\n";
+    std::cout << "Block cache misses: " << block_misses << " (" << block_conflict_misses << " conflict)\n";
+    std::cout << "Block cache evictions: " << block_evictions << "\n";
+    std::cout << "Block links: " << blocks_chained.load() << "\n";
+    std::cout << "Superblocks formed: " << superblocks_formed << " (" << superblock_parts << " blocks, "
+              << superblocks_retired << " retired)\n";
+    if (persistent_blocks_loaded + persistent_blocks_rejected + persistent_blocks_saved > 0) {
+        std::cout << "Persistent cache blocks: " << persistent_blocks_loaded << " loaded, "
+                  << persistent_blocks_rejected << " stale, " << persistent_blocks_saved << " saved\n";
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Basic block translation
+// ---------------------------------------------------------------------------
+
+void KNCInstructionTranslator::set_handler_resolver(knc_handler_resolver_t resolver) {
+    handler_resolver = resolver;
+}
+
+knc_translated_block_t* KNCInstructionTranslator::find_block(uint64_t start_address) {
+    knc_block_set_t& set = block_sets[get_cache_set(start_address)];
+    for (uint32_t way = 0; way < CACHE_WAYS; way++) {
+        if (set.tags[way].load(std::memory_order_acquire) != start_address) {
+            continue;
+        }
+        knc_translated_block_t* block = set.blocks[way].load(std::memory_order_acquire);
+        if (block && block->start_address == start_address && block->is_valid.load(std::memory_order_acquire)) {
+            // Only write the reference bit when it changes, so hot sets stay shared
+            if (!set.referenced[way].load(std::memory_order_relaxed)) {
+                set.referenced[way].store(1, std::memory_order_relaxed);
+            }
+            return block;
+        }
+    }
+    return nullptr;
+}
+
+bool KNCInstructionTranslator::count_execution(uint64_t address, uint32_t threshold) {
+    knc_hotness_entry_t& entry = hotness[(address * 0x9E3779B97F4A7C15ULL) >> (64 - HOTNESS_BITS)];
+    if (entry.original_address.load(std::memory_order_relaxed) != address) {
+        entry.original_address.store(address, std::memory_order_relaxed);
+        entry.access_count.store(1, std::memory_order_relaxed);
+        return threshold <= 1;
+    }
+    return entry.access_count.fetch_add(1, std::memory_order_relaxed) + 1 >= threshold;
+}
+
+knc_translated_block_t* KNCInstructionTranslator::translate_block(uint64_t start_address,
+                                                                  const uint8_t* block_bytes,
+                                                                  size_t block_size) {
+    std::lock_guard<std::mutex> lock(block_mutex);
+    
+    // Another core may have filled the way since the caller's probe
+    knc_block_set_t& set = block_sets[get_cache_set(start_address)];
+    for (uint32_t way = 0; way < CACHE_WAYS; way++) {
+        knc_translated_block_t* block = set.blocks[way].load(std::memory_order_relaxed);
+        if (block && block->start_address == start_address) {
+            return block;
+        }
+    }
+    block_misses++;
+    
+    knc_translated_block_t* block = nullptr;
+    auto it = block_cache.find(start_address);
+    if (it != block_cache.end()) {
+        block = it->second.get();
+        block_conflict_misses++;
+    } else {
+        block = load_cached_block(start_address, block_bytes, block_size);
+        if (!block) {
+            block = form_block(start_address, block_bytes, block_size);
+            if (!block) {
+                return nullptr;
+            }
+            blocks_translated++;
+            persistent_dirty = true;
+        }
+        add_block(block);
+    }
+    insert_block(block);
+    return block;
+}
+
+std::vector<knc_translated_block_t*> KNCInstructionTranslator::pretranslate(uint64_t start_address,
+                                                                           const uint8_t* code, size_t size,
+                                                                           const std::vector<uint64_t>& seeds,
+                                                                           uint32_t threads) {
+    std::vector<knc_translated_block_t*> added;
+    if (size == 0 || threads == 0) {
+        return added;
+    }
+    
+    // One claim per byte of the region, so each start address is decoded once
+    std::unique_ptr<std::atomic<uint8_t>[]> claimed(new std::atomic<uint8_t>[size]);
+    for (size_t i = 0; i < size; i++) {
+        claimed[i].store(0, std::memory_order_relaxed);
+    }
+    std::vector<std::vector<uint64_t>> chunks(threads);
+    for (uint64_t seed : seeds) {
+        if (seed >= start_address && seed - start_address < size) {
+            chunks[(seed - start_address) * threads / size].push_back(seed);
+        }
+    }
+    
+    // Decoding needs no lock; the blocks are formed privately and added below
+    std::vector<std::vector<std::unique_ptr<knc_translated_block_t>>> formed(threads);
+    auto worker = [&](uint32_t chunk) {
+        std::vector<uint64_t>& pending = chunks[chunk];
+        while (!pending.empty()) {
+            uint64_t address = pending.back();
+            pending.pop_back();
+            if (address < start_address || address - start_address >= size ||
+                claimed[address - start_address].exchange(1, std::memory_order_relaxed)) {
+                continue;
+            }
+            uint64_t offset = address - start_address;
+            knc_translated_block_t* block = form_block(address, code + offset, size - offset);
+            if (!block) {
+                continue;
+            }
+            formed[chunk].emplace_back(block);
+            for (uint32_t i = 0; i < KNC_BLOCK_NUM_EXITS; i++) {
+                if (block->exit_targets[i] != ~0ULL) {
+                    pending.push_back(block->exit_targets[i]);
+                }
+            }
+            knc_exec_op_t last = static_cast<knc_exec_op_t>(block->instructions.back().op);
+            if (last == KNC_OP_CALL || last == KNC_OP_CALL_INDIRECT) {
+                pending.push_back(block->end_address);  // Where the callee returns
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (uint32_t chunk = 1; chunk < threads; chunk++) {
+        workers.emplace_back(worker, chunk);
+    }
+    worker(0);
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+    
+    std::lock_guard<std::mutex> lock(block_mutex);
+    for (auto& blocks : formed) {
+        for (std::unique_ptr<knc_translated_block_t>& block : blocks) {
+            if (block_cache.count(block->start_address)) {
+                continue;  // A core got there first
+            }
+            knc_translated_block_t* added_block = block.release();
+            add_block(added_block);
+            insert_block(added_block);
+            added.push_back(added_block);
+        }
+    }
+    blocks_translated += added.size();
+    blocks_pretranslated += added.size();
+    persistent_dirty = persistent_dirty || !added.empty();
+    return added;
+}
+
+void KNCInstructionTranslator::insert_block(knc_translated_block_t* block) {
+    knc_block_set_t& set = block_sets[get_cache_set(block->start_address)];
+    
+    // A free way, else the CLOCK victim
+    uint32_t way = 0;
+    while (way < CACHE_WAYS && set.blocks[way].load(std::memory_order_relaxed)) {
+        way++;
+    }
+    if (way == CACHE_WAYS) {
+        while (set.referenced[set.hand].load(std::memory_order_relaxed)) {
+            set.referenced[set.hand].store(0, std::memory_order_relaxed);
+            set.hand = (set.hand + 1) % CACHE_WAYS;
+        }
+        way = set.hand;
+        set.hand = (set.hand + 1) % CACHE_WAYS;
+        block_evictions++;
+    }
+    
+    set.tags[way].store(EMPTY_TAG, std::memory_order_relaxed);
+    set.blocks[way].store(block, std::memory_order_release);
+    set.tags[way].store(block->start_address, std::memory_order_release);
+    set.referenced[way].store(1, std::memory_order_relaxed);
+}
+
+void KNCInstructionTranslator::add_block(knc_translated_block_t* block) {
+    block_cache[block->start_address].reset(block);
+    for (uint64_t page = block->start_address >> KNC_PAGE_SHIFT; page <= (block->end_address - 1) >> KNC_PAGE_SHIFT;
+         page++) {
+        page_blocks[page].push_back(block);
+    }
+}
+
+void KNCInstructionTranslator::retire_block(knc_translated_block_t* block) {
+    // Retired blocks stay allocated because other cores may still be
+    // executing them or hold links to them
+    block->is_valid.store(false, std::memory_order_release);
+    evict_block(block);
+    std::vector<knc_translated_block_t*> containing;
+    containing.swap(block->containing_superblocks);
+    for (knc_translated_block_t* superblock : containing) {
+        retire_superblock(superblock);
+    }
+    for (uint64_t page = block->start_address >> KNC_PAGE_SHIFT; page <= (block->end_address - 1) >> KNC_PAGE_SHIFT;
+         page++) {
+        auto it = page_blocks.find(page);
+        if (it == page_blocks.end()) {
+            continue;
+        }
+        it->second.erase(std::remove(it->second.begin(), it->second.end(), block), it->second.end());
+        if (it->second.empty()) {
+            page_blocks.erase(it);
+        }
+    }
+    auto it = block_cache.find(block->start_address);
+    retired_blocks.push_back(std::move(it->second));
+    block_cache.erase(it);
+}
+
+void KNCInstructionTranslator::retire_superblock(knc_translated_block_t* superblock) {
+    if (!superblock->is_valid.load(std::memory_order_relaxed)) {
+        return;
+    }
+    superblock->is_valid.store(false, std::memory_order_release);
+    superblock->parts.front()->superblock.store(nullptr, std::memory_order_release);
+    for (knc_translated_block_t* part : superblock->parts) {
+        std::vector<knc_translated_block_t*>& containing = part->containing_superblocks;
+        containing.erase(std::remove(containing.begin(), containing.end(), superblock), containing.end());
+    }
+    superblocks_retired++;
+}
+
+void KNCInstructionTranslator::evict_block(const knc_translated_block_t* block) {
+    knc_block_set_t& set = block_sets[get_cache_set(block->start_address)];
+    for (uint32_t way = 0; way < CACHE_WAYS; way++) {
+        if (set.blocks[way].load(std::memory_order_relaxed) == block) {
+            set.tags[way].store(EMPTY_TAG, std::memory_order_relaxed);
+            set.blocks[way].store(nullptr, std::memory_order_release);
+            set.referenced[way].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+knc_translated_block_t* KNCInstructionTranslator::new_block(uint64_t start_address) {
+    knc_translated_block_t* block = new knc_translated_block_t();
+    block->start_address = start_address;
+    block->is_valid.store(true);
+    block->execution_count.store(0);
+    block->jit_code.store(nullptr);
+    block->superblock.store(nullptr);
+    block->code = nullptr;
+    block->check_code.store(false);
+    for (uint32_t i = 0; i < KNC_BLOCK_NUM_EXITS; i++) {
+        block->exit_targets[i] = ~0ULL;
+        block->successors[i].store(nullptr);
+        block->exit_counts[i].store(0);
+    }
+    return block;
+}
+
+knc_translated_block_t* KNCInstructionTranslator::form_block(uint64_t start_address,
+                                                             const uint8_t* block_bytes,
+                                                             size_t block_size) {
+    std::unique_ptr<knc_translated_block_t> block(new_block(start_address));
+    
+    // Decode until the first control transfer, an undecodable instruction or the size cap
+    size_t offset = 0;
+    while (offset < block_size && block->instructions.size() < MAX_BLOCK_INSTRUCTIONS) {
+        knc_decoded_instruction_t inst;
+        if (!decode_instruction(start_address + offset, block_bytes + offset, block_size - offset, inst)) {
+            break;
+        }
+        if (handler_resolver) {
+            inst.handler = handler_resolver(static_cast<knc_exec_op_t>(inst.op));
+        }
+        offset += inst.length;
+        block->instructions.push_back(inst);
+        if (inst.flags & KNC_DECODE_BRANCH) {
+            break;
+        }
+    }
+    
+    if (block->instructions.empty()) {
+        return nullptr;
+    }
+    block->end_address = start_address + offset;
+    block->code_hash = knc_hash_bytes(block_bytes, offset);
+    block->code = block_bytes;
+    set_block_exits(block.get());
+    return block.release();
+}
+
+knc_translated_block_t* KNCInstructionTranslator::load_cached_block(uint64_t start_address,
+                                                                    const uint8_t* block_bytes,
+                                                                    size_t block_size) {
+    const knc_cached_block_t* cached = persistent_store.is_open() ? persistent_store.find_block(start_address)
+                                                                  : nullptr;
+    if (!cached) {
+        return nullptr;
+    }
+    uint32_t index = static_cast<uint32_t>(cached - &persistent_store.get_block(0));
+    if (persistent_rejected[index]) {
+        return nullptr;
+    }
+    
+    // The guest bytes must be the ones the block was decoded from, and the
+    // instructions must tile them exactly
+    uint64_t length = cached->end_address - cached->start_address;
+    bool valid = length <= block_size && knc_hash_bytes(block_bytes, length) == cached->code_hash;
+    const knc_decoded_instruction_t* records = persistent_store.get_instructions(*cached);
+    uint64_t address = start_address;
+    for (uint32_t i = 0; valid && i < cached->instruction_count; i++) {
+        valid = records[i].address == address && records[i].length > 0 && records[i].op < KNC_OP_COUNT;
+        address += records[i].length;
+    }
+    if (!valid || address != cached->end_address) {
+        persistent_rejected[index] = true;
+        persistent_blocks_rejected++;
+        persistent_dirty = true;
+        return nullptr;
+    }
+    
+    std::unique_ptr<knc_translated_block_t> block(new_block(start_address));
+    block->end_address = cached->end_address;
+    block->code_hash = cached->code_hash;
+    block->code = block_bytes;
+    block->instructions.assign(records, records + cached->instruction_count);
+    for (knc_decoded_instruction_t& inst : block->instructions) {
+        inst.handler = handler_resolver ? handler_resolver(static_cast<knc_exec_op_t>(inst.op)) : nullptr;
+    }
+    set_block_exits(block.get());
+    persistent_blocks_loaded++;
+    return block.release();
+}
+
+void KNCInstructionTranslator::set_block_exits(knc_translated_block_t* block) {
+    // Record the statically known exits so the block can be chained
+    const knc_decoded_instruction_t& last = block->instructions.back();
+    switch (last.op) {
+        case KNC_OP_JMP:
+        case KNC_OP_CALL:
+            block->exit_targets[KNC_BLOCK_EXIT_TAKEN] = static_cast<uint64_t>(last.immediate);
+            break;
+        case KNC_OP_JCC:
+            block->exit_targets[KNC_BLOCK_EXIT_TAKEN] = static_cast<uint64_t>(last.immediate);
+            block->exit_targets[KNC_BLOCK_EXIT_FALLTHROUGH] = block->end_address;
+            break;
+        case KNC_OP_JMP_INDIRECT:
+        case KNC_OP_CALL_INDIRECT:
+        case KNC_OP_RET:
+        case KNC_OP_HLT:
+            break;  // Resolved through the dispatcher
+        default:
+            block->exit_targets[KNC_BLOCK_EXIT_FALLTHROUGH] = block->end_address;
+            break;
+    }
+}
+
+void KNCInstructionTranslator::link_block(knc_translated_block_t* block, uint32_t exit_index,
+                                          knc_translated_block_t* successor) {
+    if (!block || !successor || exit_index >= KNC_BLOCK_NUM_EXITS) {
+        return;
+    }
+    if (block->exit_targets[exit_index] != successor->start_address) {
+        return;
+    }
+    
+    // Racing cores link the same successor, so a plain store is enough
+    block->successors[exit_index].store(successor, std::memory_order_release);
+    blocks_chained.fetch_add(1, std::memory_order_relaxed);
+}
+
+int KNCInstructionTranslator::hot_exit(const knc_translated_block_t* block) const {
+    // Calls, returns and indirect jumps end a superblock
+    const knc_decoded_instruction_t& last = block->instructions.back();
+    if ((last.flags & KNC_DECODE_BRANCH) && last.op != KNC_OP_JCC && last.op != KNC_OP_JMP) {
+        return -1;
+    }
+    
+    int hot = -1;
+    uint64_t taken = 0, total = 0;
+    for (uint32_t exit = 0; exit < KNC_BLOCK_NUM_EXITS; exit++) {
+        if (block->exit_targets[exit] == ~0ULL) {
+            continue;
+        }
+        uint64_t count = block->exit_counts[exit].load(std::memory_order_relaxed);
+        total += count;
+        if (count > taken) {
+            taken = count;
+            hot = static_cast<int>(exit);
+        }
+    }
+    if (hot < 0 || taken * SUPERBLOCK_BIAS < total * (SUPERBLOCK_BIAS - 1)) {
+        return -1;
+    }
+    return hot;
+}
+
+knc_translated_block_t* KNCInstructionTranslator::form_superblock(knc_translated_block_t* block) {
+    std::lock_guard<std::mutex> lock(block_mutex);
+    if (!block->is_valid.load(std::memory_order_relaxed) || !block->parts.empty() ||
+        block->superblock.load(std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    
+    // Follow linked successors along hot exits until the path returns to a
+    // block already on it - the loop closes - or stops being predictable
+    std::vector<knc_translated_block_t*> parts(1, block);
+    size_t instruction_count = block->instructions.size();
+    knc_translated_block_t* last = block;
+    for (int exit = hot_exit(last); exit >= 0; exit = hot_exit(last)) {
+        knc_translated_block_t* next = last->successors[exit].load(std::memory_order_acquire);
+        if (!next || !next->is_valid.load(std::memory_order_relaxed) || !next->parts.empty() ||
+            std::find(parts.begin(), parts.end(), next) != parts.end() ||
+            instruction_count + next->instructions.size() > MAX_SUPERBLOCK_INSTRUCTIONS) {
+            break;
+        }
+        parts.push_back(next);
+        instruction_count += next->instructions.size();
+        last = next;
+    }
+    if (parts.size() < 2) {
+        return nullptr;
+    }
+    
+    // Guest code is checked per part, so code and code_hash stay those of the first block
+    knc_translated_block_t* superblock = new_block(block->start_address);
+    superblocks.emplace_back(superblock);
+    superblock->end_address = last->end_address;
+    superblock->code_hash = block->code_hash;
+    superblock->code = block->code;
+    superblock->instructions.reserve(instruction_count);
+    bool check_code = false;
+    for (knc_translated_block_t* part : parts) {
+        superblock->instructions.insert(superblock->instructions.end(), part->instructions.begin(),
+                                        part->instructions.end());
+        part->containing_superblocks.push_back(superblock);
+        check_code = check_code || part->check_code.load(std::memory_order_relaxed);
+    }
+    superblock->parts = parts;
+    superblock->check_code.store(check_code, std::memory_order_relaxed);
+    set_block_exits(superblock);
+    block->superblock.store(superblock, std::memory_order_release);
+    
+    superblocks_formed++;
+    superblock_parts += parts.size();
+    return superblock;
+}
+
+void KNCInstructionTranslator::flush_translation_cache() {
+    // Callers must ensure no core is executing translated blocks
+    std::lock_guard<std::mutex> lock(block_mutex);
+    for (const auto& entry : block_cache) {
+        evict_block(entry.second.get());
+    }
+    block_cache.clear();
+    retired_blocks.clear();
+    superblocks.clear();
+    page_blocks.clear();
+    
+    for (auto& entry : translation_cache) {
+        entry.referenced = false;
+        entry.is_valid = false;
+    }
+    translation_entries = 0;
+    for (size_t i = 0; i < HOTNESS_ENTRIES; i++) {
+        hotness[i].original_address.store(EMPTY_TAG, std::memory_order_relaxed);
+        hotness[i].access_count.store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t KNCInstructionTranslator::invalidate_cache_range(uint64_t start_address, uint64_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    uint64_t end_address = start_address + size;
+    
+    std::lock_guard<std::mutex> lock(block_mutex);
+    
+    // Overlapping blocks, found through the pages they cover
+    std::vector<knc_translated_block_t*> stale;
+    uint64_t first_page = start_address >> KNC_PAGE_SHIFT;
+    uint64_t last_page = (end_address - 1) >> KNC_PAGE_SHIFT;
+    auto collect = [&](const std::vector<knc_translated_block_t*>& blocks) {
+        for (knc_translated_block_t* block : blocks) {
+            if (block->start_address < end_address && block->end_address > start_address) {
+                stale.push_back(block);
+            }
+        }
+    };
+    if (last_page - first_page < page_blocks.size()) {
+        for (uint64_t page = first_page; page <= last_page; page++) {
+            auto it = page_blocks.find(page);
+            if (it != page_blocks.end()) {
+                collect(it->second);
+            }
+        }
+    } else {
+        for (const auto& entry : page_blocks) {
+            collect(entry.second);
+        }
+    }
+    
+    // A block spanning two pages is listed under both
+    std::sort(stale.begin(), stale.end());
+    stale.erase(std::unique(stale.begin(), stale.end()), stale.end());
+    for (knc_translated_block_t* block : stale) {
+        retire_block(block);
+    }
+    
+    if (translation_entries > 0) {
+        for (auto& entry : translation_cache) {
+            if (entry.is_valid && entry.original_address >= start_address && entry.original_address < end_address) {
+                entry.is_valid = false;
+                translation_entries--;
+            }
+        }
+    }
+    return stale.size();
+}
+
+bool KNCInstructionTranslator::has_blocks_in_range(uint64_t start_address, uint64_t size) const {
+    uint64_t end_address = start_address + size;
+    std::lock_guard<std::mutex> lock(block_mutex);
+    for (uint64_t page = start_address >> KNC_PAGE_SHIFT; size > 0 && page <= (end_address - 1) >> KNC_PAGE_SHIFT;
+         page++) {
+        auto it = page_blocks.find(page);
+        if (it == page_blocks.end()) {
+            continue;
+        }
+        for (const knc_translated_block_t* block : it->second) {
+            if (block->start_address < end_address && block->end_address > start_address) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void KNCInstructionTranslator::check_code_in_range(uint64_t start_address, uint64_t size) {
+    uint64_t end_address = start_address + size;
+    std::lock_guard<std::mutex> lock(block_mutex);
+    for (uint64_t page = start_address >> KNC_PAGE_SHIFT; size > 0 && page <= (end_address - 1) >> KNC_PAGE_SHIFT;
+         page++) {
+        auto it = page_blocks.find(page);
+        if (it == page_blocks.end()) {
+            continue;
+        }
+        for (knc_translated_block_t* block : it->second) {
+            if (block->start_address < end_address && block->end_address > start_address) {
+                block->check_code.store(true, std::memory_order_release);
+                for (knc_translated_block_t* superblock : block->containing_superblocks) {
+                    superblock->check_code.store(true, std::memory_order_release);
+                }
+            }
+        }
+    }
+}
+
+void KNCInstructionTranslator::invalidate_cache_entry(uint64_t address) {
+    invalidate_cache_range(address, 1);
+}
+
+bool KNCInstructionTranslator::open_persistent_cache(const std::string& path,
+                                                     const knc_translation_cache_key_t& key) {
+    close_persistent_cache();
+    
+    std::lock_guard<std::mutex> lock(block_mutex);
+    persistent_path = path;
+    persistent_key = key;
+    persistent_dirty = false;
+    if (!persistent_store.open(path, key)) {
+        return false;
+    }
+    persistent_rejected.assign(persistent_store.get_block_count(), false);
+    std::cout << "Translation cache: " << persistent_store.get_block_count() << " blocks in " << path << "\n";
+    return true;
+}
+
+void KNCInstructionTranslator::close_persistent_cache() {
+    std::lock_guard<std::mutex> lock(block_mutex);
+    if (persistent_path.empty()) {
+        return;
+    }
+    
+    if (persistent_dirty) {
+        // This run's blocks, then stored blocks it never reached
+        std::vector<knc_cached_block_t> blocks;
+        std::vector<knc_decoded_instruction_t> instructions;
+        for (const auto& entry : block_cache) {
+            const knc_translated_block_t* block = entry.second.get();
+            knc_cached_block_t cached;
+            cached.start_address = block->start_address;
+            cached.end_address = block->end_address;
+            cached.code_hash = block->code_hash;
+            cached.first_instruction = static_cast<uint32_t>(instructions.size());
+            cached.instruction_count = static_cast<uint32_t>(block->instructions.size());
+            blocks.push_back(cached);
+            for (knc_decoded_instruction_t inst : block->instructions) {
+                inst.handler = nullptr;  // Host addresses do not survive the run
+                instructions.push_back(inst);
+            }
+        }
+        for (uint32_t i = 0; i < persistent_store.get_block_count(); i++) {
+            const knc_cached_block_t& stored = persistent_store.get_block(i);
+            if (persistent_rejected[i] || block_cache.count(stored.start_address)) {
+                continue;
+            }
+            knc_cached_block_t cached = stored;
+            cached.first_instruction = static_cast<uint32_t>(instructions.size());
+            blocks.push_back(cached);
+            const knc_decoded_instruction_t* records = persistent_store.get_instructions(stored);
+            instructions.insert(instructions.end(), records, records + stored.instruction_count);
+        }
+        
+        // Unmap before replacing the file
+        persistent_store.close();
+        if (KNCTranslationStore::write(persistent_path, persistent_key, blocks, instructions)) {
+            persistent_blocks_saved += blocks.size();
+        }
+    }
+    
+    persistent_store.close();
+    persistent_rejected.clear();
+    persistent_path.clear();
+    persistent_dirty = false;
 }
 
 void KNCInstructionTranslator::shutdown() {
+    close_persistent_cache();
     std::cout << "Shutting down KNC Instruction Translator\n";
     print_translation_statistics();
 }
 
 // Missing translation function implementations
-knc_translated_instruction_t KNCInstructionTranslator::translate_vcmpps(const knc_translation_context_t& ctx) {
-    knc_translated_instruction_t result;
-    result.translated_bytes = generate_avx512_vector_op(ctx, "vcmpps");
-    result.translated_length = result.translated_bytes.size();
-    result.description = "KNC VCMPPS -> AVX-512 VCMPPS";
-    result.is_emulated = false;
-    result.emulation_overhead_cycles = 1;
+knc_micro_op_t KNCInstructionTranslator::translate_vcmpps(const knc_translation_context_t& ctx) {
+    knc_micro_op_t result = make_micro_op("KNC VCMPPS -> AVX-512 VCMPPS", false, 1);
+    generate_avx512_vector_op(ctx, "vcmpps", result);
     return result;
 }
 
-knc_translated_instruction_t KNCInstructionTranslator::translate_vminps(const knc_translation_context_t& ctx) {
-    knc_translated_instruction_t result;
-    result.translated_bytes = generate_avx512_vector_op(ctx, "vminps");
-    result.translated_length = result.translated_bytes.size();
-    result.description = "KNC VMINPS -> AVX-512 VMINPS";
-    result.is_emulated = false;
-    result.emulation_overhead_cycles = 1;
+knc_micro_op_t KNCInstructionTranslator::translate_vminps(const knc_translation_context_t& ctx) {
+    knc_micro_op_t result = make_micro_op("KNC VMINPS -> AVX-512 VMINPS", false, 1);
+    generate_avx512_vector_op(ctx, "vminps", result);
     return result;
 }
 
-knc_translated_instruction_t KNCInstructionTranslator::translate_vpermd(const knc_translation_context_t& ctx) {
-    knc_translated_instruction_t result;
-    result.translated_bytes = generate_avx512_vector_op(ctx, "vpermd");
-    result.translated_length = result.translated_bytes.size();
-    result.description = "KNC VPERMD -> AVX-512 VPERMD";
-    result.is_emulated = false;
-    result.emulation_overhead_cycles = 1;
+knc_micro_op_t KNCInstructionTranslator::translate_vpermd(const knc_translation_context_t& ctx) {
+    knc_micro_op_t result = make_micro_op("KNC VPERMD -> AVX-512 VPERMD", false, 1);
+    generate_avx512_vector_op(ctx, "vpermd", result);
     return result;
 }
 
-knc_translated_instruction_t KNCInstructionTranslator::translate_vpmulud(const knc_translation_context_t& ctx) {
-    knc_translated_instruction_t result;
-    result.translated_bytes = generate_avx512_vector_op(ctx, "vpmulud");
-    result.translated_length = result.translated_bytes.size();
-    result.description = "KNC VPMULUD -> AVX-512 VPMULUD";
-    result.is_emulated = false;
-    result.emulation_overhead_cycles = 1;
+knc_micro_op_t KNCInstructionTranslator::translate_vpmulud(const knc_translation_context_t& ctx) {
+    knc_micro_op_t result = make_micro_op("KNC VPMULUD -> AVX-512 VPMULUD", false, 1);
+    generate_avx512_vector_op(ctx, "vpmulud", result);
     return result;
 }
 
-knc_translated_instruction_t KNCInstructionTranslator::translate_vmaxps(const knc_translation_context_t& ctx) {
-    knc_translated_instruction_t result;
-    result.translated_bytes = generate_avx512_vector_op(ctx, "vmaxps");
-    result.translated_length = result.translated_bytes.size();
-    result.description = "KNC VMAXPS -> AVX-512 VMAXPS";
-    result.is_emulated = false;
-    result.emulation_overhead_cycles = 1;
+knc_micro_op_t KNCInstructionTranslator::translate_vmaxps(const knc_translation_context_t& ctx) {
+    knc_micro_op_t result = make_micro_op("KNC VMAXPS -> AVX-512 VMAXPS", false, 1);
+    generate_avx512_vector_op(ctx, "vmaxps", result);
     return result;
 }
 
-knc_translated_instruction_t KNCInstructionTranslator::translate_vpsubd(const knc_translation_context_t& ctx) {
-    knc_translated_instruction_t result;
-    result.translated_bytes = generate_avx512_vector_op(ctx, "vpsubd");
-    result.translated_length = result.translated_bytes.size();
-    result.description = "KNC VPSUBD -> AVX-512 VPSUBD";
-    result.is_emulated = false;
-    result.emulation_overhead_cycles = 1;
+knc_micro_op_t KNCInstructionTranslator::translate_vpsubd(const knc_translation_context_t& ctx) {
+    knc_micro_op_t result = make_micro_op("KNC VPSUBD -> AVX-512 VPSUBD", false, 1);
+    generate_avx512_vector_op(ctx, "vpsubd", result);
     return result;
 }
 
-knc_translated_instruction_t KNCInstructionTranslator::translate_scalar_instruction(const knc_translation_context_t& ctx) {
-    knc_translated_instruction_t result;
+knc_micro_op_t KNCInstructionTranslator::translate_scalar_instruction(const knc_translation_context_t& ctx) {
     // For scalar KNC-specific instructions, we'll implement basic emulation
+    // Higher overhead for emulated instructions
+    knc_micro_op_t result = make_micro_op("KNC scalar instruction - emulation needed", true, 5);
     if (ctx.instruction_bytes && ctx.instruction_length > 0) {
-        result.translated_bytes.assign(ctx.instruction_bytes, ctx.instruction_bytes + ctx.instruction_length);
+        result.length = static_cast<uint8_t>(std::min<uint32_t>(ctx.instruction_length, KNC_MICRO_OP_MAX_BYTES));
+        memcpy(result.bytes, ctx.instruction_bytes, result.length);
     }
-    result.translated_length = ctx.instruction_length;
-    result.description = "KNC scalar instruction - emulation needed";
-    result.is_emulated = true;
-    result.emulation_overhead_cycles = 5; // Higher overhead for emulated instructions
     return result;
 }
+
+// ---------------------------------------------------------------------------
+// Predecoder
+//
+// XED supplies the instruction length and class; the operand fields the
+// interpreter needs (registers, memory operand, immediate, write-mask) are
+// extracted here once so execution never looks at raw guest bytes again.
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const uint8_t* bytes;
+    uint32_t limit;
+    uint32_t pos;
+    bool lock;
+    bool rep;
+    bool opsize16;
+    uint8_t segment;
+    uint8_t rex;
+    // EVEX prefix fields (already un-inverted)
+    bool evex;
+    uint8_t evex_map;
+    uint8_t evex_pp;
+    bool evex_w;
+    uint8_t evex_vvvv;
+    uint8_t evex_ll;
+    uint8_t evex_aaa;
+    bool evex_z;
+    bool evex_b;
+    uint8_t evex_r;   // R' (bit 4 of the reg field)
+    uint8_t evex_v;   // V' (bit 4 of vvvv / VSIB index)
+    // KNC MVEX form of the 62 escape: P2 holds these in place of z, L'L and b
+    bool mvex;
+    bool mvex_eh;     // Eviction hint, or static rounding for register sources
+    uint8_t mvex_sss; // Swizzle / conversion selector
+    // ModRM fields with REX/EVEX extensions applied
+    uint8_t mod;
+    uint8_t reg;
+    uint8_t rm;
+    bool disp8;
+} knc_decode_state_t;
+
+static bool decode_fetch(knc_decode_state_t& st, uint8_t& byte) {
+    if (st.pos >= st.limit) {
+        return false;
+    }
+    byte = st.bytes[st.pos++];
+    return true;
+}
+
+static bool decode_immediate(knc_decode_state_t& st, uint32_t size, int64_t& value) {
+    if (st.pos + size > st.limit) {
+        return false;
+    }
+    
+    const uint8_t* p = st.bytes + st.pos;
+    switch (size) {
+        case 0: value = 0; break;
+        case 1: value = static_cast<int8_t>(p[0]); break;
+        case 2: { int16_t v; memcpy(&v, p, 2); value = v; break; }
+        case 4: { int32_t v; memcpy(&v, p, 4); value = v; break; }
+        case 8: { int64_t v; memcpy(&v, p, 8); value = v; break; }
+        default: { uint32_t v = 0; memcpy(&v, p, size); value = v; break; }  // ENTER iw,ib
+    }
+    st.pos += size;
+    return true;
+}
+
+static bool decode_modrm(knc_decode_state_t& st, knc_decoded_instruction_t& decoded, bool vsib) {
+    uint8_t modrm;
+    if (!decode_fetch(st, modrm)) {
+        return false;
+    }
+    
+    uint8_t rex_r = (st.rex >> 2) & 1;
+    uint8_t rex_x = (st.rex >> 1) & 1;
+    uint8_t rex_b = st.rex & 1;
+    
+    st.mod = modrm >> 6;
+    st.reg = ((modrm >> 3) & 7) | (rex_r << 3);
+    st.rm = modrm & 7;
+    st.disp8 = false;
+    
+    if (st.mod == 3) {
+        st.rm |= rex_b << 3;
+        return true;
+    }
+    
+    knc_memory_operand_t& mem = decoded.memory;
+    uint32_t disp_size = (st.mod == 1) ? 1 : (st.mod == 2) ? 4 : 0;
+    
+    if (st.rm == 4) {
+        uint8_t sib;
+        if (!decode_fetch(st, sib)) {
+            return false;
+        }
+        uint8_t index = ((sib >> 3) & 7) | (rex_x << 3);
+        mem.scale = static_cast<uint8_t>(1 << (sib >> 6));
+        if (vsib) {
+            mem.index = index | (st.evex_v << 4);  // zmm index register
+        } else if (index != 4) {
+            mem.index = index;
+        }
+        if ((sib & 7) == 5 && st.mod == 0) {
+            disp_size = 4;
+        } else {
+            mem.base = (sib & 7) | (rex_b << 3);
+        }
+    } else if (st.rm == 5 && st.mod == 0) {
+        mem.base = KNC_REG_RIP;
+        disp_size = 4;
+    } else {
+        mem.base = st.rm | (rex_b << 3);
+    }
+    
+    int64_t disp = 0;
+    if (!decode_immediate(st, disp_size, disp)) {
+        return false;
+    }
+    mem.displacement = static_cast<int32_t>(disp);
+    st.disp8 = (disp_size == 1);
+    return true;
+}
+
+// Immediate size of a one-byte-map opcode, 0 if none
+static uint32_t one_byte_immediate_size(const knc_decode_state_t& st, uint8_t opcode) {
+    uint32_t z = st.opsize16 ? 2 : 4;
+    
+    if (opcode < 0x40) {
+        if ((opcode & 7) == 4) return 1;
+        if ((opcode & 7) == 5) return z;
+        return 0;
+    }
+    if (opcode >= 0x70 && opcode <= 0x7F) return 1;
+    if (opcode >= 0xB0 && opcode <= 0xB7) return 1;
+    if (opcode >= 0xB8 && opcode <= 0xBF) return (st.rex & 0x08) ? 8 : z;
+    if (opcode >= 0xA0 && opcode <= 0xA3) return 8;  // moffs64
+    if (opcode >= 0xE0 && opcode <= 0xE7) return 1;
+    
+    switch (opcode) {
+        case 0x68: case 0x69: case 0x81: case 0xA9: case 0xC7:
+            return z;
+        case 0x6A: case 0x6B: case 0x80: case 0x83: case 0xA8:
+        case 0xC0: case 0xC1: case 0xC6: case 0xCD: case 0xEB:
+            return 1;
+        case 0xC2: case 0xCA:
+            return 2;
+        case 0xC8:
+            return 3;
+        case 0xE8: case 0xE9:
+            return 4;
+        case 0xF6:
+            return ((st.reg & 7) < 2) ? 1 : 0;
+        case 0xF7:
+            return ((st.reg & 7) < 2) ? z : 0;
+        default:
+            return 0;
+    }
+}
+
+static bool one_byte_has_modrm(uint8_t opcode) {
+    if (opcode < 0x40) {
+        return (opcode & 7) < 4;
+    }
+    if (opcode >= 0x80 && opcode <= 0x8F) return true;
+    if (opcode >= 0xD0 && opcode <= 0xD3) return true;
+    if (opcode >= 0xD8 && opcode <= 0xDF) return true;
+    
+    switch (opcode) {
+        case 0x63: case 0x69: case 0x6B:
+        case 0xC0: case 0xC1: case 0xC6: case 0xC7:
+        case 0xF6: case 0xF7: case 0xFE: case 0xFF:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool two_byte_has_modrm(uint8_t opcode) {
+    if (opcode >= 0x05 && opcode <= 0x09) return false;
+    if (opcode >= 0x30 && opcode <= 0x37) return false;
+    if (opcode >= 0x80 && opcode <= 0x8F) return false;
+    if (opcode >= 0xC8 && opcode <= 0xCF) return false;
+    
+    switch (opcode) {
+        case 0x0B: case 0x0E: case 0x77:
+        case 0xA0: case 0xA1: case 0xA2: case 0xA8: case 0xA9: case 0xAA:
+            return false;
+        default:
+            return true;
+    }
+}
+
+static uint32_t two_byte_immediate_size(uint8_t opcode) {
+    if (opcode >= 0x70 && opcode <= 0x73) return 1;
+    if (opcode >= 0x80 && opcode <= 0x8F) return 4;
+    
+    switch (opcode) {
+        case 0xA4: case 0xAC: case 0xBA:
+        case 0xC2: case 0xC4: case 0xC5: case 0xC6:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static void decode_set_rm_dst(const knc_decode_state_t& st, knc_decoded_instruction_t& decoded) {
+    if (st.mod == 3) {
+        decoded.dst = st.rm;
+    } else {
+        decoded.flags |= KNC_DECODE_MEM_DST;
+    }
+}
+
+static void decode_set_rm_src(const knc_decode_state_t& st, knc_decoded_instruction_t& decoded) {
+    if (st.mod == 3) {
+        decoded.src = st.rm;
+    } else {
+        decoded.flags |= KNC_DECODE_MEM_SRC;
+    }
+}
+
+// Byte-sized operands; without a REX prefix, byte registers 4-7 are AH, CH, DH and BH
+static void decode_byte_operands(const knc_decode_state_t& st, knc_decoded_instruction_t& decoded) {
+    decoded.operand_size = 1;
+    if (!st.rex) {
+        decoded.flags |= KNC_DECODE_HIGH_BYTE;
+    }
+}
+
+static bool decode_one_byte(knc_decode_state_t& st, uint8_t opcode, knc_decoded_instruction_t& decoded) {
+    static const knc_exec_op_t alu_ops[8] = {
+        KNC_OP_ADD, KNC_OP_OR, KNC_OP_ADC, KNC_OP_SBB,
+        KNC_OP_AND, KNC_OP_SUB, KNC_OP_XOR, KNC_OP_CMP
+    };
+    static const knc_exec_op_t shift_ops[8] = {
+        KNC_OP_ROL, KNC_OP_ROR, KNC_OP_UNKNOWN, KNC_OP_UNKNOWN,  // RCL/RCR not modelled
+        KNC_OP_SHL, KNC_OP_SHR, KNC_OP_SHL, KNC_OP_SAR
+    };
+    static const knc_exec_op_t unary_ops[8] = {
+        KNC_OP_TEST, KNC_OP_TEST, KNC_OP_NOT, KNC_OP_NEG,
+        KNC_OP_MUL, KNC_OP_IMUL_WIDE, KNC_OP_DIV, KNC_OP_IDIV
+    };
+    
+    if (one_byte_has_modrm(opcode) && !decode_modrm(st, decoded, false)) {
+        return false;
+    }
+    if (!decode_immediate(st, one_byte_immediate_size(st, opcode), decoded.immediate)) {
+        return false;
+    }
+    
+    uint8_t rex_b = st.rex & 1;
+    uint8_t group = st.reg & 7;
+    decoded.operand_size = (st.rex & 0x08) ? 8 : st.opsize16 ? 2 : 4;
+    
+    if (opcode < 0x40) {
+        decoded.op = alu_ops[opcode >> 3];
+        switch (opcode & 7) {
+            case 0:
+            case 1:  // r/m, r
+                decode_set_rm_dst(st, decoded);
+                decoded.src = st.reg;
+                break;
+            case 2:
+            case 3:  // r, r/m
+                decoded.dst = st.reg;
+                decode_set_rm_src(st, decoded);
+                break;
+            case 4:
+            case 5:  // rAX, imm
+                decoded.dst = KNC_REG_RAX;
+                decoded.flags |= KNC_DECODE_SRC_IMM;
+                break;
+            default:  // Legacy opcodes invalid in 64-bit mode
+                decoded.op = KNC_OP_UNKNOWN;
+                break;
+        }
+        if (!(opcode & 1)) {
+            decode_byte_operands(st, decoded);
+        }
+        return true;
+    }
+    
+    if (opcode >= 0x50 && opcode <= 0x57) {
+        decoded.op = KNC_OP_PUSH;
+        decoded.src = (opcode & 7) | (rex_b << 3);
+        decoded.operand_size = 8;
+        return true;
+    }
+    if (opcode >= 0x58 && opcode <= 0x5F) {
+        decoded.op = KNC_OP_POP;
+        decoded.dst = (opcode & 7) | (rex_b << 3);
+        decoded.operand_size = 8;
+        return true;
+    }
+    if (opcode >= 0x70 && opcode <= 0x7F) {
+        decoded.op = KNC_OP_JCC;
+        decoded.condition = opcode & 0x0F;
+        decoded.flags |= KNC_DECODE_BRANCH;
+        return true;
+    }
+    if (opcode >= 0x90 && opcode <= 0x97) {
+        uint8_t reg = (opcode & 7) | (rex_b << 3);
+        if (reg == KNC_REG_RAX) {
+            decoded.op = st.rep ? KNC_OP_PAUSE : KNC_OP_NOP;
+        } else {
+            decoded.op = KNC_OP_XCHG;
+            decoded.dst = reg;
+            decoded.src = KNC_REG_RAX;
+        }
+        return true;
+    }
+    if (opcode >= 0xB0 && opcode <= 0xB7) {
+        decoded.op = KNC_OP_MOV;
+        decoded.dst = (opcode & 7) | (rex_b << 3);
+        decoded.flags |= KNC_DECODE_SRC_IMM;
+        decode_byte_operands(st, decoded);
+        return true;
+    }
+    if (opcode >= 0xB8 && opcode <= 0xBF) {
+        decoded.op = KNC_OP_MOV;
+        decoded.dst = (opcode & 7) | (rex_b << 3);
+        decoded.flags |= KNC_DECODE_SRC_IMM;
+        if (decoded.operand_size == 4) {
+            decoded.immediate = static_cast<uint32_t>(decoded.immediate);  // mov r32, imm32 zero-extends
+        }
+        return true;
+    }
+    
+    switch (opcode) {
+        case 0x63:  // movsxd r, r/m32
+            decoded.op = KNC_OP_MOVSX;
+            decoded.dst = st.reg;
+            decode_set_rm_src(st, decoded);
+            decoded.immediate = 4;
+            break;
+        case 0x69:
+        case 0x6B:  // imul r, r/m, imm
+            decoded.op = KNC_OP_IMUL;
+            decoded.dst = st.reg;
+            decode_set_rm_src(st, decoded);
+            decoded.flags |= KNC_DECODE_SRC_IMM;
+            break;
+        case 0x80:
+        case 0x81:
+        case 0x83:  // group 1 r/m, imm
+            decoded.op = alu_ops[group];
+            decode_set_rm_dst(st, decoded);
+            decoded.flags |= KNC_DECODE_SRC_IMM;
+            if (opcode == 0x80) {
+                decode_byte_operands(st, decoded);
+            }
+            break;
+        case 0x84:
+        case 0x85:
+            decoded.op = KNC_OP_TEST;
+            decode_set_rm_dst(st, decoded);
+            decoded.src = st.reg;
+            if (opcode == 0x84) {
+                decode_byte_operands(st, decoded);
+            }
+            break;
+        case 0x87:
+            decoded.op = KNC_OP_XCHG;
+            decode_set_rm_dst(st, decoded);
+            decoded.src = st.reg;
+            break;
+        case 0x88:
+        case 0x89:
+            decoded.op = KNC_OP_MOV;
+            decode_set_rm_dst(st, decoded);
+            decoded.src = st.reg;
+            if (opcode == 0x88) {
+                decode_byte_operands(st, decoded);
+            }
+            break;
+        case 0x8A:
+        case 0x8B:
+            decoded.op = KNC_OP_MOV;
+            decoded.dst = st.reg;
+            decode_set_rm_src(st, decoded);
+            if (opcode == 0x8A) {
+                decode_byte_operands(st, decoded);
+            }
+            break;
+        case 0x8D:
+            if (st.mod != 3) {
+                decoded.op = KNC_OP_LEA;
+                decoded.dst = st.reg;
+            }
+            break;
+        case 0x98:  // cbw/cwde/cdqe
+            decoded.op = KNC_OP_CBW;
+            break;
+        case 0x99:  // cwd/cdq/cqo
+            decoded.op = KNC_OP_CWD;
+            break;
+        case 0xA8:
+        case 0xA9:
+            decoded.op = KNC_OP_TEST;
+            decoded.dst = KNC_REG_RAX;
+            decoded.flags |= KNC_DECODE_SRC_IMM;
+            if (opcode == 0xA8) {
+                decode_byte_operands(st, decoded);
+            }
+            break;
+        case 0xC0:
+        case 0xC1:
+        case 0xD0:
+        case 0xD1:
+        case 0xD2:
+        case 0xD3:  // group 2 shifts and rotates by imm8 / by one / by CL
+            decoded.op = shift_ops[group];
+            decode_set_rm_dst(st, decoded);
+            if (opcode >= 0xD2) {
+                decoded.src = KNC_REG_RCX;
+            } else {
+                if (opcode >= 0xD0) {
+                    decoded.immediate = 1;
+                }
+                decoded.flags |= KNC_DECODE_SRC_IMM;
+            }
+            if (!(opcode & 1)) {
+                decode_byte_operands(st, decoded);
+            }
+            break;
+        case 0xC3:
+            decoded.op = KNC_OP_RET;
+            decoded.flags |= KNC_DECODE_BRANCH;
+            break;
+        case 0xC6:
+        case 0xC7:
+            if (group == 0) {
+                decoded.op = KNC_OP_MOV;
+                decode_set_rm_dst(st, decoded);
+                decoded.flags |= KNC_DECODE_SRC_IMM;
+                if (opcode == 0xC6) {
+                    decode_byte_operands(st, decoded);
+                }
+            }
+            break;
+        case 0xC9:
+            decoded.op = KNC_OP_LEAVE;
+            decoded.operand_size = 8;
+            break;
+        case 0xE8:
+            decoded.op = KNC_OP_CALL;
+            decoded.flags |= KNC_DECODE_BRANCH;
+            break;
+        case 0xE9:
+        case 0xEB:
+            decoded.op = KNC_OP_JMP;
+            decoded.flags |= KNC_DECODE_BRANCH;
+            break;
+        case 0xF4:
+            decoded.op = KNC_OP_HLT;
+            decoded.flags |= KNC_DECODE_BRANCH;
+            break;
+        case 0xF6:
+        case 0xF7:  // group 3
+            decoded.op = unary_ops[group];
+            if (group < 2) {
+                decode_set_rm_dst(st, decoded);
+                decoded.flags |= KNC_DECODE_SRC_IMM;
+            } else if (group < 4) {
+                decode_set_rm_dst(st, decoded);
+            } else {
+                decode_set_rm_src(st, decoded);  // rDX:rAX is the implicit destination
+            }
+            if (opcode == 0xF6) {
+                decode_byte_operands(st, decoded);
+            }
+            break;
+        case 0xFE:
+            if (group == 0 || group == 1) {
+                decoded.op = (group == 0) ? KNC_OP_INC : KNC_OP_DEC;
+                decode_set_rm_dst(st, decoded);
+                decode_byte_operands(st, decoded);
+            }
+            break;
+        case 0xFF:
+            if (group == 0 || group == 1) {
+                decoded.op = (group == 0) ? KNC_OP_INC : KNC_OP_DEC;
+                decode_set_rm_dst(st, decoded);
+            } else if (group == 2 || group == 4) {
+                decoded.op = (group == 2) ? KNC_OP_CALL_INDIRECT : KNC_OP_JMP_INDIRECT;
+                decode_set_rm_src(st, decoded);
+                decoded.operand_size = 8;
+                decoded.flags |= KNC_DECODE_BRANCH;
+            }
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+static bool decode_two_byte(knc_decode_state_t& st, knc_decoded_instruction_t& decoded) {
+    uint8_t opcode;
+    if (!decode_fetch(st, opcode)) {
+        return false;
+    }
+    
+    // Three-byte legacy maps (SSE4 etc.) are only sized, not executed
+    if (opcode == 0x38 || opcode == 0x3A) {
+        uint8_t opcode3;
+        int64_t imm;
+        return decode_fetch(st, opcode3) && decode_modrm(st, decoded, false) &&
+               decode_immediate(st, (opcode == 0x3A) ? 1 : 0, imm);
+    }
+    
+    if (two_byte_has_modrm(opcode) && !decode_modrm(st, decoded, false)) {
+        return false;
+    }
+    if (!decode_immediate(st, two_byte_immediate_size(opcode), decoded.immediate)) {
+        return false;
+    }
+    
+    decoded.operand_size = (st.rex & 0x08) ? 8 : st.opsize16 ? 2 : 4;
+    
+    if (opcode >= 0x80 && opcode <= 0x8F) {
+        decoded.op = KNC_OP_JCC;
+        decoded.condition = opcode & 0x0F;
+        decoded.flags |= KNC_DECODE_BRANCH;
+        return true;
+    }
+    if (opcode >= 0x40 && opcode <= 0x4F) {
+        decoded.op = KNC_OP_CMOVCC;
+        decoded.condition = opcode & 0x0F;
+        decoded.dst = st.reg;
+        decode_set_rm_src(st, decoded);
+        return true;
+    }
+    if (opcode >= 0x90 && opcode <= 0x9F) {
+        decoded.op = KNC_OP_SETCC;
+        decoded.condition = opcode & 0x0F;
+        decode_set_rm_dst(st, decoded);
+        decode_byte_operands(st, decoded);
+        return true;
+    }
+    
+    switch (opcode) {
+        case 0x05:
+            decoded.op = KNC_OP_SYSCALL;
+            decoded.flags |= KNC_DECODE_BRANCH;
+            break;
+        case 0x0D:
+        case 0x18: case 0x19: case 0x1A: case 0x1B:
+        case 0x1C: case 0x1D: case 0x1E: case 0x1F:
+            decoded.op = KNC_OP_NOP;  // Prefetches, ENDBR64 and the hint NOP space
+            break;
+        case 0xAF:
+            decoded.op = KNC_OP_IMUL;
+            decoded.dst = st.reg;
+            decode_set_rm_src(st, decoded);
+            break;
+        case 0xB1:
+            decoded.op = KNC_OP_CMPXCHG;
+            decode_set_rm_dst(st, decoded);
+            decoded.src = st.reg;
+            break;
+        case 0xB6:
+        case 0xB7:
+        case 0xBE:
+        case 0xBF:  // movzx/movsx r, r/m8 or r/m16
+            decoded.op = (opcode < 0xB8) ? KNC_OP_MOVZX : KNC_OP_MOVSX;
+            decoded.dst = st.reg;
+            decode_set_rm_src(st, decoded);
+            decoded.immediate = (opcode & 1) ? 2 : 1;
+            if (!(opcode & 1) && !st.rex) {
+                decoded.flags |= KNC_DECODE_HIGH_BYTE;
+            }
+            break;
+        case 0xC1:
+            decoded.op = KNC_OP_XADD;
+            decode_set_rm_dst(st, decoded);
+            decoded.src = st.reg;
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+// 16-bit opmask instructions. KNC encodes the logic operations with two
+// operands (VEX.L0, the reg-field mask is both destination and first
+// source); AVX-512 adds a three-operand form (VEX.L1, first source in vvvv).
+static knc_exec_op_t decode_vex_opmask(const knc_decode_state_t& st, uint8_t opcode, uint8_t vvvv, bool l,
+                                       knc_decoded_instruction_t& decoded) {
+    bool mem = (st.mod != 3);
+    uint8_t reg = st.reg & 7;
+    uint8_t rm = st.rm & 7;
+    
+    decoded.operand_size = 2;
+    decoded.dst = reg;
+    decoded.src = l ? (vvvv & 7) : reg;
+    decoded.src2 = rm;
+    
+    switch (opcode) {
+        case 0x41: return mem ? KNC_OP_UNKNOWN : KNC_OP_KAND;
+        case 0x42: return mem ? KNC_OP_UNKNOWN : KNC_OP_KANDN;
+        case 0x45: return mem ? KNC_OP_UNKNOWN : KNC_OP_KOR;
+        case 0x46: return mem ? KNC_OP_UNKNOWN : KNC_OP_KXNOR;
+        case 0x47: return mem ? KNC_OP_UNKNOWN : KNC_OP_KXOR;
+        case 0x43:
+            // KNC kandnr: k1 = ~k2 & k1
+            decoded.src = rm;
+            decoded.src2 = reg;
+            return (mem || l) ? KNC_OP_UNKNOWN : KNC_OP_KANDN;
+        default:
+            break;
+    }
+    
+    // The rest have a single source and no three-operand form
+    decoded.src = KNC_REG_NONE;
+    if (l) {
+        return KNC_OP_UNKNOWN;
+    }
+    switch (opcode) {
+        case 0x44:
+            return mem ? KNC_OP_UNKNOWN : KNC_OP_KNOT;
+        case 0x90:
+            if (mem) {
+                decoded.flags |= KNC_DECODE_MEM_SRC;
+                decoded.src2 = KNC_REG_NONE;
+            }
+            return KNC_OP_KMOV;
+        case 0x91:
+            decoded.flags |= KNC_DECODE_MEM_DST;
+            decoded.dst = KNC_REG_NONE;
+            decoded.src = reg;
+            decoded.src2 = KNC_REG_NONE;
+            return mem ? KNC_OP_KMOV : KNC_OP_UNKNOWN;
+        case 0x92:
+            decoded.operand_size = 4;
+            decoded.src2 = st.rm;  // General register source
+            return mem ? KNC_OP_UNKNOWN : KNC_OP_KMOV_FROM_GPR;
+        case 0x93:
+            decoded.operand_size = 4;
+            decoded.dst = st.reg;  // General register destination
+            return mem ? KNC_OP_UNKNOWN : KNC_OP_KMOV_TO_GPR;
+        case 0x98:
+            decoded.dst = KNC_REG_NONE;
+            decoded.src = reg;
+            return mem ? KNC_OP_UNKNOWN : KNC_OP_KORTEST;
+        default:
+            return KNC_OP_UNKNOWN;
+    }
+}
+
+static bool decode_vex(knc_decode_state_t& st, uint8_t opcode, knc_decoded_instruction_t& decoded) {
+    // VEX-encoded AVX/AVX2 instructions are sized but not executed, apart
+    // from the opmask instructions KNC and AVX-512 share
+    uint8_t p0, p1 = 0, map = 1;
+    if (!decode_fetch(st, p0)) {
+        return false;
+    }
+    if (opcode == 0xC4) {
+        map = p0 & 0x1F;
+        if (!decode_fetch(st, p1)) {
+            return false;
+        }
+    }
+    
+    // R, X, B and vvvv are stored inverted; C5 carries only R
+    uint8_t fields = (opcode == 0xC4) ? p1 : p0;
+    st.rex = static_cast<uint8_t>((~p0 >> 5) & ((opcode == 0xC4) ? 0x7 : 0x4));
+    bool w = (opcode == 0xC4) && (p1 & 0x80);
+    uint8_t vvvv = ((~fields) >> 3) & 0x0F;
+    bool l = (fields & 0x04) != 0;
+    uint8_t pp = fields & 0x03;
+    
+    uint8_t vex_opcode;
+    if (!decode_fetch(st, vex_opcode)) {
+        return false;
+    }
+    if (!(map == 1 && vex_opcode == 0x77) && !decode_modrm(st, decoded, false)) {
+        return false;
+    }
+    
+    uint32_t imm_size = (map == 3) ? 1 : (map == 1) ? two_byte_immediate_size(vex_opcode) : 0;
+    int64_t imm;
+    if (!decode_immediate(st, imm_size, imm)) {
+        return false;
+    }
+    
+    if (map == 1 && pp == 0 && !w) {
+        decoded.op = decode_vex_opmask(st, vex_opcode, vvvv, l, decoded);
+    }
+    return true;
+}
+
+// KNC (MVEX) vector instructions. The shared ones keep their EVEX opcode;
+// the swizzle/conversion field is resolved against the table for the
+// instruction's element type, and disp8 scales by the size of the memory
+// operand before up-conversion.
+static knc_exec_op_t decode_mvex(const knc_decode_state_t& st, uint8_t opcode, knc_exec_op_t op, bool mem,
+                                 knc_decoded_instruction_t& decoded, uint32_t& disp_scale) {
+    bool is_float = false;
+    bool load_op = false;     // Arithmetic source: register swizzles and memory broadcasts
+    bool element = false;     // Memory operand is single elements: disp8 scales by element size
+    switch (op) {
+        case KNC_OP_VPADDD: case KNC_OP_VPSUBD: case KNC_OP_VPMULLD: case KNC_OP_VPANDD:
+        case KNC_OP_VPORD: case KNC_OP_VPXORD: case KNC_OP_VPERMD:
+            load_op = true;
+            break;
+        case KNC_OP_VADDPS: case KNC_OP_VSUBPS: case KNC_OP_VMULPS: case KNC_OP_VFMADD231PS:
+        case KNC_OP_VCMPPS:
+            load_op = true;
+            is_float = true;
+            break;
+        case KNC_OP_VLOAD:
+        case KNC_OP_VSTORE:
+            // vmovaps and vmovdqa32; KNC has no unaligned full-vector moves
+            if (opcode == 0x10 || opcode == 0x11 || st.evex_pp == 2) {
+                return KNC_OP_UNKNOWN;
+            }
+            is_float = (st.evex_pp == 0);
+            break;
+        case KNC_OP_VPBROADCASTD:
+            is_float = (opcode == 0x18);
+            element = true;
+            break;
+        case KNC_OP_VGATHERDPS:
+        case KNC_OP_VSCATTERDPS:
+            is_float = true;
+            element = true;
+            break;
+        case KNC_OP_UNKNOWN:
+            if (st.evex_map != 2 || st.evex_pp > 1) {
+                return KNC_OP_UNKNOWN;
+            }
+            switch (opcode) {
+                case 0xD0: case 0xD1:
+                    op = (st.evex_pp == 0) ? KNC_OP_VLOADUNPACKL : KNC_OP_VPACKSTOREL;
+                    break;
+                case 0xD4: case 0xD5:
+                    op = (st.evex_pp == 0) ? KNC_OP_VLOADUNPACKH : KNC_OP_VPACKSTOREH;
+                    break;
+                default:
+                    return KNC_OP_UNKNOWN;
+            }
+            if (!mem) {
+                return KNC_OP_UNKNOWN;
+            }
+            is_float = (opcode & 1) != 0;  // ps forms; the d forms are even
+            element = true;
+            break;
+        default:
+            return KNC_OP_UNKNOWN;  // EVEX-only instruction
+    }
+    if (is_float) {
+        decoded.flags |= KNC_DECODE_FLOAT;
+    }
+    
+    if (!mem) {
+        // With the eviction hint set, SSS selects a static rounding mode for
+        // register sources instead; rounding overrides are not modelled
+        if (!st.mvex_eh && st.mvex_sss != 0) {
+            if (!load_op && op != KNC_OP_VLOAD) {
+                return KNC_OP_UNKNOWN;
+            }
+            decoded.conversion = static_cast<uint8_t>(KNC_SWIZZLE_CDAB + st.mvex_sss - 1);
+        }
+        return op;
+    }
+    
+    static const uint8_t memory_conversions[8] = {
+        KNC_CONV_NONE, KNC_CONV_1TO16, KNC_CONV_4TO16, KNC_CONV_FLOAT16,
+        KNC_CONV_UINT8, KNC_CONV_SINT8, KNC_CONV_UINT16, KNC_CONV_SINT16
+    };
+    uint8_t conversion = memory_conversions[st.mvex_sss];
+    bool broadcast = (conversion == KNC_CONV_1TO16 || conversion == KNC_CONV_4TO16);
+    if ((conversion == KNC_CONV_FLOAT16 && !is_float) || (broadcast && !load_op)) {
+        return KNC_OP_UNKNOWN;  // Reserved encodings
+    }
+    if ((op == KNC_OP_VGATHERDPS || op == KNC_OP_VSCATTERDPS) && conversion != KNC_CONV_NONE) {
+        return KNC_OP_UNKNOWN;  // Gathers and scatters move 32-bit elements only
+    }
+    decoded.conversion = conversion;
+    
+    uint32_t size = knc_conversion_element_size(conversion);
+    if (element) {
+        disp_scale = size;
+    } else if (conversion == KNC_CONV_1TO16) {
+        disp_scale = 4;
+    } else if (conversion == KNC_CONV_4TO16) {
+        disp_scale = 16;
+    } else {
+        disp_scale = size * KNC_VECTOR_LANES;
+    }
+    return op;
+}
+
+static bool decode_evex(knc_decode_state_t& st, knc_decoded_instruction_t& decoded) {
+    uint8_t p0, p1, p2, opcode;
+    if (!decode_fetch(st, p0) || !decode_fetch(st, p1) || !decode_fetch(st, p2) ||
+        !decode_fetch(st, opcode)) {
+        return false;
+    }
+    
+    // R, X, B, R', vvvv and V' are stored inverted
+    st.evex = true;
+    st.rex = static_cast<uint8_t>(((~p0 >> 5) & 0x7) | ((p1 & 0x80) ? 0x08 : 0));
+    st.evex_r = ((~p0) >> 4) & 1;
+    st.evex_w = (p1 & 0x80) != 0;
+    st.evex_vvvv = ((~p1) >> 3) & 0x0F;
+    st.evex_pp = p1 & 0x03;
+    st.evex_v = ((~p2) >> 3) & 1;
+    
+    // KNC's MVEX clears P1 bit 2. Every MVEX instruction is 512 bits wide;
+    // P2 carries the eviction hint and swizzle/conversion selector instead
+    // of zeroing, vector length and broadcast.
+    st.mvex = !(p1 & 0x04);
+    if (st.mvex) {
+        st.evex_map = p0 & 0x0F;
+        st.mvex_eh = (p2 & 0x80) != 0;
+        st.mvex_sss = (p2 >> 4) & 0x07;
+        st.evex_ll = 2;
+    } else {
+        st.evex_map = p0 & 0x07;
+        st.evex_z = (p2 & 0x80) != 0;
+        st.evex_ll = (p2 >> 5) & 0x03;
+        st.evex_b = (p2 & 0x10) != 0;
+    }
+    st.evex_aaa = p2 & 0x07;
+    
+    bool vsib = (st.evex_map == 2 && (opcode == 0x92 || opcode == 0xA2 || opcode == 0xC6));
+    if (!decode_modrm(st, decoded, vsib)) {
+        return false;
+    }
+    
+    uint32_t imm_size = (st.evex_map == 3) ? 1 : (st.evex_map == 1) ? two_byte_immediate_size(opcode) : 0;
+    if (!decode_immediate(st, imm_size, decoded.immediate)) {
+        return false;
+    }
+    
+    uint8_t reg = st.reg | (st.evex_r << 4);
+    uint8_t vvvv = st.evex_vvvv | (st.evex_v << 4);
+    bool mem = (st.mod != 3);
+    
+    decoded.flags |= KNC_DECODE_VECTOR;
+    decoded.operand_size = KNC_VECTOR_BYTES;
+    decoded.mask = st.evex_aaa;
+    decoded.dst = reg;
+    decoded.src = vvvv;
+    if (mem) {
+        decoded.flags |= KNC_DECODE_MEM_SRC;
+        if (st.evex_b) {
+            decoded.flags |= KNC_DECODE_BROADCAST;
+        }
+    } else {
+        decoded.src2 = st.rm | ((st.rex & 0x02) ? 0x10 : 0);  // EVEX.X extends register rm
+    }
+    if (st.evex_z) {
+        decoded.flags |= KNC_DECODE_ZEROING;
+    }
+    
+    // Only 512-bit, 32-bit element forms are executed
+    knc_exec_op_t op = KNC_OP_UNKNOWN;
+    uint32_t disp_scale = st.evex_b ? 4 : KNC_VECTOR_BYTES;
+    if (st.evex_ll == 2 && !st.evex_w) {
+        if (st.evex_map == 1 && st.evex_pp == 1) {
+            switch (opcode) {
+                case 0xFE: op = KNC_OP_VPADDD; break;
+                case 0xFA: op = KNC_OP_VPSUBD; break;
+                case 0xDB: op = KNC_OP_VPANDD; break;
+                case 0xEB: op = KNC_OP_VPORD; break;
+                case 0xEF: op = KNC_OP_VPXORD; break;
+                case 0x6F: op = KNC_OP_VLOAD; break;    // vmovdqa32
+                case 0x7F: op = KNC_OP_VSTORE; break;   // vmovdqa32
+            }
+        } else if (st.evex_map == 1 && st.evex_pp == 2) {
+            switch (opcode) {
+                case 0x6F: op = KNC_OP_VLOAD; break;    // vmovdqu32
+                case 0x7F: op = KNC_OP_VSTORE; break;   // vmovdqu32
+            }
+        } else if (st.evex_map == 1 && st.evex_pp == 0) {
+            switch (opcode) {
+                case 0x58: op = KNC_OP_VADDPS; break;
+                case 0x5C: op = KNC_OP_VSUBPS; break;
+                case 0x59: op = KNC_OP_VMULPS; break;
+                case 0x5E: op = KNC_OP_VDIVPS; break;
+                case 0x5F: op = KNC_OP_VMAXPS; break;
+                case 0x5D: op = KNC_OP_VMINPS; break;
+                case 0x10: case 0x28: op = KNC_OP_VLOAD; break;    // vmovups / vmovaps
+                case 0x11: case 0x29: op = KNC_OP_VSTORE; break;   // vmovups / vmovaps
+                case 0xC2:
+                    op = KNC_OP_VCMPPS;
+                    decoded.dst = st.reg & 7;  // destination is an opmask register
+                    decoded.condition = static_cast<uint8_t>(decoded.immediate & 0x1F);
+                    break;
+            }
+        } else if (st.evex_map == 2 && st.evex_pp == 1) {
+            switch (opcode) {
+                case 0x40: op = KNC_OP_VPMULLD; break;
+                case 0x36: op = KNC_OP_VPERMD; break;
+                case 0xB8: op = KNC_OP_VFMADD231PS; break;
+                case 0x18:
+                case 0x58:  // vbroadcastss / vpbroadcastd
+                    op = KNC_OP_VPBROADCASTD;
+                    disp_scale = 4;
+                    break;
+                case 0x92:
+                    op = KNC_OP_VGATHERDPS;
+                    disp_scale = 4;
+                    break;
+                case 0xA2:
+                    op = KNC_OP_VSCATTERDPS;
+                    disp_scale = 4;
+                    break;
+                case 0x88:
+                case 0x89:  // vexpandps / vpexpandd
+                    op = KNC_OP_VEXPAND;
+                    disp_scale = 4;
+                    break;
+                case 0x8A:
+                case 0x8B:  // vcompressps / vpcompressd
+                    op = KNC_OP_VCOMPRESS;
+                    disp_scale = 4;
+                    break;
+                case 0x7E: case 0x7F: op = KNC_OP_VPERMT2D; break;  // vpermt2d / vpermt2ps
+                case 0xC4: op = KNC_OP_VPCONFLICTD; break;
+                case 0x44: op = KNC_OP_VPLZCNTD; break;
+                case 0xCA: op = KNC_OP_VRCP28PS; break;
+                case 0xCC: op = KNC_OP_VRSQRT28PS; break;
+                case 0xC8: op = KNC_OP_VEXP2PS; break;
+                case 0xC6:
+                    // Prefetch hints share the opcode: /1 /2 gather, /5 /6 scatter, 0 = L1 and 1 = L2
+                    switch (st.reg & 7) {
+                        case 1: case 2: op = KNC_OP_VGATHERPFDPS; break;
+                        case 5: case 6: op = KNC_OP_VSCATTERPFDPS; break;
+                    }
+                    decoded.condition = static_cast<uint8_t>(((st.reg & 7) - 1) & 3);
+                    disp_scale = 4;
+                    break;
+            }
+        }
+    }
+    
+    if (st.mvex) {
+        op = decode_mvex(st, opcode, op, mem, decoded, disp_scale);
+    }
+    
+    // Stores and scatters write memory from the reg-field register
+    if (op == KNC_OP_VSTORE || op == KNC_OP_VSCATTERDPS || op == KNC_OP_VPACKSTOREL || op == KNC_OP_VPACKSTOREH) {
+        if (!mem) {
+            op = KNC_OP_UNKNOWN;  // register-to-register move encodings
+        }
+        decoded.flags = (decoded.flags & ~KNC_DECODE_MEM_SRC) | KNC_DECODE_MEM_DST;
+        decoded.src = reg;
+        decoded.dst = KNC_REG_NONE;
+    }
+    if ((op == KNC_OP_VGATHERDPS || op == KNC_OP_VSCATTERDPS) && (!mem || decoded.mask == 0)) {
+        op = KNC_OP_UNKNOWN;  // gathers and scatters require VSIB and a write-mask
+    }
+    
+    // Single-source operations take it from r/m; vvvv is unused
+    if (op == KNC_OP_VEXPAND || op == KNC_OP_VPCONFLICTD || op == KNC_OP_VPLZCNTD ||
+        op == KNC_OP_VRCP28PS || op == KNC_OP_VRSQRT28PS || op == KNC_OP_VEXP2PS) {
+        decoded.src = KNC_REG_NONE;
+    }
+    // Compresses write r/m from the reg-field register, packing into memory or a register
+    if (op == KNC_OP_VCOMPRESS) {
+        decoded.src = reg;
+        if (mem) {
+            decoded.flags = (decoded.flags & ~KNC_DECODE_MEM_SRC) | KNC_DECODE_MEM_DST;
+            decoded.dst = KNC_REG_NONE;
+        } else {
+            decoded.dst = decoded.src2;
+            decoded.src2 = KNC_REG_NONE;
+        }
+    }
+    if ((op == KNC_OP_VEXPAND || op == KNC_OP_VCOMPRESS) && (decoded.flags & KNC_DECODE_BROADCAST)) {
+        op = KNC_OP_UNKNOWN;  // no embedded broadcast
+    }
+    // Gather and scatter prefetches only name memory; they never fault or write a register
+    if (op == KNC_OP_VGATHERPFDPS || op == KNC_OP_VSCATTERPFDPS) {
+        if (!mem || decoded.mask == 0) {
+            op = KNC_OP_UNKNOWN;
+        }
+        decoded.dst = KNC_REG_NONE;
+        decoded.src = KNC_REG_NONE;
+    }
+    
+    if (st.disp8) {
+        decoded.memory.displacement *= static_cast<int32_t>(disp_scale);  // EVEX disp8*N compression
+    }
+    decoded.op = op;
+    return true;
+}
+
+bool KNCInstructionTranslator::decode_instruction(uint64_t address, const uint8_t* instruction_bytes,
+                                                  size_t available, knc_decoded_instruction_t& decoded) {
+    memset(&decoded, 0, sizeof(decoded));
+    decoded.address = address;
+    decoded.op = KNC_OP_UNKNOWN;
+    decoded.dst = KNC_REG_NONE;
+    decoded.src = KNC_REG_NONE;
+    decoded.src2 = KNC_REG_NONE;
+    decoded.memory.base = KNC_REG_NONE;
+    decoded.memory.index = KNC_REG_NONE;
+    decoded.memory.scale = 1;
+    
+    uint32_t limit = static_cast<uint32_t>(std::min<size_t>(available, 15));
+    if (limit == 0) {
+        return false;
+    }
+    
+    // XED pass - authoritative length and class when it recognizes the bytes
+    xed_decoded_inst_t xed_inst;
+    if (xed_decode_bytes(instruction_bytes, limit, xed_inst) != XED_ERROR_NONE) {
+        return false;
+    }
+    uint32_t xed_length = xed_decoded_inst_get_length(&xed_inst);
+    
+    // Operand extraction pass
+    knc_decode_state_t st;
+    memset(&st, 0, sizeof(st));
+    st.bytes = instruction_bytes;
+    st.limit = limit;
+    
+    uint8_t opcode = 0;
+    bool ok = true;
+    for (;;) {
+        if (!decode_fetch(st, opcode)) {
+            ok = false;
+            break;
+        }
+        if (opcode == 0xF0) { st.lock = true; continue; }
+        if (opcode == 0xF3) { st.rep = true; continue; }
+        if (opcode == 0xF2 || opcode == 0x67 || opcode == 0x2E || opcode == 0x36 ||
+            opcode == 0x3E || opcode == 0x26) { continue; }
+        if (opcode == 0x66) { st.opsize16 = true; continue; }
+        if (opcode == 0x64 || opcode == 0x65) { st.segment = opcode; continue; }
+        if ((opcode & 0xF0) == 0x40) {
+            st.rex = opcode;
+            ok = decode_fetch(st, opcode);
+        }
+        break;
+    }
+    
+    if (ok) {
+        switch (opcode) {
+            case 0x0F: ok = decode_two_byte(st, decoded); break;
+            case 0x62: ok = decode_evex(st, decoded); break;
+            case 0xC4:
+            case 0xC5: ok = decode_vex(st, opcode, decoded); break;
+            default: ok = decode_one_byte(st, opcode, decoded); break;
+        }
+    }
+    
+    uint32_t length = xed_length ? xed_length : (ok ? st.pos : 0);
+    if (!ok || length != st.pos) {
+        // Operand fields cannot be trusted - keep the length so the block can
+        // still be formed; executing it raises KNC_ERROR_INVALID_INSTRUCTION
+        decoded.op = KNC_OP_UNKNOWN;
+        decoded.flags = 0;
+    }
+    decoded.length = static_cast<uint8_t>(length ? length : 1);
+    decoded.memory.segment = st.segment;
+    if (st.lock) {
+        decoded.flags |= KNC_DECODE_LOCK;
+    }
+    if (st.rep) {
+        decoded.flags |= KNC_DECODE_REP;
+    }
+    
+    // Relative branches carry their absolute target
+    if (decoded.op == KNC_OP_JMP || decoded.op == KNC_OP_JCC || decoded.op == KNC_OP_CALL) {
+        decoded.immediate += static_cast<int64_t>(address + decoded.length);
+    }
+    
+    return true;
+}
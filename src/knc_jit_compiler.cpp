@@ -0,0 +1,1006 @@
+/*
+ * Copyright (c) 2026 IMIC_SDS Development Team
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "knc_jit_compiler.h"
+#include "knc_page_tables.h"
+#include <iostream>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Host registers used by compiled code (System V calling convention)
+//   rdi - core state
+//   rax, rcx - operand scratch / flag spills / TLB probe
+//   r8 - effective address    r9 - index scratch
+//   r10 - exit RIP            r11 - self-loop iteration budget
+#define HOST_RAX 0
+#define HOST_RCX 1
+#define HOST_RDX 2
+#define HOST_RSI 6
+#define HOST_RDI 7
+#define HOST_R8 8
+#define HOST_R9 9
+#define HOST_R10 10
+#define HOST_R11 11
+
+// Core state layout seen from compiled code
+static const int32_t JIT_ZMM_OFFSET = static_cast<int32_t>(
+    offsetof(knc_core_state_t, registers) + offsetof(knc_register_file_t, zmm));
+static const int32_t JIT_K_OFFSET = static_cast<int32_t>(
+    offsetof(knc_core_state_t, registers) + offsetof(knc_register_file_t, k));
+static const int32_t JIT_GPR_OFFSET = static_cast<int32_t>(
+    offsetof(knc_core_state_t, registers) + offsetof(knc_register_file_t, gpr));
+static const int32_t JIT_RIP_OFFSET = static_cast<int32_t>(
+    offsetof(knc_core_state_t, registers) + offsetof(knc_register_file_t, rip));
+static const int32_t JIT_RFLAGS_OFFSET = static_cast<int32_t>(
+    offsetof(knc_core_state_t, registers) + offsetof(knc_register_file_t, rflags));
+static const int32_t JIT_CYCLES_OFFSET = static_cast<int32_t>(offsetof(knc_core_state_t, cycles_executed));
+static const int32_t JIT_BUDGET_OFFSET = static_cast<int32_t>(offsetof(knc_core_state_t, jit_loop_budget));
+static const int32_t JIT_TLB_OFFSET = static_cast<int32_t>(offsetof(knc_core_state_t, tlb));
+
+// Software TLB entry layout probed inline before every guest access
+static_assert(sizeof(knc_tlb_entry_t) == 32, "TLB entry index is scaled with shl 5");
+static_assert(KNC_TLB_ENTRIES == 64, "TLB entry index is masked with and 63");
+static const int8_t JIT_TLB_READ_TAG = static_cast<int8_t>(offsetof(knc_tlb_entry_t, read_tag));
+static const int8_t JIT_TLB_WRITE_TAG = static_cast<int8_t>(offsetof(knc_tlb_entry_t, write_tag));
+static const int8_t JIT_TLB_HOST_OFFSET = static_cast<int8_t>(offsetof(knc_tlb_entry_t, host_offset));
+static const int8_t JIT_TLB_HITS = static_cast<int8_t>(offsetof(knc_tlb_entry_t, hits));
+
+// Arithmetic flags (CF PF AF ZF SF OF) carried between host and guest RFLAGS
+static const uint32_t JIT_ARITH_FLAGS = 0x8D5;
+
+// Fault sites reserved per byte of code buffer; every memory access emits well over this
+static const size_t JIT_CODE_BYTES_PER_FAULT_SITE = 16;
+
+// ---------------------------------------------------------------------------
+// Minimal x86-64 assembler for the instruction forms the JIT emits
+// ---------------------------------------------------------------------------
+
+class KNCJitAssembler {
+public:
+    std::vector<uint8_t>& code;
+
+    explicit KNCJitAssembler(std::vector<uint8_t>& buffer) : code(buffer) {}
+
+    size_t position() const { return code.size(); }
+
+    void byte(uint8_t value) { code.push_back(value); }
+
+    void dword(uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            code.push_back(static_cast<uint8_t>(value >> (i * 8)));
+        }
+    }
+
+    void qword(uint64_t value) {
+        for (int i = 0; i < 8; i++) {
+            code.push_back(static_cast<uint8_t>(value >> (i * 8)));
+        }
+    }
+
+    void rex(bool w, int reg, int index, int base) {
+        uint8_t value = 0x40 | (w ? 0x08 : 0) | ((reg & 8) ? 0x04 : 0) |
+                        ((index & 8) ? 0x02 : 0) | ((base & 8) ? 0x01 : 0);
+        if (value != 0x40) {
+            byte(value);
+        }
+    }
+
+    // [base + disp32]
+    void modrm_mem(int reg, int base, int32_t disp) {
+        byte(static_cast<uint8_t>(0x80 | ((reg & 7) << 3) | (base & 7)));
+        if ((base & 7) == 4) {
+            byte(0x24);
+        }
+        dword(static_cast<uint32_t>(disp));
+    }
+
+    void modrm_reg(int reg, int rm) {
+        byte(static_cast<uint8_t>(0xC0 | ((reg & 7) << 3) | (rm & 7)));
+    }
+
+    // Legacy op reg, [base + disp32]
+    void op_mem(bool w, uint8_t opcode, int reg, int base, int32_t disp) {
+        rex(w, reg, 0, base);
+        byte(opcode);
+        modrm_mem(reg, base, disp);
+    }
+
+    // Legacy op rm, reg (register form)
+    void op_reg(bool w, uint8_t opcode, int reg, int rm) {
+        rex(w, reg, 0, rm);
+        byte(opcode);
+        modrm_reg(reg, rm);
+    }
+
+    void mov_load(bool w, int dst, int base, int32_t disp) { op_mem(w, 0x8B, dst, base, disp); }
+    void mov_store(bool w, int base, int32_t disp, int src) { op_mem(w, 0x89, src, base, disp); }
+
+    void mov_imm64(int reg, uint64_t value) {
+        rex(true, 0, 0, reg);
+        byte(static_cast<uint8_t>(0xB8 | (reg & 7)));
+        qword(value);
+    }
+
+    // EVEX.512 instruction; rm is a register number, or the base register when rm_is_mem
+    void evex(uint8_t map, uint8_t pp, bool w, int reg, int vvvv, int rm, bool rm_is_mem,
+              uint8_t aaa, bool z, bool b, uint8_t opcode) {
+        byte(0x62);
+        byte(static_cast<uint8_t>(((reg & 0x08) ? 0 : 0x80) |
+                                  ((!rm_is_mem && (rm & 0x10)) ? 0 : 0x40) |
+                                  ((rm & 0x08) ? 0 : 0x20) |
+                                  ((reg & 0x10) ? 0 : 0x10) | map));
+        byte(static_cast<uint8_t>((w ? 0x80 : 0) | ((~vvvv & 0x0F) << 3) | 0x04 | pp));
+        byte(static_cast<uint8_t>((z ? 0x80 : 0) | 0x40 | (b ? 0x10 : 0) |
+                                  ((vvvv & 0x10) ? 0 : 0x08) | (aaa & 7)));
+        byte(opcode);
+        if (rm_is_mem) {
+            modrm_mem(reg, rm, 0);
+        } else {
+            modrm_reg(reg, rm);
+        }
+    }
+
+    void vmovdqu32_load(int zmm, int base, int32_t disp) {
+        byte(0x62);
+        byte(static_cast<uint8_t>(((zmm & 0x08) ? 0 : 0x80) | 0x40 | ((base & 0x08) ? 0 : 0x20) |
+                                  ((zmm & 0x10) ? 0 : 0x10) | 0x01));
+        byte(0x7E);  // W0, vvvv=1111, pp=F3
+        byte(0x48);  // 512-bit, V'=1, no mask
+        byte(0x6F);
+        modrm_mem(zmm, base, disp);
+    }
+
+    void vmovdqu32_store(int base, int32_t disp, int zmm) {
+        byte(0x62);
+        byte(static_cast<uint8_t>(((zmm & 0x08) ? 0 : 0x80) | 0x40 | ((base & 0x08) ? 0 : 0x20) |
+                                  ((zmm & 0x10) ? 0 : 0x10) | 0x01));
+        byte(0x7E);
+        byte(0x48);
+        byte(0x7F);
+        modrm_mem(zmm, base, disp);
+    }
+
+    void kmovw_load(int k, int base, int32_t disp) {
+        byte(0xC5);
+        byte(0xF8);
+        byte(0x90);
+        modrm_mem(k, base, disp);
+    }
+
+    void kmovw_store(int base, int32_t disp, int k) {
+        byte(0xC5);
+        byte(0xF8);
+        byte(0x91);
+        modrm_mem(k, base, disp);
+    }
+
+    // Branches return the offset of their rel32 field for later patching
+    size_t jcc_rel32(uint8_t condition) {
+        byte(0x0F);
+        byte(static_cast<uint8_t>(0x80 | (condition & 0x0F)));
+        size_t at = position();
+        dword(0);
+        return at;
+    }
+
+    size_t jmp_rel32() {
+        byte(0xE9);
+        size_t at = position();
+        dword(0);
+        return at;
+    }
+
+    void patch_rel32(size_t at, size_t target) {
+        int32_t rel = static_cast<int32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(at + 4));
+        for (int i = 0; i < 4; i++) {
+            code[at + i] = static_cast<uint8_t>(static_cast<uint32_t>(rel) >> (i * 8));
+        }
+    }
+
+    // Merge host arithmetic flags into guest RFLAGS (clobbers rax, rcx)
+    void save_flags() {
+        byte(0x9C);                                       // pushfq
+        byte(0x58);                                       // pop rax
+        byte(0x25); dword(JIT_ARITH_FLAGS);               // and eax, flags
+        mov_load(true, HOST_RCX, HOST_RDI, JIT_RFLAGS_OFFSET);
+        byte(0x48); byte(0x81); byte(0xE1); dword(~JIT_ARITH_FLAGS);  // and rcx, ~flags
+        byte(0x48); byte(0x09); byte(0xC1);               // or rcx, rax
+        mov_store(true, HOST_RDI, JIT_RFLAGS_OFFSET, HOST_RCX);
+    }
+
+    // Load guest arithmetic flags into the host flags (clobbers rax, rcx)
+    void restore_flags() {
+        mov_load(true, HOST_RCX, HOST_RDI, JIT_RFLAGS_OFFSET);
+        byte(0x81); byte(0xE1); dword(JIT_ARITH_FLAGS);   // and ecx, flags
+        byte(0x9C);                                       // pushfq
+        byte(0x58);                                       // pop rax
+        byte(0x48); byte(0x25); dword(~JIT_ARITH_FLAGS);  // and rax, ~flags
+        byte(0x48); byte(0x09); byte(0xC8);               // or rax, rcx
+        byte(0x50);                                       // push rax
+        byte(0x9D);                                       // popfq
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Block compilation
+// ---------------------------------------------------------------------------
+
+namespace {
+
+struct knc_jit_vector_form_t {
+    uint8_t map;
+    uint8_t pp;
+    uint8_t opcode;
+};
+
+// EVEX.512.W0 encodings of the two-source vector operations
+bool jit_vector_form(uint16_t op, knc_jit_vector_form_t& form) {
+    switch (op) {
+        case KNC_OP_VPADDD: form = {1, 1, 0xFE}; return true;
+        case KNC_OP_VPSUBD: form = {1, 1, 0xFA}; return true;
+        case KNC_OP_VPANDD: form = {1, 1, 0xDB}; return true;
+        case KNC_OP_VPORD: form = {1, 1, 0xEB}; return true;
+        case KNC_OP_VPXORD: form = {1, 1, 0xEF}; return true;
+        case KNC_OP_VADDPS: form = {1, 0, 0x58}; return true;
+        case KNC_OP_VSUBPS: form = {1, 0, 0x5C}; return true;
+        case KNC_OP_VMULPS: form = {1, 0, 0x59}; return true;
+        case KNC_OP_VDIVPS: form = {1, 0, 0x5E}; return true;
+        case KNC_OP_VMAXPS: form = {1, 0, 0x5F}; return true;
+        case KNC_OP_VMINPS: form = {1, 0, 0x5D}; return true;
+        case KNC_OP_VPMULLD: form = {2, 1, 0x40}; return true;
+        case KNC_OP_VPERMD: form = {2, 1, 0x36}; return true;
+        case KNC_OP_VFMADD231PS: form = {2, 1, 0xB8}; return true;
+        case KNC_OP_VPERMT2D: form = {2, 1, 0x7E}; return true;
+        default: return false;
+    }
+}
+
+// Group-1 extension and r/m,reg opcode of the scalar ALU operations
+bool jit_alu_form(uint16_t op, uint8_t& group, uint8_t& opcode) {
+    switch (op) {
+        case KNC_OP_ADD: group = 0; opcode = 0x01; return true;
+        case KNC_OP_OR: group = 1; opcode = 0x09; return true;
+        case KNC_OP_AND: group = 4; opcode = 0x21; return true;
+        case KNC_OP_SUB: group = 5; opcode = 0x29; return true;
+        case KNC_OP_XOR: group = 6; opcode = 0x31; return true;
+        case KNC_OP_CMP: group = 7; opcode = 0x39; return true;
+        case KNC_OP_TEST: group = 0; opcode = 0x85; return true;
+        default: return false;
+    }
+}
+
+int32_t gpr_offset(uint8_t reg) {
+    return JIT_GPR_OFFSET + static_cast<int32_t>(reg) * 8;
+}
+
+// Instruction whose guest memory access may fault, the host code emitted for
+// it, and its TLB miss branch to patch to the same side exit
+struct knc_jit_fault_exit_t {
+    uint64_t guest_rip;
+    size_t code_start;
+    size_t code_end;
+    size_t miss_fixup;
+};
+
+// Per-block emission state
+struct knc_jit_block_emitter_t {
+    KNCJitAssembler& as;
+    bool flags_live;  // Host flags hold the guest arithmetic flags
+    size_t instruction_start;
+    std::vector<knc_jit_fault_exit_t> fault_exits;
+
+    explicit knc_jit_block_emitter_t(KNCJitAssembler& assembler)
+        : as(assembler), flags_live(false), instruction_start(0) {}
+
+    void spill_flags() {
+        if (flags_live) {
+            as.save_flags();
+            flags_live = false;
+        }
+    }
+
+    // r8 = guest effective address (flag-neutral)
+    void compute_effective_address(const knc_decoded_instruction_t& inst) {
+        const knc_memory_operand_t& mem = inst.memory;
+        if (mem.base == KNC_REG_RIP) {
+            as.mov_imm64(HOST_R8, inst.address + inst.length + static_cast<int64_t>(mem.displacement));
+            return;
+        }
+        if (mem.base != KNC_REG_NONE) {
+            as.mov_load(true, HOST_R8, HOST_RDI, gpr_offset(mem.base));
+        } else {
+            as.mov_imm64(HOST_R8, 0);
+        }
+        if (mem.index != KNC_REG_NONE) {
+            static const uint8_t scale_bits[9] = {0, 0, 1, 0, 2, 0, 0, 0, 3};
+            as.mov_load(true, HOST_R9, HOST_RDI, gpr_offset(mem.index));
+            as.byte(0x4F); as.byte(0x8D); as.byte(0x84);  // lea r8, [r8 + r9*scale + disp32]
+            as.byte(static_cast<uint8_t>((scale_bits[mem.scale & 0x0F] << 6) | (1 << 3)));
+        } else {
+            as.byte(0x4D); as.byte(0x8D); as.byte(0x80);  // lea r8, [r8 + disp32]
+        }
+        as.dword(static_cast<uint32_t>(mem.displacement));
+    }
+
+    // r8 = host address of a guest access of size bytes, translated by
+    // probing the core's TLB. A miss - including a store to a read-only page
+    // and an access crossing into the next page - leaves through this
+    // instruction's side exit, and the interpreter walks the page tables and
+    // refills the entry. Flags are spilled first since the probe clobbers them.
+    void emit_address(const knc_decoded_instruction_t& inst, uint32_t size, bool is_store) {
+        spill_flags();
+        compute_effective_address(inst);
+        as.mov_load(true, HOST_RCX, HOST_RDI, JIT_TLB_OFFSET);                 // rcx = core TLB
+        as.byte(0x4C); as.byte(0x89); as.byte(0xC0);                           // mov rax, r8
+        as.byte(0x48); as.byte(0xC1); as.byte(0xE8); as.byte(KNC_PAGE_SHIFT);  // shr rax, 12
+        as.byte(0x83); as.byte(0xE0); as.byte(KNC_TLB_ENTRIES - 1);            // and eax, 63
+        as.byte(0xC1); as.byte(0xE0); as.byte(0x05);                           // shl eax, 5
+        as.byte(0x48); as.byte(0x01); as.byte(0xC1);                           // add rcx, rax
+        as.byte(0x49); as.byte(0x8D); as.byte(0x80); as.dword(size - 1);       // lea rax, [r8 + size - 1]
+        as.byte(0x48); as.byte(0xC1); as.byte(0xE8); as.byte(KNC_PAGE_SHIFT);  // shr rax, 12
+        as.byte(0x48); as.byte(0xFF); as.byte(0xC0);                           // inc rax - tag of the last page
+        as.byte(0x48); as.byte(0x3B); as.byte(0x41);                           // cmp rax, [rcx + tag]
+        as.byte(static_cast<uint8_t>(is_store ? JIT_TLB_WRITE_TAG : JIT_TLB_READ_TAG));
+        size_t miss = as.jcc_rel32(0x5);                                        // jne side exit
+        as.byte(0x4C); as.byte(0x03); as.byte(0x41); as.byte(JIT_TLB_HOST_OFFSET);  // add r8, [rcx + host_offset]
+        as.byte(0xFF); as.byte(0x41); as.byte(JIT_TLB_HITS);                   // inc dword [rcx + hits]
+        fault_exits.push_back({inst.address, instruction_start, 0, miss});
+    }
+
+    // Bytes a vector instruction reads or writes in memory
+    static uint32_t vector_access_size(const knc_decoded_instruction_t& inst) {
+        if (inst.op == KNC_OP_VPBROADCASTD || (inst.flags & KNC_DECODE_BROADCAST)) {
+            return sizeof(int32_t);
+        }
+        return KNC_VECTOR_BYTES;
+    }
+
+    void emit_vector(const knc_decoded_instruction_t& inst) {
+        bool mem = (inst.flags & KNC_DECODE_MEM_SRC) != 0;
+        bool zeroing = (inst.flags & KNC_DECODE_ZEROING) && inst.mask != 0;
+        bool broadcast = mem && (inst.flags & KNC_DECODE_BROADCAST);
+        int rm = inst.src2;
+
+        switch (inst.op) {
+            case KNC_OP_VLOAD:
+                if (mem) {
+                    emit_address(inst, vector_access_size(inst), false);
+                    rm = HOST_R8;
+                }
+                as.evex(1, 2, false, inst.dst, 0, rm, mem, inst.mask, zeroing, false, 0x6F);
+                return;
+            case KNC_OP_VSTORE:
+                emit_address(inst, KNC_VECTOR_BYTES, true);
+                as.evex(1, 2, false, inst.src, 0, HOST_R8, true, inst.mask, false, false, 0x7F);
+                return;
+            case KNC_OP_VPBROADCASTD:
+                if (mem) {
+                    emit_address(inst, vector_access_size(inst), false);
+                    rm = HOST_R8;
+                }
+                as.evex(2, 1, false, inst.dst, 0, rm, mem, inst.mask, zeroing, false, 0x58);
+                return;
+            case KNC_OP_VCMPPS:
+                if (mem) {
+                    emit_address(inst, vector_access_size(inst), false);
+                    rm = HOST_R8;
+                }
+                as.evex(1, 0, false, inst.dst, inst.src, rm, mem, inst.mask, false, broadcast, 0xC2);
+                as.byte(inst.condition);
+                return;
+            default:
+                break;
+        }
+
+        knc_jit_vector_form_t form;
+        jit_vector_form(inst.op, form);
+        if (mem) {
+            emit_address(inst, vector_access_size(inst), false);
+            rm = HOST_R8;
+        }
+        as.evex(form.map, form.pp, false, inst.dst, inst.src, rm, mem, inst.mask, zeroing, broadcast, form.opcode);
+    }
+
+    // rcx = register or memory source operand
+    void load_source(const knc_decoded_instruction_t& inst, bool w) {
+        if (inst.flags & KNC_DECODE_MEM_SRC) {
+            as.op_mem(w, 0x8B, HOST_RCX, HOST_R8, 0);
+        } else {
+            as.mov_load(w, HOST_RCX, HOST_RDI, gpr_offset(inst.src));
+        }
+    }
+
+    void emit_scalar(const knc_decoded_instruction_t& inst) {
+        bool w = (inst.operand_size == 8);
+        uint8_t group, opcode;
+
+        // Memory addresses first - forming them clobbers rax, rcx and the host flags
+        if (inst.flags & (KNC_DECODE_MEM_SRC | KNC_DECODE_MEM_DST)) {
+            if (inst.op != KNC_OP_LEA) {
+                emit_address(inst, inst.operand_size, (inst.flags & KNC_DECODE_MEM_DST) != 0);
+            }
+        }
+
+        switch (inst.op) {
+            case KNC_OP_NOP:
+                return;
+            case KNC_OP_LEA:
+                compute_effective_address(inst);
+                if (!w) {
+                    as.byte(0x45); as.byte(0x89); as.byte(0xC0);  // mov r8d, r8d
+                }
+                as.mov_store(true, HOST_RDI, gpr_offset(inst.dst), HOST_R8);
+                return;
+            case KNC_OP_MOV:
+                if (inst.flags & KNC_DECODE_SRC_IMM) {
+                    uint64_t value = static_cast<uint64_t>(inst.immediate);
+                    as.mov_imm64(HOST_RAX, w ? value : static_cast<uint32_t>(value));
+                } else if (inst.flags & KNC_DECODE_MEM_SRC) {
+                    as.op_mem(w, 0x8B, HOST_RAX, HOST_R8, 0);
+                } else {
+                    as.mov_load(w, HOST_RAX, HOST_RDI, gpr_offset(inst.src));
+                }
+                if (inst.flags & KNC_DECODE_MEM_DST) {
+                    as.op_mem(w, 0x89, HOST_RAX, HOST_R8, 0);
+                } else {
+                    as.mov_store(true, HOST_RDI, gpr_offset(inst.dst), HOST_RAX);
+                }
+                return;
+            case KNC_OP_IMUL:
+                if (inst.flags & KNC_DECODE_SRC_IMM) {
+                    load_source(inst, w);
+                    as.op_reg(w, 0x69, HOST_RAX, HOST_RCX);  // imul rax, rcx, imm32
+                    as.dword(static_cast<uint32_t>(inst.immediate));
+                } else {
+                    as.mov_load(true, HOST_RAX, HOST_RDI, gpr_offset(inst.dst));
+                    load_source(inst, w);
+                    as.rex(w, HOST_RAX, 0, HOST_RCX);
+                    as.byte(0x0F); as.byte(0xAF);  // imul rax, rcx
+                    as.modrm_reg(HOST_RAX, HOST_RCX);
+                }
+                as.mov_store(true, HOST_RDI, gpr_offset(inst.dst), HOST_RAX);
+                flags_live = true;
+                return;
+            case KNC_OP_INC:
+            case KNC_OP_DEC:
+                // INC/DEC preserve CF, so the host flags must hold the guest's first
+                if (!flags_live) {
+                    as.restore_flags();
+                }
+                as.mov_load(true, HOST_RAX, HOST_RDI, gpr_offset(inst.dst));
+                as.op_reg(w, 0xFF, (inst.op == KNC_OP_INC) ? 0 : 1, HOST_RAX);
+                as.mov_store(true, HOST_RDI, gpr_offset(inst.dst), HOST_RAX);
+                flags_live = true;
+                return;
+            case KNC_OP_SHL:
+            case KNC_OP_SHR:
+            case KNC_OP_SAR: {
+                uint8_t count = static_cast<uint8_t>(inst.immediate & (w ? 0x3F : 0x1F));
+                if (count == 0) {
+                    return;  // Flags and destination unchanged
+                }
+                uint8_t ext = (inst.op == KNC_OP_SHL) ? 4 : (inst.op == KNC_OP_SHR) ? 5 : 7;
+                as.mov_load(true, HOST_RAX, HOST_RDI, gpr_offset(inst.dst));
+                as.op_reg(w, 0xC1, ext, HOST_RAX);
+                as.byte(count);
+                as.mov_store(true, HOST_RDI, gpr_offset(inst.dst), HOST_RAX);
+                flags_live = true;
+                return;
+            }
+            default:
+                break;
+        }
+
+        // ADD/SUB/AND/OR/XOR/CMP/TEST with a register destination
+        jit_alu_form(inst.op, group, opcode);
+        as.mov_load(true, HOST_RAX, HOST_RDI, gpr_offset(inst.dst));
+        if (inst.flags & KNC_DECODE_SRC_IMM) {
+            as.op_reg(w, (inst.op == KNC_OP_TEST) ? 0xF7 : 0x81, group, HOST_RAX);
+            as.dword(static_cast<uint32_t>(inst.immediate));
+        } else {
+            load_source(inst, w);
+            as.op_reg(w, opcode, HOST_RCX, HOST_RAX);
+        }
+        if (inst.op != KNC_OP_CMP && inst.op != KNC_OP_TEST) {
+            as.mov_store(true, HOST_RDI, gpr_offset(inst.dst), HOST_RAX);
+        }
+        flags_live = true;
+    }
+};
+
+}  // namespace
+
+KNCJitCompiler::KNCJitCompiler() {
+    code_buffer = nullptr;
+    code_write = nullptr;
+    code_capacity = 0;
+    code_used = 0;
+    code_alignment = 64;
+    available = false;
+    buffer_full_reported = false;
+    fault_site_capacity = 0;
+    fault_site_count.store(0);
+    blocks_compiled = 0;
+    blocks_rejected = 0;
+}
+
+KNCJitCompiler::~KNCJitCompiler() {
+    shutdown();
+}
+
+bool KNCJitCompiler::host_supports_jit() const {
+#if defined(_WIN32) || !defined(__x86_64__)
+    // Compiled blocks follow the System V calling convention
+    return false;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f");
+#endif
+}
+
+bool KNCJitCompiler::initialize(size_t buffer_size) {
+    if (available) {
+        return true;
+    }
+
+    if (!host_supports_jit()) {
+        std::cout << "JIT unavailable: host lacks AVX-512F or the System V ABI, using the interpreter\n";
+        return false;
+    }
+
+#ifndef _WIN32
+    size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    buffer_size = (buffer_size + page_size - 1) & ~(page_size - 1);
+    code_buffer = nullptr;
+    code_write = nullptr;
+#ifdef MFD_CLOEXEC
+    // Two views of one memory object: executable, and writable while a
+    // block is copied in
+    int fd = memfd_create("knc-jit", MFD_CLOEXEC);
+    if (fd >= 0) {
+        if (ftruncate(fd, static_cast<off_t>(buffer_size)) == 0) {
+            void* execute = mmap(nullptr, buffer_size, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+            void* write = mmap(nullptr, buffer_size, PROT_NONE, MAP_SHARED, fd, 0);
+            if (execute != MAP_FAILED && write != MAP_FAILED) {
+                code_buffer = static_cast<uint8_t*>(execute);
+                code_write = static_cast<uint8_t*>(write);
+                code_alignment = 64;
+            } else {
+                if (execute != MAP_FAILED) {
+                    munmap(execute, buffer_size);
+                }
+                if (write != MAP_FAILED) {
+                    munmap(write, buffer_size);
+                }
+            }
+        }
+        close(fd);
+    }
+#endif
+    if (!code_buffer) {
+        void* buffer = mmap(nullptr, buffer_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (buffer == MAP_FAILED) {
+            std::cerr << "Error: Failed to allocate JIT code buffer\n";
+            return false;
+        }
+        code_buffer = static_cast<uint8_t*>(buffer);
+        code_write = code_buffer;
+        code_alignment = page_size;
+    }
+#endif
+
+    fault_site_capacity = buffer_size / JIT_CODE_BYTES_PER_FAULT_SITE;
+    fault_sites.reset(new knc_jit_fault_site_t[fault_site_capacity]);
+    fault_site_count.store(0);
+    code_capacity = buffer_size;
+    code_used = 0;
+    available = true;
+
+    std::cout << "KNC JIT compiler initialized (" << (buffer_size / (1024 * 1024)) << " MB code buffer)\n";
+    return true;
+}
+
+void KNCJitCompiler::shutdown() {
+    if (!available) {
+        return;
+    }
+
+    print_statistics();
+#ifndef _WIN32
+    if (code_write != code_buffer) {
+        munmap(code_write, code_capacity);
+    }
+    munmap(code_buffer, code_capacity);
+#endif
+    code_buffer = nullptr;
+    code_write = nullptr;
+    code_capacity = 0;
+    code_used = 0;
+    available = false;
+}
+
+bool KNCJitCompiler::is_available() const {
+    return available;
+}
+
+bool KNCJitCompiler::can_compile_instruction(const knc_decoded_instruction_t& inst) const {
+    if (inst.flags & (KNC_DECODE_LOCK | KNC_DECODE_REP)) {
+        return false;
+    }
+    if (inst.memory.segment != 0) {
+        return false;  // FS/GS bases are not modelled
+    }
+    if (inst.conversion != KNC_CONV_NONE) {
+        return false;  // KNC swizzles and conversions stay in the interpreter
+    }
+
+    knc_jit_vector_form_t form;
+    uint8_t group, opcode;
+    bool mem_dst = (inst.flags & KNC_DECODE_MEM_DST) != 0;
+    bool sized = (inst.operand_size == 4 || inst.operand_size == 8);
+
+    switch (inst.op) {
+        case KNC_OP_NOP:
+            return true;
+        case KNC_OP_PAUSE:
+            return false;  // Spin-wait loops stay interpreted so the scheduler can yield the context
+        case KNC_OP_VLOAD:
+        case KNC_OP_VPBROADCASTD:
+            return !(inst.flags & KNC_DECODE_BROADCAST);
+        case KNC_OP_VSTORE:
+        case KNC_OP_VCMPPS:
+            return true;
+        case KNC_OP_MOV:
+        case KNC_OP_LEA:
+            return sized;
+        case KNC_OP_IMUL:
+        case KNC_OP_INC:
+        case KNC_OP_DEC:
+            return sized && !mem_dst;
+        case KNC_OP_SHL:
+        case KNC_OP_SHR:
+        case KNC_OP_SAR:
+            return sized && !mem_dst && (inst.flags & KNC_DECODE_SRC_IMM);  // Counts in CL stay interpreted
+        case KNC_OP_JCC:
+        case KNC_OP_JMP:
+            return true;
+        default:
+            if (jit_vector_form(inst.op, form)) {
+                return true;
+            }
+            return jit_alu_form(inst.op, group, opcode) && sized && !mem_dst;
+    }
+}
+
+bool KNCJitCompiler::can_compile(const knc_translated_block_t& block) const {
+    for (const knc_decoded_instruction_t& inst : block.instructions) {
+        if (!can_compile_instruction(inst)) {
+            return false;
+        }
+    }
+    return !block.instructions.empty();
+}
+
+bool KNCJitCompiler::emit_block(const knc_translated_block_t& block, std::vector<uint8_t>& code,
+                                std::vector<knc_jit_fault_site_t>& faults) const {
+    KNCJitAssembler as(code);
+    knc_jit_block_emitter_t emitter(as);
+
+    // Guest vector and mask registers touched by the block
+    uint32_t zmm_used = 0, zmm_written = 0;
+    uint32_t k_used = 0, k_written = 0;
+    for (const knc_decoded_instruction_t& inst : block.instructions) {
+        if (!(inst.flags & KNC_DECODE_VECTOR)) {
+            continue;
+        }
+        if (inst.mask) {
+            k_used |= 1u << inst.mask;
+        }
+        if (inst.src != KNC_REG_NONE) {
+            zmm_used |= 1u << inst.src;
+        }
+        if (inst.src2 != KNC_REG_NONE && !(inst.flags & KNC_DECODE_MEM_SRC)) {
+            zmm_used |= 1u << inst.src2;
+        }
+        if (inst.op == KNC_OP_VCMPPS) {
+            k_used |= 1u << inst.dst;
+            k_written |= 1u << inst.dst;
+        } else if (inst.op != KNC_OP_VSTORE) {
+            zmm_used |= 1u << inst.dst;  // Merge-masking and FMA read the destination
+            zmm_written |= 1u << inst.dst;
+        }
+    }
+
+    // Prologue: map guest registers onto the host registers of the same number
+    for (int i = 0; i < KNC_NUM_VECTOR_REGISTERS; i++) {
+        if (zmm_used & (1u << i)) {
+            as.vmovdqu32_load(i, HOST_RDI, JIT_ZMM_OFFSET + i * KNC_VECTOR_BYTES);
+        }
+    }
+    for (int i = 0; i < KNC_NUM_MASK_REGISTERS; i++) {
+        if (k_used & (1u << i)) {
+            as.kmovw_load(i, HOST_RDI, JIT_K_OFFSET + i * static_cast<int32_t>(sizeof(knc_mask_t)));
+        }
+    }
+    as.byte(0x44); as.byte(0x8B); as.byte(0x9F); as.dword(JIT_BUDGET_OFFSET);  // mov r11d, [rdi + budget]
+    size_t body_start = as.position();
+
+    // Body
+    const knc_decoded_instruction_t& last = block.instructions.back();
+    bool has_branch = (last.flags & KNC_DECODE_BRANCH) != 0;
+    size_t body_count = block.instructions.size() - (has_branch ? 1 : 0);
+    std::vector<std::pair<size_t, uint64_t>> branch_exits;  // Superblock side exits: (fixup, branch address)
+    for (size_t i = 0; i < body_count; i++) {
+        const knc_decoded_instruction_t& inst = block.instructions[i];
+        if (inst.flags & KNC_DECODE_BRANCH) {
+            // Inner branch of a superblock: a jump falls through to its
+            // target, a conditional branch leaves where it goes off the path
+            uint64_t next = block.instructions[i + 1].address;
+            uint64_t target = static_cast<uint64_t>(inst.immediate);
+            uint64_t fallthrough = inst.address + inst.length;
+            if (inst.op == KNC_OP_JCC && target != fallthrough) {
+                if (!emitter.flags_live) {
+                    as.restore_flags();
+                    emitter.flags_live = true;
+                }
+                uint8_t condition = (target == next) ? (inst.condition ^ 1) : inst.condition;
+                branch_exits.push_back(std::make_pair(as.jcc_rel32(condition), inst.address));
+            }
+            continue;
+        }
+        emitter.instruction_start = as.position();
+        if (inst.flags & KNC_DECODE_VECTOR) {
+            emitter.emit_vector(inst);
+        } else {
+            emitter.emit_scalar(inst);
+        }
+        if (!emitter.fault_exits.empty() && emitter.fault_exits.back().code_end == 0) {
+            emitter.fault_exits.back().code_end = as.position();
+        }
+    }
+
+    // Exits: (fixup, guest target) pairs resolved to exit stubs below
+    std::vector<std::pair<size_t, uint64_t>> exits;
+    uint64_t fallthrough = block.end_address;
+    size_t loop_fixup = 0;
+    bool self_loop = false;
+
+    if (has_branch && last.op == KNC_OP_JCC) {
+        if (!emitter.flags_live) {
+            as.restore_flags();
+            emitter.flags_live = true;
+        }
+        uint64_t target = static_cast<uint64_t>(last.immediate);
+        size_t fixup = as.jcc_rel32(last.condition);
+        if (target == block.start_address) {
+            self_loop = true;
+            loop_fixup = fixup;
+        } else {
+            exits.push_back(std::make_pair(fixup, target));
+        }
+    } else if (has_branch) {
+        fallthrough = static_cast<uint64_t>(last.immediate);  // JMP
+        if (fallthrough == block.start_address) {
+            self_loop = true;
+            loop_fixup = as.jmp_rel32();
+        }
+    }
+
+    // Fall-through exit (also the JMP target)
+    bool flags_live = emitter.flags_live;
+    std::vector<size_t> epilogue_fixups;
+    if (!(last.op == KNC_OP_JMP && self_loop)) {
+        as.mov_imm64(HOST_R10, fallthrough);
+        if (flags_live) {
+            as.save_flags();
+        }
+        as.byte(0x31); as.byte(0xC0);  // xor eax, eax
+        epilogue_fixups.push_back(as.jmp_rel32());
+    }
+
+    // Taken exits
+    for (const auto& exit : exits) {
+        as.patch_rel32(exit.first, as.position());
+        as.mov_imm64(HOST_R10, exit.second);
+        if (flags_live) {
+            as.save_flags();
+        }
+        as.byte(0x31); as.byte(0xC0);
+        epilogue_fixups.push_back(as.jmp_rel32());
+    }
+
+    // Back edge: keep the guest state in host registers while the budget lasts
+    if (self_loop) {
+        as.patch_rel32(loop_fixup, as.position());
+        if (flags_live) {
+            as.save_flags();
+        }
+        as.byte(0x41); as.byte(0xFF); as.byte(0xCB);  // dec r11d
+        size_t continue_fixup = as.jcc_rel32(0x5);    // jnz body
+        as.patch_rel32(continue_fixup, body_start);
+        as.byte(0x41); as.byte(0xFF); as.byte(0xC3);  // inc r11d - the caller counts the last pass
+        as.mov_imm64(HOST_R10, block.start_address);
+        as.byte(0x31); as.byte(0xC0);
+        epilogue_fixups.push_back(as.jmp_rel32());
+    }
+
+    // Side exits from a superblock run the branch again in the interpreter;
+    // flags are live at every inner branch
+    for (const auto& exit : branch_exits) {
+        as.patch_rel32(exit.first, as.position());
+        as.save_flags();
+        as.mov_imm64(HOST_R10, exit.second);
+        as.byte(0xB8); as.dword(KNC_JIT_EXIT_SIDE);  // mov eax, KNC_JIT_EXIT_SIDE
+        epilogue_fixups.push_back(as.jmp_rel32());
+    }
+
+    // Side exits taken on a TLB miss or from the fault handler - flags were
+    // spilled before every guest access
+    faults.clear();
+    for (const knc_jit_fault_exit_t& exit : emitter.fault_exits) {
+        as.patch_rel32(exit.miss_fixup, as.position());
+        faults.push_back({exit.code_start, exit.code_end, as.position()});
+        as.mov_imm64(HOST_R10, exit.guest_rip);
+        as.byte(0xB8); as.dword(KNC_JIT_EXIT_SIDE);  // mov eax, KNC_JIT_EXIT_SIDE
+        epilogue_fixups.push_back(as.jmp_rel32());
+    }
+
+    // Common epilogue: write back guest registers and the exit RIP
+    for (size_t fixup : epilogue_fixups) {
+        as.patch_rel32(fixup, as.position());
+    }
+    for (int i = 0; i < KNC_NUM_VECTOR_REGISTERS; i++) {
+        if (zmm_written & (1u << i)) {
+            as.vmovdqu32_store(HOST_RDI, JIT_ZMM_OFFSET + i * KNC_VECTOR_BYTES, i);
+        }
+    }
+    for (int i = 0; i < KNC_NUM_MASK_REGISTERS; i++) {
+        if (k_written & (1u << i)) {
+            as.kmovw_store(HOST_RDI, JIT_K_OFFSET + i * static_cast<int32_t>(sizeof(knc_mask_t)), i);
+        }
+    }
+    as.mov_store(true, HOST_RDI, JIT_RIP_OFFSET, HOST_R10);
+    if (self_loop) {
+        // Retire the passes completed through the back edge; the caller counts the final one
+        as.byte(0x8B); as.byte(0x8F); as.dword(JIT_BUDGET_OFFSET);  // mov ecx, [rdi + budget]
+        as.byte(0x44); as.byte(0x29); as.byte(0xD9);                // sub ecx, r11d
+        as.byte(0x48); as.byte(0x69); as.byte(0xC9);                // imul rcx, rcx, count
+        as.dword(static_cast<uint32_t>(block.instructions.size()));
+        as.mov_load(true, HOST_R9, HOST_RDI, JIT_CYCLES_OFFSET);
+        as.byte(0x4C); as.byte(0x01); as.byte(0xC9);                // add rcx, r9
+        as.mov_store(true, HOST_RDI, JIT_CYCLES_OFFSET, HOST_RCX);
+    }
+    as.byte(0xC5); as.byte(0xF8); as.byte(0x77);  // vzeroupper
+    as.byte(0xC3);                                // ret
+
+    return true;
+}
+
+knc_jit_entry_t KNCJitCompiler::compile_block(const knc_translated_block_t& block) {
+    std::lock_guard<std::mutex> lock(compile_mutex);
+
+    if (!available) {
+        return nullptr;
+    }
+    if (!can_compile(block)) {
+        blocks_rejected++;
+        return nullptr;
+    }
+
+    std::vector<uint8_t> code;
+    std::vector<knc_jit_fault_site_t> faults;
+    code.reserve(256 + block.instructions.size() * 48);
+    if (!emit_block(block, code, faults)) {
+        blocks_rejected++;
+        return nullptr;
+    }
+
+    // Keep entry points cache-line aligned, or page aligned when the block
+    // must not share a page with code that may be running
+    size_t offset = (code_used + code_alignment - 1) & ~(code_alignment - 1);
+    size_t sites = fault_site_count.load(std::memory_order_relaxed);
+    if (offset + code.size() > code_capacity || sites + faults.size() > fault_site_capacity) {
+        if (!buffer_full_reported) {
+            std::cerr << "Warning: JIT code buffer full, further blocks stay interpreted\n";
+            buffer_full_reported = true;
+        }
+        return nullptr;
+    }
+
+    if (!write_code(offset, code)) {
+        blocks_rejected++;
+        return nullptr;
+    }
+    code_used = offset + code.size();
+    blocks_compiled++;
+
+    // Code is bump allocated, so appending keeps the fault sites sorted
+    uintptr_t block_base = reinterpret_cast<uintptr_t>(code_buffer + offset);
+    for (const knc_jit_fault_site_t& site : faults) {
+        fault_sites[sites++] = {block_base + site.start, block_base + site.end, block_base + site.resume};
+    }
+    fault_site_count.store(sites, std::memory_order_release);
+
+    return reinterpret_cast<knc_jit_entry_t>(code_buffer + offset);
+}
+
+bool KNCJitCompiler::write_code(size_t offset, const std::vector<uint8_t>& code) {
+#ifndef _WIN32
+    size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t first = offset & ~(page_size - 1);
+    size_t length = ((offset + code.size() + page_size - 1) & ~(page_size - 1)) - first;
+    if (mprotect(code_write + first, length, PROT_READ | PROT_WRITE) != 0) {
+        std::cerr << "Warning: Cannot open the JIT code buffer for writing\n";
+        return false;
+    }
+    memcpy(code_write + offset, code.data(), code.size());
+    int closed = code_write != code_buffer ? PROT_NONE : PROT_READ | PROT_EXEC;
+    if (mprotect(code_write + first, length, closed) != 0) {
+        std::cerr << "Error: Cannot make JIT code executable\n";
+        return false;
+    }
+    return true;
+#else
+    (void)offset;
+    (void)code;
+    return false;
+#endif
+}
+
+void KNCJitCompiler::reset() {
+    std::lock_guard<std::mutex> lock(compile_mutex);
+    code_used = 0;
+    fault_site_count.store(0, std::memory_order_release);
+    buffer_full_reported = false;
+}
+
+uintptr_t KNCJitCompiler::fault_resume_address(void* context, uintptr_t pc) {
+    // Runs in the fault handler: no locks, no allocation
+    const KNCJitCompiler* jit = static_cast<const KNCJitCompiler*>(context);
+    size_t count = jit->fault_site_count.load(std::memory_order_acquire);
+    const knc_jit_fault_site_t* first = jit->fault_sites.get();
+    if (!first || count == 0) {
+        return 0;
+    }
+
+    const knc_jit_fault_site_t* site = std::upper_bound(first, first + count, pc,
+        [](uintptr_t value, const knc_jit_fault_site_t& entry) { return value < entry.start; });
+    if (site == first) {
+        return 0;
+    }
+    --site;
+    return (pc < site->end) ? site->resume : 0;
+}
+
+void KNCJitCompiler::print_statistics() const {
+    std::lock_guard<std::mutex> lock(compile_mutex);
+    std::cout << "\n=== JIT Compiler Statistics ===\n";
+    std::cout << "Blocks compiled: " << blocks_compiled << "\n";
+    std::cout << "Blocks rejected: " << blocks_rejected << "\n";
+    std::cout << "Code buffer used: " << code_used << " / " << code_capacity << " bytes\n";
+}
+
+uint64_t KNCJitCompiler::get_blocks_compiled() const {
+    std::lock_guard<std::mutex> lock(compile_mutex);
+    return blocks_compiled;
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2026 IMIC_SDS Development Team
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "knc_page_tables.h"
+#include <iostream>
+#include <cstring>
+
+const char* knc_page_size_name(knc_page_size_t size) {
+    switch (size) {
+        case KNC_PAGE_2M: return "2m";
+        case KNC_PAGE_1G: return "1g";
+        default: return "4k";
+    }
+}
+
+bool knc_parse_page_size(const char* name, knc_page_size_t& size) {
+    static const knc_page_size_t sizes[] = {KNC_PAGE_4K, KNC_PAGE_2M, KNC_PAGE_1G};
+    for (knc_page_size_t candidate : sizes) {
+        if (strcmp(name, knc_page_size_name(candidate)) == 0) {
+            size = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t knc_page_bytes(knc_page_size_t size) {
+    switch (size) {
+        case KNC_PAGE_2M: return KNC_PAGE_SIZE_2M;
+        case KNC_PAGE_1G: return KNC_PAGE_SIZE_1G;
+        default: return KNC_PAGE_SIZE_4K;
+    }
+}
+
+KNCPageTables::KNCPageTables() {
+    root = nullptr;
+    reset(0);
+}
+
+KNCPageTables::~KNCPageTables() {
+}
+
+KNCPageTables::knc_page_table_t* KNCPageTables::new_table() {
+    std::unique_ptr<knc_page_table_t> table(new knc_page_table_t);
+    for (uint32_t i = 0; i < ENTRIES_PER_TABLE; i++) {
+        table->entries[i].store(0, std::memory_order_relaxed);
+    }
+    tables.push_back(std::move(table));
+    return tables.back().get();
+}
+
+void KNCPageTables::reset(uint64_t physical_size) {
+    std::lock_guard<std::mutex> guard(fill_mutex);
+    tables.clear();
+    regions.clear();
+    root = new_table();
+    physical_limit = physical_size;
+    for (uint64_t& count : pages_filled) {
+        count = 0;
+    }
+}
+
+bool KNCPageTables::map(uint64_t virtual_address, uint64_t physical_address, uint64_t bytes,
+                        knc_page_size_t page_size, bool writable) {
+    static const uint64_t sizes[] = {KNC_PAGE_SIZE_4K, KNC_PAGE_SIZE_2M, KNC_PAGE_SIZE_1G};
+
+    if (((virtual_address | physical_address | bytes) & (KNC_PAGE_SIZE_4K - 1)) || bytes == 0) {
+        std::cerr << "Error: Guest mapping is not page aligned\n";
+        return false;
+    }
+    if (virtual_address + bytes > (1ULL << KNC_VIRTUAL_ADDRESS_BITS) || virtual_address + bytes < virtual_address ||
+        physical_address + bytes > physical_limit) {
+        std::cerr << "Error: Guest mapping 0x" << std::hex << virtual_address << "-0x" << (virtual_address + bytes)
+                  << " is outside the address space" << std::dec << "\n";
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard(fill_mutex);
+    for (const knc_page_region_t& region : regions) {
+        if (virtual_address < region.virtual_address + region.bytes &&
+            region.virtual_address < virtual_address + bytes) {
+            std::cerr << "Error: Guest mapping at 0x" << std::hex << virtual_address
+                      << " overlaps an existing mapping" << std::dec << "\n";
+            return false;
+        }
+    }
+
+    // Split into runs of one page size: the largest allowed size both
+    // addresses are aligned for, up to where a larger page becomes possible
+    while (bytes > 0) {
+        int level = page_size;
+        while (level > 0 && (((virtual_address | physical_address) & (sizes[level] - 1)) || bytes < sizes[level])) {
+            level--;
+        }
+        uint64_t run = bytes & ~(sizes[level] - 1);
+        for (int larger = level + 1; larger <= page_size; larger++) {
+            if ((virtual_address ^ physical_address) & (sizes[larger] - 1)) {
+                break;  // Never aligned together
+            }
+            uint64_t boundary = ((virtual_address + sizes[larger] - 1) & ~(sizes[larger] - 1)) - virtual_address;
+            if (boundary > 0 && boundary < run) {
+                run = boundary;
+            }
+        }
+
+        regions.push_back({virtual_address, physical_address, run, static_cast<knc_page_size_t>(level), writable});
+        virtual_address += run;
+        physical_address += run;
+        bytes -= run;
+    }
+    return true;
+}
+
+const KNCPageTables::knc_page_region_t* KNCPageTables::find_region(uint64_t virtual_address) const {
+    for (const knc_page_region_t& region : regions) {
+        if (virtual_address - region.virtual_address < region.bytes) {
+            return &region;
+        }
+    }
+    return nullptr;
+}
+
+bool KNCPageTables::walk(uint64_t virtual_address, knc_page_walk_t& result) const {
+    const knc_page_table_t* table = root;
+    result.levels = 0;
+
+    for (int level = 3; level >= 0; level--) {
+        uint32_t shift = KNC_PAGE_SHIFT + 9 * level;
+        uint64_t entry = table->entries[(virtual_address >> shift) & (ENTRIES_PER_TABLE - 1)]
+                             .load(std::memory_order_acquire);
+        result.levels++;
+        if (!(entry & ENTRY_PRESENT)) {
+            return false;
+        }
+        if (level == 0 || (entry & ENTRY_LARGE)) {
+            uint64_t page_bytes = 1ULL << shift;
+            result.page_base = entry & ENTRY_ADDRESS;
+            result.physical = result.page_base + (virtual_address & (page_bytes - 1));
+            result.size = static_cast<knc_page_size_t>(level);
+            result.writable = (entry & ENTRY_WRITABLE) != 0;
+            return true;
+        }
+        table = reinterpret_cast<const knc_page_table_t*>(entry & ENTRY_ADDRESS);
+    }
+    return false;
+}
+
+bool KNCPageTables::fill(uint64_t virtual_address) {
+    const knc_page_region_t* region = find_region(virtual_address);
+    if (!region) {
+        return false;
+    }
+
+    // Intermediate tables down to the level holding this page size's leaves
+    int leaf_level = region->size;
+    knc_page_table_t* table = root;
+    for (int level = 3; level > leaf_level; level--) {
+        uint32_t shift = KNC_PAGE_SHIFT + 9 * level;
+        std::atomic<uint64_t>& entry = table->entries[(virtual_address >> shift) & (ENTRIES_PER_TABLE - 1)];
+        uint64_t value = entry.load(std::memory_order_relaxed);
+        if (!(value & ENTRY_PRESENT)) {
+            knc_page_table_t* next = new_table();
+            value = reinterpret_cast<uint64_t>(next) | ENTRY_PRESENT | ENTRY_WRITABLE;
+            entry.store(value, std::memory_order_release);
+        }
+        table = reinterpret_cast<knc_page_table_t*>(value & ENTRY_ADDRESS);
+    }
+
+    uint32_t shift = KNC_PAGE_SHIFT + 9 * leaf_level;
+    uint64_t page_virtual = virtual_address & ~((1ULL << shift) - 1);
+    uint64_t page_physical = region->physical_address + (page_virtual - region->virtual_address);
+    uint64_t leaf = page_physical | ENTRY_PRESENT | (region->writable ? ENTRY_WRITABLE : 0) |
+                    (leaf_level > 0 ? ENTRY_LARGE : 0);
+    table->entries[(virtual_address >> shift) & (ENTRIES_PER_TABLE - 1)].store(leaf, std::memory_order_release);
+    pages_filled[leaf_level]++;
+    return true;
+}
+
+bool KNCPageTables::translate(uint64_t virtual_address, knc_page_walk_t& result) {
+    if (virtual_address >> KNC_VIRTUAL_ADDRESS_BITS) {
+        return false;
+    }
+    if (walk(virtual_address, result)) {
+        return true;
+    }
+
+    // First touch of a mapped page
+    std::lock_guard<std::mutex> guard(fill_mutex);
+    if (walk(virtual_address, result)) {
+        return true;  // Another core filled it meanwhile
+    }
+    return fill(virtual_address) && walk(virtual_address, result);
+}
+
+void KNCPageTables::print_statistics() const {
+    std::cout << "Guest page tables: " << tables.size() << " tables, "
+              << pages_filled[KNC_PAGE_4K] << " x 4K, "
+              << pages_filled[KNC_PAGE_2M] << " x 2M, "
+              << pages_filled[KNC_PAGE_1G] << " x 1G pages mapped\n";
+}
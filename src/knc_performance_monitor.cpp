@@ -19,6 +19,7 @@ KNCPerformanceMonitor::KNCPerformanceMonitor(uint32_t cores) : num_cores(cores)
     
     // Initialize aggregate counters
     memset(&aggregate_counters_val, 0, sizeof(aggregate_counters_val));
+    memset(&aggregate_gather_lines, 0, sizeof(aggregate_gather_lines));
 }
 
 KNCPerformanceMonitor::~KNCPerformanceMonitor() {
@@ -86,6 +87,7 @@ void KNCPerformanceMonitor::reset_counters() {
     }
     
     memset(&aggregate_counters_val, 0, sizeof(aggregate_counters_val));
+    memset(&aggregate_gather_lines, 0, sizeof(aggregate_gather_lines));
 }
 
 void KNCPerformanceMonitor::enable_monitoring(bool enable) {
@@ -192,6 +194,35 @@ void KNCPerformanceMonitor::record_cycle(uint32_t core_id, uint64_t cycles) {
     aggregate_counters_val.cycles += cycles;
 }
 
+void KNCPerformanceMonitor::record_tlb_events(uint32_t core_id, uint64_t hits, uint64_t misses) {
+    if (!monitoring_enabled || core_id >= num_cores) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(data_mutex);
+    
+    core_data[core_id].tlb_hits += hits;
+    core_data[core_id].tlb_misses += misses;
+    aggregate_counters_val.tlb_hits += hits;
+    aggregate_counters_val.tlb_misses += misses;
+}
+
+void KNCPerformanceMonitor::record_gather_lines(uint32_t core_id, const knc_gather_lines_t& lines) {
+    if (!monitoring_enabled || core_id >= num_cores) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(data_mutex);
+    
+    knc_gather_lines_t& core = core_data[core_id].gather_lines;
+    for (uint32_t i = 0; i < KNC_GATHER_LINE_BUCKETS; i++) {
+        core.gathers[i] += lines.gathers[i];
+        core.scatters[i] += lines.scatters[i];
+        aggregate_gather_lines.gathers[i] += lines.gathers[i];
+        aggregate_gather_lines.scatters[i] += lines.scatters[i];
+    }
+}
+
 bool KNCPerformanceMonitor::is_l1_hit(uint64_t address, uint32_t core_id) {
     // Simple L1 cache model - 32KB per core
     // Use simple hash function for cache line mapping
@@ -271,11 +302,25 @@ uint64_t KNCPerformanceMonitor::get_counter_value(uint32_t core_id, knc_perf_eve
             return core.branches_taken;
         case KNC_PERF_BRANCHES_MISPREDICTED:
             return core.branches_mispredicted;
+        case KNC_PERF_TLB_HITS:
+            return core.tlb_hits;
+        case KNC_PERF_TLB_MISSES:
+            return core.tlb_misses;
         default:
             return 0;
     }
 }
 
+// Instructions in a lines-per-gather histogram and the cache lines they touched
+static void sum_gather_lines(const uint64_t counts[KNC_GATHER_LINE_BUCKETS], uint64_t& instructions, uint64_t& lines) {
+    instructions = 0;
+    lines = 0;
+    for (uint32_t i = 0; i < KNC_GATHER_LINE_BUCKETS; i++) {
+        instructions += counts[i];
+        lines += counts[i] * i;
+    }
+}
+
 void KNCPerformanceMonitor::print_performance_report() const {
     std::cout << "\n=== KNC Performance Report ===\n";
     print_aggregate_statistics();
@@ -316,7 +361,24 @@ void KNCPerformanceMonitor::print_core_statistics(uint32_t core_id) const {
     }
     std::cout << "\n";
     
+    std::cout << "TLB hits/misses: " << core.tlb_hits << "/" << core.tlb_misses;
+    
+    if (core.tlb_hits + core.tlb_misses > 0) {
+        double tlb_hit_rate = (double)core.tlb_hits / (core.tlb_hits + core.tlb_misses) * 100.0;
+        std::cout << " (" << std::fixed << std::setprecision(1) << tlb_hit_rate << "%)";
+    }
+    std::cout << "\n";
+    
     std::cout << "Ring bus transactions: " << core.ring_bus_transactions << "\n";
+    
+    uint64_t gathers, gather_lines, scatters, scatter_lines;
+    sum_gather_lines(core.gather_lines.gathers, gathers, gather_lines);
+    sum_gather_lines(core.gather_lines.scatters, scatters, scatter_lines);
+    if (gathers + scatters > 0) {
+        std::cout << "Gathers/scatters: " << gathers << "/" << scatters << " (" << std::fixed << std::setprecision(2)
+                  << (gathers ? (double)gather_lines / gathers : 0.0) << "/"
+                  << (scatters ? (double)scatter_lines / scatters : 0.0) << " cache lines each)\n";
+    }
     std::cout << "Cycles: " << core.cycles << "\n";
     
     if (core.cycles > 0) {
@@ -349,6 +411,34 @@ void KNCPerformanceMonitor::print_aggregate_statistics() const {
                            (aggregate_counters_val.l2_hits + aggregate_counters_val.l2_misses) * 100.0;
         std::cout << "L2 hit rate: " << std::fixed << std::setprecision(1) << l2_hit_rate << "%\n";
     }
+    
+    if (aggregate_counters_val.tlb_hits + aggregate_counters_val.tlb_misses > 0) {
+        double tlb_hit_rate = (double)aggregate_counters_val.tlb_hits / 
+                            (aggregate_counters_val.tlb_hits + aggregate_counters_val.tlb_misses) * 100.0;
+        std::cout << "TLB hit rate: " << std::fixed << std::setprecision(1) << tlb_hit_rate << "%\n";
+    }
+    
+    print_gather_histogram();
+}
+
+void KNCPerformanceMonitor::print_gather_histogram() const {
+    uint64_t gathers, gather_lines, scatters, scatter_lines;
+    sum_gather_lines(aggregate_gather_lines.gathers, gathers, gather_lines);
+    sum_gather_lines(aggregate_gather_lines.scatters, scatters, scatter_lines);
+    if (gathers + scatters == 0) {
+        return;
+    }
+    
+    std::cout << "Cache lines per gather/scatter:\n";
+    for (uint32_t i = 0; i < KNC_GATHER_LINE_BUCKETS; i++) {
+        if (aggregate_gather_lines.gathers[i] + aggregate_gather_lines.scatters[i] > 0) {
+            std::cout << "  " << std::setw(2) << i << ": " << aggregate_gather_lines.gathers[i] << " gathers, "
+                      << aggregate_gather_lines.scatters[i] << " scatters\n";
+        }
+    }
+    std::cout << "  average: " << std::fixed << std::setprecision(2)
+              << (gathers ? (double)gather_lines / gathers : 0.0) << " lines per gather, "
+              << (scatters ? (double)scatter_lines / scatters : 0.0) << " per scatter\n";
 }
 
 void KNCPerformanceMonitor::export_csv(const std::string& filename) const {
@@ -361,7 +451,8 @@ void KNCPerformanceMonitor::export_csv(const std::string& filename) const {
     // Write header
     file << "core_id,instructions_retired,vector_instructions,memory_accesses,";
     file << "l1_hits,l1_misses,l2_hits,l2_misses,";
-    file << "ring_bus_transactions,cycles,ipc\n";
+    file << "ring_bus_transactions,cycles,ipc,";
+    file << "gathers,gather_lines,scatters,scatter_lines\n";
     
     // Write data for each core
     for (uint32_t i = 0; i < num_cores; i++) {
@@ -378,7 +469,12 @@ void KNCPerformanceMonitor::export_csv(const std::string& filename) const {
         file << core.cycles << ",";
         
         double ipc = (core.cycles > 0) ? (double)core.instructions_retired / core.cycles : 0.0;
-        file << std::fixed << std::setprecision(3) << ipc;
+        file << std::fixed << std::setprecision(3) << ipc << ",";
+        
+        uint64_t gathers, gather_lines, scatters, scatter_lines;
+        sum_gather_lines(core.gather_lines.gathers, gathers, gather_lines);
+        sum_gather_lines(core.gather_lines.scatters, scatters, scatter_lines);
+        file << gathers << "," << gather_lines << "," << scatters << "," << scatter_lines;
         file << "\n";
     }
     
@@ -1,11 +1,17 @@
 #include "knc_runtime.h"
 #include "knc_instruction_translator.h"
+#include "knc_translation_store.h"
+#include "knc_jit_compiler.h"
 #include "knc_debugger.h"
 #include "knc_performance_monitor.h"
 #include "pcie_bridge.h"
+#include "ring_bus_simulator.h"
 #include <iostream>
 #include <cstring>
 #include <cstdlib>
+#include <algorithm>
+#include <cstdio>
+#include <chrono>
 
 // Windows compatibility
 #ifdef _WIN32
@@ -16,6 +22,10 @@
 #include <unistd.h>
 #endif
 
+// Emulated core the calling host thread is running, which picks its MMU
+// statistics shard; threads outside guest execution keep the host shard
+static thread_local uint32_t mmu_shard = UINT32_MAX;
+
 KNCRuntime::KNCRuntime(uint32_t cores, uint64_t mem_size, knc_architecture_t arch) 
     : num_cores(cores), memory_size(mem_size), architecture(arch) {
     should_halt.store(false);
@@ -23,7 +33,34 @@ KNCRuntime::KNCRuntime(uint32_t cores, uint64_t mem_size, knc_architecture_t arc
     running.store(false);
     initialized = false;
     
-    core_states.resize(num_cores);
+    translator.reset(new KNCInstructionTranslator());
+    jit.reset(new KNCJitCompiler());
+    guest_memory.reset(new KNCGuestMemory());
+    huge_pages = KNC_HUGE_PAGES_NONE;
+    page_tables.reset(new KNCPageTables());
+    page_size = KNC_PAGE_4K;
+    jit_enabled = false;
+    compile_busy = false;
+    compile_stop = false;
+    blocks_compiled.store(0);
+    scheduler.reset(new KNCScheduler());
+    num_workers = 0;
+    threads_per_core = 1;
+    sync_quantum = KNC_DEFAULT_SYNC_QUANTUM;
+    pretranslate_threads = 0;
+    max_core_skew.store(0);
+    vector_backend = knc_detect_vector_backend();
+    vector_ops = knc_get_vector_ops(vector_backend);
+    
+    core_states.resize(num_cores * KNC_THREADS_PER_CORE);
+    core_issue.resize(num_cores);
+    core_clocks.reset(new knc_core_clock_t[num_cores]);
+    tlbs.reset(new knc_tlb_t[num_cores]);
+    gather_lines.reset(new knc_gather_lines_t[num_cores]());
+    reported_gather_lines.reset(new knc_gather_lines_t[num_cores]());
+    code_generation.store(0);
+    code_page_writes.store(0);
+    code_blocks_invalidated.store(0);
     memory = nullptr;
     
     ring_bus = nullptr;
@@ -54,20 +91,39 @@ KNCRuntime::KNCRuntime(uint32_t cores, uint64_t mem_size, knc_architecture_t arc
         // Calculate tile distribution based on architecture
         uint32_t num_tiles = (architecture == ARCH_KNL) ? KNL_NUM_TILES : KNC_NUM_TILES;
         mmus[i].tile_id = i * (num_tiles / num_mmus);
-        
-        mmus[i].accesses = 0;
-        mmus[i].cache_hits = 0;
-        mmus[i].cache_misses = 0;
     }
+    mmu_counters.reset(new knc_mmu_counters_t[num_cores + 1]);
+    for (uint32_t shard = 0; shard <= num_cores; shard++) {
+        for (uint32_t i = 0; i < KNL_NUM_MMUS; i++) {
+            mmu_counters[shard].accesses[i].store(0);
+            mmu_counters[shard].cache_hits[i].store(0);
+            mmu_counters[shard].cache_misses[i].store(0);
+        }
+        mmu_counters[shard].hit_state.store(shard + 1);
+    }
+    atomic_lines.reset(new std::atomic<uint64_t>[ATOMIC_LINE_SLOTS]);
+    for (uint32_t i = 0; i < ATOMIC_LINE_SLOTS; i++) {
+        atomic_lines[i].store(0);
+    }
+    contended_atomics.store(0);
     
-    // Initialize core states
-    for (uint32_t i = 0; i < num_cores; i++) {
+    // Initialize hardware thread contexts
+    for (uint32_t i = 0; i < num_cores * KNC_THREADS_PER_CORE; i++) {
         memset(&core_states[i], 0, sizeof(knc_core_state_t));
-        core_states[i].core_id = i;
-        core_states[i].tile_id = i / KNC_CORES_PER_TILE;
+        core_states[i].core_id = i / KNC_THREADS_PER_CORE;
+        core_states[i].thread_id = i % KNC_THREADS_PER_CORE;
+        core_states[i].tile_id = core_states[i].core_id / KNC_CORES_PER_TILE;
         core_states[i].is_halted = true;
         core_states[i].cycles_executed = 0;
+        core_states[i].jit_loop_budget = KNC_JIT_MAX_LOOP_BUDGET;
+        core_states[i].tlb = &tlbs[core_states[i].core_id];
+    }
+    for (uint32_t i = 0; i < num_cores; i++) {
+        memset(&core_issue[i], 0, sizeof(knc_core_issue_t));
+        core_issue[i].num_threads = threads_per_core;
+        core_clocks[i].cycles.store(0);
     }
+    flush_tlbs();
 }
 
 KNCRuntime::~KNCRuntime() {
@@ -78,21 +134,26 @@ bool KNCRuntime::initialize() {
     std::cout << "Initializing KNC Runtime with " << num_cores << " cores\n";
     std::cout << "Memory size: " << (memory_size / (1024*1024)) << " MB\n";
     
-    // Allocate memory
-    memory = new uint8_t[memory_size];
-    if (!memory) {
+    // Reserve guest memory; the host zero-fills each page on first touch
+    if (!guest_memory->allocate(memory_size, huge_pages)) {
         std::cerr << "Error: Failed to allocate memory\n";
         return false;
     }
+    memory = guest_memory->data();
     
-    // Initialize memory to zero
-    memset(memory, 0, memory_size);
+    uint64_t code_page_words = ((memory_size >> KNC_PAGE_SHIFT) + 63) / 64;
+    code_pages.reset(new std::atomic<uint64_t>[code_page_words]);
+    mixed_pages.reset(new std::atomic<uint64_t>[code_page_words]);
+    for (uint64_t i = 0; i < code_page_words; i++) {
+        code_pages[i].store(0, std::memory_order_relaxed);
+        mixed_pages[i].store(0, std::memory_order_relaxed);
+    }
     
-    // Initialize cores
-    for (uint32_t i = 0; i < num_cores; i++) {
+    // Initialize hardware thread contexts
+    for (uint32_t i = 0; i < num_cores * KNC_THREADS_PER_CORE; i++) {
         // Initialize vector registers to zero
         for (int j = 0; j < KNC_NUM_VECTOR_REGISTERS; j++) {
-            core_states[i].registers.zmm[j] = _mm512_setzero_si512();
+            memset(&core_states[i].registers.zmm[j], 0, sizeof(knc_vector_t));
         }
         
         // Initialize mask registers
@@ -109,6 +170,23 @@ bool KNCRuntime::initialize() {
         core_states[i].registers.rflags = 0;
     }
     
+    // Set up the block translator
+    if (!translator->initialize()) {
+        std::cerr << "Error: Failed to initialize instruction translator\n";
+        return false;
+    }
+    translator->set_handler_resolver(&KNCRuntime::get_instruction_handler);
+    
+    if (jit_enabled && !jit->initialize()) {
+        jit_enabled = false;
+    }
+    if (jit_enabled) {
+        // Compiled guest accesses that hit a guard page resume at a side exit
+        guest_memory->set_fault_redirect(&KNCJitCompiler::fault_resume_address, jit.get());
+        start_compile_thread();
+    }
+    std::cout << "Vector backend: " << vector_ops->name << "\n";
+    
     initialized = true;
     std::cout << "KNC Runtime initialized successfully\n";
     return true;
@@ -119,14 +197,12 @@ void KNCRuntime::shutdown() {
         halt();
     }
     
-    // Wait for all threads to finish
-    for (auto& thread : core_threads) {
-        if (thread.joinable()) {
-            thread.join();
-        }
-    }
+    // Wait for all workers to finish
+    scheduler->stop();
+    stop_compile_thread();
     
-    core_threads.clear();
+    guest_memory->release();
+    memory = nullptr;
     initialized = false;
     std::cout << "KNC Runtime shutdown\n";
 }
@@ -143,18 +219,251 @@ bool KNCRuntime::load_program(const uint8_t* program_data, uint64_t program_size
     }
     
     // Copy program to memory starting at address 0
+    guest_memory->discard_file_mappings();
     memcpy(memory, program_data, program_size);
-    
-    // Set entry point for all cores
-    for (uint32_t i = 0; i < num_cores; i++) {
-        core_states[i].registers.rip = 0;  // Entry point at address 0
-        core_states[i].is_halted = false;
+    if (!map_address_space(std::vector<knc_elf_segment_t>())) {
+        return false;
     }
+    reset_contexts(program_size);
     
     std::cout << "Program loaded: " << program_size << " bytes\n";
     return true;
 }
 
+bool KNCRuntime::load_binary(const KNCBinaryLoader& loader) {
+    if (!initialized) {
+        std::cerr << "Error: Runtime not initialized\n";
+        return false;
+    }
+    
+    const knc_binary_info_t& binary = loader.get_binary_info();
+    if (binary.segments.empty()) {
+        std::cerr << "Error: Binary has no loadable segments\n";
+        return false;
+    }
+    uint64_t image_end = 0;
+    for (const knc_elf_segment_t& segment : binary.segments) {
+        if (segment.virtual_address > memory_size || segment.memory_size > memory_size - segment.virtual_address) {
+            std::cerr << "Error: Segment at 0x" << std::hex << segment.virtual_address << std::dec
+                      << " does not fit in guest memory\n";
+            return false;
+        }
+        image_end = std::max(image_end, segment.virtual_address + segment.memory_size);
+    }
+    
+    // Read-only segments that share no page with another segment are mapped
+    // straight from the file; the rest are copied, and BSS is zeroed
+    guest_memory->discard_file_mappings();
+    const uint8_t* file = loader.get_file_data();
+    uint64_t host_page = std::max<uint64_t>(KNC_PAGE_SIZE_4K, guest_memory->get_page_size());
+    uint64_t mapped = 0, copied = 0;
+    for (const knc_elf_segment_t& segment : binary.segments) {
+        uint64_t start = segment.virtual_address & ~(host_page - 1);
+        uint64_t end = (segment.virtual_address + segment.memory_size + host_page - 1) & ~(host_page - 1);
+        bool shares_page = false;
+        for (const knc_elf_segment_t& other : binary.segments) {
+            if (&other != &segment && other.virtual_address < end &&
+                start < other.virtual_address + other.memory_size) {
+                shares_page = true;
+            }
+        }
+        
+        if (!segment.writable && !shares_page && segment.file_size == segment.memory_size &&
+            guest_memory->map_file(segment.virtual_address, loader.get_file_descriptor(),
+                                   segment.file_offset, segment.file_size)) {
+            mapped += segment.file_size;
+            continue;
+        }
+        memcpy(memory + segment.virtual_address, file + segment.file_offset, segment.file_size);
+        guest_memory->zero(segment.virtual_address + segment.file_size, segment.memory_size - segment.file_size);
+        copied += segment.file_size;
+    }
+    
+    if (!map_address_space(binary.segments)) {
+        return false;
+    }
+    reset_contexts(image_end);
+    if (!set_entry_point(binary.entry_point)) {
+        return false;
+    }
+    
+    // Warm-start translation from an earlier run of the same file
+    if (!translation_cache_dir.empty()) {
+        static const char* const arch_names[] = {"knc", "knl", "knf"};
+        knc_translation_cache_key_t key;
+        key.binary_hash = knc_hash_bytes(file, loader.get_file_size());
+        key.binary_size = loader.get_file_size();
+        key.translator_version = KNC_TRANSLATOR_VERSION;
+        key.architecture = architecture;
+        char name[64];
+        snprintf(name, sizeof(name), "/%016llx-%s.ktc", static_cast<unsigned long long>(key.binary_hash),
+                 arch_names[architecture <= ARCH_KNF ? architecture : ARCH_KNC]);
+        translator->open_persistent_cache(translation_cache_dir + name, key);
+    }
+    if (pretranslate_threads > 0) {
+        pretranslate_text(loader);
+    }
+    
+    std::cout << "Program loaded: " << binary.segments.size() << " segments, " << mapped << " bytes mapped, "
+              << copied << " bytes copied, entry 0x" << std::hex << binary.entry_point << std::dec << "\n";
+    return true;
+}
+
+void KNCRuntime::pretranslate_text(const KNCBinaryLoader& loader) {
+    // .text, or every executable segment of a file without section headers
+    const knc_binary_info_t& binary = loader.get_binary_info();
+    std::vector<knc_elf_section_t> regions;
+    if (binary.text_section.size > 0) {
+        regions.push_back(binary.text_section);
+    } else {
+        for (const knc_elf_segment_t& segment : binary.segments) {
+            if (segment.executable && segment.file_size > 0) {
+                regions.push_back({segment.virtual_address, segment.file_size});
+            }
+        }
+    }
+    std::vector<uint64_t> seeds = loader.get_function_addresses();
+    
+    auto start = std::chrono::steady_clock::now();
+    size_t blocks = 0, instructions = 0;
+    for (const knc_elf_section_t& region : regions) {
+        // Segments are mapped at their own physical addresses
+        knc_page_walk_t first, last;
+        if (!page_tables->translate(region.address, first) ||
+            !page_tables->translate(region.address + region.size - 1, last) ||
+            first.physical != region.address || last.physical != region.address + region.size - 1) {
+            std::cerr << "Warning: Code at 0x" << std::hex << region.address << std::dec
+                      << " is not mapped; translating it lazily\n";
+            continue;
+        }
+        
+        std::lock_guard<std::mutex> guard(code_mutex);
+        std::vector<knc_translated_block_t*> added =
+            translator->pretranslate(region.address, memory + region.address, region.size, seeds, pretranslate_threads);
+        for (knc_translated_block_t* block : added) {
+            track_code_pages(block, block->start_address);
+            instructions += block->instructions.size();
+        }
+        blocks += added.size();
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Pretranslated " << blocks << " blocks (" << instructions << " instructions) in " << ms
+              << " ms on " << pretranslate_threads << " host threads\n";
+}
+
+bool KNCRuntime::set_entry_point(uint64_t entry_point) {
+    knc_page_walk_t walk;
+    if (!page_tables->translate(entry_point, walk)) {
+        std::cerr << "Error: Entry point 0x" << std::hex << entry_point << std::dec << " is not mapped\n";
+        return false;
+    }
+    for (knc_core_state_t& thread : core_states) {
+        thread.registers.rip = entry_point;
+    }
+    return true;
+}
+
+bool KNCRuntime::map_address_space(const std::vector<knc_elf_segment_t>& segments) {
+    // Pages holding only read-only segments become read-only; a page shared
+    // with a writable segment stays writable
+    std::vector<std::pair<uint64_t, uint64_t>> read_only;
+    for (const knc_elf_segment_t& segment : segments) {
+        if (segment.writable) {
+            continue;
+        }
+        uint64_t start = segment.virtual_address & ~(KNC_PAGE_SIZE_4K - 1);
+        uint64_t end = (segment.virtual_address + segment.memory_size + KNC_PAGE_SIZE_4K - 1) &
+                       ~(KNC_PAGE_SIZE_4K - 1);
+        for (const knc_elf_segment_t& other : segments) {
+            if (!other.writable) {
+                continue;
+            }
+            uint64_t other_end = other.virtual_address + other.memory_size;
+            if (other.virtual_address < start + KNC_PAGE_SIZE_4K && start < other_end) {
+                start += KNC_PAGE_SIZE_4K;
+            }
+            if (other.virtual_address < end && end - KNC_PAGE_SIZE_4K < other_end) {
+                end -= KNC_PAGE_SIZE_4K;
+            }
+        }
+        if (start < end) {
+            read_only.push_back(std::make_pair(start, end));
+        }
+    }
+    std::sort(read_only.begin(), read_only.end());
+    
+    // Everything else maps one-to-one onto physical memory as well, in pages
+    // up to the configured size
+    page_tables->reset(memory_size);
+    uint64_t limit = memory_size & ~(KNC_PAGE_SIZE_4K - 1);
+    uint64_t cursor = 0;
+    for (const auto& range : read_only) {
+        uint64_t start = std::max(range.first, cursor);
+        uint64_t end = std::min(range.second, limit);
+        if (start >= end) {
+            continue;
+        }
+        if (start > cursor && !page_tables->map(cursor, cursor, start - cursor, page_size, true)) {
+            return false;
+        }
+        if (!page_tables->map(start, start, end - start, page_size, false)) {
+            return false;
+        }
+        cursor = end;
+    }
+    if (cursor < limit && !page_tables->map(cursor, cursor, limit - cursor, page_size, true)) {
+        return false;
+    }
+    flush_tlbs();
+    return true;
+}
+
+void KNCRuntime::reset_contexts(uint64_t image_end) {
+    translator->close_persistent_cache();  // Saves the previous program's blocks
+    drain_compile_queue();  // Queued blocks are about to be freed
+    translator->flush_translation_cache();
+    jit->reset();
+    for (uint64_t i = 0; i < ((memory_size >> KNC_PAGE_SHIFT) + 63) / 64; i++) {
+        code_pages[i].store(0, std::memory_order_relaxed);
+        mixed_pages[i].store(0, std::memory_order_relaxed);
+    }
+    
+    // Each hardware thread in use gets its own stack below the top of guest memory
+    uint32_t num_contexts = num_cores * threads_per_core;
+    uint64_t stack_size = KNC_STACK_SIZE;
+    if (image_end + stack_size * num_contexts > memory_size) {
+        stack_size = ((memory_size - image_end) / num_contexts) & ~0xFULL;
+    }
+    
+    // Start every hardware thread in use at address 0; the rest stay halted
+    for (uint32_t i = 0; i < num_cores * KNC_THREADS_PER_CORE; i++) {
+        knc_core_state_t& thread = core_states[i];
+        uint32_t context = thread.core_id * threads_per_core + thread.thread_id;
+        thread.registers.rip = 0;
+        thread.stack_top = memory_size - context * stack_size;
+        thread.registers.gpr[KNC_REG_RSP] = thread.stack_top;
+        thread.is_halted = thread.thread_id >= threads_per_core;
+        thread.yield_requested = false;
+        thread.cycles_executed = 0;
+        thread.active_cycles = 0;
+        thread.stall_cycles = 0;
+        thread.gather_cycles = 0;
+        thread.block_lookups = 0;
+        thread.cold_runs = 0;
+        thread.cold_instructions = 0;
+        thread.jit_loop_budget = KNC_JIT_MAX_LOOP_BUDGET;
+    }
+    for (uint32_t i = 0; i < num_cores; i++) {
+        memset(&core_issue[i], 0, sizeof(knc_core_issue_t));
+        memset(&gather_lines[i], 0, sizeof(knc_gather_lines_t));
+        memset(&reported_gather_lines[i], 0, sizeof(knc_gather_lines_t));
+        core_issue[i].num_threads = threads_per_core;
+        core_clocks[i].cycles.store(0);
+    }
+    global_cycle_count.store(0);
+    max_core_skew.store(0);
+}
+
 knc_error_t KNCRuntime::run() {
     if (!initialized) {
         return KNC_ERROR_INVALID_ARGUMENT;
@@ -163,114 +472,1937 @@ knc_error_t KNCRuntime::run() {
     running.store(true);
     should_halt.store(false);
     
-    std::cout << "Starting KNC emulation on " << num_cores << " cores\n";
-    
-    // Start core execution threads
-    core_threads.clear();
-    for (uint32_t i = 0; i < num_cores; i++) {
-        core_threads.emplace_back(&KNCRuntime::execute_core, this, i);
+    // Cores run as time slices on a fixed pool of host workers
+    uint32_t workers = num_workers ? num_workers : KNCScheduler::default_worker_count(num_cores);
+    if (!scheduler->start(num_cores, workers, [this](uint32_t context_id, uint32_t) {
+            knc_slice_result_t result = execute_slice(context_id, SLICE_INSTRUCTIONS);
+            collect_tlb_events(context_id);
+            collect_gather_events(context_id);
+            return result;
+        })) {
+        running.store(false);
+        return KNC_ERROR_INVALID_ARGUMENT;
     }
+    std::cout << "Starting KNC emulation on " << num_cores << " cores (" << scheduler->get_num_workers()
+              << " host workers)\n";
     
-    // Main emulation loop
+    // Main emulation loop - the cores keep their own time; this only watches them
     while (running.load() && !should_halt.load()) {
         update_global_cycle_count();
         
+        // Stop once every core has returned, halted or faulted
+        if (scheduler->is_finished()) {
+            break;
+        }
+        
         // Check for debugger break requests
         if (debugger && debugger->should_pause()) {
             // Handle debugger interaction
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
         
-        // Small delay to prevent busy waiting
-        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        // Small delay to prevent busy waiting
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    
+    // Workers exit on their own once every context finished; halt() stops them early
+    scheduler->stop();
+    synchronize_cores();
+    
+    running.store(false);
+    std::cout << "KNC emulation completed\n";
+    
+    return KNC_SUCCESS;
+}
+
+knc_slice_result_t KNCRuntime::execute_slice(uint32_t core_id, uint64_t budget) {
+    mmu_shard = core_id;
+    knc_core_issue_t& pipeline = core_issue[core_id];
+    knc_core_state_t* threads = &core_states[core_id * KNC_THREADS_PER_CORE];
+    knc_translated_block_t* blocks[KNC_THREADS_PER_CORE] = {};
+    uint64_t retired = 0;
+    
+    while (true) {
+        if (!running.load(std::memory_order_relaxed) || should_halt.load(std::memory_order_relaxed)) {
+            return KNC_SLICE_PREEMPTED;
+        }
+        
+        // Stop at the end of the quantum until the slowest core catches up
+        if (!barrier_wait(core_id)) {
+            return retired ? KNC_SLICE_PREEMPTED : KNC_SLICE_BLOCKED;
+        }
+        // Cycles left in the quantum, shared by the threads issuing this round
+        uint64_t allowance = sync_quantum
+            ? (global_cycle_count.load(std::memory_order_acquire) + sync_quantum - pipeline.cycles) /
+              pipeline.num_threads + 1
+            : 0;
+        
+        // One round: every live hardware thread issues one block, in round-robin order
+        uint64_t issued[KNC_THREADS_PER_CORE] = {};
+        uint64_t gathered[KNC_THREADS_PER_CORE] = {};
+        uint32_t live = 0, spinning = 0;
+        for (uint32_t n = 0; n < pipeline.num_threads; n++) {
+            uint32_t t = (pipeline.next_thread + n) % pipeline.num_threads;
+            knc_core_state_t& thread = threads[t];
+            if (thread.is_halted) {
+                continue;
+            }
+            live++;
+            
+            uint64_t before = thread.cycles_executed;
+            uint64_t gather_before = thread.gather_cycles;
+            thread.yield_requested = false;
+            step_thread(thread, blocks[t], allowance);
+            issued[t] = thread.cycles_executed - before;
+            gathered[t] = thread.gather_cycles - gather_before;
+            if (thread.yield_requested) {
+                spinning++;
+            }
+        }
+        pipeline.next_thread = (pipeline.next_thread + 1) % pipeline.num_threads;
+        
+        if (live == 0) {
+            // A finished core no longer holds the others back
+            publish_core_clock(core_id, UINT64_MAX);
+            return KNC_SLICE_FINISHED;
+        }
+        account_issue(core_id, issued, gathered);
+        publish_core_clock(core_id, pipeline.cycles);
+        for (uint32_t t = 0; t < KNC_THREADS_PER_CORE; t++) {
+            retired += issued[t];
+        }
+        
+        // Give up the host worker when every thread is spin-waiting or the slice is used up
+        if (spinning == live) {
+            return KNC_SLICE_YIELDED;
+        }
+        if (retired >= budget) {
+            return KNC_SLICE_PREEMPTED;
+        }
+    }
+}
+
+bool KNCRuntime::step_thread(knc_core_state_t& thread, knc_translated_block_t*& block, uint64_t allowance) {
+    uint32_t core_id = thread.core_id;
+    
+    // Another core translated code on a page this core may hold writable
+    if (thread.tlb->code_generation != code_generation.load(std::memory_order_acquire)) {
+        revoke_code_writes(*thread.tlb);
+    }
+    
+    // Enter through the dispatcher only when no chained successor exists
+    if (!block || !block->is_valid.load(std::memory_order_acquire)) {
+        bool cold = false;
+        block = lookup_block(thread, thread.registers.rip, &cold);
+        if (cold) {
+            if (execute_cold(core_id, thread) != KNC_SUCCESS) {
+                thread.is_halted = true;
+                return false;
+            }
+            return !thread.is_halted;
+        }
+        if (!block) {
+            std::cerr << "Core " << core_id << " thread " << thread.thread_id << ": Cannot decode instruction at RIP 0x"
+                      << std::hex << thread.registers.rip << std::dec << "\n";
+            thread.is_halted = true;
+            return false;
+        }
+    }
+    knc_translated_block_t* superblock = block->superblock.load(std::memory_order_acquire);
+    if (superblock && superblock->is_valid.load(std::memory_order_acquire)) {
+        block = superblock;
+    }
+    if (block->check_code.load(std::memory_order_relaxed) && !check_block_code(thread, block)) {
+        thread.is_halted = true;
+        return false;
+    }
+    
+    knc_jit_entry_t code = block->jit_code.load(std::memory_order_acquire);
+    if (code) {
+        // Keep compiled self-loops inside the quantum: each pass issues at
+        // least two cycles per instruction once the core's threads interleave
+        uint64_t passes = KNC_JIT_MAX_LOOP_BUDGET;
+        if (allowance) {
+            passes = std::min<uint64_t>(passes, allowance / (2 * block->instructions.size()));
+        }
+        thread.jit_loop_budget = static_cast<uint32_t>(std::max<uint64_t>(passes, 1));
+    }
+    if (code && !execute_jit_block(thread, *block, code)) {
+        // Side exit - interpret from the instruction the compiled code could not handle
+        code = nullptr;
+        block = lookup_block(thread, thread.registers.rip);
+        if (!block) {
+            thread.is_halted = true;
+            return false;
+        }
+    }
+    if (!code) {
+        if (execute_block(core_id, thread, *block) != KNC_SUCCESS) {
+            thread.is_halted = true;
+            return false;
+        }
+    }
+    
+    // Follow or establish the direct link for static exits; a link to a
+    // retired block is replaced by its retranslation
+    uint64_t next_rip = thread.registers.rip;
+    knc_translated_block_t* next = nullptr;
+    uint32_t exit = 0;
+    for (; exit < KNC_BLOCK_NUM_EXITS; exit++) {
+        if (block->exit_targets[exit] != next_rip) {
+            continue;
+        }
+        next = block->successors[exit].load(std::memory_order_acquire);
+        if (!next || !next->is_valid.load(std::memory_order_relaxed)) {
+            // A cold successor stays unlinked and is run by the next dispatch
+            bool cold = false;
+            next = lookup_block(thread, next_rip, &cold);
+            translator->link_block(block, exit, next);
+        }
+        break;
+    }
+    if (!code) {
+        profile_block(*block, exit);
+    }
+    block = next;
+    return !thread.is_halted;
+}
+
+void KNCRuntime::account_issue(uint32_t core_id, const uint64_t issued[KNC_THREADS_PER_CORE],
+                               const uint64_t gathered[KNC_THREADS_PER_CORE]) {
+    // Instructions of the threads in a round interleave in the pipeline, and
+    // each extra gather/scatter pass takes issue slots like an instruction.
+    // With no back-to-back issue from one thread, the round takes at least two
+    // cycles per slot of its longest thread, and never less than one cycle per
+    // slot overall.
+    uint64_t total = 0, longest = 0;
+    for (uint32_t t = 0; t < KNC_THREADS_PER_CORE; t++) {
+        uint64_t slots = issued[t] + gathered[t];
+        total += slots;
+        longest = std::max(longest, slots);
+    }
+    if (total == 0) {
+        return;
+    }
+    uint64_t cycles = std::max(total, 2 * longest);
+    
+    knc_core_issue_t& pipeline = core_issue[core_id];
+    pipeline.cycles += cycles;
+    pipeline.idle_cycles += cycles - total;
+    
+    knc_core_state_t* threads = &core_states[core_id * KNC_THREADS_PER_CORE];
+    for (uint32_t t = 0; t < KNC_THREADS_PER_CORE; t++) {
+        uint64_t slots = issued[t] + gathered[t];
+        if (slots > 0) {
+            threads[t].active_cycles += cycles;
+            threads[t].stall_cycles += cycles - slots;
+        }
+    }
+    
+    if (perf_monitor) {
+        perf_monitor->record_cycle(core_id, cycles);
+    }
+}
+
+knc_translated_block_t* KNCRuntime::lookup_block(knc_core_state_t& thread, uint64_t rip, bool* cold) {
+    thread.block_lookups++;
+    knc_translated_block_t* block = translator->find_block(rip);
+    if (block) {
+        return block;
+    }
+    
+    // Code reached only once or twice is not worth translating and caching
+    if (cold && !translator->count_execution(rip, WARM_THRESHOLD)) {
+        *cold = true;
+        return nullptr;
+    }
+    
+    uint64_t physical, available;
+    if (!fetch_code(rip, physical, available)) {
+        return nullptr;
+    }
+    
+    std::lock_guard<std::mutex> guard(code_mutex);
+    block = translator->translate_block(rip, memory + physical, available);
+    if (block && track_code_pages(block, physical)) {
+        revoke_code_writes(*thread.tlb);  // Before this core runs the block
+    }
+    return block;
+}
+
+bool KNCRuntime::fetch_code(uint64_t rip, uint64_t& physical, uint64_t& available) {
+    knc_page_walk_t walk;
+    if (!page_tables->translate(rip, walk)) {
+        return false;
+    }
+    
+    // Decode up to the end of the page, or further while the following pages
+    // are physically contiguous
+    uint64_t page_bytes = knc_page_bytes(walk.size);
+    available = page_bytes - (rip & (page_bytes - 1));
+    knc_page_walk_t next;
+    while (available < MAX_FETCH_BYTES && page_tables->translate(rip + available, next) &&
+           next.physical == walk.physical + available) {
+        available += knc_page_bytes(next.size) - ((rip + available) & (knc_page_bytes(next.size) - 1));
+    }
+    physical = walk.physical;
+    return true;
+}
+
+knc_error_t KNCRuntime::execute_cold(uint32_t core_id, knc_core_state_t& core) {
+    uint64_t start = core.registers.rip;
+    uint64_t physical, available;
+    if (!fetch_code(start, physical, available)) {
+        std::cerr << "Core " << core_id << " thread " << core.thread_id << ": Cannot decode instruction at RIP 0x"
+                  << std::hex << start << std::dec << "\n";
+        return KNC_ERROR_MEMORY_ACCESS;
+    }
+    core.cold_runs++;
+    
+    // Same fault recovery as execute_block; the faulting instruction is the
+    // one being run
+    volatile uint64_t fault_rip = start;
+    knc_fault_jmp_buf_t recovery;
+    knc_fault_jmp_buf_t* previous = KNCGuestMemory::arm_fault_recovery(&recovery);
+    if (KNC_GUEST_FAULT_SETJMP(recovery)) {
+        KNCGuestMemory::disarm_fault_recovery(previous);
+        std::cerr << "Core " << core_id << ": Execution error " << KNC_ERROR_MEMORY_ACCESS << " at RIP 0x"
+                  << std::hex << fault_rip << std::dec << "\n";
+        return KNC_ERROR_MEMORY_ACCESS;
+    }
+    
+    // Decode each instruction just before running it, so stores into code
+    // that was never translated need no invalidation
+    knc_error_t result = KNC_SUCCESS;
+    uint64_t offset = 0;
+    for (size_t n = 0; n < MAX_COLD_INSTRUCTIONS && offset < available; n++) {
+        knc_decoded_instruction_t inst;
+        if (!translator->decode_instruction(start + offset, memory + physical + offset, available - offset, inst)) {
+            if (n == 0) {
+                std::cerr << "Core " << core_id << " thread " << core.thread_id
+                          << ": Cannot decode instruction at RIP 0x" << std::hex << start << std::dec << "\n";
+                result = KNC_ERROR_INVALID_INSTRUCTION;
+            }
+            break;  // The dispatcher reports it if execution gets there
+        }
+        inst.handler = get_instruction_handler(static_cast<knc_exec_op_t>(inst.op));
+        fault_rip = inst.address;
+        result = execute_instruction(core, inst);
+        if (result != KNC_SUCCESS) {
+            std::cerr << "Core " << core_id << ": Execution error " << result << " at RIP 0x"
+                      << std::hex << inst.address << std::dec << "\n";
+            break;
+        }
+        core.cycles_executed++;
+        core.cold_instructions++;
+        
+        if (debugger && debugger->should_break(core.registers.rip, core_id)) {
+            debugger->notify_breakpoint_hit(core.registers.rip, core_id);
+            while (debugger->should_pause()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+        }
+        if (inst.flags & KNC_DECODE_BRANCH) {
+            break;
+        }
+        offset += inst.length;
+    }
+    KNCGuestMemory::disarm_fault_recovery(previous);
+    return result;
+}
+
+knc_error_t KNCRuntime::execute_block(uint32_t core_id, knc_core_state_t& core, const knc_translated_block_t& block) {
+    // Guest loads and stores are unchecked; one that leaves guest memory hits
+    // a guard page and lands back here
+    knc_fault_jmp_buf_t recovery;
+    knc_fault_jmp_buf_t* previous = KNCGuestMemory::arm_fault_recovery(&recovery);
+    if (KNC_GUEST_FAULT_SETJMP(recovery)) {
+        KNCGuestMemory::disarm_fault_recovery(previous);
+        
+        // RIP already points past the faulting instruction
+        uint64_t fault_rip = block.instructions.back().address;
+        for (const knc_decoded_instruction_t& inst : block.instructions) {
+            if (inst.address + inst.length == core.registers.rip) {
+                fault_rip = inst.address;
+                break;
+            }
+        }
+        std::cerr << "Core " << core_id << ": Execution error " << KNC_ERROR_MEMORY_ACCESS << " at RIP 0x"
+                  << std::hex << fault_rip << std::dec << "\n";
+        return KNC_ERROR_MEMORY_ACCESS;
+    }
+    
+    knc_error_t result = interpret_block(core_id, core, block);
+    KNCGuestMemory::disarm_fault_recovery(previous);
+    return result;
+}
+
+knc_error_t KNCRuntime::interpret_block(uint32_t core_id, knc_core_state_t& core, const knc_translated_block_t& block) {
+    size_t count = block.instructions.size();
+    for (size_t i = 0; i < count; i++) {
+        const knc_decoded_instruction_t& inst = block.instructions[i];
+        knc_error_t result = execute_instruction(core, inst);
+        
+        if (result != KNC_SUCCESS) {
+            std::cerr << "Core " << core_id << ": Execution error " << result << " at RIP 0x" 
+                      << std::hex << inst.address << std::dec << "\n";
+            return result;
+        }
+        
+        core.cycles_executed++;
+        
+        // A store rewrote this block's code; the dispatcher retranslates from RIP
+        if (!block.is_valid.load(std::memory_order_relaxed)) {
+            break;
+        }
+        
+        // Side exit from a superblock where a branch left the recorded path
+        if ((inst.flags & KNC_DECODE_BRANCH) && i + 1 < count &&
+            core.registers.rip != block.instructions[i + 1].address) {
+            break;
+        }
+        
+        // Check for debugger breakpoints
+        if (debugger && debugger->should_break(core.registers.rip, core_id)) {
+            debugger->notify_breakpoint_hit(core.registers.rip, core_id);
+            // Wait for debugger commands
+            while (debugger->should_pause()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+        }
+    }
+    
+    return KNC_SUCCESS;
+}
+
+bool KNCRuntime::execute_jit_block(knc_core_state_t& core, const knc_translated_block_t& block, knc_jit_entry_t code) {
+    // Compiled self-loops retire their completed iterations themselves
+    uint32_t status = code(&core);
+    
+    uint64_t pass = block.instructions.size();
+    if (status != KNC_JIT_EXIT_NORMAL) {
+        // Count the instructions retired before the side exit; superblock
+        // addresses need not ascend, but none repeats
+        pass = 0;
+        for (const knc_decoded_instruction_t& inst : block.instructions) {
+            if (inst.address == core.registers.rip) {
+                break;
+            }
+            pass++;
+        }
+    }
+    core.cycles_executed += pass;
+    return status == KNC_JIT_EXIT_NORMAL;
+}
+
+void KNCRuntime::profile_block(knc_translated_block_t& block, uint32_t exit) {
+    // Only the first JIT_THRESHOLD interpreted executions are counted; both
+    // decisions they feed are taken by then
+    if (block.execution_count.load(std::memory_order_relaxed) >= JIT_THRESHOLD) {
+        return;
+    }
+    if (exit < KNC_BLOCK_NUM_EXITS) {
+        block.exit_counts[exit].fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    // Exactly one core sees each threshold crossing
+    uint32_t count = block.execution_count.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (count == SUPERBLOCK_THRESHOLD && block.parts.empty()) {
+        translator->form_superblock(&block);
+    }
+    
+    // The debugger needs per-instruction breakpoint checks, so it keeps blocks interpreted
+    if (count != JIT_THRESHOLD || !jit_enabled || debugger) {
+        return;
+    }
+    request_compile(&block);
+}
+
+void KNCRuntime::start_compile_thread() {
+    std::lock_guard<std::mutex> lock(compile_mutex);
+    if (compile_thread.joinable()) {
+        return;
+    }
+    compile_stop = false;
+    compile_thread = std::thread(&KNCRuntime::compile_worker, this);
+}
+
+void KNCRuntime::stop_compile_thread() {
+    {
+        std::lock_guard<std::mutex> lock(compile_mutex);
+        compile_stop = true;
+        compile_queue.clear();
+    }
+    compile_ready.notify_all();
+    if (compile_thread.joinable()) {
+        compile_thread.join();
+    }
+}
+
+void KNCRuntime::compile_worker() {
+    std::unique_lock<std::mutex> lock(compile_mutex);
+    while (true) {
+        compile_ready.wait(lock, [this] { return compile_stop || !compile_queue.empty(); });
+        if (compile_stop) {
+            break;
+        }
+        knc_translated_block_t* block = compile_queue.front();
+        compile_queue.pop_front();
+        compile_busy = true;
+        lock.unlock();
+        
+        // A block retired while queued is never dispatched again
+        if (block->is_valid.load(std::memory_order_acquire)) {
+            knc_jit_entry_t code = jit->compile_block(*block);
+            if (code) {
+                block->jit_code.store(code, std::memory_order_release);
+                blocks_compiled.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        
+        lock.lock();
+        compile_busy = false;
+        compile_idle.notify_all();
+    }
+}
+
+void KNCRuntime::request_compile(knc_translated_block_t* block) {
+    {
+        std::lock_guard<std::mutex> lock(compile_mutex);
+        if (!compile_thread.joinable() || compile_stop) {
+            return;
+        }
+        compile_queue.push_back(block);
+    }
+    compile_ready.notify_one();
+}
+
+void KNCRuntime::drain_compile_queue() {
+    // Drop what has not started and wait out the block being compiled
+    std::unique_lock<std::mutex> lock(compile_mutex);
+    compile_queue.clear();
+    compile_idle.wait(lock, [this] { return !compile_busy; });
+}
+
+knc_error_t KNCRuntime::execute_instruction(knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+    // RIP points at the next instruction while the handler runs, as on hardware;
+    // control transfers overwrite it
+    core.registers.rip = inst.address + inst.length;
+    return inst.handler(*this, core, inst);
+}
+
+// ---------------------------------------------------------------------------
+// Interpreter handlers
+//
+// Each predecoded instruction carries a pointer to one of these; they operate
+// purely on the decoded fields and never look at the raw instruction bytes.
+// ---------------------------------------------------------------------------
+
+struct KNCInterpreterOps {
+    static uint64_t size_mask(uint8_t size) {
+        return (size >= 8) ? ~0ULL : ((1ULL << (size * 8)) - 1);
+    }
+    
+    static uint64_t sign_bit(uint8_t size) {
+        return 1ULL << (size * 8 - 1);
+    }
+    
+    static bool uses_vsib(const knc_decoded_instruction_t& inst) {
+        return inst.op == KNC_OP_VGATHERDPS || inst.op == KNC_OP_VSCATTERDPS ||
+               inst.op == KNC_OP_VGATHERPFDPS || inst.op == KNC_OP_VSCATTERPFDPS;
+    }
+    
+    static uint64_t effective_address(const knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        const knc_memory_operand_t& mem = inst.memory;
+        uint64_t address = static_cast<int64_t>(mem.displacement);
+        if (mem.base == KNC_REG_RIP) {
+            address += core.registers.rip;  // Already the next instruction
+        } else if (mem.base != KNC_REG_NONE) {
+            address += core.registers.gpr[mem.base];
+        }
+        // Gathers, scatters and their prefetches use the index as a vector register (VSIB)
+        if (mem.index != KNC_REG_NONE && !uses_vsib(inst)) {
+            address += core.registers.gpr[mem.index] * mem.scale;
+        }
+        return address;
+    }
+    
+    static void write_gpr(knc_core_state_t& core, uint8_t reg, uint64_t value, uint8_t size) {
+        uint64_t& target = core.registers.gpr[reg];
+        if (size == 4) {
+            target = static_cast<uint32_t>(value);  // 32-bit writes zero-extend
+        } else if (size == 8) {
+            target = value;
+        } else {
+            uint64_t mask = size_mask(size);
+            target = (target & ~mask) | (value & mask);
+        }
+    }
+    
+    // Register operands of inst; byte registers 4-7 are AH-BH when it has no REX prefix
+    static bool is_high_byte(const knc_decoded_instruction_t& inst, uint8_t reg, uint8_t size) {
+        return size == 1 && (inst.flags & KNC_DECODE_HIGH_BYTE) && reg >= 4 && reg < 8;
+    }
+    
+    static uint64_t read_reg(const knc_core_state_t& core, const knc_decoded_instruction_t& inst,
+                             uint8_t reg, uint8_t size) {
+        if (is_high_byte(inst, reg, size)) {
+            return (core.registers.gpr[reg - 4] >> 8) & 0xFF;
+        }
+        return core.registers.gpr[reg] & size_mask(size);
+    }
+    
+    static void write_reg(knc_core_state_t& core, const knc_decoded_instruction_t& inst,
+                          uint8_t reg, uint64_t value, uint8_t size) {
+        if (is_high_byte(inst, reg, size)) {
+            uint64_t& target = core.registers.gpr[reg - 4];
+            target = (target & ~0xFF00ULL) | ((value & 0xFF) << 8);
+            return;
+        }
+        write_gpr(core, reg, value, size);
+    }
+    
+    static knc_error_t read_dst(KNCRuntime& rt, const knc_core_state_t& core,
+                                const knc_decoded_instruction_t& inst, uint64_t& value) {
+        value = 0;
+        if (inst.flags & KNC_DECODE_MEM_DST) {
+            return rt.read_memory(core, effective_address(core, inst), &value, inst.operand_size);
+        }
+        value = read_reg(core, inst, inst.dst, inst.operand_size);
+        return KNC_SUCCESS;
+    }
+    
+    static knc_error_t write_dst(KNCRuntime& rt, knc_core_state_t& core,
+                                 const knc_decoded_instruction_t& inst, uint64_t value) {
+        if (inst.flags & KNC_DECODE_MEM_DST) {
+            return rt.write_memory(core, effective_address(core, inst), &value, inst.operand_size);
+        }
+        write_reg(core, inst, inst.dst, value, inst.operand_size);
+        return KNC_SUCCESS;
+    }
+    
+    // The register or memory source, read as size bytes
+    static knc_error_t read_rm_src(KNCRuntime& rt, const knc_core_state_t& core,
+                                   const knc_decoded_instruction_t& inst, uint8_t size, uint64_t& value) {
+        value = 0;
+        if (inst.flags & KNC_DECODE_MEM_SRC) {
+            return rt.read_memory(core, effective_address(core, inst), &value, size);
+        }
+        value = read_reg(core, inst, inst.src, size);
+        return KNC_SUCCESS;
+    }
+    
+    static knc_error_t read_src(KNCRuntime& rt, const knc_core_state_t& core,
+                                const knc_decoded_instruction_t& inst, uint64_t& value) {
+        if ((inst.flags & (KNC_DECODE_SRC_IMM | KNC_DECODE_MEM_SRC)) == KNC_DECODE_SRC_IMM &&
+            inst.op != KNC_OP_IMUL) {
+            value = static_cast<uint64_t>(inst.immediate) & size_mask(inst.operand_size);
+            return KNC_SUCCESS;
+        }
+        return read_rm_src(rt, core, inst, inst.operand_size, value);
+    }
+    
+    static void set_result_flags(knc_core_state_t& core, uint64_t result, uint8_t size,
+                                 bool carry, bool overflow) {
+        uint64_t flags = core.registers.rflags &
+            ~(KNC_RFLAGS_CF | KNC_RFLAGS_PF | KNC_RFLAGS_ZF | KNC_RFLAGS_SF | KNC_RFLAGS_OF);
+        result &= size_mask(size);
+        if (carry) flags |= KNC_RFLAGS_CF;
+        if (overflow) flags |= KNC_RFLAGS_OF;
+        if (result == 0) flags |= KNC_RFLAGS_ZF;
+        if (result & sign_bit(size)) flags |= KNC_RFLAGS_SF;
+        if (!__builtin_parity(static_cast<uint32_t>(result & 0xFF))) flags |= KNC_RFLAGS_PF;
+        core.registers.rflags = flags;
+    }
+    
+    // carry_in is ADC's carry and SBB's borrow
+    static uint64_t add_with_flags(knc_core_state_t& core, uint64_t a, uint64_t b, uint8_t size,
+                                   bool carry_in = false) {
+        uint64_t mask = size_mask(size);
+        uint64_t result = (a + b + carry_in) & mask;
+        bool carry = carry_in ? result <= (a & mask) : result < (a & mask);
+        set_result_flags(core, result, size, carry, ((a ^ result) & (b ^ result) & sign_bit(size)) != 0);
+        return result;
+    }
+    
+    static uint64_t sub_with_flags(knc_core_state_t& core, uint64_t a, uint64_t b, uint8_t size,
+                                   bool carry_in = false) {
+        uint64_t mask = size_mask(size);
+        uint64_t result = (a - b - carry_in) & mask;
+        bool carry = carry_in ? (a & mask) <= (b & mask) : (a & mask) < (b & mask);
+        set_result_flags(core, result, size, carry, ((a ^ b) & (a ^ result) & sign_bit(size)) != 0);
+        return result;
+    }
+    
+    static bool condition_holds(uint64_t rflags, uint8_t condition) {
+        bool cf = rflags & KNC_RFLAGS_CF;
+        bool zf = rflags & KNC_RFLAGS_ZF;
+        bool sf = rflags & KNC_RFLAGS_SF;
+        bool of = rflags & KNC_RFLAGS_OF;
+        bool pf = rflags & KNC_RFLAGS_PF;
+        bool result;
+        
+        switch (condition >> 1) {
+            case 0: result = of; break;                 // O
+            case 1: result = cf; break;                 // B
+            case 2: result = zf; break;                 // E
+            case 3: result = cf || zf; break;           // BE
+            case 4: result = sf; break;                 // S
+            case 5: result = pf; break;                 // P
+            case 6: result = sf != of; break;           // L
+            default: result = zf || (sf != of); break;  // LE
+        }
+        return (condition & 1) ? !result : result;
+    }
+    
+    static knc_error_t push(KNCRuntime& rt, knc_core_state_t& core, uint64_t value) {
+        uint64_t rsp = core.registers.gpr[KNC_REG_RSP] - 8;
+        knc_error_t result = rt.write_memory(core, rsp, &value, 8);
+        if (result == KNC_SUCCESS) {
+            core.registers.gpr[KNC_REG_RSP] = rsp;
+        }
+        return result;
+    }
+    
+    static knc_error_t pop(KNCRuntime& rt, knc_core_state_t& core, uint64_t& value) {
+        uint64_t rsp = core.registers.gpr[KNC_REG_RSP];
+        knc_error_t result = rt.read_memory(core, rsp, &value, 8);
+        if (result == KNC_SUCCESS) {
+            core.registers.gpr[KNC_REG_RSP] = rsp + 8;
+        }
+        return result;
+    }
+    
+    // --- System and no-op instructions ---
+    
+    static knc_error_t exec_nop(KNCRuntime&, knc_core_state_t&, const knc_decoded_instruction_t&) {
+        return KNC_SUCCESS;
+    }
+    
+    static knc_error_t exec_unknown(KNCRuntime&, knc_core_state_t&, const knc_decoded_instruction_t&) {
+        return KNC_ERROR_INVALID_INSTRUCTION;  // Only its length was decoded
+    }
+    
+    static knc_error_t exec_pause(KNCRuntime&, knc_core_state_t& core, const knc_decoded_instruction_t&) {
+        // Spin-wait hint - the scheduler hands the host worker to another context
+        core.yield_requested = true;
+        return KNC_SUCCESS;
+    }
+    
+    static knc_error_t exec_hlt(KNCRuntime&, knc_core_state_t& core, const knc_decoded_instruction_t&) {
+        core.is_halted = true;
+        return KNC_SUCCESS;
+    }
+    
+    static knc_error_t exec_syscall(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t&) {
+        core.registers.gpr[KNC_REG_RCX] = core.registers.rip;
+        core.registers.gpr[KNC_REG_R11] = core.registers.rflags;
+        return rt.handle_system_call(core, static_cast<knc_syscall_type_t>(core.registers.gpr[KNC_REG_RAX]));
+    }
+    
+    // --- Scalar integer instructions ---
+    
+    static knc_error_t exec_mov(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        uint64_t value;
+        knc_error_t result = (inst.flags & KNC_DECODE_SRC_IMM)
+            ? (value = static_cast<uint64_t>(inst.immediate), KNC_SUCCESS)
+            : read_src(rt, core, inst, value);
+        if (result != KNC_SUCCESS) {
+            return result;
+        }
+        return write_dst(rt, core, inst, value);
+    }
+    
+    static knc_error_t exec_lea(KNCRuntime&, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        write_gpr(core, inst.dst, effective_address(core, inst), inst.operand_size);
+        return KNC_SUCCESS;
+    }
+    
+    template <knc_exec_op_t OP>
+    static knc_error_t exec_alu(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        uint64_t a, b;
+        knc_error_t result = read_src(rt, core, inst, b);
+        if (result != KNC_SUCCESS) {
+            return result;
+        }
+        bool locked = (OP != KNC_OP_CMP && OP != KNC_OP_TEST) && is_locked_rmw(inst);
+        result = locked ? guest_atomic(rt, core, inst, a, b) : read_dst(rt, core, inst, a);
+        if (result != KNC_SUCCESS) {
+            return result;
+        }
+        a &= size_mask(inst.operand_size);
+        
+        uint64_t value;
+        bool carry_in = (core.registers.rflags & KNC_RFLAGS_CF) != 0;
+        switch (OP) {
+            case KNC_OP_ADD: value = add_with_flags(core, a, b, inst.operand_size); break;
+            case KNC_OP_ADC: value = add_with_flags(core, a, b, inst.operand_size, carry_in); break;
+            case KNC_OP_SBB: value = sub_with_flags(core, a, b, inst.operand_size, carry_in); break;
+            case KNC_OP_SUB:
+            case KNC_OP_CMP: value = sub_with_flags(core, a, b, inst.operand_size); break;
+            case KNC_OP_AND:
+            case KNC_OP_TEST: value = a & b; set_result_flags(core, value, inst.operand_size, false, false); break;
+            case KNC_OP_OR: value = a | b; set_result_flags(core, value, inst.operand_size, false, false); break;
+            default: value = a ^ b; set_result_flags(core, value, inst.operand_size, false, false); break;
+        }
+        
+        if (OP == KNC_OP_CMP || OP == KNC_OP_TEST || locked) {
+            return KNC_SUCCESS;
+        }
+        return write_dst(rt, core, inst, value);
+    }
+    
+    template <knc_exec_op_t OP>
+    static knc_error_t exec_incdec(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        uint64_t a;
+        bool locked = is_locked_rmw(inst);
+        knc_error_t result = locked ? guest_atomic(rt, core, inst, a, 1) : read_dst(rt, core, inst, a);
+        if (result != KNC_SUCCESS) {
+            return result;
+        }
+        a &= size_mask(inst.operand_size);
+        
+        // INC/DEC leave CF untouched
+        uint64_t carry = core.registers.rflags & KNC_RFLAGS_CF;
+        uint64_t value = (OP == KNC_OP_INC) ? add_with_flags(core, a, 1, inst.operand_size)
+                                            : sub_with_flags(core, a, 1, inst.operand_size);
+        core.registers.rflags = (core.registers.rflags & ~KNC_RFLAGS_CF) | carry;
+        if (locked) {
+            return KNC_SUCCESS;
+        }
+        return write_dst(rt, core, inst, value);
+    }
+    
+    static knc_error_t exec_imul(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        uint64_t a, b;
+        knc_error_t result;
+        if (inst.flags & KNC_DECODE_SRC_IMM) {
+            result = read_src(rt, core, inst, a);  // imul r, r/m, imm
+            b = static_cast<uint64_t>(inst.immediate);
+        } else {
+            a = core.registers.gpr[inst.dst];
+            result = read_src(rt, core, inst, b);
+        }
+        if (result != KNC_SUCCESS) {
+            return result;
+        }
+        
+        uint32_t bits = inst.operand_size * 8;
+        int64_t sa = static_cast<int64_t>(a << (64 - bits)) >> (64 - bits);
+        int64_t sb = static_cast<int64_t>(b << (64 - bits)) >> (64 - bits);
+        __int128 full = static_cast<__int128>(sa) * sb;
+        uint64_t value = static_cast<uint64_t>(full) & size_mask(inst.operand_size);
+        int64_t truncated = static_cast<int64_t>(value << (64 - bits)) >> (64 - bits);
+        bool overflow = (static_cast<__int128>(truncated) != full);
+        
+        set_result_flags(core, value, inst.operand_size, overflow, overflow);
+        write_gpr(core, inst.dst, value, inst.operand_size);
+        return KNC_SUCCESS;
+    }
+    
+    template <knc_exec_op_t OP>
+    static knc_error_t exec_shift(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        uint64_t a;
+        knc_error_t result = read_dst(rt, core, inst, a);
+        if (result != KNC_SUCCESS) {
+            return result;
+        }
+        
+        uint32_t bits = inst.operand_size * 8;
+        uint64_t raw_count = (inst.flags & KNC_DECODE_SRC_IMM) ? static_cast<uint64_t>(inst.immediate)
+                                                               : core.registers.gpr[inst.src];
+        uint32_t count = static_cast<uint32_t>(raw_count) & ((bits == 64) ? 0x3F : 0x1F);
+        if (count == 0) {
+            return KNC_SUCCESS;  // Flags unchanged
+        }
+        
+        uint64_t value;
+        bool carry;
+        bool overflow = false;
+        if (OP == KNC_OP_ROL || OP == KNC_OP_ROR) {
+            // Rotates only touch CF and OF
+            uint32_t rotate = count % bits;
+            uint64_t mask = size_mask(inst.operand_size);
+            if (rotate == 0) {
+                value = a;
+            } else if (OP == KNC_OP_ROL) {
+                value = ((a << rotate) | (a >> (bits - rotate))) & mask;
+            } else {
+                value = ((a >> rotate) | (a << (bits - rotate))) & mask;
+            }
+            bool msb = (value & sign_bit(inst.operand_size)) != 0;
+            if (OP == KNC_OP_ROL) {
+                carry = value & 1;
+                overflow = msb != carry;
+            } else {
+                carry = msb;
+                overflow = msb != ((value >> (bits - 2)) & 1);
+            }
+            uint64_t flags = core.registers.rflags & ~(KNC_RFLAGS_CF | KNC_RFLAGS_OF);
+            core.registers.rflags = flags | (carry ? KNC_RFLAGS_CF : 0) | (overflow ? KNC_RFLAGS_OF : 0);
+            return write_dst(rt, core, inst, value);
+        }
+        if (OP == KNC_OP_SHL) {
+            // Counts past the operand width leave CF undefined; report it clear
+            carry = (count <= bits) && ((a >> (bits - count)) & 1);
+            value = (a << count) & size_mask(inst.operand_size);
+            overflow = ((value & sign_bit(inst.operand_size)) != 0) != carry;
+        } else if (OP == KNC_OP_SHR) {
+            carry = (a >> (count - 1)) & 1;
+            value = a >> count;
+            overflow = (a & sign_bit(inst.operand_size)) != 0;
+        } else {
+            int64_t sa = static_cast<int64_t>(a << (64 - bits)) >> (64 - bits);
+            carry = (sa >> (count - 1)) & 1;
+            value = static_cast<uint64_t>(sa >> count) & size_mask(inst.operand_size);
+        }
+        
+        set_result_flags(core, value, inst.operand_size, carry, overflow);
+        return write_dst(rt, core, inst, value);
+    }
+    
+    template <knc_exec_op_t OP>
+    static knc_error_t exec_notneg(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        uint64_t a;
+        bool locked = is_locked_rmw(inst);
+        knc_error_t result = locked ? guest_atomic(rt, core, inst, a, 0) : read_dst(rt, core, inst, a);
+        if (result != KNC_SUCCESS) {
+            return result;
+        }
+        a &= size_mask(inst.operand_size);
+        uint64_t value = (OP == KNC_OP_NOT) ? ~a : sub_with_flags(core, 0, a, inst.operand_size);
+        if (locked) {
+            return KNC_SUCCESS;
+        }
+        return write_dst(rt, core, inst, value);
+    }
+    
+    template <knc_exec_op_t OP>
+    static knc_error_t exec_muldiv(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        uint64_t b;
+        knc_error_t result = read_src(rt, core, inst, b);
+        if (result != KNC_SUCCESS) {
+            return result;
+        }
+        
+        // Byte forms work on AX; the others on rDX:rAX
+        uint8_t size = inst.operand_size;
+        uint32_t bits = size * 8;
+        uint64_t mask = size_mask(size);
+        uint64_t& rax = core.registers.gpr[KNC_REG_RAX];
+        uint64_t& rdx = core.registers.gpr[KNC_REG_RDX];
+        uint64_t low = rax & mask;
+        uint64_t high = (size == 1) ? (rax >> 8) & 0xFF : rdx & mask;
+        unsigned __int128 wide = (static_cast<unsigned __int128>(high) << bits) | low;
+        
+        uint64_t quotient, remainder;
+        if (OP == KNC_OP_MUL || OP == KNC_OP_IMUL_WIDE) {
+            unsigned __int128 product;
+            bool overflow;
+            if (OP == KNC_OP_MUL) {
+                product = static_cast<unsigned __int128>(low) * b;
+                overflow = (product >> bits) != 0;
+            } else {
+                int64_t sa = static_cast<int64_t>(low << (64 - bits)) >> (64 - bits);
+                int64_t sb = static_cast<int64_t>(b << (64 - bits)) >> (64 - bits);
+                __int128 full = static_cast<__int128>(sa) * sb;
+                int64_t truncated = static_cast<int64_t>(static_cast<uint64_t>(full) << (64 - bits)) >> (64 - bits);
+                product = static_cast<unsigned __int128>(full);
+                overflow = (static_cast<__int128>(truncated) != full);
+            }
+            quotient = static_cast<uint64_t>(product) & mask;
+            remainder = static_cast<uint64_t>(product >> bits) & mask;
+            set_result_flags(core, quotient, size, overflow, overflow);
+        } else {
+            // Division by zero and quotients that do not fit both raise #DE
+            if (b == 0) {
+                return KNC_ERROR_DIVIDE_BY_ZERO;
+            }
+            if (OP == KNC_OP_DIV) {
+                unsigned __int128 q = wide / b;
+                if (q > mask) {
+                    return KNC_ERROR_DIVIDE_BY_ZERO;
+                }
+                quotient = static_cast<uint64_t>(q);
+                remainder = static_cast<uint64_t>(wide % b);
+            } else {
+                uint32_t shift = 128 - 2 * bits;
+                __int128 dividend = static_cast<__int128>(wide << shift) >> shift;
+                int64_t divisor = static_cast<int64_t>(b << (64 - bits)) >> (64 - bits);
+                __int128 limit = static_cast<__int128>(1) << (bits - 1);
+                if (divisor == -1 && static_cast<unsigned __int128>(dividend) == static_cast<unsigned __int128>(1) << 127) {
+                    return KNC_ERROR_DIVIDE_BY_ZERO;  // The one 128-bit quotient that overflows the host
+                }
+                __int128 q = dividend / divisor;
+                if (q >= limit || q < -limit) {
+                    return KNC_ERROR_DIVIDE_BY_ZERO;
+                }
+                quotient = static_cast<uint64_t>(q) & mask;
+                remainder = static_cast<uint64_t>(dividend % divisor) & mask;
+            }
+        }
+        
+        if (size == 1) {
+            write_gpr(core, KNC_REG_RAX, (remainder << 8) | quotient, 2);
+        } else {
+            write_gpr(core, KNC_REG_RAX, quotient, size);
+            write_gpr(core, KNC_REG_RDX, remainder, size);
+        }
+        return KNC_SUCCESS;
+    }
+    
+    template <bool SIGNED>
+    static knc_error_t exec_movx(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        uint8_t size = static_cast<uint8_t>(inst.immediate);
+        uint64_t value;
+        knc_error_t result = read_rm_src(rt, core, inst, size, value);
+        if (result != KNC_SUCCESS) {
+            return result;
+        }
+        if (SIGNED) {
+            uint32_t shift = 64 - size * 8;
+            value = static_cast<uint64_t>(static_cast<int64_t>(value << shift) >> shift);
+        }
+        write_gpr(core, inst.dst, value, inst.operand_size);
+        return KNC_SUCCESS;
+    }
+    
+    static knc_error_t exec_cmov(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        // The source is read whether or not the move happens, as on hardware
+        uint64_t value;
+        knc_error_t result = read_src(rt, core, inst, value);
+        if (result != KNC_SUCCESS) {
+            return result;
+        }
+        if (!condition_holds(core.registers.rflags, inst.condition)) {
+            value = core.registers.gpr[inst.dst];  // A 32-bit CMOV still zero-extends
+        }
+        write_gpr(core, inst.dst, value, inst.operand_size);
+        return KNC_SUCCESS;
+    }
+    
+    static knc_error_t exec_setcc(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        return write_dst(rt, core, inst, condition_holds(core.registers.rflags, inst.condition) ? 1 : 0);
+    }
+    
+    static knc_error_t exec_cbw(KNCRuntime&, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        uint32_t shift = 64 - inst.operand_size * 4;  // Sign-extend the low half of rAX
+        uint64_t value = static_cast<uint64_t>(static_cast<int64_t>(core.registers.gpr[KNC_REG_RAX] << shift) >> shift);
+        write_gpr(core, KNC_REG_RAX, value, inst.operand_size);
+        return KNC_SUCCESS;
+    }
+    
+    static knc_error_t exec_cwd(KNCRuntime&, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        bool negative = (core.registers.gpr[KNC_REG_RAX] & sign_bit(inst.operand_size)) != 0;
+        write_gpr(core, KNC_REG_RDX, negative ? ~0ULL : 0, inst.operand_size);
+        return KNC_SUCCESS;
+    }
+    
+    // Memory value a locked read-modify-write leaves behind current; expected
+    // is CMPXCHG's comparand and carry ADC's carry or SBB's borrow
+    static uint64_t locked_result(knc_exec_op_t op, uint64_t current, uint64_t value, uint64_t expected,
+                                  bool carry) {
+        switch (op) {
+            case KNC_OP_XCHG: return value;
+            case KNC_OP_XADD:
+            case KNC_OP_ADD:
+            case KNC_OP_INC: return current + value;
+            case KNC_OP_ADC: return current + value + carry;
+            case KNC_OP_SUB:
+            case KNC_OP_DEC: return current - value;
+            case KNC_OP_SBB: return current - value - carry;
+            case KNC_OP_AND: return current & value;
+            case KNC_OP_OR: return current | value;
+            case KNC_OP_XOR: return current ^ value;
+            case KNC_OP_NOT: return ~current;
+            case KNC_OP_NEG: return 0 - current;
+            default: return current == expected ? value : current;
+        }
+    }
+    
+    // XCHG, XADD, CMPXCHG and LOCK-prefixed read-modify-writes on memory run
+    // as the host's own locked instruction on the guest buffer, so they stay
+    // atomic between cores running on different host workers. Operations
+    // with no host fetch-op retry a compare-exchange until it succeeds.
+    template <typename T>
+    static uint64_t atomic_op(uint8_t* target, knc_exec_op_t op, uint64_t value, uint64_t expected, bool carry) {
+        T* location = reinterpret_cast<T*>(target);
+        T operand = static_cast<T>(value);
+        T current = static_cast<T>(expected);
+        switch (op) {
+            case KNC_OP_XCHG: return __atomic_exchange_n(location, operand, __ATOMIC_SEQ_CST);
+            case KNC_OP_XADD:
+            case KNC_OP_ADD:
+            case KNC_OP_INC: return __atomic_fetch_add(location, operand, __ATOMIC_SEQ_CST);
+            case KNC_OP_SUB:
+            case KNC_OP_DEC: return __atomic_fetch_sub(location, operand, __ATOMIC_SEQ_CST);
+            case KNC_OP_AND: return __atomic_fetch_and(location, operand, __ATOMIC_SEQ_CST);
+            case KNC_OP_OR: return __atomic_fetch_or(location, operand, __ATOMIC_SEQ_CST);
+            case KNC_OP_XOR: return __atomic_fetch_xor(location, operand, __ATOMIC_SEQ_CST);
+            case KNC_OP_ADC:
+            case KNC_OP_SBB:
+            case KNC_OP_NOT:
+            case KNC_OP_NEG:
+                // On failure current is reloaded, so the value returned (and
+                // the flags computed from it) is the one actually replaced
+                current = __atomic_load_n(location, __ATOMIC_RELAXED);
+                while (!__atomic_compare_exchange_n(location, &current,
+                                                    static_cast<T>(locked_result(op, current, value, 0, carry)),
+                                                    true, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+                }
+                return current;
+            default:
+                __atomic_compare_exchange_n(location, &current, operand, false,
+                                            __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+                return current;
+        }
+    }
+    
+    // Sets previous to the memory value before the operation; the operand
+    // must be writable. One straddling a page boundary has no host atomic to
+    // map to and runs under split_lock_mutex instead, as a split lock would
+    // lock the bus.
+    static knc_error_t guest_atomic(KNCRuntime& rt, const knc_core_state_t& core, const knc_decoded_instruction_t& inst,
+                                    uint64_t& previous, uint64_t value, uint64_t expected = 0) {
+        uint64_t address = effective_address(core, inst);
+        knc_exec_op_t op = static_cast<knc_exec_op_t>(inst.op);
+        bool carry = (core.registers.rflags & KNC_RFLAGS_CF) != 0;
+        uint8_t size = inst.operand_size;
+        uint64_t first = KNC_PAGE_SIZE_4K - (address & (KNC_PAGE_SIZE_4K - 1));
+        if (first < size) {
+            uint8_t* low = rt.tlb_lookup(core, address, first, true);
+            uint8_t* high = low ? rt.tlb_lookup(core, address + first, size - first, true) : nullptr;
+            if (!high) {
+                return KNC_ERROR_MEMORY_ACCESS;
+            }
+            std::lock_guard<std::mutex> guard(rt.split_lock_mutex);
+            uint64_t current = 0;
+            memcpy(&current, low, first);
+            memcpy(reinterpret_cast<uint8_t*>(&current) + first, high, size - first);
+            uint64_t replaced = locked_result(op, current, value, expected, carry);
+            memcpy(low, &replaced, first);
+            memcpy(high, reinterpret_cast<uint8_t*>(&replaced) + first, size - first);
+            previous = current;
+            rt.note_atomic_access(core.core_id, address);
+            return KNC_SUCCESS;
+        }
+        
+        uint8_t* target = rt.tlb_lookup(core, address, size, true);
+        if (!target) {
+            return KNC_ERROR_MEMORY_ACCESS;
+        }
+        switch (size) {
+            case 1: previous = atomic_op<uint8_t>(target, op, value, expected, carry); break;
+            case 2: previous = atomic_op<uint16_t>(target, op, value, expected, carry); break;
+            case 4: previous = atomic_op<uint32_t>(target, op, value, expected, carry); break;
+            default: previous = atomic_op<uint64_t>(target, op, value, expected, carry); break;
+        }
+        rt.note_atomic_access(core.core_id, address);
+        return KNC_SUCCESS;
+    }
+    
+    static bool is_locked_rmw(const knc_decoded_instruction_t& inst) {
+        return (inst.flags & (KNC_DECODE_LOCK | KNC_DECODE_MEM_DST)) == (KNC_DECODE_LOCK | KNC_DECODE_MEM_DST);
+    }
+    
+    static knc_error_t exec_xchg(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        uint64_t b = core.registers.gpr[inst.src];
+        if (inst.flags & KNC_DECODE_MEM_DST) {
+            uint64_t a;
+            knc_error_t result = guest_atomic(rt, core, inst, a, b);
+            if (result == KNC_SUCCESS) {
+                write_gpr(core, inst.src, a, inst.operand_size);
+            }
+            return result;
+        }
+        
+        uint64_t a;
+        knc_error_t result = read_dst(rt, core, inst, a);
+        if (result != KNC_SUCCESS) {
+            return result;
+        }
+        result = write_dst(rt, core, inst, b);
+        if (result == KNC_SUCCESS) {
+            write_gpr(core, inst.src, a, inst.operand_size);
+        }
+        return result;
+    }
+    
+    static knc_error_t exec_xadd(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        uint64_t b = core.registers.gpr[inst.src];
+        if (inst.flags & KNC_DECODE_MEM_DST) {
+            uint64_t a;
+            knc_error_t result = guest_atomic(rt, core, inst, a, b);
+            if (result != KNC_SUCCESS) {
+                return result;
+            }
+            a &= size_mask(inst.operand_size);
+            add_with_flags(core, a, b, inst.operand_size);
+            write_gpr(core, inst.src, a, inst.operand_size);
+            return KNC_SUCCESS;
+        }
+        
+        uint64_t a;
+        knc_error_t result = read_dst(rt, core, inst, a);
+        if (result != KNC_SUCCESS) {
+            return result;
+        }
+        uint64_t sum = add_with_flags(core, a, b, inst.operand_size);
+        result = write_dst(rt, core, inst, sum);
+        if (result == KNC_SUCCESS) {
+            write_gpr(core, inst.src, a, inst.operand_size);
+        }
+        return result;
+    }
+    
+    static knc_error_t exec_cmpxchg(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        uint64_t expected = core.registers.gpr[KNC_REG_RAX] & size_mask(inst.operand_size);
+        uint64_t current;
+        knc_error_t result;
+        if (inst.flags & KNC_DECODE_MEM_DST) {
+            result = guest_atomic(rt, core, inst, current, core.registers.gpr[inst.src], expected);
+            current &= size_mask(inst.operand_size);
+        } else {
+            result = read_dst(rt, core, inst, current);
+        }
+        if (result != KNC_SUCCESS) {
+            return result;
+        }
+        
+        sub_with_flags(core, expected, current, inst.operand_size);
+        if (current == expected) {
+            if (inst.flags & KNC_DECODE_MEM_DST) {
+                return KNC_SUCCESS;  // Already stored
+            }
+            return write_dst(rt, core, inst, core.registers.gpr[inst.src]);
+        }
+        write_gpr(core, KNC_REG_RAX, current, inst.operand_size);
+        return KNC_SUCCESS;
+    }
+    
+    static knc_error_t exec_push(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        return push(rt, core, core.registers.gpr[inst.src]);
+    }
+    
+    static knc_error_t exec_pop(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        uint64_t value;
+        knc_error_t result = pop(rt, core, value);
+        if (result == KNC_SUCCESS) {
+            core.registers.gpr[inst.dst] = value;
+        }
+        return result;
+    }
+    
+    static knc_error_t exec_leave(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t&) {
+        uint64_t rsp = core.registers.gpr[KNC_REG_RSP];
+        core.registers.gpr[KNC_REG_RSP] = core.registers.gpr[KNC_REG_RBP];
+        uint64_t value;
+        knc_error_t result = pop(rt, core, value);
+        if (result != KNC_SUCCESS) {
+            core.registers.gpr[KNC_REG_RSP] = rsp;
+            return result;
+        }
+        core.registers.gpr[KNC_REG_RBP] = value;
+        return KNC_SUCCESS;
+    }
+    
+    // --- Control transfer ---
+    
+    static knc_error_t exec_jmp(KNCRuntime&, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        core.registers.rip = static_cast<uint64_t>(inst.immediate);
+        return KNC_SUCCESS;
+    }
+    
+    static knc_error_t exec_jmp_indirect(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        uint64_t target;
+        knc_error_t result = read_src(rt, core, inst, target);
+        if (result == KNC_SUCCESS) {
+            core.registers.rip = target;
+        }
+        return result;
+    }
+    
+    static knc_error_t exec_jcc(KNCRuntime&, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        if (condition_holds(core.registers.rflags, inst.condition)) {
+            core.registers.rip = static_cast<uint64_t>(inst.immediate);
+        }
+        return KNC_SUCCESS;
+    }
+    
+    static knc_error_t exec_call(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        knc_error_t result = push(rt, core, core.registers.rip);
+        if (result == KNC_SUCCESS) {
+            core.registers.rip = static_cast<uint64_t>(inst.immediate);
+        }
+        return result;
+    }
+    
+    static knc_error_t exec_call_indirect(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        uint64_t target;
+        knc_error_t result = read_src(rt, core, inst, target);
+        if (result == KNC_SUCCESS) {
+            result = push(rt, core, core.registers.rip);
+        }
+        if (result == KNC_SUCCESS) {
+            core.registers.rip = target;
+        }
+        return result;
+    }
+    
+    static knc_error_t exec_ret(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t&) {
+        // Returning from the entry frame ends the program on this core
+        if (core.registers.gpr[KNC_REG_RSP] >= core.stack_top) {
+            core.is_halted = true;
+            return KNC_SUCCESS;
+        }
+        uint64_t target;
+        knc_error_t result = pop(rt, core, target);
+        if (result == KNC_SUCCESS) {
+            core.registers.rip = target;
+        }
+        return result;
+    }
+    
+    // --- 512-bit vector instructions ---
+    
+    static knc_error_t load_vector_source(KNCRuntime& rt, const knc_core_state_t& core,
+                                          const knc_decoded_instruction_t& inst, knc_vector_t& value) {
+        if (!(inst.flags & KNC_DECODE_MEM_SRC)) {
+            value = core.registers.zmm[inst.src2];
+            if (inst.conversion != KNC_CONV_NONE) {
+                rt.vector_ops->swizzle_epi32(value, value, inst.conversion);
+            }
+            return KNC_SUCCESS;
+        }
+        if (inst.conversion != KNC_CONV_NONE) {
+            return load_converted(rt, core, inst, value);
+        }
+        if (inst.flags & KNC_DECODE_BROADCAST) {
+            int32_t element = 0;
+            knc_error_t result = rt.read_memory(core, effective_address(core, inst), &element, sizeof(element));
+            broadcast_element(value, element);
+            return result;
+        }
+        return rt.read_vector_memory(core, effective_address(core, inst), value);
+    }
+    
+    // KNC memory source: broadcast, or sixteen elements of a narrower format
+    // up-converted to 32-bit lanes
+    static knc_error_t load_converted(KNCRuntime& rt, const knc_core_state_t& core,
+                                      const knc_decoded_instruction_t& inst, knc_vector_t& value) {
+        uint64_t address = effective_address(core, inst);
+        knc_error_t result;
+        if (inst.conversion == KNC_CONV_1TO16) {
+            int32_t element = 0;
+            result = rt.read_memory(core, address, &element, sizeof(element));
+            broadcast_element(value, element);
+        } else if (inst.conversion == KNC_CONV_4TO16) {
+            result = rt.read_memory(core, address, value.i32, 4 * sizeof(int32_t));
+            for (int lane = 4; lane < KNC_VECTOR_LANES; lane++) {
+                value.i32[lane] = value.i32[lane & 3];
+            }
+        } else {
+            knc_vector_t raw;
+            result = rt.read_memory(core, address, &raw,
+                                    knc_conversion_element_size(inst.conversion) * KNC_VECTOR_LANES);
+            rt.vector_ops->upconvert(value, &raw, inst.conversion, (inst.flags & KNC_DECODE_FLOAT) != 0);
+        }
+        return result;
+    }
+    
+    static void broadcast_element(knc_vector_t& value, int32_t element) {
+        for (int lane = 0; lane < KNC_VECTOR_LANES; lane++) {
+            value.i32[lane] = element;
+        }
+    }
+    
+    static void write_vector_result(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst,
+                                    const knc_vector_t& value) {
+        knc_vector_t& dst = core.registers.zmm[inst.dst];
+        if (inst.mask == 0) {
+            dst = value;
+        } else {
+            rt.vector_ops->mask_mov_epi32(dst, value, core.registers.k[inst.mask],
+                                          (inst.flags & KNC_DECODE_ZEROING) != 0);
+        }
+    }
+    
+    static knc_vector_binary_fn_t vector_kernel(const knc_vector_ops_t& ops, knc_exec_op_t op) {
+        switch (op) {
+            case KNC_OP_VPADDD: return ops.add_epi32;
+            case KNC_OP_VPSUBD: return ops.sub_epi32;
+            case KNC_OP_VPMULLD: return ops.mullo_epi32;
+            case KNC_OP_VPANDD: return ops.and_epi32;
+            case KNC_OP_VPORD: return ops.or_epi32;
+            case KNC_OP_VPXORD: return ops.xor_epi32;
+            case KNC_OP_VPERMD: return ops.permutexvar_epi32;
+            case KNC_OP_VADDPS: return ops.add_ps;
+            case KNC_OP_VSUBPS: return ops.sub_ps;
+            case KNC_OP_VMULPS: return ops.mul_ps;
+            case KNC_OP_VDIVPS: return ops.div_ps;
+            case KNC_OP_VMAXPS: return ops.max_ps;
+            case KNC_OP_VMINPS: return ops.min_ps;
+            default: return nullptr;
+        }
+    }
+    
+    static knc_vector_unary_fn_t vector_unary_kernel(const knc_vector_ops_t& ops, knc_exec_op_t op) {
+        switch (op) {
+            case KNC_OP_VPCONFLICTD: return ops.conflict_epi32;
+            case KNC_OP_VPLZCNTD: return ops.lzcnt_epi32;
+            case KNC_OP_VRCP28PS: return ops.rcp28_ps;
+            case KNC_OP_VRSQRT28PS: return ops.rsqrt28_ps;
+            case KNC_OP_VEXP2PS: return ops.exp2_ps;
+            default: return nullptr;
+        }
+    }
+    
+    template <knc_exec_op_t OP>
+    static knc_error_t exec_vector(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        knc_vector_t b;
+        knc_error_t result = load_vector_source(rt, core, inst, b);
+        if (result != KNC_SUCCESS) {
+            return result;
+        }
+        
+        // Kernels come from the host vector backend chosen at initialize()
+        const knc_vector_t& a = core.registers.zmm[inst.src];
+        knc_vector_t value;
+        if (OP == KNC_OP_VFMADD231PS) {
+            rt.vector_ops->fmadd_ps(value, a, b, core.registers.zmm[inst.dst]);
+        } else if (OP == KNC_OP_VPERMT2D) {
+            rt.vector_ops->permutex2var_epi32(value, core.registers.zmm[inst.dst], a, b);  // a holds the indices
+        } else if (OP == KNC_OP_VLOAD) {
+            value = b;
+        } else {
+            vector_kernel(*rt.vector_ops, OP)(value, a, b);
+        }
+        
+        write_vector_result(rt, core, inst, value);
+        return KNC_SUCCESS;
+    }
+    
+    template <knc_exec_op_t OP>
+    static knc_error_t exec_vector_unary(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        knc_vector_t source;
+        knc_error_t result = load_vector_source(rt, core, inst, source);
+        if (result != KNC_SUCCESS) {
+            return result;
+        }
+        knc_vector_t value;
+        vector_unary_kernel(*rt.vector_ops, OP)(value, source);
+        write_vector_result(rt, core, inst, value);
+        return KNC_SUCCESS;
+    }
+    
+    static knc_mask_t vector_mask(const knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        return inst.mask ? core.registers.k[inst.mask] : static_cast<knc_mask_t>(0xFFFF);
+    }
+    
+    static knc_error_t exec_vexpand(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        knc_mask_t mask = vector_mask(core, inst);
+        knc_vector_t source;
+        if (!(inst.flags & KNC_DECODE_MEM_SRC)) {
+            source = core.registers.zmm[inst.src2];
+        } else if (mask != 0) {
+            // Only the elements that are expanded are read
+            size_t bytes = __builtin_popcount(mask) * sizeof(int32_t);
+            knc_error_t result = rt.read_memory(core, effective_address(core, inst), &source, bytes);
+            if (result != KNC_SUCCESS) {
+                return result;
+            }
+        }
+        bool zeroing = inst.mask != 0 && (inst.flags & KNC_DECODE_ZEROING);
+        rt.vector_ops->expand_epi32(core.registers.zmm[inst.dst], source, mask, zeroing);
+        return KNC_SUCCESS;
+    }
+    
+    static knc_error_t exec_vcompress(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        knc_mask_t mask = vector_mask(core, inst);
+        const knc_vector_t& source = core.registers.zmm[inst.src];
+        if (!(inst.flags & KNC_DECODE_MEM_DST)) {
+            bool zeroing = inst.mask != 0 && (inst.flags & KNC_DECODE_ZEROING);
+            rt.vector_ops->compress_epi32(core.registers.zmm[inst.dst], source, mask, zeroing);
+            return KNC_SUCCESS;
+        }
+        
+        // Only the packed elements are written
+        if (mask == 0) {
+            return KNC_SUCCESS;
+        }
+        knc_vector_t packed;
+        rt.vector_ops->compress_epi32(packed, source, mask, true);
+        size_t bytes = __builtin_popcount(mask) * sizeof(int32_t);
+        return rt.write_memory(core, effective_address(core, inst), &packed, bytes);
+    }
+    
+    template <knc_exec_op_t OP>
+    static knc_error_t exec_vprefetch(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        const knc_vector_t& indices = core.registers.zmm[inst.memory.index];
+        uint64_t base = effective_address(core, inst);
+        knc_mask_t mask = core.registers.k[inst.mask];
+        
+        // A hint only: lanes without a valid translation are dropped, and
+        // neither the mask nor any register changes
+        for (int lane = 0; lane < KNC_VECTOR_LANES; lane++) {
+            if (!((mask >> lane) & 1)) {
+                continue;
+            }
+            uint64_t address = base + static_cast<int64_t>(indices.i32[lane]) * inst.memory.scale;
+            const uint8_t* host = rt.tlb_lookup(core, address, sizeof(int32_t), false);
+            if (!host) {
+                continue;
+            }
+            const int rw = (OP == KNC_OP_VSCATTERPFDPS) ? 1 : 0;
+            if (inst.condition == 0) {
+                __builtin_prefetch(host, rw, 3);  // Into L1
+            } else {
+                __builtin_prefetch(host, rw, 2);  // Into L2
+            }
+        }
+        return KNC_SUCCESS;
+    }
+    
+    static knc_error_t exec_vbroadcast(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        int32_t element = 0;
+        if (inst.flags & KNC_DECODE_MEM_SRC) {
+            uint32_t size = knc_conversion_element_size(inst.conversion);
+            knc_vector_t raw = {};
+            knc_error_t result = rt.read_memory(core, effective_address(core, inst), &raw, size);
+            if (result != KNC_SUCCESS) {
+                return result;
+            }
+            if (inst.conversion != KNC_CONV_NONE) {
+                rt.vector_ops->upconvert(raw, &raw, inst.conversion, (inst.flags & KNC_DECODE_FLOAT) != 0);
+            }
+            element = raw.i32[0];
+        } else {
+            element = core.registers.zmm[inst.src2].i32[0];
+        }
+        knc_vector_t value;
+        broadcast_element(value, element);
+        write_vector_result(rt, core, inst, value);
+        return KNC_SUCCESS;
+    }
+    
+    static knc_error_t exec_vstore(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        uint64_t address = effective_address(core, inst);
+        if (inst.conversion != KNC_CONV_NONE) {
+            return store_converted(rt, core, inst, address);
+        }
+        if (inst.mask == 0) {
+            return rt.write_vector_memory(core, address, core.registers.zmm[inst.src]);
+        }
+        return store_elements(rt, core, address, core.registers.zmm[inst.src], sizeof(int32_t),
+                              core.registers.k[inst.mask]);
+    }
+    
+    // KNC down-converting store: every lane is narrowed, and only the
+    // elements with a set mask bit are written
+    static knc_error_t store_converted(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst,
+                                       uint64_t address) {
+        uint32_t size = knc_conversion_element_size(inst.conversion);
+        knc_vector_t packed;
+        rt.vector_ops->downconvert(&packed, core.registers.zmm[inst.src], inst.conversion,
+                                   (inst.flags & KNC_DECODE_FLOAT) != 0);
+        if (inst.mask == 0) {
+            return rt.write_memory(core, address, &packed, size * KNC_VECTOR_LANES);
+        }
+        return store_elements(rt, core, address, packed, size, core.registers.k[inst.mask]);
+    }
+    
+    // Masked store of consecutive size-byte elements from address on. Bytes
+    // of masked-off elements are never touched, so they may lie on pages the
+    // guest cannot write and keep what other threads store there meanwhile.
+    static knc_error_t store_elements(KNCRuntime& rt, knc_core_state_t& core, uint64_t address,
+                                      const knc_vector_t& elements, uint32_t size, knc_mask_t mask) {
+        for (int lane = 0; lane < KNC_VECTOR_LANES; lane++) {
+            if (!((mask >> lane) & 1)) {
+                continue;
+            }
+            uint64_t element = address + lane * size;
+            uint8_t* host = rt.tlb_lookup(core, element, size, true);
+            if (host) {
+                memcpy(host, elements.u8 + lane * size, size);
+                continue;
+            }
+            knc_error_t result = rt.write_memory(core, element, elements.u8 + lane * size, size);
+            if (result != KNC_SUCCESS) {
+                return result;
+            }
+        }
+        return KNC_SUCCESS;
+    }
+    
+    // Lanes a KNC unpacking load or packing store moves, and the address of
+    // the first element. The low half covers the elements from address up to
+    // the next 64-byte boundary; the high half, given address + 64, the ones
+    // from that boundary on. Elements are consecutive in memory and go to or
+    // come from the lanes with a set mask bit, in order.
+    static knc_mask_t unpack_lanes(uint64_t address, uint32_t size, knc_mask_t mask, bool high, uint64_t& start) {
+        uint64_t line_start = high ? address - KNC_VECTOR_BYTES : address;
+        uint32_t to_boundary = KNC_VECTOR_LANES;  // Never reached when not element aligned
+        if (line_start % size == 0) {
+            to_boundary = std::min<uint32_t>(KNC_VECTOR_LANES,
+                                             (KNC_VECTOR_BYTES - line_start % KNC_VECTOR_BYTES) / size);
+        }
+        knc_mask_t rest = mask;
+        for (uint32_t i = 0; i < to_boundary && rest != 0; i++) {
+            rest &= static_cast<knc_mask_t>(rest - 1);  // Drop the lowest set lane
+        }
+        if (high) {
+            start = line_start + static_cast<uint64_t>(size) * to_boundary;
+            return rest;
+        }
+        start = address;
+        return static_cast<knc_mask_t>(mask & ~rest);
+    }
+    
+    template <bool HIGH>
+    static knc_error_t exec_vloadunpack(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        uint32_t size = knc_conversion_element_size(inst.conversion);
+        uint64_t start;
+        knc_mask_t lanes = unpack_lanes(effective_address(core, inst), size, vector_mask(core, inst), HIGH, start);
+        if (lanes == 0) {
+            return KNC_SUCCESS;
+        }
+        
+        knc_vector_t raw = {};
+        knc_error_t result = rt.read_memory(core, start, &raw, size * __builtin_popcount(lanes));
+        if (result != KNC_SUCCESS) {
+            return result;
+        }
+        if (inst.conversion != KNC_CONV_NONE) {
+            rt.vector_ops->upconvert(raw, &raw, inst.conversion, (inst.flags & KNC_DECODE_FLOAT) != 0);
+        }
+        rt.vector_ops->expand_epi32(core.registers.zmm[inst.dst], raw, lanes, false);
+        return KNC_SUCCESS;
+    }
+    
+    template <bool HIGH>
+    static knc_error_t exec_vpackstore(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        uint32_t size = knc_conversion_element_size(inst.conversion);
+        uint64_t start;
+        knc_mask_t lanes = unpack_lanes(effective_address(core, inst), size, vector_mask(core, inst), HIGH, start);
+        if (lanes == 0) {
+            return KNC_SUCCESS;
+        }
+        
+        knc_vector_t packed;
+        rt.vector_ops->compress_epi32(packed, core.registers.zmm[inst.src], lanes, true);
+        if (inst.conversion != KNC_CONV_NONE) {
+            rt.vector_ops->downconvert(&packed, packed, inst.conversion, (inst.flags & KNC_DECODE_FLOAT) != 0);
+        }
+        return rt.write_memory(core, start, &packed, size * __builtin_popcount(lanes));
+    }
+    
+    static bool compare_ps(float a, float b, uint8_t predicate) {
+        bool unordered = (a != a) || (b != b);
+        switch (predicate & 0x0F) {
+            case 0x0: return !unordered && a == b;      // EQ_OQ
+            case 0x1: return !unordered && a < b;       // LT_OS
+            case 0x2: return !unordered && a <= b;      // LE_OS
+            case 0x3: return unordered;                 // UNORD_Q
+            case 0x4: return unordered || a != b;       // NEQ_UQ
+            case 0x5: return unordered || !(a < b);     // NLT_US
+            case 0x6: return unordered || !(a <= b);    // NLE_US
+            case 0x7: return !unordered;                // ORD_Q
+            case 0x8: return unordered || a == b;       // EQ_UQ
+            case 0x9: return unordered || a < b;        // NGE_US
+            case 0xA: return unordered || a <= b;       // NGT_US
+            case 0xB: return false;                     // FALSE_OQ
+            case 0xC: return !unordered && a != b;      // NEQ_OQ
+            case 0xD: return !unordered && a >= b;      // GE_OS
+            case 0xE: return !unordered && a > b;       // GT_OS
+            default: return true;                       // TRUE_UQ
+        }
+    }
+    
+    static knc_error_t exec_vcmpps(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        knc_vector_t b;
+        knc_error_t result = load_vector_source(rt, core, inst, b);
+        if (result != KNC_SUCCESS) {
+            return result;
+        }
+        
+        const knc_vector_t& a = core.registers.zmm[inst.src];
+        knc_mask_t write_mask = inst.mask ? core.registers.k[inst.mask] : 0xFFFF;
+        knc_mask_t value = 0;
+        for (int lane = 0; lane < KNC_VECTOR_LANES; lane++) {
+            if (((write_mask >> lane) & 1) && compare_ps(a.f32[lane], b.f32[lane], inst.condition)) {
+                value |= static_cast<knc_mask_t>(1 << lane);
+            }
+        }
+        core.registers.k[inst.dst] = value;
+        return KNC_SUCCESS;
     }
     
-    // Wait for all cores to finish
-    for (auto& thread : core_threads) {
-        if (thread.joinable()) {
-            thread.join();
+    // Guest addresses of the active elements of a gather or scatter; returns
+    // the number of distinct cache lines they touch
+    static uint32_t element_addresses(knc_core_state_t& core, const knc_decoded_instruction_t& inst, knc_mask_t mask,
+                                      uint64_t addresses[KNC_VECTOR_LANES]) {
+        const knc_vector_t& indices = core.registers.zmm[inst.memory.index];
+        uint64_t base = effective_address(core, inst);
+        uint64_t lines[KNC_VECTOR_LANES];
+        uint32_t count = 0;
+        for (int lane = 0; lane < KNC_VECTOR_LANES; lane++) {
+            if (!((mask >> lane) & 1)) {
+                continue;
+            }
+            addresses[lane] = base + static_cast<int64_t>(indices.i32[lane]) * inst.memory.scale;
+            uint64_t line = addresses[lane] / KNC_CACHE_LINE_SIZE;
+            uint32_t seen = 0;
+            while (seen < count && lines[seen] != line) {
+                seen++;
+            }
+            if (seen == count) {
+                lines[count++] = line;
+            }
         }
+        return count;
     }
     
-    running.store(false);
-    std::cout << "KNC emulation completed\n";
-    
-    return KNC_SUCCESS;
-}
-
-void KNCRuntime::execute_core(uint32_t core_id) {
-    knc_core_state_t& core = core_states[core_id];
+    // Translate the active elements to host addresses in place; false when
+    // one misses the TLB, so the instruction goes element by element
+    static bool translate_elements(KNCRuntime& rt, knc_core_state_t& core, knc_mask_t mask,
+                                   uint64_t addresses[KNC_VECTOR_LANES], bool is_write) {
+        for (int lane = 0; lane < KNC_VECTOR_LANES; lane++) {
+            if (!((mask >> lane) & 1)) {
+                continue;
+            }
+            uint8_t* host = rt.tlb_lookup(core, addresses[lane], sizeof(int32_t), is_write);
+            if (!host) {
+                return false;
+            }
+            addresses[lane] = reinterpret_cast<uint64_t>(host);
+        }
+        return true;
+    }
     
-    while (running.load() && !should_halt.load() && !core.is_halted) {
-        // Fetch instruction
-        uint64_t rip = core.registers.rip;
-        if (rip >= memory_size) {
-            std::cerr << "Core " << core_id << ": Instruction pointer out of bounds\n";
-            core.is_halted = true;
-            return;
+    // Count a completed gather or scatter and charge a pass per extra cache line
+    static void account_gather(KNCRuntime& rt, knc_core_state_t& core, uint32_t lines, bool scatter) {
+        knc_gather_lines_t& stats = rt.gather_lines[core.core_id];
+        (scatter ? stats.scatters : stats.gathers)[lines]++;
+        if (lines > 1) {
+            core.gather_cycles += (lines - 1) * KNC_GATHER_CYCLES_PER_LINE;
         }
+    }
+    
+    static knc_error_t exec_vgatherdps(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        knc_vector_t& lanes = core.registers.zmm[inst.dst];
+        knc_mask_t& mask = core.registers.k[inst.mask];
+        uint64_t addresses[KNC_VECTOR_LANES];
+        uint32_t lines = element_addresses(core, inst, mask, addresses);
         
-        uint8_t* instruction_ptr = memory + rip;
-        
-        // Execute instruction
-        knc_error_t result = execute_instruction(core, instruction_ptr);
+        // Every element in a TLB-mapped page: one host gather
+        if (translate_elements(rt, core, mask, addresses, false)) {
+            rt.vector_ops->gather_epi32(lanes, addresses, mask);
+            mask = 0;
+            account_gather(rt, core, lines, false);
+            return KNC_SUCCESS;
+        }
         
-        if (result != KNC_SUCCESS) {
-            std::cerr << "Core " << core_id << ": Execution error " << result << " at RIP 0x" 
-                      << std::hex << rip << std::dec << "\n";
-            core.is_halted = true;
-            return;
+        // Completed elements clear their mask bit, so a faulting gather can restart
+        element_addresses(core, inst, mask, addresses);
+        for (int lane = 0; lane < KNC_VECTOR_LANES; lane++) {
+            if (!((mask >> lane) & 1)) {
+                continue;
+            }
+            knc_error_t result = rt.read_memory(core, addresses[lane], &lanes.i32[lane], sizeof(int32_t));
+            if (result != KNC_SUCCESS) {
+                return result;
+            }
+            mask &= static_cast<knc_mask_t>(~(1 << lane));
         }
+        account_gather(rt, core, lines, false);
+        return KNC_SUCCESS;
+    }
+    
+    static knc_error_t exec_vscatterdps(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        const knc_vector_t& lanes = core.registers.zmm[inst.src];
+        knc_mask_t& mask = core.registers.k[inst.mask];
+        uint64_t addresses[KNC_VECTOR_LANES];
+        uint32_t lines = element_addresses(core, inst, mask, addresses);
         
-        // Update instruction pointer
-        core.registers.rip += 1;  // Simplified - should use actual instruction length
-        core.cycles_executed++;
+        if (translate_elements(rt, core, mask, addresses, true)) {
+            rt.vector_ops->scatter_epi32(addresses, lanes, mask);
+            mask = 0;
+            account_gather(rt, core, lines, true);
+            return KNC_SUCCESS;
+        }
         
-        // Check for debugger breakpoints
-        if (debugger && debugger->should_break(core.registers.rip, core_id)) {
-            debugger->notify_breakpoint_hit(core.registers.rip, core_id);
-            // Wait for debugger commands
-            while (debugger->should_pause()) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        element_addresses(core, inst, mask, addresses);
+        for (int lane = 0; lane < KNC_VECTOR_LANES; lane++) {
+            if (!((mask >> lane) & 1)) {
+                continue;
+            }
+            knc_error_t result = rt.write_memory(core, addresses[lane], &lanes.i32[lane], sizeof(int32_t));
+            if (result != KNC_SUCCESS) {
+                return result;
             }
+            mask &= static_cast<knc_mask_t>(~(1 << lane));
         }
-        
-        // Performance monitoring
-        if (perf_monitor) {
-            perf_monitor->record_cycle(core_id, 1);
+        account_gather(rt, core, lines, true);
+        return KNC_SUCCESS;
+    }
+    
+    // --- 16-bit opmask instructions ---
+    
+    template <knc_exec_op_t OP>
+    static knc_error_t exec_kmask(KNCRuntime&, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        knc_mask_t b = core.registers.k[inst.src2];
+        knc_mask_t value;
+        if (OP == KNC_OP_KNOT) {
+            value = static_cast<knc_mask_t>(~b);
+        } else {
+            knc_mask_t a = core.registers.k[inst.src];
+            switch (OP) {
+                case KNC_OP_KAND: value = a & b; break;
+                case KNC_OP_KANDN: value = static_cast<knc_mask_t>(~a & b); break;
+                case KNC_OP_KOR: value = a | b; break;
+                case KNC_OP_KXOR: value = a ^ b; break;
+                default: value = static_cast<knc_mask_t>(~(a ^ b)); break;  // KXNOR
+            }
         }
+        core.registers.k[inst.dst] = value;
+        return KNC_SUCCESS;
     }
-}
-
-knc_error_t KNCRuntime::execute_instruction(knc_core_state_t& core, uint8_t* instruction) {
-    // This is a simplified instruction execution
-    // In practice, this would use the instruction translator
     
-    // Check for system call instruction (simplified)
-    if (instruction[0] == 0x0F && instruction[1] == 0x05) {
-        return handle_system_call(core, static_cast<knc_syscall_type_t>(core.registers.gpr[0]));
+    static knc_error_t exec_kmov(KNCRuntime& rt, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        if (inst.flags & KNC_DECODE_MEM_DST) {
+            return rt.write_memory(core, effective_address(core, inst), &core.registers.k[inst.src], sizeof(knc_mask_t));
+        }
+        if (inst.flags & KNC_DECODE_MEM_SRC) {
+            return rt.read_memory(core, effective_address(core, inst), &core.registers.k[inst.dst], sizeof(knc_mask_t));
+        }
+        core.registers.k[inst.dst] = core.registers.k[inst.src2];
+        return KNC_SUCCESS;
     }
     
-    // Simple instruction execution (placeholder)
-    // Real implementation would decode and execute properly
-    switch (instruction[0]) {
-        case 0x90:  // NOP
-            return KNC_SUCCESS;
-            
-        case 0xC3:  // RET
-            core.is_halted = true;
-            return KNC_SUCCESS;
-            
-        default:
-            // For now, just increment RIP
-            return KNC_SUCCESS;
+    static knc_error_t exec_kmov_from_gpr(KNCRuntime&, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        core.registers.k[inst.dst] = static_cast<knc_mask_t>(core.registers.gpr[inst.src2]);
+        return KNC_SUCCESS;
+    }
+    
+    static knc_error_t exec_kmov_to_gpr(KNCRuntime&, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        write_gpr(core, inst.dst, core.registers.k[inst.src2], inst.operand_size);
+        return KNC_SUCCESS;
+    }
+    
+    static knc_error_t exec_kortest(KNCRuntime&, knc_core_state_t& core, const knc_decoded_instruction_t& inst) {
+        knc_mask_t value = core.registers.k[inst.src] | core.registers.k[inst.src2];
+        uint64_t flags = core.registers.rflags &
+            ~(KNC_RFLAGS_CF | KNC_RFLAGS_PF | KNC_RFLAGS_ZF | KNC_RFLAGS_SF | KNC_RFLAGS_OF);
+        if (value == 0) flags |= KNC_RFLAGS_ZF;
+        if (value == 0xFFFF) flags |= KNC_RFLAGS_CF;
+        core.registers.rflags = flags;
+        return KNC_SUCCESS;
+    }
+};
+
+knc_instruction_handler_t KNCRuntime::get_instruction_handler(knc_exec_op_t op) {
+    typedef KNCInterpreterOps ops;
+    
+    switch (op) {
+        case KNC_OP_NOP: return &ops::exec_nop;
+        case KNC_OP_PAUSE: return &ops::exec_pause;
+        case KNC_OP_HLT: return &ops::exec_hlt;
+        case KNC_OP_SYSCALL: return &ops::exec_syscall;
+        case KNC_OP_MOV: return &ops::exec_mov;
+        case KNC_OP_LEA: return &ops::exec_lea;
+        case KNC_OP_ADD: return &ops::exec_alu<KNC_OP_ADD>;
+        case KNC_OP_SUB: return &ops::exec_alu<KNC_OP_SUB>;
+        case KNC_OP_AND: return &ops::exec_alu<KNC_OP_AND>;
+        case KNC_OP_OR: return &ops::exec_alu<KNC_OP_OR>;
+        case KNC_OP_XOR: return &ops::exec_alu<KNC_OP_XOR>;
+        case KNC_OP_CMP: return &ops::exec_alu<KNC_OP_CMP>;
+        case KNC_OP_TEST: return &ops::exec_alu<KNC_OP_TEST>;
+        case KNC_OP_INC: return &ops::exec_incdec<KNC_OP_INC>;
+        case KNC_OP_DEC: return &ops::exec_incdec<KNC_OP_DEC>;
+        case KNC_OP_IMUL: return &ops::exec_imul;
+        case KNC_OP_SHL: return &ops::exec_shift<KNC_OP_SHL>;
+        case KNC_OP_SHR: return &ops::exec_shift<KNC_OP_SHR>;
+        case KNC_OP_SAR: return &ops::exec_shift<KNC_OP_SAR>;
+        case KNC_OP_XCHG: return &ops::exec_xchg;
+        case KNC_OP_XADD: return &ops::exec_xadd;
+        case KNC_OP_CMPXCHG: return &ops::exec_cmpxchg;
+        case KNC_OP_PUSH: return &ops::exec_push;
+        case KNC_OP_POP: return &ops::exec_pop;
+        case KNC_OP_ADC: return &ops::exec_alu<KNC_OP_ADC>;
+        case KNC_OP_SBB: return &ops::exec_alu<KNC_OP_SBB>;
+        case KNC_OP_NOT: return &ops::exec_notneg<KNC_OP_NOT>;
+        case KNC_OP_NEG: return &ops::exec_notneg<KNC_OP_NEG>;
+        case KNC_OP_MUL: return &ops::exec_muldiv<KNC_OP_MUL>;
+        case KNC_OP_IMUL_WIDE: return &ops::exec_muldiv<KNC_OP_IMUL_WIDE>;
+        case KNC_OP_DIV: return &ops::exec_muldiv<KNC_OP_DIV>;
+        case KNC_OP_IDIV: return &ops::exec_muldiv<KNC_OP_IDIV>;
+        case KNC_OP_ROL: return &ops::exec_shift<KNC_OP_ROL>;
+        case KNC_OP_ROR: return &ops::exec_shift<KNC_OP_ROR>;
+        case KNC_OP_MOVZX: return &ops::exec_movx<false>;
+        case KNC_OP_MOVSX: return &ops::exec_movx<true>;
+        case KNC_OP_CMOVCC: return &ops::exec_cmov;
+        case KNC_OP_SETCC: return &ops::exec_setcc;
+        case KNC_OP_CBW: return &ops::exec_cbw;
+        case KNC_OP_CWD: return &ops::exec_cwd;
+        case KNC_OP_LEAVE: return &ops::exec_leave;
+        case KNC_OP_JMP: return &ops::exec_jmp;
+        case KNC_OP_JMP_INDIRECT: return &ops::exec_jmp_indirect;
+        case KNC_OP_JCC: return &ops::exec_jcc;
+        case KNC_OP_CALL: return &ops::exec_call;
+        case KNC_OP_CALL_INDIRECT: return &ops::exec_call_indirect;
+        case KNC_OP_RET: return &ops::exec_ret;
+        case KNC_OP_VPADDD: return &ops::exec_vector<KNC_OP_VPADDD>;
+        case KNC_OP_VPSUBD: return &ops::exec_vector<KNC_OP_VPSUBD>;
+        case KNC_OP_VPMULLD: return &ops::exec_vector<KNC_OP_VPMULLD>;
+        case KNC_OP_VPANDD: return &ops::exec_vector<KNC_OP_VPANDD>;
+        case KNC_OP_VPORD: return &ops::exec_vector<KNC_OP_VPORD>;
+        case KNC_OP_VPXORD: return &ops::exec_vector<KNC_OP_VPXORD>;
+        case KNC_OP_VADDPS: return &ops::exec_vector<KNC_OP_VADDPS>;
+        case KNC_OP_VSUBPS: return &ops::exec_vector<KNC_OP_VSUBPS>;
+        case KNC_OP_VMULPS: return &ops::exec_vector<KNC_OP_VMULPS>;
+        case KNC_OP_VDIVPS: return &ops::exec_vector<KNC_OP_VDIVPS>;
+        case KNC_OP_VMAXPS: return &ops::exec_vector<KNC_OP_VMAXPS>;
+        case KNC_OP_VMINPS: return &ops::exec_vector<KNC_OP_VMINPS>;
+        case KNC_OP_VFMADD231PS: return &ops::exec_vector<KNC_OP_VFMADD231PS>;
+        case KNC_OP_VPERMD: return &ops::exec_vector<KNC_OP_VPERMD>;
+        case KNC_OP_VPBROADCASTD: return &ops::exec_vbroadcast;
+        case KNC_OP_VCMPPS: return &ops::exec_vcmpps;
+        case KNC_OP_VLOAD: return &ops::exec_vector<KNC_OP_VLOAD>;
+        case KNC_OP_VSTORE: return &ops::exec_vstore;
+        case KNC_OP_VGATHERDPS: return &ops::exec_vgatherdps;
+        case KNC_OP_VSCATTERDPS: return &ops::exec_vscatterdps;
+        case KNC_OP_VEXPAND: return &ops::exec_vexpand;
+        case KNC_OP_VCOMPRESS: return &ops::exec_vcompress;
+        case KNC_OP_VPERMT2D: return &ops::exec_vector<KNC_OP_VPERMT2D>;
+        case KNC_OP_VPCONFLICTD: return &ops::exec_vector_unary<KNC_OP_VPCONFLICTD>;
+        case KNC_OP_VPLZCNTD: return &ops::exec_vector_unary<KNC_OP_VPLZCNTD>;
+        case KNC_OP_VRCP28PS: return &ops::exec_vector_unary<KNC_OP_VRCP28PS>;
+        case KNC_OP_VRSQRT28PS: return &ops::exec_vector_unary<KNC_OP_VRSQRT28PS>;
+        case KNC_OP_VEXP2PS: return &ops::exec_vector_unary<KNC_OP_VEXP2PS>;
+        case KNC_OP_VGATHERPFDPS: return &ops::exec_vprefetch<KNC_OP_VGATHERPFDPS>;
+        case KNC_OP_VSCATTERPFDPS: return &ops::exec_vprefetch<KNC_OP_VSCATTERPFDPS>;
+        case KNC_OP_VLOADUNPACKL: return &ops::exec_vloadunpack<false>;
+        case KNC_OP_VLOADUNPACKH: return &ops::exec_vloadunpack<true>;
+        case KNC_OP_VPACKSTOREL: return &ops::exec_vpackstore<false>;
+        case KNC_OP_VPACKSTOREH: return &ops::exec_vpackstore<true>;
+        case KNC_OP_KAND: return &ops::exec_kmask<KNC_OP_KAND>;
+        case KNC_OP_KANDN: return &ops::exec_kmask<KNC_OP_KANDN>;
+        case KNC_OP_KOR: return &ops::exec_kmask<KNC_OP_KOR>;
+        case KNC_OP_KXOR: return &ops::exec_kmask<KNC_OP_KXOR>;
+        case KNC_OP_KXNOR: return &ops::exec_kmask<KNC_OP_KXNOR>;
+        case KNC_OP_KNOT: return &ops::exec_kmask<KNC_OP_KNOT>;
+        case KNC_OP_KMOV: return &ops::exec_kmov;
+        case KNC_OP_KMOV_FROM_GPR: return &ops::exec_kmov_from_gpr;
+        case KNC_OP_KMOV_TO_GPR: return &ops::exec_kmov_to_gpr;
+        case KNC_OP_KORTEST: return &ops::exec_kortest;
+        default: return &ops::exec_unknown;
     }
 }
 
 knc_error_t KNCRuntime::handle_system_call(knc_core_state_t& core, knc_syscall_type_t syscall) {
     switch (syscall) {
         case KNC_SYSCALL_EXIT:
-            return syscall_exit(core, static_cast<int>(core.registers.gpr[0]));
+            return syscall_exit(core, static_cast<int>(core.registers.gpr[KNC_REG_RDI]));
             
         case KNC_SYSCALL_WRITE:
             return syscall_write(core);
@@ -294,60 +2426,356 @@ knc_error_t KNCRuntime::syscall_exit(knc_core_state_t& core, int exit_code) {
 knc_error_t KNCRuntime::syscall_write(knc_core_state_t& core) {
     // Simplified write system call
     // Arguments: fd (rdi), buf (rsi), count (rdx)
-    uint64_t fd = core.registers.gpr[1];  // RDI
-    uint64_t buf = core.registers.gpr[2];  // RSI
-    uint64_t count = core.registers.gpr[3];  // RDX
+    uint64_t fd = core.registers.gpr[KNC_REG_RDI];
+    uint64_t buf = core.registers.gpr[KNC_REG_RSI];
+    uint64_t count = core.registers.gpr[KNC_REG_RDX];
     
     if (fd == 1) {  // stdout
-        std::cout.write(reinterpret_cast<const char*>(memory + buf), count);
-        core.registers.gpr[0] = count;  // Return value
+        // The buffer is a guest virtual range; copy it out a page at a time
+        char chunk[KNC_PAGE_SIZE_4K];
+        for (uint64_t done = 0; done < count;) {
+            size_t bytes = std::min<uint64_t>(count - done, sizeof(chunk) - ((buf + done) & (sizeof(chunk) - 1)));
+            if (read_memory(core, buf + done, chunk, bytes) != KNC_SUCCESS) {
+                core.registers.gpr[KNC_REG_RAX] = -1;
+                return KNC_ERROR_MEMORY_ACCESS;
+            }
+            std::cout.write(chunk, bytes);
+            done += bytes;
+        }
+        core.registers.gpr[KNC_REG_RAX] = count;  // Return value
         return KNC_SUCCESS;
     }
     
     // Other file descriptors not implemented
-    core.registers.gpr[0] = -1;  // Error
+    core.registers.gpr[KNC_REG_RAX] = -1;  // Error
     return KNC_ERROR_SYSTEM_CALL;
 }
 
 knc_error_t KNCRuntime::syscall_read(knc_core_state_t& core) {
     // Simplified read system call
     // Arguments: fd (rdi), buf (rsi), count (rdx)
-    uint64_t fd = core.registers.gpr[1];  // RDI
-    uint64_t buf = core.registers.gpr[2];  // RSI
-    uint64_t count = core.registers.gpr[3];  // RDX
+    uint64_t fd = core.registers.gpr[KNC_REG_RDI];
+    uint64_t buf = core.registers.gpr[KNC_REG_RSI];
+    uint64_t count = core.registers.gpr[KNC_REG_RDX];
     
     if (fd == 0) {  // stdin
         // For now, return 0 bytes read
-        core.registers.gpr[0] = 0;
+        core.registers.gpr[KNC_REG_RAX] = 0;
         return KNC_SUCCESS;
     }
     
     // Other file descriptors not implemented
-    core.registers.gpr[0] = -1;  // Error
+    core.registers.gpr[KNC_REG_RAX] = -1;  // Error
     return KNC_ERROR_SYSTEM_CALL;
 }
 
-knc_error_t KNCRuntime::read_memory(uint64_t address, void* data, size_t size) {
-    if (!memory || address + size > memory_size) {
-        return KNC_ERROR_INVALID_ARGUMENT;
+// Guest accesses translate through the core's TLB, which only ever hands
+// out host addresses inside guest memory. They still run inside
+// execute_block's fault recovery point as a safety net.
+inline uint8_t* KNCRuntime::tlb_lookup(const knc_core_state_t& core, uint64_t address, size_t size, bool is_write) {
+    knc_tlb_entry_t& entry = core.tlb->entries[(address >> KNC_PAGE_SHIFT) % KNC_TLB_ENTRIES];
+    uint64_t tag = ((address + size - 1) >> KNC_PAGE_SHIFT) + 1;  // Never matches an access crossing the page
+    if ((is_write ? entry.write_tag : entry.read_tag) == tag) {
+        entry.hits++;
+        return reinterpret_cast<uint8_t*>(address + entry.host_offset);
+    }
+    return tlb_miss(core, address, size, is_write);
+}
+
+uint8_t* KNCRuntime::tlb_miss(const knc_core_state_t& core, uint64_t address, size_t size, bool is_write) {
+    uint64_t page = address >> KNC_PAGE_SHIFT;
+    if (((address + size - 1) >> KNC_PAGE_SHIFT) != page) {
+        return nullptr;  // Crosses a page boundary; the caller splits it
+    }
+    knc_tlb_t& tlb = *core.tlb;
+    knc_tlb_entry_t& entry = tlb.entries[page % KNC_TLB_ENTRIES];
+    
+    // A 2M or 1G translation already held refills the 4K entry without a walk
+    uint32_t large_slot = (address >> 21) % KNC_TLB_LARGE_ENTRIES;
+    uint32_t huge_slot = (address >> 30) % KNC_TLB_HUGE_ENTRIES;
+    uint64_t physical;
+    bool writable;
+    uint32_t source;
+    if (tlb.large[large_slot].tag == (address >> 21) + 1) {
+        physical = tlb.large[large_slot].physical + (address & (KNC_PAGE_SIZE_2M - 1));
+        writable = tlb.large[large_slot].writable;
+        source = 1 + large_slot;
+        tlb.hits++;
+    } else if (tlb.huge[huge_slot].tag == (address >> 30) + 1) {
+        physical = tlb.huge[huge_slot].physical + (address & (KNC_PAGE_SIZE_1G - 1));
+        writable = tlb.huge[huge_slot].writable;
+        source = 1 + KNC_TLB_LARGE_ENTRIES + huge_slot;
+        tlb.hits++;
+    } else {
+        knc_page_walk_t walk;
+        if (!page_tables->translate(address, walk)) {
+            return nullptr;
+        }
+        tlb.misses++;
+        tlb.walk_reads += walk.levels;
+        physical = walk.physical;
+        writable = walk.writable;
+        source = 0;
+        
+        knc_tlb_page_t* slot = nullptr;
+        if (walk.size == KNC_PAGE_2M) {
+            slot = &tlb.large[large_slot];
+            source = 1 + large_slot;
+        } else if (walk.size == KNC_PAGE_1G) {
+            slot = &tlb.huge[huge_slot];
+            source = 1 + KNC_TLB_LARGE_ENTRIES + huge_slot;
+        }
+        if (slot) {
+            // 4K entries split from the page this slot held go with it
+            for (knc_tlb_entry_t& split : tlb.entries) {
+                if (split.source == source) {
+                    split.read_tag = split.write_tag = 0;
+                    split.source = 0;
+                }
+            }
+            slot->tag = (address >> (walk.size == KNC_PAGE_2M ? 21 : 30)) + 1;
+            slot->physical = walk.page_base;
+            slot->writable = writable;
+        }
+    }
+    
+    // Translated code stays write-protected; a store to it retires the translations first
+    bool code = writable && test_page(code_pages, physical);
+    if (code && is_write) {
+        code = write_code_page(address, size, physical);
     }
     
-    memcpy(data, memory + address, size);
+    entry.read_tag = page + 1;
+    entry.write_tag = writable && !code ? page + 1 : 0;
+    entry.host_offset = static_cast<int64_t>(reinterpret_cast<uintptr_t>(memory) +
+                                             (physical & ~(KNC_PAGE_SIZE_4K - 1)) - (page << KNC_PAGE_SHIFT));
+    entry.source = source;
+    if (is_write && !writable) {
+        return nullptr;
+    }
+    return reinterpret_cast<uint8_t*>(address + entry.host_offset);
+}
+
+knc_error_t KNCRuntime::access_pages(const knc_core_state_t& core, uint64_t address, void* data, size_t size,
+                                     bool is_write) {
+    uint8_t* bytes = static_cast<uint8_t*>(data);
+    while (size > 0) {
+        size_t chunk = std::min<uint64_t>(size, KNC_PAGE_SIZE_4K - (address & (KNC_PAGE_SIZE_4K - 1)));
+        uint8_t* host = tlb_lookup(core, address, chunk, is_write);
+        if (!host) {
+            return KNC_ERROR_MEMORY_ACCESS;
+        }
+        if (is_write) {
+            memcpy(host, bytes, chunk);
+        } else {
+            memcpy(bytes, host, chunk);
+        }
+        address += chunk;
+        bytes += chunk;
+        size -= chunk;
+    }
     return KNC_SUCCESS;
 }
 
-knc_error_t KNCRuntime::write_memory(uint64_t address, const void* data, size_t size) {
-    if (!memory || address + size > memory_size) {
-        return KNC_ERROR_MEMORY_ACCESS;
+knc_error_t KNCRuntime::read_memory(const knc_core_state_t& core, uint64_t address, void* data, size_t size) {
+    uint8_t* host = tlb_lookup(core, address, size, false);
+    if (!host) {
+        return access_pages(core, address, data, size, false);
     }
-    
-    std::lock_guard<std::mutex> lock(memory_mutex);
-    memcpy(memory + address, data, size);
+    memcpy(data, host, size);
+    return KNC_SUCCESS;
+}
+
+knc_error_t KNCRuntime::write_memory(const knc_core_state_t& core, uint64_t address, const void* data, size_t size) {
+    uint8_t* host = tlb_lookup(core, address, size, true);
+    if (!host) {
+        return access_pages(core, address, const_cast<void*>(data), size, true);
+    }
+    memcpy(host, data, size);
     return KNC_SUCCESS;
 }
 
+knc_error_t KNCRuntime::read_vector_memory(const knc_core_state_t& core, uint64_t address, knc_vector_t& data) {
+    return read_memory(core, address, &data, sizeof(knc_vector_t));
+}
+
+knc_error_t KNCRuntime::write_vector_memory(const knc_core_state_t& core, uint64_t address, const knc_vector_t& data) {
+    return write_memory(core, address, &data, sizeof(knc_vector_t));
+}
+
+inline bool KNCRuntime::test_page(const std::unique_ptr<std::atomic<uint64_t>[]>& bitmap, uint64_t physical) {
+    uint64_t page = physical >> KNC_PAGE_SHIFT;
+    return (bitmap[page / 64].load(std::memory_order_acquire) >> (page % 64)) & 1;
+}
+
+bool KNCRuntime::track_code_pages(knc_translated_block_t* block, uint64_t physical) {
+    // Called with code_mutex held; true when a page became write-protected
+    bool marked = false;
+    uint64_t last = (physical + (block->end_address - block->start_address) - 1) >> KNC_PAGE_SHIFT;
+    for (uint64_t page = physical >> KNC_PAGE_SHIFT; page <= last; page++) {
+        uint64_t bit = 1ULL << (page % 64);
+        if (mixed_pages[page / 64].load(std::memory_order_relaxed) & bit) {
+            block->check_code.store(true, std::memory_order_release);
+        } else if (!(code_pages[page / 64].fetch_or(bit, std::memory_order_acq_rel) & bit)) {
+            marked = true;
+        }
+    }
+    if (marked) {
+        code_generation.fetch_add(1, std::memory_order_release);
+    }
+    return marked;
+}
+
+bool KNCRuntime::write_code_page(uint64_t address, size_t size, uint64_t physical) {
+    std::lock_guard<std::mutex> guard(code_mutex);
+    uint64_t page = physical >> KNC_PAGE_SHIFT;
+    uint64_t bit = 1ULL << (page % 64);
+    if (!(code_pages[page / 64].load(std::memory_order_relaxed) & bit)) {
+        return false;  // Another core's store got here first
+    }
+    
+    uint64_t page_address = address & ~(KNC_PAGE_SIZE_4K - 1);
+    size_t retired = translator->invalidate_cache_range(address, size);
+    if (retired > 0) {
+        code_page_writes.fetch_add(1, std::memory_order_relaxed);
+        code_blocks_invalidated.fetch_add(retired, std::memory_order_relaxed);
+        if (translator->has_blocks_in_range(page_address, KNC_PAGE_SIZE_4K)) {
+            return true;
+        }
+    } else {
+        mixed_pages[page / 64].fetch_or(bit, std::memory_order_relaxed);
+        translator->check_code_in_range(page_address, KNC_PAGE_SIZE_4K);
+    }
+    code_pages[page / 64].fetch_and(~bit, std::memory_order_release);
+    return false;
+}
+
+bool KNCRuntime::check_block_code(knc_core_state_t& thread, knc_translated_block_t*& block) {
+    // A superblock checks the blocks it was formed from
+    const knc_translated_block_t* changed = nullptr;
+    if (block->parts.empty()) {
+        if (knc_hash_bytes(block->code, block->end_address - block->start_address) != block->code_hash) {
+            changed = block;
+        }
+    }
+    for (const knc_translated_block_t* part : block->parts) {
+        if (knc_hash_bytes(part->code, part->end_address - part->start_address) != part->code_hash) {
+            changed = part;
+            break;
+        }
+    }
+    if (!changed) {
+        return true;
+    }
+    {
+        std::lock_guard<std::mutex> guard(code_mutex);
+        size_t retired = translator->invalidate_cache_range(changed->start_address,
+                                                            changed->end_address - changed->start_address);
+        code_page_writes.fetch_add(1, std::memory_order_relaxed);
+        code_blocks_invalidated.fetch_add(retired, std::memory_order_relaxed);
+    }
+    block = lookup_block(thread, thread.registers.rip);
+    return block != nullptr;
+}
+
+void KNCRuntime::revoke_code_writes(knc_tlb_t& tlb) {
+    tlb.code_generation = code_generation.load(std::memory_order_acquire);
+    for (knc_tlb_entry_t& entry : tlb.entries) {
+        if (!entry.write_tag) {
+            continue;
+        }
+        uint64_t host = ((entry.write_tag - 1) << KNC_PAGE_SHIFT) + entry.host_offset;
+        if (test_page(code_pages, host - reinterpret_cast<uintptr_t>(memory))) {
+            entry.write_tag = 0;
+        }
+    }
+}
+
+void KNCRuntime::flush_tlbs() {
+    for (uint32_t i = 0; i < num_cores; i++) {
+        memset(&tlbs[i], 0, sizeof(knc_tlb_t));
+    }
+}
+
+void KNCRuntime::collect_tlb_events(uint32_t core_id) {
+    // Entry hit counters are plain per-entry increments on the access path;
+    // fold them into the core totals between slices
+    knc_tlb_t& tlb = tlbs[core_id];
+    for (knc_tlb_entry_t& entry : tlb.entries) {
+        tlb.hits += entry.hits;
+        entry.hits = 0;
+    }
+    if (perf_monitor && (tlb.hits != tlb.reported_hits || tlb.misses != tlb.reported_misses)) {
+        perf_monitor->record_tlb_events(core_id, tlb.hits - tlb.reported_hits, tlb.misses - tlb.reported_misses);
+    }
+    tlb.reported_hits = tlb.hits;
+    tlb.reported_misses = tlb.misses;
+}
+
+void KNCRuntime::collect_gather_events(uint32_t core_id) {
+    knc_gather_lines_t& lines = gather_lines[core_id];
+    knc_gather_lines_t& reported = reported_gather_lines[core_id];
+    if (!perf_monitor || memcmp(&lines, &reported, sizeof(knc_gather_lines_t)) == 0) {
+        return;
+    }
+    knc_gather_lines_t delta;
+    for (uint32_t i = 0; i < KNC_GATHER_LINE_BUCKETS; i++) {
+        delta.gathers[i] = lines.gathers[i] - reported.gathers[i];
+        delta.scatters[i] = lines.scatters[i] - reported.scatters[i];
+    }
+    perf_monitor->record_gather_lines(core_id, delta);
+    reported = lines;
+}
+
+void KNCRuntime::publish_core_clock(uint32_t core_id, uint64_t cycles) {
+    core_clocks[core_id].cycles.store(cycles, std::memory_order_release);
+}
+
 void KNCRuntime::update_global_cycle_count() {
-    global_cycle_count.fetch_add(1);
+    // Global time is the slowest running core's clock; it only moves forward
+    uint64_t slowest = UINT64_MAX;
+    for (uint32_t i = 0; i < num_cores; i++) {
+        slowest = std::min(slowest, core_clocks[i].cycles.load(std::memory_order_acquire));
+    }
+    if (slowest == UINT64_MAX) {
+        return;  // Every core has finished
+    }
+    
+    uint64_t current = global_cycle_count.load(std::memory_order_relaxed);
+    while (slowest > current &&
+           !global_cycle_count.compare_exchange_weak(current, slowest, std::memory_order_acq_rel)) {
+    }
+}
+
+bool KNCRuntime::barrier_wait(uint32_t core_id) {
+    // Non-blocking: a worker never sleeps on the barrier, since the slowest
+    // core may be queued behind this one on the same host thread
+    if (sync_quantum == 0) {
+        return true;
+    }
+    uint64_t now = core_issue[core_id].cycles;
+    if (now < global_cycle_count.load(std::memory_order_acquire) + sync_quantum) {
+        return true;
+    }
+    
+    update_global_cycle_count();
+    uint64_t horizon = global_cycle_count.load(std::memory_order_acquire);
+    if (now > horizon) {
+        uint64_t skew = now - horizon;
+        uint64_t seen = max_core_skew.load(std::memory_order_relaxed);
+        while (skew > seen && !max_core_skew.compare_exchange_weak(seen, skew, std::memory_order_relaxed)) {
+        }
+    }
+    return now < horizon + sync_quantum;
+}
+
+void KNCRuntime::synchronize_cores() {
+    // Once every core has stopped, machine time is the time of the last one to finish
+    uint64_t latest = 0;
+    for (uint32_t i = 0; i < num_cores; i++) {
+        latest = std::max(latest, core_issue[i].cycles);
+    }
+    global_cycle_count.store(latest, std::memory_order_release);
 }
 
 void KNCRuntime::set_ring_bus_simulator(RingBusSimulator* simulator) {
@@ -366,6 +2794,63 @@ void KNCRuntime::set_pcie_bridge(PCIeBridge* bridge) {
     pcie_bridge = bridge;
 }
 
+void KNCRuntime::set_jit_enabled(bool enable) {
+    jit_enabled = enable;
+}
+
+void KNCRuntime::set_worker_threads(uint32_t workers) {
+    num_workers = workers;
+}
+
+void KNCRuntime::set_sync_quantum(uint64_t cycles) {
+    sync_quantum = cycles;
+}
+
+void KNCRuntime::set_huge_pages(knc_huge_pages_t pages) {
+    huge_pages = pages;
+}
+
+void KNCRuntime::set_page_size(knc_page_size_t size) {
+    page_size = size;
+}
+
+void KNCRuntime::set_translation_cache(const std::string& directory) {
+    translation_cache_dir = directory;
+}
+
+void KNCRuntime::set_pretranslation(uint32_t threads) {
+    pretranslate_threads = threads;
+}
+
+void KNCRuntime::set_block_cache_size(size_t entries) {
+    translator->set_cache_size(entries);
+}
+
+bool KNCRuntime::set_threads_per_core(uint32_t threads) {
+    if (threads == 0 || threads > KNC_THREADS_PER_CORE) {
+        std::cerr << "Error: Threads per core must be between 1 and " << KNC_THREADS_PER_CORE << "\n";
+        return false;
+    }
+    threads_per_core = threads;
+    return true;
+}
+
+bool KNCRuntime::set_vector_backend(knc_vector_backend_t backend) {
+    const knc_vector_ops_t* ops = knc_get_vector_ops(backend);
+    if (!ops) {
+        std::cerr << "Error: Vector backend '" << knc_vector_backend_name(backend)
+                  << "' is not supported by this host CPU\n";
+        return false;
+    }
+    vector_backend = ops->backend;
+    vector_ops = ops;
+    return true;
+}
+
+const char* KNCRuntime::get_vector_backend_name() const {
+    return vector_ops->name;
+}
+
 bool KNCRuntime::is_running() const {
     return running.load();
 }
@@ -375,13 +2860,21 @@ uint64_t KNCRuntime::get_cycle_count() const {
 }
 
 const knc_core_state_t& KNCRuntime::get_core_state(uint32_t core_id) const {
-    if (core_id < num_cores) {
-        return core_states[core_id];
+    return get_thread_state(core_id, 0);
+}
+
+const knc_core_state_t& KNCRuntime::get_thread_state(uint32_t core_id, uint32_t thread_id) const {
+    if (core_id < num_cores && thread_id < KNC_THREADS_PER_CORE) {
+        return core_states[core_id * KNC_THREADS_PER_CORE + thread_id];
     }
     static knc_core_state_t dummy_state;
     return dummy_state;
 }
 
+uint64_t KNCRuntime::get_core_cycles(uint32_t core_id) const {
+    return (core_id < num_cores) ? core_issue[core_id].cycles : 0;
+}
+
 const knc_memory_t& KNCRuntime::get_memory() const {
     static knc_memory_t dummy_memory;
     dummy_memory.base_address = 0;
@@ -390,16 +2883,21 @@ const knc_memory_t& KNCRuntime::get_memory() const {
     return dummy_memory;
 }
 
+uint64_t KNCRuntime::get_blocks_compiled() const {
+    return blocks_compiled.load();
+}
+
 void KNCRuntime::dump_core_state(uint32_t core_id) const {
     if (core_id >= num_cores) {
         std::cerr << "Invalid core ID: " << core_id << "\n";
         return;
     }
     
-    const knc_core_state_t& core = core_states[core_id];
+    const knc_core_state_t& core = core_states[core_id * KNC_THREADS_PER_CORE];
     
     std::cout << "\n=== Core " << core_id << " State ===\n";
     std::cout << "Tile ID: " << core.tile_id << "\n";
+    std::cout << "Core cycles: " << core_issue[core_id].cycles << "\n";
     std::cout << "RIP: 0x" << std::hex << core.registers.rip << std::dec << "\n";
     std::cout << "RFLAGS: 0x" << std::hex << core.registers.rflags << std::dec << "\n";
     std::cout << "Halted: " << (core.is_halted ? "Yes" : "No") << "\n";
@@ -418,20 +2916,95 @@ void KNCRuntime::print_statistics() const {
     
     uint64_t total_instructions = 0;
     uint64_t active_cores = 0;
+    uint64_t core_cycles = 0, max_core_cycles = 0, idle_cycles = 0;
     
-    for (const auto& core : core_states) {
-        if (core.cycles_executed > 0) {
+    for (uint32_t i = 0; i < num_cores; i++) {
+        const knc_core_issue_t& pipeline = core_issue[i];
+        if (pipeline.cycles > 0) {
             active_cores++;
         }
-        total_instructions += core.cycles_executed;  // Simplified
+        core_cycles += pipeline.cycles;
+        idle_cycles += pipeline.idle_cycles;
+        max_core_cycles = std::max(max_core_cycles, pipeline.cycles);
+    }
+    uint64_t block_lookups = 0, cold_runs = 0, cold_instructions = 0;
+    for (const auto& thread : core_states) {
+        total_instructions += thread.cycles_executed;
+        block_lookups += thread.block_lookups;
+        cold_runs += thread.cold_runs;
+        cold_instructions += thread.cold_instructions;
     }
     
     std::cout << "Active cores: " << active_cores << "/" << num_cores << "\n";
+    std::cout << "Threads per core: " << threads_per_core << "\n";
     std::cout << "Total instructions: " << total_instructions << "\n";
+    std::cout << "Core cycles (slowest core): " << max_core_cycles << "\n";
+    if (core_cycles > 0) {
+        std::cout << "Per-core IPC: " << (double)total_instructions / core_cycles << "\n";
+        std::cout << "Idle issue cycles: " << (100.0 * idle_cycles / core_cycles) << "%\n";
+    }
+    
+    // Per-thread counters for every hardware thread that ran
+    for (const auto& thread : core_states) {
+        if (thread.cycles_executed == 0) {
+            continue;
+        }
+        std::cout << "  Core " << thread.core_id << " thread " << thread.thread_id << ": "
+                  << thread.cycles_executed << " instructions, "
+                  << thread.active_cycles << " active cycles, "
+                  << thread.stall_cycles << " stall cycles, "
+                  << thread.gather_cycles << " gather/scatter cycles, IPC "
+                  << (thread.active_cycles ? (double)thread.cycles_executed / thread.active_cycles : 0.0) << "\n";
+    }
+    std::cout << "Dispatcher block cache lookups: " << block_lookups << "\n";
+    std::cout << "Cold code: " << cold_instructions << " instructions in " << cold_runs
+              << " runs, interpreted without translation\n";
+    if (jit_enabled) {
+        std::cout << "Blocks compiled in the background: " << blocks_compiled.load() << "\n";
+    }
+    std::cout << "Contended guest atomics: " << contended_atomics.load() << "\n";
+    std::cout << "Stores to translated code: " << code_page_writes.load() << " (" << code_blocks_invalidated.load()
+              << " blocks invalidated)\n";
+    guest_memory->print_statistics();
+    
+    uint64_t tlb_hits = 0, tlb_misses = 0, walk_reads = 0;
+    for (uint32_t i = 0; i < num_cores; i++) {
+        tlb_hits += tlbs[i].hits;
+        tlb_misses += tlbs[i].misses;
+        walk_reads += tlbs[i].walk_reads;
+    }
+    std::cout << "Guest page size: " << knc_page_size_name(page_size) << "\n";
+    std::cout << "Data TLB: " << tlb_hits << " hits, " << tlb_misses << " misses";
+    if (tlb_hits + tlb_misses > 0) {
+        std::cout << " (" << (100.0 * tlb_hits / (tlb_hits + tlb_misses)) << "% hit rate)";
+    }
+    std::cout << ", " << walk_reads << " page-table reads\n";
+    
+    uint64_t gathers = 0, gather_lines_touched = 0, scatters = 0, scatter_lines_touched = 0;
+    for (uint32_t i = 0; i < num_cores; i++) {
+        for (uint32_t n = 0; n < KNC_GATHER_LINE_BUCKETS; n++) {
+            gathers += gather_lines[i].gathers[n];
+            gather_lines_touched += gather_lines[i].gathers[n] * n;
+            scatters += gather_lines[i].scatters[n];
+            scatter_lines_touched += gather_lines[i].scatters[n] * n;
+        }
+    }
+    if (gathers + scatters > 0) {
+        std::cout << "Gathers: " << gathers << " (" << (gathers ? (double)gather_lines_touched / gathers : 0.0)
+                  << " cache lines each), scatters: " << scatters << " ("
+                  << (scatters ? (double)scatter_lines_touched / scatters : 0.0) << " cache lines each)\n";
+    }
+    page_tables->print_statistics();
+    if (sync_quantum) {
+        std::cout << "Sync quantum: " << sync_quantum << " cycles (max skew " << max_core_skew.load() << ")\n";
+    } else {
+        std::cout << "Sync quantum: unbounded\n";
+    }
+    scheduler->print_statistics();
     
     if (global_cycle_count.load() > 0) {
         double avg_ipc = (double)total_instructions / global_cycle_count.load();
-        std::cout << "Average IPC: " << avg_ipc << "\n";
+        std::cout << "Machine IPC: " << avg_ipc << "\n";
     }
 }
 
@@ -459,83 +3032,95 @@ bool KNCRuntime::is_valid_address(uint64_t address) {
     return address < memory_size;
 }
 
-knc_error_t KNCRuntime::mmu_write(uint64_t address, const void* data, size_t size) {
-    std::lock_guard<std::mutex> lock(mmu_mutex);
+void KNCRuntime::note_atomic_access(uint32_t core_id, uint64_t address) {
+    uint64_t line = (address & KNC_GUEST_ADDRESS_MASK) / KNC_CACHE_LINE_SIZE;
+    uint64_t owner = ((line + 1) << 8) | (core_id & 0xFF);
+    std::atomic<uint64_t>& slot = atomic_lines[line % ATOMIC_LINE_SLOTS];
     
-    if (!is_valid_address(address) || !is_valid_address(address + size - 1)) {
-        return KNC_ERROR_MEMORY_ACCESS;
+    // A core repeating atomics on a line it already owns leaves the slot alone
+    if (slot.load(std::memory_order_relaxed) == owner) {
+        return;
     }
-    
-    uint32_t mmu_id = address_to_mmu(address);
-    uint32_t max_mmus = (architecture == ARCH_KNL) ? KNL_NUM_MMUS : KNC_NUM_MMUS;
-    if (mmu_id >= max_mmus) {
-        return KNC_ERROR_MEMORY_ACCESS;
+    uint64_t previous = slot.exchange(owner, std::memory_order_relaxed);
+    if ((previous >> 8) != line + 1 || previous == owner) {
+        return;  // First use of the line, or the slot held another line
     }
     
-    // Transfer data through PCIe bridge if available (simulating host-to-device transfer)
-    if (pcie_bridge) {
-        pcie_bridge->transferDataHostToDevice(data, size, address);
+    contended_atomics.fetch_add(1, std::memory_order_relaxed);
+    if (ring_bus) {
+        ring_bus->record_contended_line(line * KNC_CACHE_LINE_SIZE,
+                                        core_states[core_id * KNC_THREADS_PER_CORE].tile_id);
     }
-    
-    // Update MMU statistics
-    mmus[mmu_id].accesses++;
+}
+
+void KNCRuntime::count_mmu_access(uint32_t mmu_id) {
+    // Each core's shard is only written by the worker running that core, so a
+    // plain increment is enough there; host callers share the last shard
+    uint32_t shard = (mmu_shard < num_cores) ? mmu_shard : num_cores;
+    knc_mmu_counters_t& counters = mmu_counters[shard];
+    bool shared = (shard == num_cores);
     
     // Simple cache simulation (90% hit rate)
-    if ((rand() % 100) < 90) {
-        mmus[mmu_id].cache_hits++;
+    uint32_t state = counters.hit_state.load(std::memory_order_relaxed);
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    counters.hit_state.store(state, std::memory_order_relaxed);
+    std::atomic<uint64_t>& outcome = ((state % 100) < 90) ? counters.cache_hits[mmu_id]
+                                                           : counters.cache_misses[mmu_id];
+    
+    if (shared) {
+        counters.accesses[mmu_id].fetch_add(1, std::memory_order_relaxed);
+        outcome.fetch_add(1, std::memory_order_relaxed);
     } else {
-        mmus[mmu_id].cache_misses++;
+        counters.accesses[mmu_id].store(counters.accesses[mmu_id].load(std::memory_order_relaxed) + 1,
+                                        std::memory_order_relaxed);
+        outcome.store(outcome.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+}
+
+knc_error_t KNCRuntime::mmu_write(uint64_t address, const void* data, size_t size) {
+    // Perform the write; a guard-page fault means the range left guest memory
+    if (!guest_memory->write(address, data, size)) {
+        return KNC_ERROR_MEMORY_ACCESS;
     }
+    uint32_t mmu_id = address_to_mmu(address & KNC_GUEST_ADDRESS_MASK);
     
-    // Perform the write
-    memcpy(memory + address, data, size);
+    // Transfer data through PCIe bridge if available (simulating host-to-device transfer)
+    if (pcie_bridge) {
+        pcie_bridge->transferDataHostToDevice(data, size, address);
+    }
     
+    count_mmu_access(mmu_id);
     return KNC_SUCCESS;
 }
 
 knc_error_t KNCRuntime::mmu_read(uint64_t address, void* data, size_t size) {
-    std::lock_guard<std::mutex> lock(mmu_mutex);
-    
-    if (!is_valid_address(address) || !is_valid_address(address + size - 1)) {
-        return KNC_ERROR_MEMORY_ACCESS;
-    }
-    
-    uint32_t mmu_id = address_to_mmu(address);
-    uint32_t max_mmus = (architecture == ARCH_KNL) ? KNL_NUM_MMUS : KNC_NUM_MMUS;
-    if (mmu_id >= max_mmus) {
+    // Perform the read; a guard-page fault means the range left guest memory
+    if (!guest_memory->read(address, data, size)) {
         return KNC_ERROR_MEMORY_ACCESS;
     }
-    
-    // Perform the read
-    memcpy(data, memory + address, size);
+    uint32_t mmu_id = address_to_mmu(address & KNC_GUEST_ADDRESS_MASK);
     
     // Transfer data through PCIe bridge if available (simulating device-to-host transfer)
     if (pcie_bridge) {
         pcie_bridge->transferDataDeviceToHost(address, data, size);
     }
     
-    // Update MMU statistics
-    mmus[mmu_id].accesses++;
-    
-    // Simple cache simulation (90% hit rate)
-    if ((rand() % 100) < 90) {
-        mmus[mmu_id].cache_hits++;
-    } else {
-        mmus[mmu_id].cache_misses++;
-    }
-    
+    count_mmu_access(mmu_id);
     return KNC_SUCCESS;
 }
 
 void KNCRuntime::get_mmu_stats(uint32_t mmu_id, uint64_t& accesses, uint64_t& hits, uint64_t& misses) {
-    std::lock_guard<std::mutex> lock(mmu_mutex);
+    accesses = hits = misses = 0;
     
     uint32_t max_mmus = (architecture == ARCH_KNL) ? KNL_NUM_MMUS : KNC_NUM_MMUS;
-    if (mmu_id < max_mmus) {
-        accesses = mmus[mmu_id].accesses;
-        hits = mmus[mmu_id].cache_hits;
-        misses = mmus[mmu_id].cache_misses;
-    } else {
-        accesses = hits = misses = 0;
+    if (mmu_id >= max_mmus) {
+        return;
+    }
+    for (uint32_t shard = 0; shard <= num_cores; shard++) {
+        accesses += mmu_counters[shard].accesses[mmu_id].load(std::memory_order_relaxed);
+        hits += mmu_counters[shard].cache_hits[mmu_id].load(std::memory_order_relaxed);
+        misses += mmu_counters[shard].cache_misses[mmu_id].load(std::memory_order_relaxed);
     }
 }
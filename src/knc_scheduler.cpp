@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2026 IMIC_SDS Development Team
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "knc_scheduler.h"
+#include <iostream>
+#include <chrono>
+
+KNCScheduler::KNCScheduler() {
+    live_contexts.store(0);
+    stop_requested.store(false);
+    num_contexts = 0;
+}
+
+KNCScheduler::~KNCScheduler() {
+    stop();
+}
+
+uint32_t KNCScheduler::default_worker_count(uint32_t contexts) {
+    uint32_t host_cpus = std::thread::hardware_concurrency();
+    if (host_cpus == 0) {
+        host_cpus = 1;
+    }
+    return (contexts < host_cpus) ? (contexts ? contexts : 1) : host_cpus;
+}
+
+bool KNCScheduler::start(uint32_t contexts, uint32_t num_workers, knc_slice_fn_t slice_fn) {
+    if (!workers.empty()) {
+        std::cerr << "Error: Scheduler already running\n";
+        return false;
+    }
+    if (contexts == 0 || !slice_fn) {
+        return false;
+    }
+    if (num_workers == 0) {
+        num_workers = default_worker_count(contexts);
+    }
+    if (num_workers > contexts) {
+        num_workers = contexts;
+    }
+
+    run_slice = slice_fn;
+    num_contexts = contexts;
+    stop_requested.store(false);
+    live_contexts.store(contexts);
+
+    queues.clear();
+    for (uint32_t i = 0; i < num_workers; i++) {
+        std::unique_ptr<knc_worker_queue_t> queue(new knc_worker_queue_t());
+        queue->slices = 0;
+        queue->steals = 0;
+        queue->yields = 0;
+        queue->blocked = 0;
+        queues.push_back(std::move(queue));
+    }
+    for (uint32_t context = 0; context < contexts; context++) {
+        queues[context % num_workers]->contexts.push_back(context);
+    }
+
+    for (uint32_t i = 0; i < num_workers; i++) {
+        workers.emplace_back(&KNCScheduler::worker_loop, this, i);
+    }
+    return true;
+}
+
+void KNCScheduler::stop() {
+    stop_requested.store(true);
+    join();
+}
+
+void KNCScheduler::join() {
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers.clear();
+}
+
+bool KNCScheduler::is_finished() const {
+    return live_contexts.load(std::memory_order_acquire) == 0;
+}
+
+uint32_t KNCScheduler::get_num_workers() const {
+    return static_cast<uint32_t>(queues.size());
+}
+
+bool KNCScheduler::pop_local(uint32_t worker_id, uint32_t& context_id) {
+    knc_worker_queue_t& queue = *queues[worker_id];
+    std::lock_guard<std::mutex> lock(queue.lock);
+    if (queue.contexts.empty()) {
+        return false;
+    }
+    context_id = queue.contexts.front();
+    queue.contexts.pop_front();
+    return true;
+}
+
+bool KNCScheduler::steal(uint32_t worker_id, uint32_t& context_id) {
+    // Take from the tail of the victim's queue - the context it would run last
+    uint32_t num_workers = static_cast<uint32_t>(queues.size());
+    for (uint32_t offset = 1; offset < num_workers; offset++) {
+        knc_worker_queue_t& victim = *queues[(worker_id + offset) % num_workers];
+        std::lock_guard<std::mutex> lock(victim.lock);
+        if (!victim.contexts.empty()) {
+            context_id = victim.contexts.back();
+            victim.contexts.pop_back();
+            queues[worker_id]->steals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void KNCScheduler::push_local(uint32_t worker_id, uint32_t context_id) {
+    knc_worker_queue_t& queue = *queues[worker_id];
+    std::lock_guard<std::mutex> lock(queue.lock);
+    queue.contexts.push_back(context_id);
+}
+
+void KNCScheduler::worker_loop(uint32_t worker_id) {
+    uint32_t idle_spins = 0;
+
+    while (!stop_requested.load(std::memory_order_relaxed) && !is_finished()) {
+        uint32_t context_id;
+        if (!pop_local(worker_id, context_id) && !steal(worker_id, context_id)) {
+            // Every remaining context is running on another worker
+            if (++idle_spins < IDLE_SPINS_BEFORE_SLEEP) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+            continue;
+        }
+        idle_spins = 0;
+
+        knc_slice_result_t result = run_slice(context_id, worker_id);
+        queues[worker_id]->slices++;
+
+        switch (result) {
+            case KNC_SLICE_FINISHED:
+                live_contexts.fetch_sub(1, std::memory_order_acq_rel);
+                break;
+            case KNC_SLICE_YIELDED:
+                queues[worker_id]->yields++;
+                push_local(worker_id, context_id);
+                break;
+            case KNC_SLICE_BLOCKED:
+                // Nothing to do until another worker advances a slower context
+                queues[worker_id]->blocked++;
+                push_local(worker_id, context_id);
+                std::this_thread::yield();
+                break;
+            default:
+                push_local(worker_id, context_id);
+                break;
+        }
+    }
+}
+
+void KNCScheduler::print_statistics() const {
+    uint64_t slices = 0, steals = 0, yields = 0, blocked = 0;
+    for (const auto& queue : queues) {
+        slices += queue->slices;
+        steals += queue->steals;
+        yields += queue->yields;
+        blocked += queue->blocked;
+    }
+
+    std::cout << "Scheduler workers: " << queues.size() << " (" << num_contexts << " contexts)\n";
+    std::cout << "Scheduler slices: " << slices << "\n";
+    std::cout << "Scheduler steals: " << steals << "\n";
+    std::cout << "Scheduler yields: " << yields << "\n";
+    std::cout << "Scheduler blocked slices: " << blocked << "\n";
+}
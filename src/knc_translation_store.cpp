@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2026 IMIC_SDS Development Team
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "knc_translation_store.h"
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static inline uint64_t hash_rotate(uint64_t value, uint32_t bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+uint64_t knc_hash_bytes(const void* data, size_t bytes, uint64_t seed) {
+    static const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+    static const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint64_t hash = seed ^ (bytes * PRIME1);
+
+    // One word at a time, then the tail zero-padded to a word
+    while (bytes >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        hash = hash_rotate(hash ^ (word * PRIME2), 31) * PRIME1;
+        p += 8;
+        bytes -= 8;
+    }
+    if (bytes > 0) {
+        uint64_t word = 0;
+        memcpy(&word, p, bytes);
+        hash = hash_rotate(hash ^ (word * PRIME2), 31) * PRIME1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    return hash;
+}
+
+KNCTranslationStore::KNCTranslationStore() {
+    file_data = nullptr;
+    file_size = 0;
+    blocks = nullptr;
+    instructions = nullptr;
+    block_count = 0;
+}
+
+KNCTranslationStore::~KNCTranslationStore() {
+    close();
+}
+
+bool KNCTranslationStore::map_file(const std::string& path) {
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            file_data = static_cast<const uint8_t*>(mapping);
+            file_size = info.st_size;
+        }
+    }
+    ::close(fd);
+    if (file_data) {
+        return true;
+    }
+#endif
+
+    // No mapping: read the file once instead
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        return false;
+    }
+    file_buffer.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    if (file_buffer.empty()) {
+        return false;
+    }
+    file_data = file_buffer.data();
+    file_size = file_buffer.size();
+    return true;
+}
+
+bool KNCTranslationStore::validate(const knc_translation_cache_key_t& key, std::string& reason) {
+    knc_cache_file_header_t header;
+    if (file_size < sizeof(header)) {
+        reason = "truncated";
+        return false;
+    }
+    memcpy(&header, file_data, sizeof(header));
+    if (header.magic != FILE_MAGIC || header.format_version != FORMAT_VERSION ||
+        header.instruction_size != sizeof(knc_decoded_instruction_t)) {
+        reason = "unknown format";
+        return false;
+    }
+    if (header.key.translator_version != key.translator_version) {
+        reason = "built by another translator version";
+        return false;
+    }
+    if (header.key.architecture != key.architecture) {
+        reason = "built for another architecture";
+        return false;
+    }
+    if (header.key.binary_hash != key.binary_hash || header.key.binary_size != key.binary_size) {
+        reason = "built for another binary";
+        return false;
+    }
+
+    uint64_t payload = static_cast<uint64_t>(header.block_count) * sizeof(knc_cached_block_t) +
+                       static_cast<uint64_t>(header.instruction_count) * sizeof(knc_decoded_instruction_t);
+    if (file_size - sizeof(header) != payload ||
+        knc_hash_bytes(file_data + sizeof(header), payload) != header.payload_hash) {
+        reason = "corrupt";
+        return false;
+    }
+
+    blocks = reinterpret_cast<const knc_cached_block_t*>(file_data + sizeof(header));
+    instructions = reinterpret_cast<const knc_decoded_instruction_t*>(blocks + header.block_count);
+    for (uint32_t i = 0; i < header.block_count; i++) {
+        const knc_cached_block_t& block = blocks[i];
+        if (block.instruction_count == 0 || block.first_instruction > header.instruction_count ||
+            block.instruction_count > header.instruction_count - block.first_instruction ||
+            block.end_address <= block.start_address) {
+            reason = "corrupt";
+            return false;
+        }
+    }
+    block_count = header.block_count;
+    return true;
+}
+
+bool KNCTranslationStore::open(const std::string& path, const knc_translation_cache_key_t& key) {
+    close();
+    if (!map_file(path)) {
+        return false;
+    }
+
+    std::string reason;
+    if (!validate(key, reason)) {
+        std::cout << "Ignoring translation cache " << path << ": " << reason << "\n";
+        close();
+        return false;
+    }
+
+    block_index.reserve(block_count);
+    for (uint32_t i = 0; i < block_count; i++) {
+        block_index[blocks[i].start_address] = i;
+    }
+    return true;
+}
+
+void KNCTranslationStore::close() {
+#ifndef _WIN32
+    if (file_data && file_buffer.empty()) {
+        munmap(const_cast<uint8_t*>(file_data), file_size);
+    }
+#endif
+    file_buffer.clear();
+    file_data = nullptr;
+    file_size = 0;
+    blocks = nullptr;
+    instructions = nullptr;
+    block_count = 0;
+    block_index.clear();
+}
+
+const knc_cached_block_t* KNCTranslationStore::find_block(uint64_t start_address) const {
+    auto it = block_index.find(start_address);
+    return it != block_index.end() ? &blocks[it->second] : nullptr;
+}
+
+const knc_decoded_instruction_t* KNCTranslationStore::get_instructions(const knc_cached_block_t& block) const {
+    return instructions + block.first_instruction;
+}
+
+bool KNCTranslationStore::write(const std::string& path, const knc_translation_cache_key_t& key,
+                                const std::vector<knc_cached_block_t>& blocks,
+                                const std::vector<knc_decoded_instruction_t>& instructions) {
+    knc_cache_file_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = FILE_MAGIC;
+    header.format_version = FORMAT_VERSION;
+    header.instruction_size = sizeof(knc_decoded_instruction_t);
+    header.key = key;
+    header.block_count = static_cast<uint32_t>(blocks.size());
+    header.instruction_count = static_cast<uint32_t>(instructions.size());
+
+    size_t block_bytes = blocks.size() * sizeof(knc_cached_block_t);
+    size_t instruction_bytes = instructions.size() * sizeof(knc_decoded_instruction_t);
+    std::vector<uint8_t> payload(block_bytes + instruction_bytes);
+    if (block_bytes > 0) {
+        memcpy(payload.data(), blocks.data(), block_bytes);
+    }
+    if (instruction_bytes > 0) {
+        memcpy(payload.data() + block_bytes, instructions.data(), instruction_bytes);
+    }
+    header.payload_hash = knc_hash_bytes(payload.data(), payload.size());
+
+    // Write beside the target and rename over it, so concurrent runs of the
+    // same binary only ever see a complete file
+    std::string temporary = path + ".tmp." + std::to_string(getpid());
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Warning: Cannot write translation cache " << temporary << "\n";
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              (payload.empty() || fwrite(payload.data(), payload.size(), 1, file) == 1);
+    ok = (fclose(file) == 0) && ok;
+#ifdef _WIN32
+    if (ok) {
+        remove(path.c_str());
+    }
+#endif
+    if (!ok || rename(temporary.c_str(), path.c_str()) != 0) {
+        std::cerr << "Warning: Cannot write translation cache " << path << "\n";
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,1045 @@
+/*
+ * Copyright (c) 2026 IMIC_SDS Development Team
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "knc_vector_backend.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+// SIMD kernels are compiled per function with target attributes, so the
+// emulator itself builds without -mavx2/-mavx512f and picks a backend at
+// startup from CPUID.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define KNC_VECTOR_HOST_X86 1
+#include <immintrin.h>
+#define KNC_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define KNC_TARGET_AVX512 __attribute__((target("avx512f,avx512cd")))
+#endif
+
+namespace {
+
+// --- Scalar backend ---
+
+void scalar_add_epi32(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b) {
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) dst.u32[i] = a.u32[i] + b.u32[i];
+}
+
+void scalar_sub_epi32(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b) {
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) dst.u32[i] = a.u32[i] - b.u32[i];
+}
+
+void scalar_mullo_epi32(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b) {
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) dst.u32[i] = a.u32[i] * b.u32[i];
+}
+
+void scalar_and_epi32(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b) {
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) dst.u32[i] = a.u32[i] & b.u32[i];
+}
+
+void scalar_or_epi32(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b) {
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) dst.u32[i] = a.u32[i] | b.u32[i];
+}
+
+void scalar_xor_epi32(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b) {
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) dst.u32[i] = a.u32[i] ^ b.u32[i];
+}
+
+void scalar_permutexvar_epi32(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b) {
+    knc_vector_t result;  // dst may alias b
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) result.u32[i] = b.u32[a.u32[i] & (KNC_VECTOR_LANES - 1)];
+    dst = result;
+}
+
+// x86 returns the first NaN source (quieted); the compiler is free to swap the
+// operands of commutative operations, so pick the NaN explicitly
+inline uint32_t x86_nan_result(uint32_t a, uint32_t b, uint32_t result) {
+    const uint32_t exponent = 0x7F800000, quiet = 0x00400000;
+    if ((result & exponent) != exponent || !(result & 0x007FFFFF)) {
+        return result;
+    }
+    if ((a & exponent) == exponent && (a & 0x007FFFFF)) {
+        return a | quiet;
+    }
+    if ((b & exponent) == exponent && (b & 0x007FFFFF)) {
+        return b | quiet;
+    }
+    return result;
+}
+
+void scalar_add_ps(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b) {
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) {
+        knc_vector_t sum;
+        sum.f32[0] = a.f32[i] + b.f32[i];
+        dst.u32[i] = x86_nan_result(a.u32[i], b.u32[i], sum.u32[0]);
+    }
+}
+
+void scalar_sub_ps(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b) {
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) dst.f32[i] = a.f32[i] - b.f32[i];
+}
+
+void scalar_mul_ps(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b) {
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) {
+        knc_vector_t product;
+        product.f32[0] = a.f32[i] * b.f32[i];
+        dst.u32[i] = x86_nan_result(a.u32[i], b.u32[i], product.u32[0]);
+    }
+}
+
+void scalar_div_ps(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b) {
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) dst.f32[i] = a.f32[i] / b.f32[i];
+}
+
+// x86 MAX/MIN return the second operand when either input is NaN or both are zero
+void scalar_max_ps(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b) {
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) dst.f32[i] = a.f32[i] > b.f32[i] ? a.f32[i] : b.f32[i];
+}
+
+void scalar_min_ps(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b) {
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) dst.f32[i] = a.f32[i] < b.f32[i] ? a.f32[i] : b.f32[i];
+}
+
+void scalar_fmadd_ps(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b, const knc_vector_t& c) {
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) {
+        knc_vector_t result;
+        result.f32[0] = std::fma(a.f32[i], b.f32[i], c.f32[i]);
+        dst.u32[i] = x86_nan_result(a.u32[i], b.u32[i], result.u32[0]);  // NaN precedence is a, b, c
+    }
+}
+
+void scalar_mask_mov_epi32(knc_vector_t& dst, const knc_vector_t& src, knc_mask_t mask, bool zeroing) {
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) {
+        uint32_t keep = zeroing ? 0 : dst.u32[i];
+        dst.u32[i] = ((mask >> i) & 1) ? src.u32[i] : keep;
+    }
+}
+
+void scalar_expand_epi32(knc_vector_t& dst, const knc_vector_t& src, knc_mask_t mask, bool zeroing) {
+    knc_vector_t result;  // dst may alias src
+    int next = 0;
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) {
+        uint32_t keep = zeroing ? 0 : dst.u32[i];
+        result.u32[i] = ((mask >> i) & 1) ? src.u32[next++] : keep;
+    }
+    dst = result;
+}
+
+void scalar_compress_epi32(knc_vector_t& dst, const knc_vector_t& src, knc_mask_t mask, bool zeroing) {
+    knc_vector_t result;
+    int next = 0;
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) {
+        if ((mask >> i) & 1) {
+            result.u32[next++] = src.u32[i];
+        }
+    }
+    for (int i = next; i < KNC_VECTOR_LANES; i++) {
+        result.u32[i] = zeroing ? 0 : dst.u32[i];
+    }
+    dst = result;
+}
+
+void scalar_permutex2var_epi32(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b,
+                               const knc_vector_t& c) {
+    knc_vector_t result;
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) {
+        const knc_vector_t& table = (b.u32[i] & KNC_VECTOR_LANES) ? c : a;
+        result.u32[i] = table.u32[b.u32[i] & (KNC_VECTOR_LANES - 1)];
+    }
+    dst = result;
+}
+
+void scalar_conflict_epi32(knc_vector_t& dst, const knc_vector_t& a) {
+    knc_vector_t result;
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) {
+        uint32_t bits = 0;
+        for (int j = 0; j < i; j++) {
+            if (a.u32[j] == a.u32[i]) {
+                bits |= 1u << j;
+            }
+        }
+        result.u32[i] = bits;
+    }
+    dst = result;
+}
+
+void scalar_lzcnt_epi32(knc_vector_t& dst, const knc_vector_t& a) {
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) dst.u32[i] = a.u32[i] ? __builtin_clz(a.u32[i]) : 32;
+}
+
+// ER instructions treat denormal inputs as zero and flush denormal results to zero
+inline float flush_denormal(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if ((bits & 0x7F800000) == 0) {
+        bits &= 0x80000000;
+        memcpy(&value, &bits, sizeof(bits));
+    }
+    return value;
+}
+
+void scalar_rcp28_ps(knc_vector_t& dst, const knc_vector_t& a) {
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) {
+        dst.f32[i] = flush_denormal(static_cast<float>(1.0 / flush_denormal(a.f32[i])));
+    }
+}
+
+void scalar_rsqrt28_ps(knc_vector_t& dst, const knc_vector_t& a) {
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) {
+        dst.f32[i] = static_cast<float>(1.0 / std::sqrt(static_cast<double>(flush_denormal(a.f32[i]))));
+    }
+}
+
+// 2^x = 2^n * 2^f with n = round(x) and |f| <= 1/2; 2^f is the degree-10
+// Taylor series of e^(f ln 2), evaluated with fused multiply-adds so every
+// backend rounds identically. Inputs are clamped to where the result
+// saturates to zero or infinity in single precision.
+const double EXP2_MIN = -151.0;
+const double EXP2_MAX = 129.0;
+const int EXP2_TERMS = 11;
+const double EXP2_COEFFICIENTS[EXP2_TERMS] = {
+    7.0549116208011209e-09, 1.0178086009239696e-07, 1.3215486790144305e-06, 1.5252733804059838e-05,
+    0.00015403530393381606, 0.0013333558146428441, 0.0096181291076284769, 0.055504108664821576,
+    0.24022650695910069, 0.69314718055994529, 1.0
+};
+
+void scalar_exp2_ps(knc_vector_t& dst, const knc_vector_t& a) {
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) {
+        double x = flush_denormal(a.f32[i]);
+        if (x != x) {
+            dst.f32[i] = static_cast<float>(x);  // Quieted NaN
+            continue;
+        }
+        x = std::min(std::max(x, EXP2_MIN), EXP2_MAX);
+        double n = std::nearbyint(x);
+        double f = x - n;
+        double p = EXP2_COEFFICIENTS[0];
+        for (int k = 1; k < EXP2_TERMS; k++) {
+            p = std::fma(p, f, EXP2_COEFFICIENTS[k]);
+        }
+        uint64_t scale_bits = static_cast<uint64_t>(static_cast<int64_t>(n) + 1023) << 52;
+        double scale;
+        memcpy(&scale, &scale_bits, sizeof(scale));
+        dst.f32[i] = flush_denormal(static_cast<float>(p * scale));
+    }
+}
+
+// KNC swizzles, as the source lane within each group of four for each
+// destination lane
+const uint8_t SWIZZLE_LANES[8][4] = {
+    {0, 1, 2, 3},   // None (dcba)
+    {1, 0, 3, 2},   // cdab
+    {2, 3, 0, 1},   // badc
+    {1, 2, 0, 3},   // dacb
+    {0, 0, 0, 0},   // aaaa
+    {1, 1, 1, 1},   // bbbb
+    {2, 2, 2, 2},   // cccc
+    {3, 3, 3, 3}    // dddd
+};
+
+void scalar_swizzle_epi32(knc_vector_t& dst, const knc_vector_t& src, uint8_t swizzle) {
+    knc_vector_t result;
+    const uint8_t* lanes = SWIZZLE_LANES[swizzle & 7];
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) result.u32[i] = src.u32[(i & ~3) | lanes[i & 3]];
+    dst = result;
+}
+
+// IEEE half precision, rounded to nearest even; NaNs stay quiet NaNs with
+// the top of their payload, as F16C converts them
+inline uint16_t float_to_half(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    uint32_t exponent = (bits >> 23) & 0xFF;
+    uint32_t mantissa = bits & 0x007FFFFF;
+    if (exponent == 0xFF) {
+        return sign | 0x7C00 | (mantissa ? 0x0200 | (mantissa >> 13) : 0);
+    }
+    int half_exponent = static_cast<int>(exponent) - 127 + 15;
+    if (half_exponent >= 31) {
+        return sign | 0x7C00;
+    }
+    uint32_t shift = 13;
+    uint32_t result = (static_cast<uint32_t>(std::max(half_exponent, 0)) << 10);
+    if (half_exponent <= 0) {
+        // Denormal result: shift the implicit bit in as well
+        if (half_exponent < -10) {
+            return sign;
+        }
+        mantissa |= 0x00800000;
+        shift = 14 - half_exponent;
+    }
+    result |= mantissa >> shift;
+    uint32_t remainder = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (result & 1))) {
+        result++;  // May carry into the exponent, up to infinity
+    }
+    return static_cast<uint16_t>(sign | result);
+}
+
+inline float half_to_float(uint16_t half) {
+    uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x03FF;
+    uint32_t bits;
+    if (exponent == 0x1F) {
+        bits = sign | 0x7F800000 | (mantissa << 13) | (mantissa ? 0x00400000 : 0);
+    } else if (exponent == 0) {
+        float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+        memcpy(&bits, &magnitude, sizeof(bits));
+        bits |= sign;
+    } else {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// cvtps2dq with round to nearest even: NaN and out-of-range values give
+// the integer indefinite 0x80000000
+inline int32_t x86_float_to_int32(float value) {
+    if (!(value >= -2147483648.0f && value < 2147483648.0f)) {
+        return INT32_MIN;
+    }
+    return static_cast<int32_t>(std::nearbyint(value));
+}
+
+inline int32_t saturate(int32_t value, int32_t low, int32_t high) {
+    return std::min(std::max(value, low), high);
+}
+
+void scalar_upconvert(knc_vector_t& dst, const void* src, uint8_t format, bool to_float) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(src);
+    knc_vector_t result;  // dst may overlap src
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) {
+        int32_t value;
+        switch (format) {
+            case KNC_CONV_FLOAT16: {
+                uint16_t half;
+                memcpy(&half, bytes + i * 2, sizeof(half));
+                result.f32[i] = half_to_float(half);
+                continue;
+            }
+            case KNC_CONV_UINT8: value = bytes[i]; break;
+            case KNC_CONV_SINT8: value = static_cast<int8_t>(bytes[i]); break;
+            case KNC_CONV_UINT16: { uint16_t v; memcpy(&v, bytes + i * 2, 2); value = v; break; }
+            case KNC_CONV_SINT16: { int16_t v; memcpy(&v, bytes + i * 2, 2); value = v; break; }
+            default:
+                memcpy(&result.u32[i], bytes + i * 4, 4);
+                continue;
+        }
+        if (to_float) {
+            result.f32[i] = static_cast<float>(value);
+        } else {
+            result.i32[i] = value;
+        }
+    }
+    dst = result;
+}
+
+void scalar_downconvert(void* dst, const knc_vector_t& src, uint8_t format, bool from_float) {
+    knc_vector_t result;  // dst may overlap src
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) {
+        if (format == KNC_CONV_FLOAT16) {
+            result.u16[i] = float_to_half(src.f32[i]);
+            continue;
+        }
+        int32_t value = from_float ? x86_float_to_int32(src.f32[i]) : src.i32[i];
+        switch (format) {
+            case KNC_CONV_UINT8: result.u8[i] = static_cast<uint8_t>(from_float ? saturate(value, 0, 255) : value); break;
+            case KNC_CONV_SINT8: result.u8[i] = static_cast<uint8_t>(from_float ? saturate(value, -128, 127) : value); break;
+            case KNC_CONV_UINT16: result.u16[i] = static_cast<uint16_t>(from_float ? saturate(value, 0, 65535) : value); break;
+            case KNC_CONV_SINT16: result.u16[i] = static_cast<uint16_t>(from_float ? saturate(value, -32768, 32767) : value); break;
+            default: result.u32[i] = src.u32[i]; break;
+        }
+    }
+    memcpy(dst, &result, knc_conversion_element_size(format) * KNC_VECTOR_LANES);
+}
+
+void scalar_gather_epi32(knc_vector_t& dst, const uint64_t addresses[KNC_VECTOR_LANES], knc_mask_t mask) {
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) {
+        if ((mask >> i) & 1) {
+            memcpy(&dst.u32[i], reinterpret_cast<const void*>(addresses[i]), sizeof(uint32_t));
+        }
+    }
+}
+
+void scalar_scatter_epi32(const uint64_t addresses[KNC_VECTOR_LANES], const knc_vector_t& src, knc_mask_t mask) {
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) {
+        if ((mask >> i) & 1) {
+            memcpy(reinterpret_cast<void*>(addresses[i]), &src.u32[i], sizeof(uint32_t));
+        }
+    }
+}
+
+const knc_vector_ops_t scalar_ops = {
+    KNC_VECTOR_BACKEND_SCALAR, "scalar",
+    scalar_add_epi32, scalar_sub_epi32, scalar_mullo_epi32,
+    scalar_and_epi32, scalar_or_epi32, scalar_xor_epi32, scalar_permutexvar_epi32,
+    scalar_add_ps, scalar_sub_ps, scalar_mul_ps, scalar_div_ps, scalar_max_ps, scalar_min_ps,
+    scalar_fmadd_ps,
+    scalar_mask_mov_epi32,
+    scalar_expand_epi32, scalar_compress_epi32, scalar_permutex2var_epi32,
+    scalar_conflict_epi32, scalar_lzcnt_epi32,
+    scalar_rcp28_ps, scalar_rsqrt28_ps, scalar_exp2_ps,
+    scalar_swizzle_epi32, scalar_upconvert, scalar_downconvert,
+    scalar_gather_epi32, scalar_scatter_epi32
+};
+
+#ifdef KNC_VECTOR_HOST_X86
+
+// --- AVX2 backend: each 512-bit operation is split into two 256-bit halves ---
+
+#define KNC_AVX2_INT_BINARY(name, intrinsic)                                                   \
+    KNC_TARGET_AVX2 void name(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b) { \
+        for (int h = 0; h < 2; h++) {                                                          \
+            __m256i x = _mm256_load_si256(reinterpret_cast<const __m256i*>(&a.u32[h * 8]));    \
+            __m256i y = _mm256_load_si256(reinterpret_cast<const __m256i*>(&b.u32[h * 8]));    \
+            _mm256_store_si256(reinterpret_cast<__m256i*>(&dst.u32[h * 8]), intrinsic(x, y));  \
+        }                                                                                      \
+    }
+
+#define KNC_AVX2_PS_BINARY(name, intrinsic)                                                    \
+    KNC_TARGET_AVX2 void name(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b) { \
+        for (int h = 0; h < 2; h++) {                                                          \
+            __m256 x = _mm256_load_ps(&a.f32[h * 8]);                                          \
+            __m256 y = _mm256_load_ps(&b.f32[h * 8]);                                          \
+            _mm256_store_ps(&dst.f32[h * 8], intrinsic(x, y));                                 \
+        }                                                                                      \
+    }
+
+// The compiler may swap the operands of commutative intrinsics; restore the
+// x86 rule that a NaN in the first source wins
+KNC_TARGET_AVX2 inline __m256 avx2_first_nan(__m256 x, __m256 y, __m256 result) {
+    __m256 x_nan = _mm256_cmp_ps(x, x, _CMP_UNORD_Q);
+    __m256 y_nan = _mm256_cmp_ps(y, y, _CMP_UNORD_Q);
+    if (_mm256_movemask_ps(_mm256_or_ps(x_nan, y_nan)) == 0) {
+        return result;
+    }
+    const __m256 quiet = _mm256_castsi256_ps(_mm256_set1_epi32(0x00400000));
+    result = _mm256_blendv_ps(result, _mm256_or_ps(y, quiet), y_nan);
+    return _mm256_blendv_ps(result, _mm256_or_ps(x, quiet), x_nan);
+}
+
+KNC_TARGET_AVX2 inline __m256 avx2_add_ordered(__m256 x, __m256 y) {
+    return avx2_first_nan(x, y, _mm256_add_ps(x, y));
+}
+
+KNC_TARGET_AVX2 inline __m256 avx2_mul_ordered(__m256 x, __m256 y) {
+    return avx2_first_nan(x, y, _mm256_mul_ps(x, y));
+}
+
+KNC_AVX2_INT_BINARY(avx2_add_epi32, _mm256_add_epi32)
+KNC_AVX2_INT_BINARY(avx2_sub_epi32, _mm256_sub_epi32)
+KNC_AVX2_INT_BINARY(avx2_mullo_epi32, _mm256_mullo_epi32)
+KNC_AVX2_INT_BINARY(avx2_and_epi32, _mm256_and_si256)
+KNC_AVX2_INT_BINARY(avx2_or_epi32, _mm256_or_si256)
+KNC_AVX2_INT_BINARY(avx2_xor_epi32, _mm256_xor_si256)
+KNC_AVX2_PS_BINARY(avx2_add_ps, avx2_add_ordered)
+KNC_AVX2_PS_BINARY(avx2_sub_ps, _mm256_sub_ps)
+KNC_AVX2_PS_BINARY(avx2_mul_ps, avx2_mul_ordered)
+KNC_AVX2_PS_BINARY(avx2_div_ps, _mm256_div_ps)
+KNC_AVX2_PS_BINARY(avx2_max_ps, _mm256_max_ps)
+KNC_AVX2_PS_BINARY(avx2_min_ps, _mm256_min_ps)
+
+#undef KNC_AVX2_INT_BINARY
+#undef KNC_AVX2_PS_BINARY
+
+KNC_TARGET_AVX2 void avx2_permutexvar_epi32(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b) {
+    __m256i lo = _mm256_load_si256(reinterpret_cast<const __m256i*>(&b.u32[0]));
+    __m256i hi = _mm256_load_si256(reinterpret_cast<const __m256i*>(&b.u32[8]));
+    __m256i result[2];
+    for (int h = 0; h < 2; h++) {
+        // Permute within each source half, then pick the half selected by index bit 3
+        __m256i index = _mm256_load_si256(reinterpret_cast<const __m256i*>(&a.u32[h * 8]));
+        __m256 from_lo = _mm256_castsi256_ps(_mm256_permutevar8x32_epi32(lo, index));
+        __m256 from_hi = _mm256_castsi256_ps(_mm256_permutevar8x32_epi32(hi, index));
+        __m256 select = _mm256_castsi256_ps(_mm256_slli_epi32(index, 28));
+        result[h] = _mm256_castps_si256(_mm256_blendv_ps(from_lo, from_hi, select));
+    }
+    _mm256_store_si256(reinterpret_cast<__m256i*>(&dst.u32[0]), result[0]);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(&dst.u32[8]), result[1]);
+}
+
+KNC_TARGET_AVX2 void avx2_fmadd_ps(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b,
+                                   const knc_vector_t& c) {
+    for (int h = 0; h < 2; h++) {
+        __m256 x = _mm256_load_ps(&a.f32[h * 8]);
+        __m256 y = _mm256_load_ps(&b.f32[h * 8]);
+        __m256 z = _mm256_load_ps(&c.f32[h * 8]);
+        _mm256_store_ps(&dst.f32[h * 8], avx2_first_nan(x, y, _mm256_fmadd_ps(x, y, z)));
+    }
+}
+
+KNC_TARGET_AVX2 void avx2_mask_mov_epi32(knc_vector_t& dst, const knc_vector_t& src, knc_mask_t mask, bool zeroing) {
+    const __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    for (int h = 0; h < 2; h++) {
+        __m256i lanes = _mm256_set1_epi32((mask >> (h * 8)) & 0xFF);
+        __m256i select = _mm256_cmpeq_epi32(_mm256_and_si256(lanes, bits), bits);
+        __m256i value = _mm256_load_si256(reinterpret_cast<const __m256i*>(&src.u32[h * 8]));
+        __m256i* out = reinterpret_cast<__m256i*>(&dst.u32[h * 8]);
+        __m256i keep = zeroing ? _mm256_setzero_si256() : _mm256_load_si256(out);
+        _mm256_store_si256(out, _mm256_blendv_epi8(keep, value, select));
+    }
+}
+
+KNC_TARGET_AVX2 void avx2_swizzle_epi32(knc_vector_t& dst, const knc_vector_t& src, uint8_t swizzle) {
+    for (int h = 0; h < 2; h++) {
+        __m256i value = _mm256_load_si256(reinterpret_cast<const __m256i*>(&src.u32[h * 8]));
+        switch (swizzle) {
+            case KNC_SWIZZLE_CDAB: value = _mm256_shuffle_epi32(value, _MM_PERM_CDAB); break;
+            case KNC_SWIZZLE_BADC: value = _mm256_shuffle_epi32(value, _MM_PERM_BADC); break;
+            case KNC_SWIZZLE_DACB: value = _mm256_shuffle_epi32(value, _MM_PERM_DACB); break;
+            case KNC_SWIZZLE_AAAA: value = _mm256_shuffle_epi32(value, _MM_PERM_AAAA); break;
+            case KNC_SWIZZLE_BBBB: value = _mm256_shuffle_epi32(value, _MM_PERM_BBBB); break;
+            case KNC_SWIZZLE_CCCC: value = _mm256_shuffle_epi32(value, _MM_PERM_CCCC); break;
+            case KNC_SWIZZLE_DDDD: value = _mm256_shuffle_epi32(value, _MM_PERM_DDDD); break;
+            default: break;
+        }
+        _mm256_store_si256(reinterpret_cast<__m256i*>(&dst.u32[h * 8]), value);
+    }
+}
+
+KNC_TARGET_AVX2 void avx2_gather_epi32(knc_vector_t& dst, const uint64_t addresses[KNC_VECTOR_LANES], knc_mask_t mask) {
+    // Four lanes per gather: 64-bit absolute addresses with a null base
+    const __m128i bits = _mm_setr_epi32(1, 2, 4, 8);
+    for (int q = 0; q < 4; q++) {
+        __m128i lanes = _mm_set1_epi32((mask >> (q * 4)) & 0xF);
+        __m128i select = _mm_cmpeq_epi32(_mm_and_si128(lanes, bits), bits);
+        __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&addresses[q * 4]));
+        __m128i* out = reinterpret_cast<__m128i*>(&dst.u32[q * 4]);
+        _mm_store_si128(out, _mm256_mask_i64gather_epi32(_mm_load_si128(out), nullptr, index, select, 1));
+    }
+}
+
+const knc_vector_ops_t avx2_ops = {
+    KNC_VECTOR_BACKEND_AVX2, "avx2",
+    avx2_add_epi32, avx2_sub_epi32, avx2_mullo_epi32,
+    avx2_and_epi32, avx2_or_epi32, avx2_xor_epi32, avx2_permutexvar_epi32,
+    avx2_add_ps, avx2_sub_ps, avx2_mul_ps, avx2_div_ps, avx2_max_ps, avx2_min_ps,
+    avx2_fmadd_ps,
+    avx2_mask_mov_epi32,
+    scalar_expand_epi32, scalar_compress_epi32, scalar_permutex2var_epi32,
+    scalar_conflict_epi32, scalar_lzcnt_epi32,
+    scalar_rcp28_ps, scalar_rsqrt28_ps, scalar_exp2_ps,
+    avx2_swizzle_epi32, scalar_upconvert, scalar_downconvert,
+    avx2_gather_epi32, scalar_scatter_epi32
+};
+
+// --- AVX-512 backend: one host instruction per emulated operation ---
+
+#define KNC_AVX512_INT_BINARY(name, intrinsic)                                                    \
+    KNC_TARGET_AVX512 void name(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b) { \
+        _mm512_store_si512(dst.u32, intrinsic(_mm512_load_si512(a.u32), _mm512_load_si512(b.u32)));  \
+    }
+
+#define KNC_AVX512_PS_BINARY(name, intrinsic)                                                     \
+    KNC_TARGET_AVX512 void name(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b) { \
+        _mm512_store_ps(dst.f32, intrinsic(_mm512_load_ps(a.f32), _mm512_load_ps(b.f32)));          \
+    }
+
+KNC_TARGET_AVX512 inline __m512 avx512_first_nan(__m512 x, __m512 y, __m512 result) {
+    __mmask16 x_nan = _mm512_cmp_ps_mask(x, x, _CMP_UNORD_Q);
+    __mmask16 y_nan = _mm512_cmp_ps_mask(y, y, _CMP_UNORD_Q);
+    if ((x_nan | y_nan) == 0) {
+        return result;
+    }
+    const __m512i quiet = _mm512_set1_epi32(0x00400000);
+    result = _mm512_mask_mov_ps(result, y_nan, _mm512_castsi512_ps(_mm512_or_epi32(_mm512_castps_si512(y), quiet)));
+    return _mm512_mask_mov_ps(result, x_nan, _mm512_castsi512_ps(_mm512_or_epi32(_mm512_castps_si512(x), quiet)));
+}
+
+KNC_TARGET_AVX512 inline __m512 avx512_add_ordered(__m512 x, __m512 y) {
+    return avx512_first_nan(x, y, _mm512_add_ps(x, y));
+}
+
+KNC_TARGET_AVX512 inline __m512 avx512_mul_ordered(__m512 x, __m512 y) {
+    return avx512_first_nan(x, y, _mm512_mul_ps(x, y));
+}
+
+KNC_AVX512_INT_BINARY(avx512_add_epi32, _mm512_add_epi32)
+KNC_AVX512_INT_BINARY(avx512_sub_epi32, _mm512_sub_epi32)
+KNC_AVX512_INT_BINARY(avx512_mullo_epi32, _mm512_mullo_epi32)
+KNC_AVX512_INT_BINARY(avx512_and_epi32, _mm512_and_epi32)
+KNC_AVX512_INT_BINARY(avx512_or_epi32, _mm512_or_epi32)
+KNC_AVX512_INT_BINARY(avx512_xor_epi32, _mm512_xor_epi32)
+KNC_AVX512_INT_BINARY(avx512_permutexvar_epi32, _mm512_permutexvar_epi32)
+KNC_AVX512_PS_BINARY(avx512_add_ps, avx512_add_ordered)
+KNC_AVX512_PS_BINARY(avx512_sub_ps, _mm512_sub_ps)
+KNC_AVX512_PS_BINARY(avx512_mul_ps, avx512_mul_ordered)
+KNC_AVX512_PS_BINARY(avx512_div_ps, _mm512_div_ps)
+KNC_AVX512_PS_BINARY(avx512_max_ps, _mm512_max_ps)
+KNC_AVX512_PS_BINARY(avx512_min_ps, _mm512_min_ps)
+
+#undef KNC_AVX512_INT_BINARY
+#undef KNC_AVX512_PS_BINARY
+
+KNC_TARGET_AVX512 void avx512_fmadd_ps(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b,
+                                       const knc_vector_t& c) {
+    __m512 x = _mm512_load_ps(a.f32);
+    __m512 y = _mm512_load_ps(b.f32);
+    _mm512_store_ps(dst.f32, avx512_first_nan(x, y, _mm512_fmadd_ps(x, y, _mm512_load_ps(c.f32))));
+}
+
+KNC_TARGET_AVX512 void avx512_mask_mov_epi32(knc_vector_t& dst, const knc_vector_t& src, knc_mask_t mask,
+                                             bool zeroing) {
+    __m512i value = _mm512_load_si512(src.u32);
+    if (zeroing) {
+        _mm512_store_si512(dst.u32, _mm512_maskz_mov_epi32(mask, value));
+    } else {
+        _mm512_store_si512(dst.u32, _mm512_mask_mov_epi32(_mm512_load_si512(dst.u32), mask, value));
+    }
+}
+
+KNC_TARGET_AVX512 void avx512_expand_epi32(knc_vector_t& dst, const knc_vector_t& src, knc_mask_t mask,
+                                           bool zeroing) {
+    __m512i value = _mm512_load_si512(src.u32);
+    if (zeroing) {
+        _mm512_store_si512(dst.u32, _mm512_maskz_expand_epi32(mask, value));
+    } else {
+        _mm512_store_si512(dst.u32, _mm512_mask_expand_epi32(_mm512_load_si512(dst.u32), mask, value));
+    }
+}
+
+KNC_TARGET_AVX512 void avx512_compress_epi32(knc_vector_t& dst, const knc_vector_t& src, knc_mask_t mask,
+                                             bool zeroing) {
+    __m512i value = _mm512_load_si512(src.u32);
+    if (zeroing) {
+        _mm512_store_si512(dst.u32, _mm512_maskz_compress_epi32(mask, value));
+    } else {
+        _mm512_store_si512(dst.u32, _mm512_mask_compress_epi32(_mm512_load_si512(dst.u32), mask, value));
+    }
+}
+
+KNC_TARGET_AVX512 void avx512_permutex2var_epi32(knc_vector_t& dst, const knc_vector_t& a, const knc_vector_t& b,
+                                                 const knc_vector_t& c) {
+    _mm512_store_si512(dst.u32, _mm512_permutex2var_epi32(_mm512_load_si512(a.u32), _mm512_load_si512(b.u32),
+                                                          _mm512_load_si512(c.u32)));
+}
+
+KNC_TARGET_AVX512 void avx512_conflict_epi32(knc_vector_t& dst, const knc_vector_t& a) {
+    _mm512_store_si512(dst.u32, _mm512_conflict_epi32(_mm512_load_si512(a.u32)));
+}
+
+KNC_TARGET_AVX512 void avx512_lzcnt_epi32(knc_vector_t& dst, const knc_vector_t& a) {
+    _mm512_store_si512(dst.u32, _mm512_lzcnt_epi32(_mm512_load_si512(a.u32)));
+}
+
+KNC_TARGET_AVX512 inline __m512 avx512_flush_denormal(__m512 value) {
+    const __m512i exponent = _mm512_set1_epi32(0x7F800000);
+    const __m512i sign = _mm512_set1_epi32(static_cast<int>(0x80000000u));
+    __m512i bits = _mm512_castps_si512(value);
+    __mmask16 denormal = _mm512_testn_epi32_mask(bits, exponent);
+    return _mm512_castsi512_ps(_mm512_mask_and_epi32(bits, denormal, bits, sign));
+}
+
+// The ER kernels work in double precision, eight lanes at a time
+KNC_TARGET_AVX512 inline __m512d avx512_widen_half(const knc_vector_t& value, int half) {
+    return _mm512_cvtps_pd(_mm256_load_ps(&value.f32[half * 8]));
+}
+
+KNC_TARGET_AVX512 inline void avx512_store_narrowed(knc_vector_t& dst, __m512d low, __m512d high) {
+    _mm256_store_ps(&dst.f32[0], _mm512_cvtpd_ps(low));
+    _mm256_store_ps(&dst.f32[8], _mm512_cvtpd_ps(high));
+    _mm512_store_ps(dst.f32, avx512_flush_denormal(_mm512_load_ps(dst.f32)));
+}
+
+KNC_TARGET_AVX512 void avx512_rcp28_ps(knc_vector_t& dst, const knc_vector_t& a) {
+    knc_vector_t input;
+    _mm512_store_ps(input.f32, avx512_flush_denormal(_mm512_load_ps(a.f32)));
+    const __m512d one = _mm512_set1_pd(1.0);
+    avx512_store_narrowed(dst, _mm512_div_pd(one, avx512_widen_half(input, 0)),
+                          _mm512_div_pd(one, avx512_widen_half(input, 1)));
+}
+
+KNC_TARGET_AVX512 void avx512_rsqrt28_ps(knc_vector_t& dst, const knc_vector_t& a) {
+    knc_vector_t input;
+    _mm512_store_ps(input.f32, avx512_flush_denormal(_mm512_load_ps(a.f32)));
+    const __m512d one = _mm512_set1_pd(1.0);
+    avx512_store_narrowed(dst, _mm512_div_pd(one, _mm512_sqrt_pd(avx512_widen_half(input, 0))),
+                          _mm512_div_pd(one, _mm512_sqrt_pd(avx512_widen_half(input, 1))));
+}
+
+KNC_TARGET_AVX512 inline __m512d avx512_exp2_pd(__m512d x) {
+    __mmask8 nan = _mm512_cmp_pd_mask(x, x, _CMP_UNORD_Q);
+    __m512d clamped = _mm512_min_pd(_mm512_max_pd(x, _mm512_set1_pd(EXP2_MIN)), _mm512_set1_pd(EXP2_MAX));
+    __m512d n = _mm512_roundscale_pd(clamped, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512d f = _mm512_sub_pd(clamped, n);
+    __m512d p = _mm512_set1_pd(EXP2_COEFFICIENTS[0]);
+    for (int k = 1; k < EXP2_TERMS; k++) {
+        p = _mm512_fmadd_pd(p, f, _mm512_set1_pd(EXP2_COEFFICIENTS[k]));
+    }
+    __m512i exponent = _mm512_add_epi64(_mm512_cvtepi32_epi64(_mm512_cvtpd_epi32(n)), _mm512_set1_epi64(1023));
+    __m512d scale = _mm512_castsi512_pd(_mm512_slli_epi64(exponent, 52));
+    return _mm512_mask_mov_pd(_mm512_mul_pd(p, scale), nan, x);
+}
+
+KNC_TARGET_AVX512 void avx512_exp2_ps(knc_vector_t& dst, const knc_vector_t& a) {
+    knc_vector_t input;
+    _mm512_store_ps(input.f32, avx512_flush_denormal(_mm512_load_ps(a.f32)));
+    avx512_store_narrowed(dst, avx512_exp2_pd(avx512_widen_half(input, 0)), avx512_exp2_pd(avx512_widen_half(input, 1)));
+}
+
+KNC_TARGET_AVX512 void avx512_swizzle_epi32(knc_vector_t& dst, const knc_vector_t& src, uint8_t swizzle) {
+    __m512i value = _mm512_load_si512(src.u32);
+    switch (swizzle) {
+        case KNC_SWIZZLE_CDAB: value = _mm512_shuffle_epi32(value, _MM_PERM_CDAB); break;
+        case KNC_SWIZZLE_BADC: value = _mm512_shuffle_epi32(value, _MM_PERM_BADC); break;
+        case KNC_SWIZZLE_DACB: value = _mm512_shuffle_epi32(value, _MM_PERM_DACB); break;
+        case KNC_SWIZZLE_AAAA: value = _mm512_shuffle_epi32(value, _MM_PERM_AAAA); break;
+        case KNC_SWIZZLE_BBBB: value = _mm512_shuffle_epi32(value, _MM_PERM_BBBB); break;
+        case KNC_SWIZZLE_CCCC: value = _mm512_shuffle_epi32(value, _MM_PERM_CCCC); break;
+        case KNC_SWIZZLE_DDDD: value = _mm512_shuffle_epi32(value, _MM_PERM_DDDD); break;
+        default: break;
+    }
+    _mm512_store_si512(dst.u32, value);
+}
+
+KNC_TARGET_AVX512 void avx512_upconvert(knc_vector_t& dst, const void* src, uint8_t format, bool to_float) {
+    __m512i value;
+    switch (format) {
+        case KNC_CONV_FLOAT16:
+            _mm512_store_ps(dst.f32, _mm512_cvtph_ps(_mm256_loadu_si256(static_cast<const __m256i*>(src))));
+            return;
+        case KNC_CONV_UINT8: value = _mm512_cvtepu8_epi32(_mm_loadu_si128(static_cast<const __m128i*>(src))); break;
+        case KNC_CONV_SINT8: value = _mm512_cvtepi8_epi32(_mm_loadu_si128(static_cast<const __m128i*>(src))); break;
+        case KNC_CONV_UINT16: value = _mm512_cvtepu16_epi32(_mm256_loadu_si256(static_cast<const __m256i*>(src))); break;
+        case KNC_CONV_SINT16: value = _mm512_cvtepi16_epi32(_mm256_loadu_si256(static_cast<const __m256i*>(src))); break;
+        default:
+            _mm512_store_si512(dst.u32, _mm512_loadu_si512(src));
+            return;
+    }
+    if (to_float) {
+        value = _mm512_castps_si512(_mm512_cvtepi32_ps(value));
+    }
+    _mm512_store_si512(dst.u32, value);
+}
+
+KNC_TARGET_AVX512 void avx512_downconvert(void* dst, const knc_vector_t& src, uint8_t format, bool from_float) {
+    if (format == KNC_CONV_FLOAT16) {
+        _mm256_storeu_si256(static_cast<__m256i*>(dst),
+                            _mm512_cvtps_ph(_mm512_load_ps(src.f32), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+        return;
+    }
+    __m512i value = _mm512_load_si512(src.u32);
+    if (format == KNC_CONV_NONE) {
+        _mm512_storeu_si512(dst, value);
+        return;
+    }
+    if (from_float) {
+        // Round, then saturate; negative values clamp to zero for the unsigned formats
+        value = _mm512_cvt_roundps_epi32(_mm512_load_ps(src.f32), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        if (format == KNC_CONV_UINT8 || format == KNC_CONV_UINT16) {
+            value = _mm512_max_epi32(value, _mm512_setzero_si512());
+        }
+    }
+    switch (format) {
+        case KNC_CONV_UINT8:
+            _mm_storeu_si128(static_cast<__m128i*>(dst), from_float ? _mm512_cvtusepi32_epi8(value) : _mm512_cvtepi32_epi8(value));
+            break;
+        case KNC_CONV_SINT8:
+            _mm_storeu_si128(static_cast<__m128i*>(dst), from_float ? _mm512_cvtsepi32_epi8(value) : _mm512_cvtepi32_epi8(value));
+            break;
+        case KNC_CONV_UINT16:
+            _mm256_storeu_si256(static_cast<__m256i*>(dst),
+                                from_float ? _mm512_cvtusepi32_epi16(value) : _mm512_cvtepi32_epi16(value));
+            break;
+        default:
+            _mm256_storeu_si256(static_cast<__m256i*>(dst),
+                                from_float ? _mm512_cvtsepi32_epi16(value) : _mm512_cvtepi32_epi16(value));
+            break;
+    }
+}
+
+KNC_TARGET_AVX512 void avx512_gather_epi32(knc_vector_t& dst, const uint64_t addresses[KNC_VECTOR_LANES],
+                                            knc_mask_t mask) {
+    // Eight lanes per gather: 64-bit absolute addresses with a null base
+    for (int h = 0; h < 2; h++) {
+        __m512i index = _mm512_loadu_si512(&addresses[h * 8]);
+        __m256i* out = reinterpret_cast<__m256i*>(&dst.u32[h * 8]);
+        _mm256_store_si256(out, _mm512_mask_i64gather_epi32(_mm256_load_si256(out),
+                                                            static_cast<__mmask8>(mask >> (h * 8)), index,
+                                                            nullptr, 1));
+    }
+}
+
+KNC_TARGET_AVX512 void avx512_scatter_epi32(const uint64_t addresses[KNC_VECTOR_LANES], const knc_vector_t& src,
+                                             knc_mask_t mask) {
+    // Low half first, so repeated addresses keep the highest lane
+    for (int h = 0; h < 2; h++) {
+        __m512i index = _mm512_loadu_si512(&addresses[h * 8]);
+        __m256i value = _mm256_load_si256(reinterpret_cast<const __m256i*>(&src.u32[h * 8]));
+        _mm512_mask_i64scatter_epi32(nullptr, static_cast<__mmask8>(mask >> (h * 8)), index, value, 1);
+    }
+}
+
+const knc_vector_ops_t avx512_ops = {
+    KNC_VECTOR_BACKEND_AVX512, "avx512",
+    avx512_add_epi32, avx512_sub_epi32, avx512_mullo_epi32,
+    avx512_and_epi32, avx512_or_epi32, avx512_xor_epi32, avx512_permutexvar_epi32,
+    avx512_add_ps, avx512_sub_ps, avx512_mul_ps, avx512_div_ps, avx512_max_ps, avx512_min_ps,
+    avx512_fmadd_ps,
+    avx512_mask_mov_epi32,
+    avx512_expand_epi32, avx512_compress_epi32, avx512_permutex2var_epi32,
+    avx512_conflict_epi32, avx512_lzcnt_epi32,
+    avx512_rcp28_ps, avx512_rsqrt28_ps, avx512_exp2_ps,
+    avx512_swizzle_epi32, avx512_upconvert, avx512_downconvert,
+    avx512_gather_epi32, avx512_scatter_epi32
+};
+
+#endif // KNC_VECTOR_HOST_X86
+
+// --- Benchmark support ---
+
+struct knc_vector_kernel_t {
+    const char* name;
+    knc_vector_binary_fn_t binary;
+    knc_vector_ternary_fn_t ternary;
+    knc_vector_mask_fn_t mask;
+    knc_vector_unary_fn_t unary;
+    knc_vector_swizzle_fn_t swizzle;
+    knc_vector_upconvert_fn_t upconvert;
+    knc_vector_downconvert_fn_t downconvert;
+    uint8_t operand;  // Swizzle or conversion format
+    knc_vector_gather_fn_t gather;
+    knc_vector_scatter_fn_t scatter;
+};
+
+static const int NUM_BENCHMARK_KERNELS = 33;
+
+void list_kernels(const knc_vector_ops_t& ops, knc_vector_kernel_t kernels[NUM_BENCHMARK_KERNELS]) {
+    const knc_vector_kernel_t list[NUM_BENCHMARK_KERNELS] = {
+        {"vpaddd", ops.add_epi32, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 0, nullptr, nullptr},
+        {"vpsubd", ops.sub_epi32, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 0, nullptr, nullptr},
+        {"vpmulld", ops.mullo_epi32, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 0, nullptr, nullptr},
+        {"vpandd", ops.and_epi32, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 0, nullptr, nullptr},
+        {"vpord", ops.or_epi32, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 0, nullptr, nullptr},
+        {"vpxord", ops.xor_epi32, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 0, nullptr, nullptr},
+        {"vpermd", ops.permutexvar_epi32, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 0, nullptr, nullptr},
+        {"vaddps", ops.add_ps, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 0, nullptr, nullptr},
+        {"vsubps", ops.sub_ps, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 0, nullptr, nullptr},
+        {"vmulps", ops.mul_ps, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 0, nullptr, nullptr},
+        {"vdivps", ops.div_ps, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 0, nullptr, nullptr},
+        {"vmaxps", ops.max_ps, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 0, nullptr, nullptr},
+        {"vminps", ops.min_ps, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 0, nullptr, nullptr},
+        {"vfmadd231ps", nullptr, ops.fmadd_ps, nullptr, nullptr, nullptr, nullptr, nullptr, 0, nullptr, nullptr},
+        {"masked move", nullptr, nullptr, ops.mask_mov_epi32, nullptr, nullptr, nullptr, nullptr, 0, nullptr, nullptr},
+        {"vpexpandd", nullptr, nullptr, ops.expand_epi32, nullptr, nullptr, nullptr, nullptr, 0, nullptr, nullptr},
+        {"vpcompressd", nullptr, nullptr, ops.compress_epi32, nullptr, nullptr, nullptr, nullptr, 0, nullptr, nullptr},
+        {"vpermt2d", nullptr, ops.permutex2var_epi32, nullptr, nullptr, nullptr, nullptr, nullptr, 0, nullptr, nullptr},
+        {"vpconflictd", nullptr, nullptr, nullptr, ops.conflict_epi32, nullptr, nullptr, nullptr, 0, nullptr, nullptr},
+        {"vplzcntd", nullptr, nullptr, nullptr, ops.lzcnt_epi32, nullptr, nullptr, nullptr, 0, nullptr, nullptr},
+        {"vrcp28ps", nullptr, nullptr, nullptr, ops.rcp28_ps, nullptr, nullptr, nullptr, 0, nullptr, nullptr},
+        {"vrsqrt28ps", nullptr, nullptr, nullptr, ops.rsqrt28_ps, nullptr, nullptr, nullptr, 0, nullptr, nullptr},
+        {"vexp2ps", nullptr, nullptr, nullptr, ops.exp2_ps, nullptr, nullptr, nullptr, 0, nullptr, nullptr},
+        {"swizzle cdab", nullptr, nullptr, nullptr, nullptr, ops.swizzle_epi32, nullptr, nullptr, KNC_SWIZZLE_CDAB, nullptr, nullptr},
+        {"swizzle dacb", nullptr, nullptr, nullptr, nullptr, ops.swizzle_epi32, nullptr, nullptr, KNC_SWIZZLE_DACB, nullptr, nullptr},
+        {"swizzle bbbb", nullptr, nullptr, nullptr, nullptr, ops.swizzle_epi32, nullptr, nullptr, KNC_SWIZZLE_BBBB, nullptr, nullptr},
+        {"upconv f16", nullptr, nullptr, nullptr, nullptr, nullptr, ops.upconvert, nullptr, KNC_CONV_FLOAT16, nullptr, nullptr},
+        {"upconv u8", nullptr, nullptr, nullptr, nullptr, nullptr, ops.upconvert, nullptr, KNC_CONV_UINT8, nullptr, nullptr},
+        {"upconv s16", nullptr, nullptr, nullptr, nullptr, nullptr, ops.upconvert, nullptr, KNC_CONV_SINT16, nullptr, nullptr},
+        {"downconv f16", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, ops.downconvert, KNC_CONV_FLOAT16, nullptr, nullptr},
+        {"downconv u8", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, ops.downconvert, KNC_CONV_UINT8, nullptr, nullptr},
+        {"vgatherdps", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 0, ops.gather_epi32, nullptr},
+        {"vscatterdps", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 0, nullptr, ops.scatter_epi32}
+    };
+    for (int i = 0; i < NUM_BENCHMARK_KERNELS; i++) {
+        kernels[i] = list[i];
+    }
+}
+
+// Nanoseconds per call; sources stay fixed so every call does the same work
+double time_kernel(const knc_vector_kernel_t& kernel, uint64_t iterations) {
+    knc_vector_t sources[3];
+    knc_vector_t results[4];
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) {
+        sources[0].f32[i] = 1.0f + i;
+        sources[1].f32[i] = 0.5f + i * 0.25f;
+        sources[2].f32[i] = 2.0f - i * 0.125f;
+    }
+    std::memset(results, 0, sizeof(results));
+
+    // Gathers and scatters touch one cache line per lane
+    static uint32_t table[KNC_VECTOR_LANES * 16];
+    uint64_t addresses[KNC_VECTOR_LANES];
+    for (int i = 0; i < KNC_VECTOR_LANES; i++) {
+        addresses[i] = reinterpret_cast<uint64_t>(&table[i * 16 + (i * 5) % 16]);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t n = 0; n < iterations; n++) {
+        knc_vector_t& dst = results[n & 3];
+        if (kernel.binary) {
+            kernel.binary(dst, sources[0], sources[1]);
+        } else if (kernel.ternary) {
+            kernel.ternary(dst, sources[0], sources[1], sources[2]);
+        } else if (kernel.unary) {
+            kernel.unary(dst, sources[n & 1]);
+        } else if (kernel.swizzle) {
+            kernel.swizzle(dst, sources[n & 1], kernel.operand);
+        } else if (kernel.upconvert) {
+            kernel.upconvert(dst, &sources[n & 1], kernel.operand, true);
+        } else if (kernel.downconvert) {
+            kernel.downconvert(&dst, sources[n & 1], kernel.operand, true);
+        } else if (kernel.gather) {
+            kernel.gather(dst, addresses, static_cast<knc_mask_t>(0xFFFF));
+        } else if (kernel.scatter) {
+            kernel.scatter(addresses, sources[n & 1], static_cast<knc_mask_t>(0xFFFF));
+        } else {
+            kernel.mask(dst, sources[0], static_cast<knc_mask_t>(n * 0x9E37), (n & 1) != 0);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    volatile uint32_t sink = results[0].u32[0] ^ results[1].u32[1] ^ results[2].u32[2] ^ results[3].u32[3];
+    (void)sink;
+    return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(iterations);
+}
+
+} // namespace
+
+knc_vector_backend_t knc_detect_vector_backend() {
+    if (knc_vector_backend_supported(KNC_VECTOR_BACKEND_AVX512)) {
+        return KNC_VECTOR_BACKEND_AVX512;
+    }
+    if (knc_vector_backend_supported(KNC_VECTOR_BACKEND_AVX2)) {
+        return KNC_VECTOR_BACKEND_AVX2;
+    }
+    return KNC_VECTOR_BACKEND_SCALAR;
+}
+
+bool knc_vector_backend_supported(knc_vector_backend_t backend) {
+    switch (backend) {
+        case KNC_VECTOR_BACKEND_SCALAR:
+        case KNC_VECTOR_BACKEND_AUTO:
+            return true;
+#ifdef KNC_VECTOR_HOST_X86
+        case KNC_VECTOR_BACKEND_AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case KNC_VECTOR_BACKEND_AVX512:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512cd");
+#endif
+        default:
+            return false;
+    }
+}
+
+const knc_vector_ops_t* knc_get_vector_ops(knc_vector_backend_t backend) {
+    if (backend == KNC_VECTOR_BACKEND_AUTO) {
+        backend = knc_detect_vector_backend();
+    }
+    if (!knc_vector_backend_supported(backend)) {
+        return nullptr;
+    }
+    switch (backend) {
+#ifdef KNC_VECTOR_HOST_X86
+        case KNC_VECTOR_BACKEND_AVX2: return &avx2_ops;
+        case KNC_VECTOR_BACKEND_AVX512: return &avx512_ops;
+#endif
+        default: return &scalar_ops;
+    }
+}
+
+const char* knc_vector_backend_name(knc_vector_backend_t backend) {
+    switch (backend) {
+        case KNC_VECTOR_BACKEND_SCALAR: return "scalar";
+        case KNC_VECTOR_BACKEND_AVX2: return "avx2";
+        case KNC_VECTOR_BACKEND_AVX512: return "avx512";
+        case KNC_VECTOR_BACKEND_AUTO: return "auto";
+        default: return "unknown";
+    }
+}
+
+bool knc_parse_vector_backend(const char* name, knc_vector_backend_t& backend) {
+    static const knc_vector_backend_t backends[] = {
+        KNC_VECTOR_BACKEND_SCALAR, KNC_VECTOR_BACKEND_AVX2, KNC_VECTOR_BACKEND_AVX512, KNC_VECTOR_BACKEND_AUTO
+    };
+    for (knc_vector_backend_t candidate : backends) {
+        if (strcmp(name, knc_vector_backend_name(candidate)) == 0) {
+            backend = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+void knc_benchmark_vector_backends(uint64_t iterations) {
+    static const knc_vector_backend_t backends[] = {
+        KNC_VECTOR_BACKEND_SCALAR, KNC_VECTOR_BACKEND_AVX2, KNC_VECTOR_BACKEND_AVX512
+    };
+    const int num_backends = sizeof(backends) / sizeof(backends[0]);
+
+    if (iterations == 0) {
+        iterations = 1;
+    }
+
+    std::cout << "=== Vector Backend Benchmark ===\n";
+    std::cout << "Host default: " << knc_vector_backend_name(knc_detect_vector_backend()) << "\n";
+    std::cout << "Iterations per kernel: " << iterations << "\n\n";
+
+    std::cout << std::left << std::setw(14) << "Kernel" << std::right;
+    for (int b = 0; b < num_backends; b++) {
+        std::cout << std::setw(12) << knc_vector_backend_name(backends[b]);
+    }
+    std::cout << "   (ns/op)\n";
+
+    double times[num_backends][NUM_BENCHMARK_KERNELS];
+    knc_vector_kernel_t kernels[num_backends][NUM_BENCHMARK_KERNELS];
+    for (int b = 0; b < num_backends; b++) {
+        const knc_vector_ops_t* ops = knc_get_vector_ops(backends[b]);
+        if (ops) {
+            list_kernels(*ops, kernels[b]);
+        }
+        for (int k = 0; k < NUM_BENCHMARK_KERNELS; k++) {
+            times[b][k] = ops ? time_kernel(kernels[b][k], iterations) : 0.0;
+        }
+    }
+
+    for (int k = 0; k < NUM_BENCHMARK_KERNELS; k++) {
+        std::cout << std::left << std::setw(14) << kernels[0][k].name << std::right;
+        for (int b = 0; b < num_backends; b++) {
+            if (knc_vector_backend_supported(backends[b])) {
+                std::cout << std::setw(12) << std::fixed << std::setprecision(2) << times[b][k];
+            } else {
+                std::cout << std::setw(12) << "n/a";
+            }
+        }
+        std::cout << "\n";
+    }
+
+    // Geometric mean slowdown of each backend against the fastest supported one
+    knc_vector_backend_t best = knc_detect_vector_backend();
+    int best_index = static_cast<int>(best);
+    std::cout << "\nSlowdown vs " << knc_vector_backend_name(best) << " (geometric mean):";
+    for (int b = 0; b < num_backends; b++) {
+        if (!knc_vector_backend_supported(backends[b])) {
+            continue;
+        }
+        double log_sum = 0.0;
+        for (int k = 0; k < NUM_BENCHMARK_KERNELS; k++) {
+            log_sum += std::log(times[b][k] / times[best_index][k]);
+        }
+        std::cout << " " << knc_vector_backend_name(backends[b]) << " " << std::setprecision(2)
+                  << std::exp(log_sum / NUM_BENCHMARK_KERNELS) << "x";
+    }
+    std::cout << std::defaultfloat << "\n";
+}
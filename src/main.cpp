@@ -26,6 +26,7 @@
 #include "ring_bus_simulator.h"
 #include "knc_debugger.h"
 #include "knc_performance_monitor.h"
+#include "knc_vector_backend.h"
 
 // Configuration structure
 struct imic_sde_config {
@@ -33,12 +34,26 @@ struct imic_sde_config {
     bool enable_debugging;
     bool enable_performance_monitoring;
     bool enable_ring_bus_simulation;
+    bool enable_jit;
+    bool run_vector_benchmark;
+    knc_vector_backend_t vector_backend;
     knc_architecture_t target_architecture;
     uint32_t num_cores;
+    uint32_t num_workers;
+    uint32_t threads_per_core;
+    uint64_t sync_quantum;
+    knc_huge_pages_t huge_pages;
+    knc_page_size_t page_size;
+    std::string translation_cache_dir;
+    uint32_t pretranslate_threads;
+    uint32_t block_cache_entries;
     uint64_t memory_size;
     std::string config_file;
 };
 
+// Kernel calls timed per vector backend by --benchmark-vector
+#define VECTOR_BENCHMARK_ITERATIONS 2000000
+
 // Print usage information
 void print_usage(const char* program_name) {
     std::cout << "IMIC_SDS - Independent Many Integrated Core Software Development Suite\n";
@@ -49,9 +64,20 @@ void print_usage(const char* program_name) {
     std::cout << "  -d, --debug                   Enable debugging mode\n";
     std::cout << "  -p, --performance             Enable performance monitoring\n";
     std::cout << "  -r, --ring-bus               Enable ring bus simulation\n";
+    std::cout << "  -j, --jit                     Compile hot blocks to host code (needs AVX-512 host)\n";
+    std::cout << "  -v, --vector-backend <name>   Host vector kernels (auto, avx512, avx2, scalar)\n";
+    std::cout << "  -b, --benchmark-vector        Benchmark every host vector backend and exit\n";
     std::cout << "  -a, --arch <architecture>     Target architecture (knc, knl)\n";
     std::cout << "  -c, --cores <num>             Number of cores to simulate (default: auto)\n";
+    std::cout << "  -t, --threads <num>           Hardware threads per core, 1-4 (default: 1)\n";
+    std::cout << "  -w, --workers <num>           Host worker threads (default: one per host CPU)\n";
+    std::cout << "  -q, --quantum <cycles>        Max cycles a core runs ahead of the others, 0 = unbounded (default: " << KNC_DEFAULT_SYNC_QUANTUM << ")\n";
     std::cout << "  -m, --memory <size>            Memory size in MB (default: auto)\n";
+    std::cout << "  -H, --huge-pages <size>       Back guest memory with huge pages: none, thp, 2m, 1g (default: none)\n";
+    std::cout << "  -P, --page-size <size>        Largest guest page size: 4k, 2m, 1g (default: 4k)\n";
+    std::cout << "  -T, --translation-cache <dir> Reuse translated code across runs, cached in <dir>\n";
+    std::cout << "  -A, --pretranslate <threads>  Translate .text at load time on <threads> host threads (default: lazily)\n";
+    std::cout << "  -C, --block-cache <entries>   Translated block lookup cache entries (default: " << KNC_DEFAULT_BLOCK_CACHE_ENTRIES << ")\n";
     std::cout << "  -f, --config <file>           Configuration file\n";
     std::cout << "\nArchitectures:\n";
     std::cout << "  knc - Knights Corner (Xeon Phi 5110P, 60 cores, 8GB)\n";
@@ -67,8 +93,18 @@ bool parse_arguments(int argc, char* argv[], struct imic_sde_config& config) {
     config.enable_debugging = false;
     config.enable_performance_monitoring = false;
     config.enable_ring_bus_simulation = false;
+    config.enable_jit = false;
+    config.run_vector_benchmark = false;
+    config.vector_backend = KNC_VECTOR_BACKEND_AUTO;
     config.target_architecture = detect_host_architecture();
     config.num_cores = get_num_cores(config.target_architecture);
+    config.num_workers = 0;
+    config.threads_per_core = 1;
+    config.sync_quantum = KNC_DEFAULT_SYNC_QUANTUM;
+    config.huge_pages = KNC_HUGE_PAGES_NONE;
+    config.page_size = KNC_PAGE_4K;
+    config.pretranslate_threads = 0;
+    config.block_cache_entries = KNC_DEFAULT_BLOCK_CACHE_ENTRIES;
     config.memory_size = get_memory_size(config.target_architecture);
     config.config_file = "config/imic_sde.conf"; // Relative path
     
@@ -77,9 +113,20 @@ bool parse_arguments(int argc, char* argv[], struct imic_sde_config& config) {
         {"debug", no_argument, 0, 'd'},
         {"performance", no_argument, 0, 'p'},
         {"ring-bus", no_argument, 0, 'r'},
+        {"jit", no_argument, 0, 'j'},
+        {"vector-backend", required_argument, 0, 'v'},
+        {"benchmark-vector", no_argument, 0, 'b'},
         {"arch", required_argument, 0, 'a'},
         {"cores", required_argument, 0, 'c'},
+        {"threads", required_argument, 0, 't'},
+        {"workers", required_argument, 0, 'w'},
+        {"quantum", required_argument, 0, 'q'},
         {"memory", required_argument, 0, 'm'},
+        {"huge-pages", required_argument, 0, 'H'},
+        {"page-size", required_argument, 0, 'P'},
+        {"translation-cache", required_argument, 0, 'T'},
+        {"pretranslate", required_argument, 0, 'A'},
+        {"block-cache", required_argument, 0, 'C'},
         {"config", required_argument, 0, 'f'},
         {0, 0, 0, 0}
     };
@@ -87,7 +134,7 @@ bool parse_arguments(int argc, char* argv[], struct imic_sde_config& config) {
     int option_index = 0;
     int c;
     
-    while ((c = getopt_long(argc, argv, "hdpr:a:c:m:f:", long_options, &option_index)) != -1) {
+    while ((c = getopt_long(argc, argv, "hdpr:jv:ba:c:t:w:q:m:H:P:T:A:C:f:", long_options, &option_index)) != -1) {
         switch (c) {
             case 'h':
                 print_usage(argv[0]);
@@ -101,6 +148,18 @@ bool parse_arguments(int argc, char* argv[], struct imic_sde_config& config) {
             case 'r':
                 config.enable_ring_bus_simulation = true;
                 break;
+            case 'j':
+                config.enable_jit = true;
+                break;
+            case 'v':
+                if (!knc_parse_vector_backend(optarg, config.vector_backend)) {
+                    std::cerr << "Error: Unknown vector backend '" << optarg << "'. Supported: auto, avx512, avx2, scalar\n";
+                    return false;
+                }
+                break;
+            case 'b':
+                config.run_vector_benchmark = true;
+                break;
             case 'a':
                 if (strcmp(optarg, "knc") == 0) {
                     config.target_architecture = ARCH_KNC;
@@ -117,9 +176,39 @@ bool parse_arguments(int argc, char* argv[], struct imic_sde_config& config) {
             case 'c':
                 config.num_cores = static_cast<uint32_t>(strtoul(optarg, nullptr, 10));
                 break;
+            case 't':
+                config.threads_per_core = static_cast<uint32_t>(strtoul(optarg, nullptr, 10));
+                break;
+            case 'w':
+                config.num_workers = static_cast<uint32_t>(strtoul(optarg, nullptr, 10));
+                break;
+            case 'q':
+                config.sync_quantum = static_cast<uint64_t>(strtoull(optarg, nullptr, 10));
+                break;
             case 'm':
                 config.memory_size = static_cast<uint64_t>(strtoull(optarg, nullptr, 10)) * 1024 * 1024;
                 break;
+            case 'H':
+                if (!knc_parse_huge_pages(optarg, config.huge_pages)) {
+                    std::cerr << "Error: Unknown huge page size '" << optarg << "'. Supported: none, thp, 2m, 1g\n";
+                    return false;
+                }
+                break;
+            case 'P':
+                if (!knc_parse_page_size(optarg, config.page_size)) {
+                    std::cerr << "Error: Unknown guest page size '" << optarg << "'. Supported: 4k, 2m, 1g\n";
+                    return false;
+                }
+                break;
+            case 'T':
+                config.translation_cache_dir = std::string(optarg);
+                break;
+            case 'A':
+                config.pretranslate_threads = static_cast<uint32_t>(strtoul(optarg, nullptr, 10));
+                break;
+            case 'C':
+                config.block_cache_entries = static_cast<uint32_t>(strtoul(optarg, nullptr, 10));
+                break;
             case 'f':
                 config.config_file = std::string(optarg);
                 break;
@@ -139,6 +228,16 @@ bool parse_arguments(int argc, char* argv[], struct imic_sde_config& config) {
         return false;
     }
     
+    if (config.threads_per_core == 0 || config.threads_per_core > KNC_THREADS_PER_CORE) {
+        std::cerr << "Error: Threads per core must be between 1 and " << KNC_THREADS_PER_CORE << "\n";
+        return false;
+    }
+    
+    if (config.block_cache_entries == 0) {
+        std::cerr << "Error: Block cache needs at least one entry\n";
+        return false;
+    }
+    
     if (config.memory_size == 0) {
         std::cerr << "Error: Memory size must be at least 1 MB\n";
         return false;
@@ -156,6 +255,11 @@ bool parse_arguments(int argc, char* argv[], struct imic_sde_config& config) {
         return false;
     }
     
+    // The benchmark does not run a guest program
+    if (config.run_vector_benchmark) {
+        return true;
+    }
+    
     // Get binary path
     if (optind >= argc) {
         std::cerr << "Error: No KNC binary specified\n";
@@ -171,7 +275,7 @@ int run_emulation(const struct imic_sde_config& config) {
     std::cout << "Starting IMIC_SDS emulation...\n";
     std::cout << "Binary: " << config.binary_path << "\n";
     std::cout << "Architecture: " << get_architecture_name(config.target_architecture) << "\n";
-    std::cout << "Cores: " << config.num_cores << "\n";
+    std::cout << "Cores: " << config.num_cores << " x " << config.threads_per_core << " threads\n";
     std::cout << "Memory: " << (config.memory_size / (1024*1024)) << " MB\n";
     
     // Initialize components
@@ -188,6 +292,18 @@ int run_emulation(const struct imic_sde_config& config) {
     }
     
     // Initialize runtime
+    runtime.set_jit_enabled(config.enable_jit);
+    runtime.set_worker_threads(config.num_workers);
+    runtime.set_threads_per_core(config.threads_per_core);
+    runtime.set_sync_quantum(config.sync_quantum);
+    runtime.set_huge_pages(config.huge_pages);
+    runtime.set_page_size(config.page_size);
+    runtime.set_translation_cache(config.translation_cache_dir);
+    runtime.set_pretranslation(config.pretranslate_threads);
+    runtime.set_block_cache_size(config.block_cache_entries);
+    if (!runtime.set_vector_backend(config.vector_backend)) {
+        return -1;
+    }
     if (!runtime.initialize()) {
         std::cerr << "Error: Failed to initialize KNC runtime\n";
         return -1;
@@ -221,7 +337,7 @@ int run_emulation(const struct imic_sde_config& config) {
     }
     
     // Load binary into memory
-    if (!runtime.load_program(loader.get_binary_data(), loader.get_binary_size())) {
+    if (!runtime.load_binary(loader)) {
         std::cerr << "Error: Failed to load program into memory\n";
         return -1;
     }
@@ -249,6 +365,7 @@ int run_emulation(const struct imic_sde_config& config) {
             double ipc = (double)counters.instructions_retired / counters.cycles;
             std::cout << "IPC: " << ipc << "\n";
         }
+        perf_monitor.print_gather_histogram();
     }
     
     std::cout << "Emulation " << (result == KNC_SUCCESS ? "completed successfully" : "failed with error") << "\n";
@@ -262,5 +379,10 @@ int main(int argc, char* argv[]) {
         return -1;
     }
     
+    if (config.run_vector_benchmark) {
+        knc_benchmark_vector_backends(VECTOR_BENCHMARK_ITERATIONS);
+        return 0;
+    }
+    
     return run_emulation(config);
 }
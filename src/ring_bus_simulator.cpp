@@ -183,6 +183,7 @@ RingBusSimulator::RingBusSimulator(uint32_t num_nodes, knc_architecture_t arch)
     dtd_enabled = true;
     cache_line_size = 64;  // KNC uses 64-byte cache lines
     associativity = 8;      // 8-way set associative
+    contended_lines.store(0);
     
     dtd_home_nodes.resize(num_nodes);
     dtd_tiles.resize(num_nodes);
@@ -510,6 +511,24 @@ bool RingBusSimulator::simulate_broadcast(uint32_t source_tile, const void* data
     return success;
 }
 
+void RingBusSimulator::record_contended_line(uint64_t address, uint32_t requesting_tile) {
+    contended_lines.fetch_add(1, std::memory_order_relaxed);
+    if (!dtd_enabled) {
+        return;
+    }
+    
+    // The locked RMW needs the line exclusive: invalidate the other sharers
+    // and take ownership of the now-modified line
+    uint64_t line = address & ~static_cast<uint64_t>(cache_line_size - 1);
+    std::lock_guard<std::mutex> lock(dtd_mutex);
+    dtd_invalidate_cacheline(line, requesting_tile);
+    dtd_update_ownership(line, requesting_tile, true);
+}
+
+uint64_t RingBusSimulator::get_contended_lines() const {
+    return contended_lines.load(std::memory_order_relaxed);
+}
+
 bool RingBusSimulator::is_running() const {
     return running.load();
 }
@@ -534,6 +553,7 @@ void RingBusSimulator::print_performance_stats() const {
     }
     
     std::cout << "Maximum contention delay: " << max_contention_val << " cycles\n";
+    std::cout << "DTD contended atomic lines: " << contended_lines.load() << "\n";
     std::cout << "Simulation time: " << simulation_time.load() << " cycles\n";
 }
 
@@ -591,6 +611,7 @@ void RingBusSimulator::reset_simulation() {
     total_bytes.store(0);
     total_latency.store(0);
     max_contention.store(0);
+    contended_lines.store(0);
 }
 
 uint32_t RingBusSimulator::calculate_distance_public(uint32_t node1, uint32_t node2) {
@@ -0,0 +1,56 @@
+#ifndef KNC_TEST_H
+#define KNC_TEST_H
+
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include "knc_runtime.h"
+
+// Checks for the standalone test programs in tests/. A failed check prints
+// its location and the values involved; main returns knc_test_result().
+static int knc_test_failures = 0;
+
+#define KNC_CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition "\n"; \
+            knc_test_failures++; \
+        } \
+    } while (0)
+
+#define KNC_CHECK_EQ(actual, expected) \
+    do { \
+        uint64_t actual_value_ = static_cast<uint64_t>(actual); \
+        uint64_t expected_value_ = static_cast<uint64_t>(expected); \
+        if (actual_value_ != expected_value_) { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": " #actual " is 0x" << std::hex << actual_value_ \
+                      << ", expected 0x" << expected_value_ << std::dec << "\n"; \
+            knc_test_failures++; \
+        } \
+    } while (0)
+
+static inline int knc_test_result(const char* name) {
+    if (knc_test_failures) {
+        std::cerr << name << ": " << knc_test_failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << name << ": all checks passed\n";
+    return 0;
+}
+
+// Run a flat guest program on a single-core runtime until it halts or
+// exits; the runtime is returned for inspecting registers and memory
+static inline std::unique_ptr<KNCRuntime> knc_test_run(const uint8_t* program, size_t size, bool jit = false) {
+    std::unique_ptr<KNCRuntime> runtime(new KNCRuntime(1, 16ull << 20));
+    runtime->set_jit_enabled(jit);
+    if (!runtime->initialize() || !runtime->load_program(program, size)) {
+        std::cerr << "could not load the test program\n";
+        knc_test_failures++;
+        return runtime;
+    }
+    runtime->run();
+    return runtime;
+}
+
+#endif // KNC_TEST_H
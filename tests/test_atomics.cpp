@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2026 IMIC_SDS Development Team
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// LOCK-prefixed read-modify-writes: every hardware thread of a multi-core
+// runtime updates shared counters, and no update may be lost
+
+#include "knc_test.h"
+#include <cstring>
+
+static const uint64_t COUNTERS = 0x10000;
+static const uint32_t ITERATIONS = 20000;
+
+static uint64_t read_counter(const KNCRuntime& rt, uint64_t offset, size_t size) {
+    uint64_t value = 0;
+    memcpy(&value, rt.get_memory().data + COUNTERS + offset, size);
+    return value;
+}
+
+static void test_counters() {
+    // mov edi, 0x10000; mov r9d, 20000
+    // l: xor eax, eax; lock adc qword [rdi], 1          ; +1, carry clear
+    //    mov eax, 1; cmp eax, 2; lock adc qword [rdi], 0 ; +1, carry set
+    //    cmp eax, 2; lock sbb dword [rdi+8], -2          ; +1, borrow set
+    //    lock not qword [rdi+16]; lock neg word [rdi+24]
+    //    lock add qword [rdi+0xffc], 1                   ; Straddles a page
+    //    cmp eax, 2; lock adc dword [rdi+0x1ffe], 0      ; Straddles a page
+    //    dec r9d; jnz l; hlt
+    const uint8_t program[] = {
+        0xbf, 0x00, 0x00, 0x01, 0x00, 0x41, 0xb9, 0x20, 0x4e, 0x00, 0x00, 0x31, 0xc0, 0xf0, 0x48, 0x83,
+        0x17, 0x01, 0xb8, 0x01, 0x00, 0x00, 0x00, 0x83, 0xf8, 0x02, 0xf0, 0x48, 0x83, 0x17, 0x00, 0x83,
+        0xf8, 0x02, 0xf0, 0x83, 0x5f, 0x08, 0xfe, 0xf0, 0x48, 0xf7, 0x57, 0x10, 0x66, 0xf0, 0xf7, 0x5f,
+        0x18, 0xf0, 0x48, 0x83, 0x87, 0xfc, 0x0f, 0x00, 0x00, 0x01, 0x83, 0xf8, 0x02, 0xf0, 0x83, 0x97,
+        0xfe, 0x1f, 0x00, 0x00, 0x00, 0x41, 0xff, 0xc9, 0x75, 0xc1, 0xf4,
+    };
+    const uint32_t cores = 4;
+    const uint32_t threads_per_core = 2;
+    KNCRuntime rt(cores, 16ull << 20);
+    rt.set_worker_threads(cores);
+    KNC_CHECK(rt.set_threads_per_core(threads_per_core));
+    if (!rt.initialize() || !rt.load_program(program, sizeof(program))) {
+        std::cerr << "could not load the test program\n";
+        knc_test_failures++;
+        return;
+    }
+    uint16_t negated = 5;
+    KNC_CHECK_EQ(rt.mmu_write(COUNTERS + 24, &negated, sizeof(negated)), KNC_SUCCESS);
+    rt.run();
+
+    // An even number of NOTs and NEGs in total leaves those counters as they were
+    uint64_t updates = static_cast<uint64_t>(cores) * threads_per_core * ITERATIONS;
+    KNC_CHECK_EQ(read_counter(rt, 0, 8), 2 * updates);
+    KNC_CHECK_EQ(read_counter(rt, 8, 4), updates);
+    KNC_CHECK_EQ(read_counter(rt, 16, 8), 0);
+    KNC_CHECK_EQ(read_counter(rt, 24, 2), 5);
+    KNC_CHECK_EQ(read_counter(rt, 0xffc, 8), updates);
+    KNC_CHECK_EQ(read_counter(rt, 0x1ffe, 4), updates);
+}
+
+static void test_flags() {
+    // mov edi, 0x10000; mov rax, -1; mov [rdi], rax; mov eax, 1; cmp eax, 2;
+    // lock adc qword [rdi], 0; setc bl; setz bh; lock neg qword [rdi+8];
+    // setc cl; setz ch; mov dword [rdi+16], 7; lock neg dword [rdi+16];
+    // setc dl; sets dh; hlt
+    const uint8_t program[] = {
+        0xbf, 0x00, 0x00, 0x01, 0x00, 0x48, 0xc7, 0xc0, 0xff, 0xff, 0xff, 0xff, 0x48, 0x89, 0x07, 0xb8,
+        0x01, 0x00, 0x00, 0x00, 0x83, 0xf8, 0x02, 0xf0, 0x48, 0x83, 0x17, 0x00, 0x0f, 0x92, 0xc3, 0x0f,
+        0x94, 0xc7, 0xf0, 0x48, 0xf7, 0x5f, 0x08, 0x0f, 0x92, 0xc1, 0x0f, 0x94, 0xc5, 0xc7, 0x47, 0x10,
+        0x07, 0x00, 0x00, 0x00, 0xf0, 0xf7, 0x5f, 0x10, 0x0f, 0x92, 0xc2, 0x0f, 0x98, 0xc6, 0xf4,
+    };
+    auto rt = knc_test_run(program, sizeof(program));
+    const uint64_t* gpr = rt->get_core_state(0).registers.gpr;
+    KNC_CHECK_EQ(gpr[3] & 0xffff, 0x0101);
+    KNC_CHECK_EQ(gpr[1] & 0xffff, 0x0100);
+    KNC_CHECK_EQ(gpr[2] & 0xffff, 0x0101);
+    KNC_CHECK_EQ(read_counter(*rt, 0, 8), 0);
+    KNC_CHECK_EQ(read_counter(*rt, 16, 4), 0xfffffff9ULL);
+}
+
+int main() {
+    test_counters();
+    test_flags();
+    return knc_test_result("test_atomics");
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2026 IMIC_SDS Development Team
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Host-side copies into and out of guest memory: ranges inside it round
+// trip, and ranges reaching past its end or the guest address window fail
+// instead of wrapping around into valid memory
+
+#include "knc_test.h"
+#include "knc_guest_memory.h"
+
+static const uint64_t MEMORY_SIZE = 16ull << 20;
+
+static void test_guest_memory_bounds() {
+    KNCGuestMemory memory;
+    KNC_CHECK(memory.allocate(MEMORY_SIZE));
+    uint64_t value = 0x0123456789abcdefULL;
+    uint64_t copy = 0;
+    KNC_CHECK(memory.write(MEMORY_SIZE - sizeof(value), &value, sizeof(value)));
+    KNC_CHECK(memory.read(MEMORY_SIZE - sizeof(value), &copy, sizeof(copy)));
+    KNC_CHECK_EQ(copy, value);
+
+    KNC_CHECK(!memory.write(MEMORY_SIZE - 4, &value, sizeof(value)));
+    KNC_CHECK(!memory.read(MEMORY_SIZE, &copy, sizeof(copy)));
+    KNC_CHECK(!memory.read(~0ULL - 3, &copy, sizeof(copy)));
+
+    // An address one window above a valid one must not alias it
+    uint64_t alias = (KNC_GUEST_ADDRESS_MASK + 1) + 0x1000;
+    KNC_CHECK(!memory.write(alias, &value, sizeof(value)));
+    KNC_CHECK(!memory.read(alias, &copy, sizeof(copy)));
+    KNC_CHECK(memory.read(0x1000, &copy, sizeof(copy)));
+    KNC_CHECK_EQ(copy, 0);
+}
+
+static void test_runtime_bounds() {
+    KNCRuntime rt(1, MEMORY_SIZE);
+    KNC_CHECK(rt.initialize());
+    uint32_t value = 0x5a5a5a5a;
+    KNC_CHECK_EQ(rt.mmu_write(0x2000, &value, sizeof(value)), KNC_SUCCESS);
+    KNC_CHECK_EQ(rt.mmu_write(MEMORY_SIZE - 2, &value, sizeof(value)), KNC_ERROR_MEMORY_ACCESS);
+    KNC_CHECK_EQ(rt.mmu_write((KNC_GUEST_ADDRESS_MASK + 1) + 0x3000, &value, sizeof(value)),
+                 KNC_ERROR_MEMORY_ACCESS);
+    KNC_CHECK_EQ(rt.mmu_read((KNC_GUEST_ADDRESS_MASK + 1) + 0x2000, &value, sizeof(value)),
+                 KNC_ERROR_MEMORY_ACCESS);
+    uint32_t untouched = 1;
+    KNC_CHECK_EQ(rt.mmu_read(0x3000, &untouched, sizeof(untouched)), KNC_SUCCESS);
+    KNC_CHECK_EQ(untouched, 0);
+}
+
+int main() {
+    test_guest_memory_bounds();
+    test_runtime_bounds();
+    return knc_test_result("test_guest_memory");
+}
@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2026 IMIC_SDS Development Team
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Decoder and interpreter golden tests: single instructions through the
+// decoder, and small flat guest programs run to their final register state
+
+#include "knc_test.h"
+#include "knc_instruction_translator.h"
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+
+static knc_decoded_instruction_t decode(KNCInstructionTranslator& translator,
+                                        std::initializer_list<uint8_t> bytes) {
+    std::vector<uint8_t> code(bytes);
+    knc_decoded_instruction_t decoded;
+    KNC_CHECK(translator.decode_instruction(0x1000, code.data(), code.size(), decoded));
+    KNC_CHECK_EQ(decoded.length, code.size());
+    return decoded;
+}
+
+static void test_decoder() {
+    KNCInstructionTranslator translator;
+    translator.initialize();
+
+    // movzx edi, cl
+    knc_decoded_instruction_t d = decode(translator, {0x0f, 0xb6, 0xf9});
+    KNC_CHECK_EQ(d.op, KNC_OP_MOVZX);
+    KNC_CHECK_EQ(d.dst, 7);
+    KNC_CHECK_EQ(d.src, 1);
+    KNC_CHECK_EQ(d.operand_size, 4);
+    KNC_CHECK_EQ(d.immediate, 1);
+    KNC_CHECK(d.flags & KNC_DECODE_HIGH_BYTE);
+
+    // movsxd rax, edi
+    d = decode(translator, {0x48, 0x63, 0xc7});
+    KNC_CHECK_EQ(d.op, KNC_OP_MOVSX);
+    KNC_CHECK_EQ(d.operand_size, 8);
+    KNC_CHECK_EQ(d.immediate, 4);
+
+    // mov al, ah
+    d = decode(translator, {0x88, 0xe0});
+    KNC_CHECK_EQ(d.op, KNC_OP_MOV);
+    KNC_CHECK_EQ(d.operand_size, 1);
+    KNC_CHECK_EQ(d.dst, 0);
+    KNC_CHECK_EQ(d.src, 4);
+    KNC_CHECK(d.flags & KNC_DECODE_HIGH_BYTE);
+
+    // div rcx
+    d = decode(translator, {0x48, 0xf7, 0xf1});
+    KNC_CHECK_EQ(d.op, KNC_OP_DIV);
+    KNC_CHECK_EQ(d.operand_size, 8);
+    KNC_CHECK_EQ(d.src, 1);
+
+    // shl eax, cl
+    d = decode(translator, {0xd3, 0xe0});
+    KNC_CHECK_EQ(d.op, KNC_OP_SHL);
+    KNC_CHECK_EQ(d.src, KNC_REG_RCX);
+    KNC_CHECK(!(d.flags & KNC_DECODE_SRC_IMM));
+
+    // cmove eax, ebx
+    d = decode(translator, {0x0f, 0x44, 0xc3});
+    KNC_CHECK_EQ(d.op, KNC_OP_CMOVCC);
+    KNC_CHECK_EQ(d.condition, 4);
+
+    d = decode(translator, {0xc9});
+    KNC_CHECK_EQ(d.op, KNC_OP_LEAVE);
+
+    // endbr64 runs as a NOP
+    d = decode(translator, {0xf3, 0x0f, 0x1e, 0xfa});
+    KNC_CHECK_EQ(d.op, KNC_OP_NOP);
+
+    // ud2 is decoded for its length only
+    d = decode(translator, {0x0f, 0x0b});
+    KNC_CHECK_EQ(d.op, KNC_OP_UNKNOWN);
+}
+
+static std::unique_ptr<KNCRuntime> run(std::initializer_list<uint8_t> bytes) {
+    std::vector<uint8_t> program(bytes);
+    return knc_test_run(program.data(), program.size());
+}
+
+static void test_zero_and_sign_extension() {
+    // mov ecx, 0x1280; movzx edi, cl; movzx esi, ch; movsx r8, cl;
+    // movsx r9d, cx; mov eax, -2; movsxd r10, eax; hlt
+    auto rt = run({0xb9, 0x80, 0x12, 0x00, 0x00, 0x0f, 0xb6, 0xf9, 0x0f, 0xb6, 0xf5,
+                   0x4c, 0x0f, 0xbe, 0xc1, 0x44, 0x0f, 0xbf, 0xc9, 0xb8, 0xfe, 0xff, 0xff, 0xff,
+                   0x4c, 0x63, 0xd0, 0xf4});
+    const uint64_t* gpr = rt->get_core_state(0).registers.gpr;
+    KNC_CHECK_EQ(gpr[7], 0x80);
+    KNC_CHECK_EQ(gpr[6], 0x12);
+    KNC_CHECK_EQ(gpr[8], 0xffffffffffffff80ULL);
+    KNC_CHECK_EQ(gpr[9], 0x1280);
+    KNC_CHECK_EQ(gpr[10], 0xfffffffffffffffeULL);
+}
+
+static void test_byte_registers() {
+    // mov eax, 0x1122; add al, ah; xor ebx, ebx; xor edx, edx; mov bl, 0x7f;
+    // add bl, 1; seto dl; inc bh; hlt
+    auto rt = run({0xb8, 0x22, 0x11, 0x00, 0x00, 0x00, 0xe0, 0x31, 0xdb, 0x31, 0xd2,
+                   0xb3, 0x7f, 0x80, 0xc3, 0x01, 0x0f, 0x90, 0xc2, 0xfe, 0xc7, 0xf4});
+    const uint64_t* gpr = rt->get_core_state(0).registers.gpr;
+    KNC_CHECK_EQ(gpr[0], 0x1133);
+    KNC_CHECK_EQ(gpr[3], 0x180);
+    KNC_CHECK_EQ(gpr[2], 1);
+}
+
+static void test_shifts_and_rotates() {
+    // mov ecx, 3; mov eax, 1; shl eax, cl; mov edx, 0x80000001; ror edx, 1;
+    // mov ebx, 0x8000; mov cl, 17; shl bx, cl; mov esi, 0x81; rol sil, 1; hlt
+    auto rt = run({0xb9, 0x03, 0x00, 0x00, 0x00, 0xb8, 0x01, 0x00, 0x00, 0x00, 0xd3, 0xe0,
+                   0xba, 0x01, 0x00, 0x00, 0x80, 0xd1, 0xca, 0xbb, 0x00, 0x80, 0x00, 0x00,
+                   0xb1, 0x11, 0x66, 0xd3, 0xe3, 0xbe, 0x81, 0x00, 0x00, 0x00, 0x40, 0xd0, 0xc6,
+                   0xf4});
+    const uint64_t* gpr = rt->get_core_state(0).registers.gpr;
+    KNC_CHECK_EQ(gpr[0], 8);
+    KNC_CHECK_EQ(gpr[2], 0xc0000000ULL);
+    KNC_CHECK_EQ(gpr[3], 0);
+    KNC_CHECK_EQ(gpr[6], 3);
+}
+
+static void test_multiply_and_divide() {
+    // mov rax, -1; mov ebx, 2; mul rbx; mov r8, rdx; mov r9, rax; mov rax, -7;
+    // cqo; mov ecx, 2; idiv rcx; mov esi, 5; neg esi; xor edi, edi; not rdi; hlt
+    auto rt = run({0x48, 0xc7, 0xc0, 0xff, 0xff, 0xff, 0xff, 0xbb, 0x02, 0x00, 0x00, 0x00,
+                   0x48, 0xf7, 0xe3, 0x49, 0x89, 0xd0, 0x49, 0x89, 0xc1,
+                   0x48, 0xc7, 0xc0, 0xf9, 0xff, 0xff, 0xff, 0x48, 0x99, 0xb9, 0x02, 0x00, 0x00, 0x00,
+                   0x48, 0xf7, 0xf9, 0xbe, 0x05, 0x00, 0x00, 0x00, 0xf7, 0xde, 0x31, 0xff,
+                   0x48, 0xf7, 0xd7, 0xf4});
+    const uint64_t* gpr = rt->get_core_state(0).registers.gpr;
+    KNC_CHECK_EQ(gpr[8], 1);
+    KNC_CHECK_EQ(gpr[9], 0xfffffffffffffffeULL);
+    KNC_CHECK_EQ(gpr[0], static_cast<uint64_t>(-3));
+    KNC_CHECK_EQ(gpr[2], static_cast<uint64_t>(-1));
+    KNC_CHECK_EQ(gpr[6], 0xfffffffbULL);
+    KNC_CHECK_EQ(gpr[7], ~0ULL);
+}
+
+static void test_conditional_moves_and_carries() {
+    // xor ecx, ecx; xor eax, eax; mov ebx, 5; cmp ebx, 3; cmovg eax, ebx;
+    // setl cl; setg ch; mov rdx, -1; add rdx, 1; adc rdx, 0; mov r8d, 1;
+    // cmp r8d, 2; sbb rsi, rsi; hlt
+    auto rt = run({0x31, 0xc9, 0x31, 0xc0, 0xbb, 0x05, 0x00, 0x00, 0x00, 0x83, 0xfb, 0x03,
+                   0x0f, 0x4f, 0xc3, 0x0f, 0x9c, 0xc1, 0x0f, 0x9f, 0xc5,
+                   0x48, 0xc7, 0xc2, 0xff, 0xff, 0xff, 0xff, 0x48, 0x83, 0xc2, 0x01,
+                   0x48, 0x83, 0xd2, 0x00, 0x41, 0xb8, 0x01, 0x00, 0x00, 0x00,
+                   0x41, 0x83, 0xf8, 0x02, 0x48, 0x19, 0xf6, 0xf4});
+    const uint64_t* gpr = rt->get_core_state(0).registers.gpr;
+    KNC_CHECK_EQ(gpr[0], 5);
+    KNC_CHECK_EQ(gpr[1], 0x100);
+    KNC_CHECK_EQ(gpr[2], 1);
+    KNC_CHECK_EQ(gpr[6], ~0ULL);
+}
+
+static void test_stack_frame() {
+    // mov r8, rsp; push rbp; mov rbp, rsp; sub rsp, 32; mov qword [rbp-8], 7;
+    // mov rax, [rbp-8]; leave; mov r9, rsp; hlt
+    auto rt = run({0x49, 0x89, 0xe0, 0x55, 0x48, 0x89, 0xe5, 0x48, 0x83, 0xec, 0x20,
+                   0x48, 0xc7, 0x45, 0xf8, 0x07, 0x00, 0x00, 0x00, 0x48, 0x8b, 0x45, 0xf8,
+                   0xc9, 0x49, 0x89, 0xe1, 0xf4});
+    const uint64_t* gpr = rt->get_core_state(0).registers.gpr;
+    KNC_CHECK_EQ(gpr[0], 7);
+    KNC_CHECK_EQ(gpr[9], gpr[8]);
+}
+
+static void test_undecoded_instruction_faults() {
+    // mov eax, 1; ud2; mov eax, 2; hlt - stops at the ud2
+    auto rt = run({0xb8, 0x01, 0x00, 0x00, 0x00, 0x0f, 0x0b, 0xb8, 0x02, 0x00, 0x00, 0x00, 0xf4});
+    const knc_core_state_t& core = rt->get_core_state(0);
+    KNC_CHECK_EQ(core.registers.gpr[0], 1);
+    KNC_CHECK_EQ(core.cycles_executed, 1);
+}
+
+static void test_movzx_exit_code() {
+    // mov ecx, 0x1234; movzx edi, cl; mov eax, 60; syscall - exits with 0x34
+    auto rt = run({0xb9, 0x34, 0x12, 0x00, 0x00, 0x0f, 0xb6, 0xf9, 0xb8, 0x3c, 0x00, 0x00, 0x00,
+                   0x0f, 0x05});
+    KNC_CHECK_EQ(rt->get_core_state(0).registers.gpr[7], 0x34);
+}
+
+static void test_masked_stores() {
+    // mov edi, 0x10000; vmovdqu32 zmm0, [rdi+0x100]; mov eax, 0x5555; kmovw k1, eax;
+    // vmovdqu32 [rdi]{k1}, zmm0; lea rdx, [rdi+0x40]; vmovdqa32 [rdx]{k1}{uint16}, zmm0;
+    // mov esi, 0xffffe0; mov eax, 0xff; kmovw k2, eax; vmovdqu32 [rsi]{k2}, zmm0;
+    // lea rdx, [rsi+16]; vmovdqa32 [rdx]{k2}{uint16}, zmm0; mov ebx, 1; hlt
+    //
+    // The last two stores end at the top of guest memory, with only their
+    // masked-off elements beyond it
+    const uint8_t program[] = {
+        0xbf, 0x00, 0x00, 0x01, 0x00, 0x62, 0xf1, 0x7e, 0x48, 0x6f, 0x47, 0x04, 0xb8, 0x55, 0x55, 0x00,
+        0x00, 0xc5, 0xf8, 0x92, 0xc8, 0x62, 0xf1, 0x7e, 0x49, 0x7f, 0x07, 0x48, 0x8d, 0x57, 0x40, 0x62,
+        0xf1, 0x79, 0x69, 0x7f, 0x02, 0xbe, 0xe0, 0xff, 0xff, 0x00, 0xb8, 0xff, 0x00, 0x00, 0x00, 0xc5,
+        0xf8, 0x92, 0xd0, 0x62, 0xf1, 0x7e, 0x4a, 0x7f, 0x06, 0x48, 0x8d, 0x56, 0x10, 0x62, 0xf1, 0x79,
+        0x6a, 0x7f, 0x02, 0xbb, 0x01, 0x00, 0x00, 0x00, 0xf4,
+    };
+    KNCRuntime rt(1, 16ull << 20);
+    if (!rt.initialize() || !rt.load_program(program, sizeof(program))) {
+        std::cerr << "could not load the test program\n";
+        knc_test_failures++;
+        return;
+    }
+    uint32_t source[KNC_VECTOR_LANES];
+    for (uint32_t lane = 0; lane < KNC_VECTOR_LANES; lane++) {
+        source[lane] = 0x01010000 + lane;
+    }
+    std::vector<uint8_t> fill(0x60, 0xaa);
+    KNC_CHECK_EQ(rt.mmu_write(0x10100, source, sizeof(source)), KNC_SUCCESS);
+    KNC_CHECK_EQ(rt.mmu_write(0x10000, fill.data(), fill.size()), KNC_SUCCESS);
+    rt.run();
+    KNC_CHECK_EQ(rt.get_core_state(0).registers.gpr[3], 1);
+
+    const uint8_t* data = rt.get_memory().data;
+    for (uint32_t lane = 0; lane < KNC_VECTOR_LANES; lane++) {
+        uint32_t stored;
+        uint16_t converted;
+        memcpy(&stored, data + 0x10000 + lane * 4, sizeof(stored));
+        memcpy(&converted, data + 0x10040 + lane * 2, sizeof(converted));
+        KNC_CHECK_EQ(stored, (lane & 1) ? 0xaaaaaaaaU : source[lane]);
+        KNC_CHECK_EQ(converted, (lane & 1) ? 0xaaaa : lane);
+    }
+    for (uint32_t lane = 0; lane < 8; lane++) {
+        uint32_t stored;
+        uint16_t converted;
+        memcpy(&stored, data + 0xffffe0 + lane * 4, sizeof(stored));
+        memcpy(&converted, data + 0xfffff0 + lane * 2, sizeof(converted));
+        KNC_CHECK_EQ(converted, lane);
+        if (lane < 4) {
+            KNC_CHECK_EQ(stored, source[lane]);  // The rest were overwritten by the converted store
+        }
+    }
+}
+
+int main() {
+    test_decoder();
+    test_zero_and_sign_extension();
+    test_byte_registers();
+    test_shifts_and_rotates();
+    test_multiply_and_divide();
+    test_conditional_moves_and_carries();
+    test_stack_frame();
+    test_undecoded_instruction_faults();
+    test_movzx_exit_code();
+    test_masked_stores();
+    return knc_test_result("test_interpreter");
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2026 IMIC_SDS Development Team
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Differential tests for the JIT: each guest program loops long enough for
+// its hot blocks to be compiled, and must leave the same registers, flags
+// and memory as when it runs on the interpreter alone
+
+#include "knc_test.h"
+#include "knc_jit_compiler.h"
+#include <cstring>
+#include <vector>
+
+typedef struct {
+    const char* name;
+    std::vector<uint8_t> code;
+    uint64_t data_address;  // Guest memory the program writes
+    size_t data_size;
+} knc_test_program_t;
+
+static const knc_test_program_t programs[] = {
+    // Scalar loop: lea, imul, shifts and loads/stores through an index
+    {"scalar", {
+        0xbf, 0x00, 0x00, 0x10, 0x00, 0x31, 0xc0, 0xbb, 0x01, 0x00, 0x00, 0x00, 0x31, 0xf6, 0xb9, 0x20,
+        0x4e, 0x00, 0x00, 0x48, 0x8d, 0x54, 0x58, 0x03, 0x48, 0x6b, 0xd2, 0x07, 0x48, 0x31, 0xd0, 0x48,
+        0x01, 0xcb, 0x48, 0xc1, 0xe3, 0x03, 0x48, 0xd1, 0xfb, 0x48, 0x89, 0x04, 0xf7, 0x48, 0x03, 0x1c,
+        0xf7, 0xff, 0xc6, 0x81, 0xe6, 0xff, 0x01, 0x00, 0x00, 0x83, 0xe9, 0x01, 0x75, 0xd5, 0xf4,
+    }, 0x100000, 4096},
+    // Vector loop: masked integer ops, a memory source, a store and a float sum
+    {"vector", {
+        0xbf, 0x00, 0x00, 0x20, 0x00, 0x31, 0xc9, 0x8d, 0x44, 0x49, 0x01, 0x89, 0x04, 0x8f, 0xc7, 0x84,
+        0x8f, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0xc0, 0x3f, 0xff, 0xc1, 0x83, 0xf9, 0x40, 0x75, 0xe7,
+        0x62, 0xf1, 0x7e, 0x48, 0x6f, 0x07, 0x62, 0xf1, 0x7e, 0x48, 0x6f, 0x4f, 0x01, 0x62, 0xf1, 0x7c,
+        0x58, 0xc2, 0x4f, 0x08, 0x01, 0xb9, 0x88, 0x13, 0x00, 0x00, 0x62, 0xf1, 0x7d, 0x48, 0xfe,
+        0xc1, 0x62, 0xf2, 0x75, 0x49, 0x40, 0xd0, 0x62, 0xf1, 0x7d, 0x48, 0xef, 0xda, 0x62, 0xf1, 0x65,
+        0x48, 0xfe, 0x5f, 0x02, 0x62, 0xf1, 0x7e, 0x48, 0x7f, 0x5f, 0x03, 0x62, 0xf1, 0x4c, 0x48, 0x58,
+        0x77, 0x04, 0xff, 0xc9, 0x75, 0xd5, 0x62, 0xf1, 0x7c, 0x48, 0x11, 0x77, 0x05, 0xf4,
+    }, 0x200000, 384},
+    // Branchy loop: a superblock with side exits on either arm
+    {"branches", {
+        0x31, 0xc0, 0x31, 0xdb, 0xb9, 0x30, 0x75, 0x00, 0x00, 0xf7, 0xc1, 0x03, 0x00, 0x00, 0x00, 0x74,
+        0x05, 0x48, 0x01, 0xc8, 0xeb, 0x07, 0x48, 0x83, 0xeb, 0x05, 0x48, 0x31, 0xc3, 0xff, 0xc9, 0x75,
+        0xe8, 0xf4,
+    }, 0, 0},
+};
+
+static void compare(const knc_test_program_t& program) {
+    auto interpreted = knc_test_run(program.code.data(), program.code.size(), false);
+    auto compiled = knc_test_run(program.code.data(), program.code.size(), true);
+    if (compiled->get_blocks_compiled() == 0) {
+        std::cerr << program.name << ": no blocks were compiled\n";
+        knc_test_failures++;
+    }
+
+    const knc_core_state_t& a = interpreted->get_core_state(0);
+    const knc_core_state_t& b = compiled->get_core_state(0);
+    KNC_CHECK_EQ(b.cycles_executed, a.cycles_executed);
+    KNC_CHECK_EQ(b.registers.rip, a.registers.rip);
+    KNC_CHECK_EQ(b.registers.rflags & 0x8D5, a.registers.rflags & 0x8D5);
+    for (int i = 0; i < 16; i++) {
+        KNC_CHECK_EQ(b.registers.gpr[i], a.registers.gpr[i]);
+    }
+    for (int i = 0; i < KNC_NUM_MASK_REGISTERS; i++) {
+        KNC_CHECK_EQ(b.registers.k[i], a.registers.k[i]);
+    }
+    KNC_CHECK(memcmp(b.registers.zmm, a.registers.zmm, sizeof(a.registers.zmm)) == 0);
+    if (program.data_size) {
+        KNC_CHECK(memcmp(compiled->get_memory().data + program.data_address,
+                         interpreted->get_memory().data + program.data_address, program.data_size) == 0);
+    }
+}
+
+int main() {
+    KNCJitCompiler jit;
+    if (!jit.initialize()) {
+        std::cout << "test_jit_differential: skipped, no JIT on this host\n";
+        return 0;
+    }
+    jit.shutdown();
+
+    for (const knc_test_program_t& program : programs) {
+        compare(program);
+    }
+    return knc_test_result("test_jit_differential");
+}
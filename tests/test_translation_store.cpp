@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2026 IMIC_SDS Development Team
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Round trips through the persistent translation cache (.ktc) format: files
+// written directly and by the translator's pretranslate path read back the
+// same, and files for another key or with damaged contents are refused
+
+#include "knc_test.h"
+#include "knc_translation_store.h"
+#include "knc_instruction_translator.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+static std::string cache_path(const char* name) {
+    return "/tmp/knc_test_" + std::to_string(getpid()) + "_" + name + ".ktc";
+}
+
+static knc_translation_cache_key_t make_key(uint64_t binary_hash) {
+    knc_translation_cache_key_t key;
+    memset(&key, 0, sizeof(key));
+    key.binary_hash = binary_hash;
+    key.binary_size = 4096;
+    key.translator_version = KNC_TRANSLATOR_VERSION;
+    key.architecture = ARCH_KNC;
+    return key;
+}
+
+static bool same_instruction(const knc_decoded_instruction_t& a, const knc_decoded_instruction_t& b) {
+    return a.address == b.address && a.immediate == b.immediate && a.op == b.op && a.flags == b.flags &&
+           a.length == b.length && a.operand_size == b.operand_size && a.dst == b.dst && a.src == b.src &&
+           a.src2 == b.src2 && a.mask == b.mask && a.condition == b.condition &&
+           a.conversion == b.conversion && memcmp(&a.memory, &b.memory, sizeof(a.memory)) == 0;
+}
+
+static void test_write_and_open() {
+    std::string path = cache_path("direct");
+    knc_translation_cache_key_t key = make_key(0x1234);
+
+    std::vector<knc_cached_block_t> blocks;
+    std::vector<knc_decoded_instruction_t> instructions;
+    for (uint32_t b = 0; b < 3; b++) {
+        knc_cached_block_t block;
+        memset(&block, 0, sizeof(block));
+        block.start_address = 0x1000 + b * 0x100;
+        block.first_instruction = static_cast<uint32_t>(instructions.size());
+        block.instruction_count = b + 1;
+        uint64_t address = block.start_address;
+        for (uint32_t i = 0; i < block.instruction_count; i++) {
+            knc_decoded_instruction_t inst;
+            memset(&inst, 0, sizeof(inst));
+            inst.address = address;
+            inst.immediate = -static_cast<int64_t>(b * 16 + i);
+            inst.op = KNC_OP_ADD;
+            inst.length = 3;
+            inst.operand_size = 8;
+            inst.dst = static_cast<uint8_t>(i);
+            inst.src = static_cast<uint8_t>(b);
+            instructions.push_back(inst);
+            address += inst.length;
+        }
+        block.end_address = address;
+        block.code_hash = 0xabcd0000 + b;
+        blocks.push_back(block);
+    }
+    KNC_CHECK(KNCTranslationStore::write(path, key, blocks, instructions));
+
+    KNCTranslationStore store;
+    KNC_CHECK(store.open(path, key));
+    KNC_CHECK_EQ(store.get_block_count(), blocks.size());
+    for (const knc_cached_block_t& block : blocks) {
+        const knc_cached_block_t* stored = store.find_block(block.start_address);
+        KNC_CHECK(stored != nullptr);
+        if (!stored) {
+            continue;
+        }
+        KNC_CHECK_EQ(stored->end_address, block.end_address);
+        KNC_CHECK_EQ(stored->code_hash, block.code_hash);
+        KNC_CHECK_EQ(stored->instruction_count, block.instruction_count);
+        const knc_decoded_instruction_t* records = store.get_instructions(*stored);
+        for (uint32_t i = 0; i < block.instruction_count; i++) {
+            KNC_CHECK(same_instruction(records[i], instructions[block.first_instruction + i]));
+        }
+    }
+    KNC_CHECK(store.find_block(0x1080) == nullptr);
+    store.close();
+
+    // Another binary, translator version or architecture
+    KNC_CHECK(!store.open(path, make_key(0x4321)));
+    knc_translation_cache_key_t other = key;
+    other.translator_version = KNC_TRANSLATOR_VERSION + 1;
+    KNC_CHECK(!store.open(path, other));
+    other = key;
+    other.architecture = ARCH_KNL;
+    KNC_CHECK(!store.open(path, other));
+
+    // A flipped payload byte and a truncated file
+    std::vector<char> contents;
+    {
+        std::ifstream in(path, std::ios::binary);
+        contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    KNC_CHECK(contents.size() > 64);
+    std::vector<char> damaged = contents;
+    damaged[damaged.size() - 5] ^= 0x40;
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(damaged.data(), damaged.size());
+    KNC_CHECK(!store.open(path, key));
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(contents.data(), contents.size() - 8);
+    KNC_CHECK(!store.open(path, key));
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(contents.data(), contents.size());
+    KNC_CHECK(store.open(path, key));
+    store.close();
+
+    remove(path.c_str());
+    KNC_CHECK(!store.open(path, key));
+}
+
+static void test_pretranslated_blocks() {
+    std::string path = cache_path("pretranslate");
+    knc_translation_cache_key_t key = make_key(0x5678);
+
+    // 0: mov ecx, 10          5: add rax, rcx       8: dec ecx
+    // a: jnz 5                c: movzx edx, al      f: cmp edx, 3
+    // 12: je 17               14: shl rdx, 2        17: hlt
+    const uint8_t code[] = {0xb9, 0x0a, 0x00, 0x00, 0x00, 0x48, 0x01, 0xc8, 0xff, 0xc9, 0x75, 0xf9,
+                            0x0f, 0xb6, 0xd0, 0x83, 0xfa, 0x03, 0x74, 0x03, 0x48, 0xc1, 0xe2, 0x02,
+                            0xf4};
+
+    std::vector<knc_translated_block_t*> written;
+    std::vector<std::vector<knc_decoded_instruction_t>> expected;
+    {
+        KNCInstructionTranslator translator;
+        translator.initialize();
+        KNC_CHECK(!translator.open_persistent_cache(path, key));  // No file yet
+        written = translator.pretranslate(0, code, sizeof(code), std::vector<uint64_t>(1, 0), 2);
+        KNC_CHECK(written.size() >= 3);
+        for (knc_translated_block_t* block : written) {
+            expected.push_back(block->instructions);
+        }
+        translator.close_persistent_cache();
+    }
+
+    KNCTranslationStore store;
+    KNC_CHECK(store.open(path, key));
+    KNC_CHECK_EQ(store.get_block_count(), expected.size());
+    for (const std::vector<knc_decoded_instruction_t>& instructions : expected) {
+        const knc_cached_block_t* stored = store.find_block(instructions.front().address);
+        KNC_CHECK(stored != nullptr);
+        if (!stored) {
+            continue;
+        }
+        KNC_CHECK_EQ(stored->instruction_count, instructions.size());
+        KNC_CHECK_EQ(stored->code_hash, knc_hash_bytes(code + stored->start_address,
+                                                       stored->end_address - stored->start_address));
+        const knc_decoded_instruction_t* records = store.get_instructions(*stored);
+        for (size_t i = 0; i < instructions.size(); i++) {
+            KNC_CHECK(records[i].handler == nullptr);
+            KNC_CHECK(same_instruction(records[i], instructions[i]));
+        }
+    }
+    store.close();
+
+    // A second translator serves the same blocks from the file
+    {
+        KNCInstructionTranslator translator;
+        translator.initialize();
+        KNC_CHECK(translator.open_persistent_cache(path, key));
+        for (const std::vector<knc_decoded_instruction_t>& instructions : expected) {
+            uint64_t start = instructions.front().address;
+            knc_translated_block_t* block = translator.translate_block(start, code + start, sizeof(code) - start);
+            KNC_CHECK(block != nullptr);
+            if (!block) {
+                continue;
+            }
+            KNC_CHECK_EQ(block->instructions.size(), instructions.size());
+            for (size_t i = 0; i < instructions.size() && i < block->instructions.size(); i++) {
+                KNC_CHECK(same_instruction(block->instructions[i], instructions[i]));
+            }
+        }
+        translator.close_persistent_cache();
+    }
+
+    remove(path.c_str());
+}
+
+int main() {
+    test_write_and_open();
+    test_pretranslated_blocks();
+    return knc_test_result("test_translation_store");
+}